@@ -135,5 +135,6 @@ struct lnet_debugfs_symlink_def {
 
 void lnet_insert_debugfs(struct ctl_table *table,
 			 const struct lnet_debugfs_symlink_def *symlinks);
+void lnet_remove_debugfs(struct ctl_table *table);
 
 #endif /* _LIBCFS_LIBCFS_H_ */
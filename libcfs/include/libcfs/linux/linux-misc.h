@@ -153,4 +153,11 @@ static inline int kstrtoul(const char *s, unsigned int base, unsigned long *res)
 }
 #endif /* !HAVE_KSTRTOUL */
 
+#ifndef READ_ONCE
+#define READ_ONCE(var)		ACCESS_ONCE(var)
+#endif
+#ifndef WRITE_ONCE
+#define WRITE_ONCE(var, val)	(ACCESS_ONCE(var) = (val))
+#endif
+
 #endif
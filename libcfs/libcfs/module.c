@@ -600,7 +600,29 @@ void lnet_insert_debugfs(struct ctl_table *table,
 }
 EXPORT_SYMBOL_GPL(lnet_insert_debugfs);
 
-static void lnet_remove_debugfs(void)
+/* Modules that may be unloaded before libcfs must remove the entries they
+ * inserted, or reads would call into code that is gone */
+void lnet_remove_debugfs(struct ctl_table *table)
+{
+	if (IS_ERR_OR_NULL(lnet_debugfs_root))
+		return;
+
+	for (; table && table->procname; table++) {
+		struct qstr dname = QSTR_INIT(table->procname,
+					      strlen(table->procname));
+		struct dentry *dentry;
+
+		dentry = d_hash_and_lookup(lnet_debugfs_root, &dname);
+		if (IS_ERR_OR_NULL(dentry))
+			continue;
+
+		debugfs_remove(dentry);
+		dput(dentry);
+	}
+}
+EXPORT_SYMBOL_GPL(lnet_remove_debugfs);
+
+static void lnet_debugfs_fini(void)
 {
 	debugfs_remove_recursive(lnet_debugfs_root);
 
@@ -667,7 +689,7 @@ static void __exit libcfs_exit(void)
 {
 	int rc;
 
-	lnet_remove_debugfs();
+	lnet_debugfs_fini();
 
 	CDEBUG(D_MALLOC, "before Portals cleanup: kmem %d\n",
 	       atomic_read(&libcfs_kmemory));
@@ -702,6 +702,23 @@ sock_create_kern_net, [
 EXTRA_KCFLAGS="$tmp_flags"
 ]) # LN_CONFIG_SOCK_CREATE_KERN
 
+#
+# LN_CONFIG_SK_BUSY_LOOP
+#
+# 3.11 added net/busy_poll.h and sk_busy_loop() for NAPI busy polling
+#
+AC_DEFUN([LN_CONFIG_SK_BUSY_LOOP], [
+LB_CHECK_COMPILE([if Linux kernel has 'sk_busy_loop'],
+sk_busy_loop, [
+	#include <net/busy_poll.h>
+],[
+	sk_busy_loop((struct sock *)0, 1);
+],[
+	AC_DEFINE(HAVE_SK_BUSY_LOOP, 1,
+		[kernel has sk_busy_loop])
+])
+]) # LN_CONFIG_SK_BUSY_LOOP
+
 #
 # LN_CONFIG_SK_DATA_READY
 #
@@ -774,6 +791,8 @@ LN_CONFIG_SK_SLEEP
 LN_CONFIG_TCP_SENDPAGE
 # 3.10
 LN_EXPORT_KMAP_TO_PAGE
+# 3.11
+LN_CONFIG_SK_BUSY_LOOP
 # 3.15
 LN_CONFIG_SK_DATA_READY
 # 4.x
@@ -189,6 +189,11 @@ extern struct kmem_cache *lnet_mes_cachep;	 /* MEs kmem_cache */
 extern struct kmem_cache *lnet_small_mds_cachep; /* <= LNET_SMALL_MD_SIZE bytes
 						  * MDs kmem_cache */
 
+void *lnet_obj_pool_get(enum lnet_pool_type type);
+bool lnet_obj_pool_put(enum lnet_pool_type type, void *obj);
+void lnet_obj_pools_resize(void);
+void lnet_obj_pools_counters(struct lnet_pool_counters *pc);
+
 static inline struct lnet_eq *
 lnet_eq_alloc (void)
 {
@@ -221,8 +226,10 @@ lnet_md_alloc(struct lnet_md *umd)
 	}
 
 	if (size <= LNET_SMALL_MD_SIZE) {
-		md = kmem_cache_alloc(lnet_small_mds_cachep,
-				      GFP_NOFS | __GFP_ZERO);
+		md = lnet_obj_pool_get(LNET_POOL_MD);
+		if (md == NULL)
+			md = kmem_cache_alloc(lnet_small_mds_cachep,
+					      GFP_NOFS | __GFP_ZERO);
 		if (md) {
 			CDEBUG(D_MALLOC, "slab-alloced 'md' of size %u at "
 			       "%p.\n", size, md);
@@ -256,6 +263,8 @@ lnet_md_free(struct lnet_libmd *md)
 		size = offsetof(struct lnet_libmd, md_iov.iov[md->md_niov]);
 
 	if (size <= LNET_SMALL_MD_SIZE) {
+		if (lnet_obj_pool_put(LNET_POOL_MD, md))
+			return;
 		CDEBUG(D_MALLOC, "slab-freed 'md' at %p.\n", md);
 		kmem_cache_free(lnet_small_mds_cachep, md);
 	} else {
@@ -268,7 +277,9 @@ lnet_me_alloc (void)
 {
 	struct lnet_me *me;
 
-	me = kmem_cache_alloc(lnet_mes_cachep, GFP_NOFS | __GFP_ZERO);
+	me = lnet_obj_pool_get(LNET_POOL_ME);
+	if (me == NULL)
+		me = kmem_cache_alloc(lnet_mes_cachep, GFP_NOFS | __GFP_ZERO);
 
 	if (me)
 		CDEBUG(D_MALLOC, "slab-alloced 'me' at %p.\n", me);
@@ -281,6 +292,8 @@ lnet_me_alloc (void)
 static inline void
 lnet_me_free(struct lnet_me *me)
 {
+	if (lnet_obj_pool_put(LNET_POOL_ME, me))
+		return;
 	CDEBUG(D_MALLOC, "slab-freed 'me' at %p.\n", me);
 	kmem_cache_free(lnet_mes_cachep, me);
 }
@@ -476,7 +489,10 @@ lnet_msg_alloc(void)
 {
 	struct lnet_msg *msg;
 
-	LIBCFS_ALLOC(msg, sizeof(*msg));
+	/* pooled msgs are zeroed too */
+	msg = lnet_obj_pool_get(LNET_POOL_MSG);
+	if (msg == NULL)
+		LIBCFS_ALLOC(msg, sizeof(*msg));
 
 	/* no need to zero, LIBCFS_ALLOC does for us */
 	return (msg);
@@ -486,9 +502,41 @@ static inline void
 lnet_msg_free(struct lnet_msg *msg)
 {
 	LASSERT(!msg->msg_onactivelist);
+	if (lnet_obj_pool_put(LNET_POOL_MSG, msg))
+		return;
 	LIBCFS_FREE(msg, sizeof(*msg));
 }
 
+#define LNET_BUNDLE_SIZE(nob)	offsetof(struct lnet_msg_bundle, mb_data[nob])
+
+static inline struct lnet_msg_bundle *
+lnet_msg_bundle_alloc(unsigned int nob)
+{
+	struct lnet_msg_bundle *mb;
+
+	LIBCFS_ALLOC(mb, LNET_BUNDLE_SIZE(nob));
+	if (mb == NULL)
+		return NULL;
+
+	atomic_set(&mb->mb_refcount, 1);
+	INIT_LIST_HEAD(&mb->mb_msgs);
+	mb->mb_size = nob;
+	mb->mb_iov.iov_base = mb->mb_data;
+	mb->mb_iov.iov_len = nob;
+	return mb;
+}
+
+static inline void
+lnet_msg_bundle_decref(struct lnet_msg_bundle *mb)
+{
+	LASSERT(atomic_read(&mb->mb_refcount) > 0);
+	if (!atomic_dec_and_test(&mb->mb_refcount))
+		return;
+
+	LASSERT(list_empty(&mb->mb_msgs));
+	LIBCFS_FREE(mb, LNET_BUNDLE_SIZE(mb->mb_size));
+}
+
 void lnet_ni_free(struct lnet_ni *ni);
 void lnet_net_free(struct lnet_net *net);
 
@@ -533,6 +581,11 @@ int lnet_lib_init(void);
 void lnet_lib_exit(void);
 
 extern unsigned int lnet_numa_range;
+extern unsigned int lnet_health_sensitivity;
+extern unsigned int lnet_recovery_interval;
+extern unsigned int lnet_retry_count;
+extern unsigned int lnet_transaction_timeout;
+extern unsigned int lnet_coalesce_size;
 extern unsigned int lnet_peer_discovery_disabled;
 extern int portal_rotor;
 
@@ -569,6 +622,8 @@ extern int libcfs_ioctl_getdata(struct libcfs_ioctl_hdr **hdr_pp,
 				struct libcfs_ioctl_hdr __user *uparam);
 extern int lnet_get_peer_list(__u32 *countp, __u32 *sizep,
 			      lnet_process_id_t __user *ids);
+int lnet_get_peer_ni_stats_bulk(__u32 *countp, __u32 *sizep,
+				struct lnet_ioctl_stats_rec __user *recs);
 
 void lnet_router_debugfs_init(void);
 void lnet_router_debugfs_fini(void);
@@ -603,6 +658,26 @@ void lnet_prep_send(struct lnet_msg *msg, int type,
 		    unsigned int len);
 int lnet_send(lnet_nid_t nid, struct lnet_msg *msg, lnet_nid_t rtr_nid);
 void lnet_return_tx_credits_locked(struct lnet_msg *msg);
+
+int lnet_path_caches_create(void);
+void lnet_path_caches_destroy(void);
+void lnet_path_cache_flush_locked(void);
+void lnet_path_cache_flush_peer_ni_locked(struct lnet_peer_ni *lpni);
+void lnet_path_cache_counters(__u64 *hits, __u64 *misses);
+
+/*
+ * Anything which may change the result of lnet_select_pathway() for a
+ * cached path must call this: NI or peer NI addition, discovery, preferred
+ * NIDs, aliveness and health changes. Stale entries keep their references
+ * until they are replaced, so removing an NI or a peer NI must flush them
+ * with lnet_path_cache_flush_locked() or
+ * lnet_path_cache_flush_peer_ni_locked() instead.
+ */
+static inline void
+lnet_path_cache_invalidate(void)
+{
+	atomic_inc(&the_lnet.ln_path_gen);
+}
 void lnet_return_rx_credits_locked(struct lnet_msg *msg);
 void lnet_schedule_blocked_locked(struct lnet_rtrbufpool *rbp);
 void lnet_drop_routed_msgs_locked(struct list_head *list, int cpt);
@@ -648,6 +723,10 @@ struct lnet_match_table *lnet_mt_of_attach(unsigned int index,
 					   enum lnet_ins_pos pos);
 int lnet_mt_match_md(struct lnet_match_table *mtable,
 		     struct lnet_match_info *info, struct lnet_msg *msg);
+void lnet_mt_mask_add(struct lnet_match_table *mtable, struct lnet_me *me,
+		      enum lnet_ins_pos pos);
+void lnet_mt_mask_del(struct lnet_me *me);
+void lnet_mt_match_counters(__u64 *nmatch, __u64 *nscan, int *nmasks_off);
 
 /* portals match/attach functions */
 void lnet_ptl_attach_md(struct lnet_me *me, struct lnet_libmd *md,
@@ -663,6 +742,7 @@ void lnet_portals_destroy(void);
 int lnet_parse(struct lnet_ni *ni, struct lnet_hdr *hdr,
 	       lnet_nid_t fromnid, void *private, int rdma_req);
 int lnet_parse_local(struct lnet_ni *ni, struct lnet_msg *msg);
+int lnet_parse_loopback(struct lnet_ni *ni, struct lnet_msg *sendmsg);
 int lnet_parse_forward_locked(struct lnet_ni *ni, struct lnet_msg *msg);
 
 void lnet_recv(struct lnet_ni *ni, void *private, struct lnet_msg *msg,
@@ -678,9 +758,12 @@ void lnet_set_reply_msg_len(struct lnet_ni *ni, struct lnet_msg *msg,
 			    unsigned int len);
 
 void lnet_finalize(struct lnet_msg *msg, int rc);
+bool lnet_msg_resend_queued(void);
+void lnet_msg_resend_pending(bool stopping);
 
 void lnet_drop_message(struct lnet_ni *ni, int cpt, void *private,
 		       unsigned int nob, __u32 msg_type);
+void lnet_unpack_bundle(struct lnet_msg *msg);
 void lnet_drop_delayed_msg_list(struct list_head *head, char *reason);
 void lnet_recv_delayed_msg_list(struct list_head *head);
 
@@ -700,6 +783,7 @@ int lnet_fault_init(void);
 void lnet_fault_fini(void);
 
 bool lnet_drop_rule_match(struct lnet_hdr *hdr);
+int lnet_drop_rule_error(struct lnet_hdr *hdr);
 
 int lnet_delay_rule_add(struct lnet_fault_attr *attr);
 int lnet_delay_rule_del(lnet_nid_t src, lnet_nid_t dst, bool shutdown);
@@ -909,6 +993,43 @@ lnet_set_peer_ni_health_locked(struct lnet_peer_ni *lpni, bool health)
 	lpni->lpni_healthy = health;
 }
 
+static inline void
+lnet_health_init(struct lnet_health *health)
+{
+	atomic_set(&health->lh_value, LNET_MAX_HEALTH_VALUE);
+	health->lh_stamp = ktime_get_seconds();
+}
+
+/*
+ * Current health of a local or peer NI. An interface recovers
+ * lnet_health_sensitivity for every lnet_recovery_interval seconds
+ * spent without failure, so that it gets traffic again after a while.
+ */
+static inline int
+lnet_health_read(struct lnet_health *health)
+{
+	int value = atomic_read(&health->lh_value);
+	long steps;
+
+	if (value >= LNET_MAX_HEALTH_VALUE || lnet_recovery_interval == 0)
+		return value;
+
+	steps = (long)(ktime_get_seconds() - health->lh_stamp) /
+		lnet_recovery_interval;
+	if (steps >= LNET_MAX_HEALTH_VALUE)
+		return LNET_MAX_HEALTH_VALUE;
+
+	return min_t(long, LNET_MAX_HEALTH_VALUE,
+		     value + steps * lnet_health_sensitivity);
+}
+
+void lnet_health_update(struct lnet_health *health, int delta);
+
+/* side of a path a send error is blamed on */
+#define LNET_HEALTH_ERR_LOCAL	(1 << 0)
+#define LNET_HEALTH_ERR_REMOTE	(1 << 1)
+unsigned int lnet_health_error_site(int status);
+
 static inline bool
 lnet_is_peer_net_healthy_locked(struct lnet_peer_net *peer_net)
 {
@@ -990,5 +1111,7 @@ __u32 lnet_sum_stats(struct lnet_element_stats *stats,
 
 void lnet_usr_translate_stats(struct lnet_ioctl_element_msg_stats *msg_stats,
 			      struct lnet_element_stats *stats);
+void lnet_usr_stats_rec(struct lnet_ioctl_stats_rec *rec, lnet_nid_t nid,
+			struct lnet_element_stats *stats);
 
 #endif
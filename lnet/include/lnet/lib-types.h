@@ -63,6 +63,7 @@
 
 /* forward refs */
 struct lnet_libmd;
+struct lnet_msg_bundle;
 
 typedef struct lnet_msg {
 	struct list_head	msg_activelist;
@@ -109,6 +110,16 @@ typedef struct lnet_msg {
 	unsigned int          msg_peerrtrcredit:1; /* taken a peer router credit */
 	unsigned int          msg_onactivelist:1; /* on the activelist */
 	unsigned int	      msg_rdma_get:1;
+	/* carries a bundle of small PUTs, see lnet_msg_bundle */
+	unsigned int	      msg_bundle_wire:1;
+	/* PUT unpacked from msg_bundle, its payload is copied from there */
+	unsigned int	      msg_unbundled:1;
+	/* # times this message was resent after a failure */
+	unsigned int	      msg_retry_count:4;
+	/* no resend after this time, seconds */
+	time64_t	      msg_deadline;
+	/* when the message was handed to the LND */
+	ktime_t		      msg_send_time;
 
 	struct lnet_peer_ni  *msg_txpeer;         /* peer I'm sending to */
 	struct lnet_peer_ni  *msg_rxpeer;         /* peer I received from */
@@ -125,11 +136,48 @@ typedef struct lnet_msg {
 	unsigned int          msg_niov;
 	struct kvec	     *msg_iov;
 	lnet_kiov_t          *msg_kiov;
+	/* bundle this message is packed in or was unpacked from */
+	struct lnet_msg_bundle	*msg_bundle;
+	/* offset of the payload in msg_bundle if msg_unbundled */
+	unsigned int		msg_bundle_offset;
 
 	struct lnet_event	msg_ev;
 	struct lnet_hdr		msg_hdr;
 } lnet_msg_t;
 
+/* health of a fully functional local or peer NI */
+#define LNET_MAX_HEALTH_VALUE	1000
+
+struct lnet_health {
+	/* drops on send failures, see lnet_health_read() for recovery */
+	atomic_t		lh_value;
+	/* last time lh_value was updated, seconds */
+	time64_t		lh_stamp;
+};
+
+/* entries in each per-CPT path cache */
+#define LNET_PATH_CACHE_BITS	8
+#define LNET_PATH_CACHE_SIZE	(1 << LNET_PATH_CACHE_BITS)
+
+/* a path chosen by lnet_select_pathway(), see lnet_path_cache_lookup() */
+struct lnet_path_entry {
+	lnet_nid_t		pe_src_nid;
+	lnet_nid_t		pe_dst_nid;
+	lnet_nid_t		pe_rtr_nid;
+	/* the_lnet.ln_path_gen when this entry was filled */
+	unsigned int		pe_gen;
+	/* local NI and peer NI to use, a reference is held on both */
+	struct lnet_ni		*pe_ni;
+	struct lnet_peer_ni	*pe_lpni;
+};
+
+/* protected by the lnet_net_lock of its CPT */
+struct lnet_path_cache {
+	struct lnet_path_entry	pc_entries[LNET_PATH_CACHE_SIZE];
+	__u64			pc_hits;
+	__u64			pc_misses;
+};
+
 typedef struct lnet_libhandle {
 	struct list_head	lh_hash_chain;
 	__u64			lh_cookie;
@@ -149,6 +197,8 @@ typedef struct lnet_eq {
 	int			**eq_refs;	/* percpt refcount for EQ */
 } lnet_eq_t;
 
+struct lnet_mt_mask;
+
 typedef struct lnet_me {
 	struct list_head	me_list;
 	struct lnet_libhandle	me_lh;
@@ -159,6 +209,13 @@ typedef struct lnet_me {
 	__u64			me_ignore_bits;
 	enum lnet_unlink	me_unlink;
 	struct lnet_libmd      *me_md;
+	/* ignore-bits index entry, see lnet_mt_match_masks() */
+	struct lnet_mt_mask    *me_mask;
+	struct list_head	me_mask_list;
+	/* list order of this ME in its match table */
+	__s64			me_seq;
+	/* an unexhausted MD is attached, counted in mm_live */
+	unsigned int		me_live:1;
 } lnet_me_t;
 
 typedef struct lnet_libmd {
@@ -342,6 +399,9 @@ struct lnet_net {
 	 */
 	bool			net_tunables_set;
 
+	/* peer NI selection policy, enum lnet_sel_policy */
+	__u32			net_sel_policy;
+
 	/* procedural interface */
 	struct lnet_lnd		*net_lnd;
 
@@ -397,6 +457,9 @@ typedef struct lnet_ni {
 	/* my health status */
 	struct lnet_ni_status	*ni_status;
 
+	/* health of this NI, lowered by local send failures */
+	struct lnet_health	ni_health;
+
 	/* NI FSM */
 	enum lnet_ni_state	ni_state;
 
@@ -424,6 +487,29 @@ typedef struct lnet_ni {
 } lnet_ni_t;
 
 #define LNET_PROTO_PING_MATCHBITS	0x8000000000000000LL
+/* PUT on LNET_RESERVED_PORTAL whose payload is a bundle of small PUTs */
+#define LNET_PROTO_BUNDLE_MATCHBITS	0x4000000000000000LL
+
+/*
+ * Small PUTs queued for the same peer NI while its credits are exhausted
+ * are sent as one message, see lnet_post_bundle_locked().  The payload of
+ * the carrier is a sequence of records, each the wire header of one PUT
+ * followed by its payload padded to LNET_BUNDLE_ALIGN, and the carrier's
+ * hdr_data holds the number of records.  The receiver unpacks the records
+ * in lnet_parse_bundle() and parses each as if it had arrived on its own
+ * on the NI the carrier arrived on, see lnet_unpack_bundle().
+ */
+#define LNET_BUNDLE_ALIGN		8
+#define LNET_BUNDLE_MAX_MSGS		64
+
+struct lnet_msg_bundle {
+	atomic_t		mb_refcount;
+	/* sender: the PUTs packed in this bundle */
+	struct list_head	mb_msgs;
+	unsigned int		mb_size;
+	struct kvec		mb_iov;
+	char			mb_data[0];
+};
 
 /*
  * Descriptor of a ping info buffer: keep a separate indicator of the
@@ -524,6 +610,14 @@ struct lnet_peer_ni {
 	__u32			lpni_gw_seq;
 	/* health flag */
 	bool			lpni_healthy;
+	/* health of this peer NI, lowered by remote send failures */
+	struct lnet_health	lpni_health;
+	/* smoothed send completion latency, microseconds.
+	 * Protected with lpni_lock */
+	unsigned long		lpni_latency_us;
+	/* virtual clock for latency-weighted selection, microseconds.
+	 * Protected with lpni_lock */
+	__u64			lpni_sel_vtime;
 	/* returned RC ping features. Protected with lpni_lock */
 	unsigned int		lpni_ping_feats;
 	/* routes on this peer */
@@ -657,6 +751,11 @@ struct lnet_peer {
  */
 #define LNET_PEER_FORCE_PING	(1 << 12)	/* Forced Ping */
 #define LNET_PEER_FORCE_PUSH	(1 << 13)	/* Forced Push */
+/*
+ * A peer is marked COALESCE if the LNET_PING_FEAT_COALESCE bit was set,
+ * so it can be sent bundles of small PUTs.
+ */
+#define LNET_PEER_COALESCE	(1 << 14)	/* Unpacks PUT bundles */
 
 struct lnet_peer_net {
 	/* chain on lp_peer_nets */
@@ -743,6 +842,14 @@ typedef struct lnet_remotenet {
 /** lnet message is waiting for discovery */
 #define LNET_DC_WAIT		2
 
+/* # of auto-sizing passes remembered by each router buffer pool */
+#define LNET_RTRPOOL_HIST	16
+
+struct lnet_rtrpool_sample {
+	int			rs_nbuffers;	/* pool size */
+	int			rs_mincredits;	/* low water mark */
+};
+
 typedef struct lnet_rtrbufpool {
 	/* my free buffer pool */
 	struct list_head	rbp_bufs;
@@ -758,6 +865,13 @@ typedef struct lnet_rtrbufpool {
 	int			rbp_credits;
 	/* low water mark */
 	int			rbp_mincredits;
+	/* low water mark since the last auto-sizing pass */
+	int			rbp_win_mincredits;
+	/* # consecutive auto-sizing passes with idle buffers */
+	int			rbp_idle_passes;
+	/* recent auto-sizing passes, rbp_hist_idx is the next slot */
+	struct lnet_rtrpool_sample rbp_hist[LNET_RTRPOOL_HIST];
+	unsigned int		rbp_hist_idx;
 } lnet_rtrbufpool_t;
 
 typedef struct lnet_rtrbuf {
@@ -811,6 +925,22 @@ struct lnet_match_info {
 #define LNET_MT_EXHAUSTED_BITS		(LNET_MT_HASH_BITS - LNET_MT_BITS_U64)
 #define LNET_MT_EXHAUSTED_BMAP		((1 << LNET_MT_EXHAUSTED_BITS) + 1)
 
+/* MEs with ignore-bits are also indexed by their mask: MEs sharing a mask
+ * are hashed on the bits they do not ignore */
+#define LNET_MT_MASK_HASH_BITS		6
+#define LNET_MT_MASK_HASH_SIZE		(1 << LNET_MT_MASK_HASH_BITS)
+/* most distinct masks indexed in one match table */
+#define LNET_MT_MASKS_MAX		16
+
+struct lnet_mt_mask {
+	struct list_head	mm_link;	/* chain on mt_masks */
+	struct lnet_match_table	*mm_mtable;	/* owning match table */
+	__u64			mm_ignore_bits;
+	int			mm_count;	/* # MEs */
+	int			mm_live;	/* # MEs with unexhausted MD */
+	struct list_head	mm_hash[LNET_MT_MASK_HASH_SIZE];
+};
+
 /* portal match table */
 struct lnet_match_table {
 	/* reserved for upcoming patches, CPU partition ID */
@@ -822,6 +952,18 @@ struct lnet_match_table {
 	/* bitmap to flag whether MEs on mt_hash are exhausted or not */
 	__u64			mt_exhausted[LNET_MT_EXHAUSTED_BMAP];
 	struct list_head	*mt_mhash;	/* matching hash */
+	/* index of mt_mhash[LNET_MT_HASH_IGNORE] by ignore-bits mask */
+	struct list_head	mt_masks;
+	int			mt_nmasks;
+	/* index unusable (ME inserted out of order, too many masks...),
+	 * mt_mhash[LNET_MT_HASH_IGNORE] is scanned instead */
+	unsigned int		mt_masks_off;
+	/* me_seq of the first and last ME */
+	__s64			mt_seq_head;
+	__s64			mt_seq_tail;
+	/* # of match attempts and # of MEs they examined */
+	__u64			mt_nmatch;
+	__u64			mt_nscan;
 };
 
 /* these are only useful for wildcard portal */
@@ -873,10 +1015,26 @@ struct lnet_msg_container {
 	/* msgs waiting to complete finalizing */
 	struct list_head	msc_finalizing;
 	struct list_head	msc_active;	/* active message list */
+	/* failed msgs waiting for the router checker to resend them */
+	struct list_head	msc_resending;
 	/* threads doing finalization */
 	void			**msc_finalizers;
 };
 
+/*
+ * Free-list of one descriptor type on one CPT. Freed objects are kept
+ * here, linked through their first bytes, up to op_max so that steady
+ * state messaging does not go to the slab.
+ */
+struct lnet_obj_pool {
+	spinlock_t		op_lock;
+	struct list_head	op_free;	/* pooled objects */
+	int			op_nfree;	/* # pooled objects */
+	int			op_max;		/* most objects to pool */
+	__u64			op_hits;
+	__u64			op_misses;
+};
+
 /* Peer Discovery states */
 #define LNET_DC_STATE_SHUTDOWN		0	/* not started */
 #define LNET_DC_STATE_RUNNING		1	/* started up OK */
@@ -940,6 +1098,14 @@ typedef struct lnet {
 	/* spin lock to protect the msg resend list */
 	spinlock_t			ln_msg_resend_lock;
 
+	/* per-CPT caches of selected paths */
+	struct lnet_path_cache		**ln_path_caches;
+	/* bumped to invalidate all cached paths */
+	atomic_t			ln_path_gen;
+
+	/* percpt free-lists of msgs, small MDs and MEs */
+	struct lnet_obj_pool		**ln_obj_pools[LNET_POOL_MAX];
+
 	/* remote networks with routes to them */
 	struct list_head		*ln_remote_nets_hash;
 	/* validity stamp */
@@ -244,9 +244,80 @@ struct lnet_ioctl_set_value {
 	__u32 sv_value;
 };
 
+/* how a peer NI is picked among those of a peer on a net */
+enum lnet_sel_policy {
+	/* most available credits, then round-robin */
+	LNET_SEL_POLICY_CREDITS	= 0,
+	/* weighted by the measured completion latency of each peer NI */
+	LNET_SEL_POLICY_LATENCY	= 1,
+	LNET_SEL_POLICY_MAX,
+};
+
+struct lnet_ioctl_net_sel_policy {
+	struct libcfs_ioctl_hdr sp_hdr;
+	__u32 sp_net;
+	__u32 sp_policy;
+};
+
+/* per-CPT free-lists of LNet descriptors */
+enum lnet_pool_type {
+	LNET_POOL_MSG	= 0,
+	LNET_POOL_MD	= 1,	/* small MDs only */
+	LNET_POOL_ME	= 2,
+	LNET_POOL_MAX
+};
+
+struct lnet_pool_counters {
+	__u64 pc_hits;		/* allocations served from the pool */
+	__u64 pc_misses;	/* allocations that went to the slab */
+	__u32 pc_free;		/* objects currently pooled */
+	__u32 pc_max;		/* most objects pooled */
+};
+
 struct lnet_ioctl_lnet_stats {
 	struct libcfs_ioctl_hdr st_hdr;
 	struct lnet_counters st_cntrs;
+	/* added later, only filled in if st_hdr.ioc_len covers it */
+	struct lnet_pool_counters st_pools[LNET_POOL_MAX];
+};
+
+/* elements whose counters IOC_LIBCFS_GET_STATS_BULK returns */
+enum lnet_stats_bulk_type {
+	LNET_STATS_BULK_NI	= 0,	/* local NIs */
+	LNET_STATS_BULK_PEER_NI	= 1,	/* peer NIs */
+	LNET_STATS_BULK_MAX
+};
+
+/*
+ * Counters of one NI or peer NI, in a layout that doesn't change so that
+ * monitoring tools can sample thousands of them cheaply.  For a local NI
+ * the credits are summed over its CPTs and the low water mark is that of
+ * its busiest CPT, and it has no router credits.  A queue is as long as
+ * its credits are negative.
+ */
+struct lnet_ioctl_stats_rec {
+	lnet_nid_t			isr_nid;
+	struct lnet_ioctl_comm_count	isr_send;
+	struct lnet_ioctl_comm_count	isr_recv;
+	struct lnet_ioctl_comm_count	isr_drop;
+	__s32				isr_tx_credits;
+	__s32				isr_min_tx_credits;
+	__s32				isr_rtr_credits;
+	__s32				isr_min_rtr_credits;
+	__u32				isr_txq_msgs;	/* waiting for credits */
+	__u32				isr_txq_nob;	/* peer NIs only */
+	__u32				isr_health;	/* out of 1000 */
+	__u32				isr_pad;
+};
+
+struct lnet_ioctl_stats_bulk {
+	struct libcfs_ioctl_hdr sb_hdr;
+	__u32 sb_type;		/* enum lnet_stats_bulk_type */
+	__u32 sb_count;		/* out: # of records */
+	__u32 sb_size;		/* in: bytes at sb_bulk, out: bytes needed */
+	__u32 sb_pad;
+	__u64 sb_time_ns;	/* out: when sampled, monotonic */
+	void __user *sb_bulk;	/* struct lnet_ioctl_stats_rec[] */
 };
 
 #endif /* _LNET_DLC_H_ */
@@ -257,6 +257,7 @@ struct lnet_ni_status {
 #define LNET_PING_FEAT_RTE_DISABLED	(1 << 2)        /* Routing enabled */
 #define LNET_PING_FEAT_MULTI_RAIL	(1 << 3)        /* Multi-Rail aware */
 #define LNET_PING_FEAT_DISCOVERY	(1 << 4)	/* Supports Discovery */
+#define LNET_PING_FEAT_COALESCE		(1 << 5)	/* Unpacks PUT bundles */
 
 /*
  * All ping feature bits fit to hit the wire.
@@ -270,7 +271,8 @@ struct lnet_ni_status {
 					 LNET_PING_FEAT_NI_STATUS | \
 					 LNET_PING_FEAT_RTE_DISABLED | \
 					 LNET_PING_FEAT_MULTI_RAIL | \
-					 LNET_PING_FEAT_DISCOVERY)
+					 LNET_PING_FEAT_DISCOVERY | \
+					 LNET_PING_FEAT_COALESCE)
 
 struct lnet_ping_info {
 	__u32			pi_magic;
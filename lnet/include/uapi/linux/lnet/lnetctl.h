@@ -51,6 +51,15 @@ enum {
 #define LNET_GET_BIT		(1 << 2)
 #define LNET_REPLY_BIT		(1 << 3)
 
+/** distribution of latency jitter of delay rule */
+enum {
+	LNET_JITTER_UNIFORM	= 0,
+	LNET_JITTER_NORMAL	= 1,
+};
+
+/** max latency jitter of delay rule in milliseconds */
+#define LNET_JITTER_MAX		100000
+
 /** ioctl parameter for LNet fault simulation */
 struct lnet_fault_attr {
 	/**
@@ -88,6 +97,13 @@ struct lnet_fault_attr {
 			 * with da_rate
 			 */
 			__u32			da_interval;
+			/**
+			 * if non-zero, matched messages are not dropped by
+			 * the receiver but fail to send with -da_error on
+			 * the sender, to simulate an interface or peer
+			 * failure
+			 */
+			__u32			da_error;
 		} drop;
 		/** message latency simulation */
 		struct {
@@ -99,6 +115,24 @@ struct lnet_fault_attr {
 			__u32			la_interval;
 			/** latency to delay */
 			__u32			la_latency;
+			/** milliseconds of latency on top of la_latency */
+			__u32			la_latency_ms;
+			/**
+			 * jitter of latency in milliseconds, for uniform
+			 * jitter it's the max deviation, for normal jitter
+			 * it's the standard deviation
+			 */
+			__u32			la_jitter;
+			/** distribution of jitter, LNET_JITTER_* */
+			__u32			la_jitter_dist;
+			/**
+			 * bandwidth cap in KiB/s, 0 means unlimited. It is
+			 * enforced by a token bucket for each (source,
+			 * destination, portal) matched by the rule
+			 */
+			__u32			la_bandwidth;
+			/** depth of token bucket in KiB, 0 for LNET_MTU */
+			__u32			la_burst;
 		} delay;
 		__u64			space[8];
 	} u;
@@ -125,6 +159,8 @@ struct lnet_fault_stat {
 		struct {
 			/** total # delayed messages */
 			__u64			ls_delayed;
+			/** # messages held back by the bandwidth cap */
+			__u64			ls_shaped;
 		} delay;
 		__u64			space[8];
 	} u;
@@ -37,9 +37,12 @@
 
 #define LST_FEAT_NONE		(0)
 #define LST_FEAT_BULK_LEN	(1 << 0)	/* enable variable page size */
+#define LST_FEAT_LAT_STATS	(1 << 1)	/* test RPC latency percentiles */
+#define LST_FEAT_BULK_MIX	(1 << 2)	/* brw sizes drawn from a mix */
 
 #define LST_FEATS_EMPTY		(LST_FEAT_NONE)
-#define LST_FEATS_MASK		(LST_FEAT_NONE | LST_FEAT_BULK_LEN)
+#define LST_FEATS_MASK		(LST_FEAT_NONE | LST_FEAT_BULK_LEN | \
+				 LST_FEAT_LAT_STATS | LST_FEAT_BULK_MIX)
 
 #define LST_NAME_SIZE		32		/* max name buffer length */
 
@@ -425,8 +428,14 @@ struct lstio_stat_args {
 	struct lnet_process_id __user *lstio_sta_idsp;
 	/* OUT: list head of result buffer */
 	struct list_head __user *lstio_sta_resultp;
+	/* IN: type of stat, LST_STAT_* */
+	int			lstio_sta_type;
 };
 
+/* stat types */
+#define LST_STAT_COUNTERS	0	/* framework, RPC and LNet counters */
+#define LST_STAT_LATENCY	1	/* test RPC latency, struct sfw_latency */
+
 enum lst_test_type {
 	LST_TEST_BULK	= 1,
 	LST_TEST_PING	= 2
@@ -475,6 +484,8 @@ enum lst_brw_flags {
 	LST_BRW_CHECK_FULL   = 3
 };
 
+#define LST_BULK_MIX_MAX	4	/* max # of sizes in a brw size mix */
+
 struct lst_test_bulk_param {
 	int blk_opc;		/* bulk operation code */
 	int blk_size;		/* size (bytes) */
@@ -482,6 +493,10 @@ struct lst_test_bulk_param {
 	int blk_flags;		/* reserved flags */
 	int blk_cli_off;	/* bulk offset on client */
 	int blk_srv_off;	/* reserved: bulk offset on server */
+	/* # of entries in the size mix, 0 means every RPC is blk_size */
+	int blk_nmix;
+	int blk_mix_size[LST_BULK_MIX_MAX];	/* sizes (bytes) */
+	int blk_mix_weight[LST_BULK_MIX_MAX];	/* weights (percent) */
 };
 
 struct lst_test_ping_param {
@@ -510,4 +525,15 @@ struct sfw_counters {
 	__u32 ping_errors;
 } WIRE_ATTR;
 
+/** latency of test RPCs completed since the previous latency query */
+struct sfw_latency {
+	__u32 lat_count;	/* # of RPCs sampled */
+	__u32 lat_min_us;
+	__u32 lat_max_us;
+	__u32 lat_avg_us;
+	__u32 lat_p50_us;
+	__u32 lat_p99_us;
+	__u32 lat_p999_us;
+} WIRE_ATTR;
+
 #endif
@@ -81,6 +81,7 @@ ksocknal_create_route(__u32 ipaddr, int port)
         route->ksnr_deleted = 0;
         route->ksnr_conn_count = 0;
         route->ksnr_share_count = 0;
+	memset(route->ksnr_ntype_conns, 0, sizeof(route->ksnr_ntype_conns));
 
         return (route);
 }
@@ -355,6 +356,7 @@ ksocknal_associate_route_conn_locked(struct ksock_route *route, struct ksock_con
         }
 
         route->ksnr_connected |= (1<<type);
+	route->ksnr_ntype_conns[type]++;
         route->ksnr_conn_count++;
 
         /* Successful connection => further attempts can
@@ -1219,9 +1221,15 @@ ksocknal_create_conn(struct lnet_ni *ni, struct ksock_route *route,
                 goto failed_2;
         }
 
-	/* Refuse to duplicate an existing connection, unless this is a
-	 * loopback connection */
+	/* Refuse to duplicate an existing connection beyond the number
+	 * allowed per type, unless this is a loopback connection.  The
+	 * active side sets how many it wants, so passively accept up to
+	 * the maximum in case the peer_ni is configured with more than me */
 	if (conn->ksnc_ipaddr != conn->ksnc_myipaddr) {
+		int nconns = 0;
+		int maxconns = active ? ksocknal_conns_per_peer() :
+				SOCKNAL_CONNS_PER_PEER_MAX;
+
 		list_for_each(tmp, &peer_ni->ksnp_conns) {
 			conn2 = list_entry(tmp, struct ksock_conn, ksnc_list);
 
@@ -1230,6 +1238,9 @@ ksocknal_create_conn(struct lnet_ni *ni, struct ksock_route *route,
                             conn2->ksnc_type != conn->ksnc_type)
                                 continue;
 
+			if (++nconns < maxconns)
+				continue;
+
                         /* Reply on a passive connection attempt so the peer_ni
                          * realises we're connected. */
                         LASSERT (rc == 0);
@@ -1437,8 +1448,6 @@ ksocknal_close_conn_locked(struct ksock_conn *conn, int error)
          * Caller holds ksnd_global_lock exclusively in irq context */
 	struct ksock_peer_ni *peer_ni = conn->ksnc_peer;
 	struct ksock_route *route;
-	struct ksock_conn *conn2;
-	struct list_head *tmp;
 
 	LASSERT(peer_ni->ksnp_error == 0);
 	LASSERT(!conn->ksnc_closing);
@@ -1452,18 +1461,9 @@ ksocknal_close_conn_locked(struct ksock_conn *conn, int error)
 		/* dissociate conn from route... */
 		LASSERT(!route->ksnr_deleted);
 		LASSERT((route->ksnr_connected & (1 << conn->ksnc_type)) != 0);
+		LASSERT(route->ksnr_ntype_conns[conn->ksnc_type] > 0);
 
-		conn2 = NULL;
-		list_for_each(tmp, &peer_ni->ksnp_conns) {
-			conn2 = list_entry(tmp, struct ksock_conn, ksnc_list);
-
-			if (conn2->ksnc_route == route &&
-			    conn2->ksnc_type == conn->ksnc_type)
-				break;
-
-			conn2 = NULL;
-		}
-		if (conn2 == NULL)
+		if (--route->ksnr_ntype_conns[conn->ksnc_type] == 0)
 			route->ksnr_connected &= ~(1 << conn->ksnc_type);
 
 		conn->ksnc_route = NULL;
@@ -2730,7 +2730,8 @@ ksocknal_start_schedulers(struct ksock_sched_info *info)
 			nthrs = cfs_cpt_weight(lnet_cpt_table(),
 					       info->ksi_cpt);
 			nthrs = min(max(SOCKNAL_NSCHEDS, nthrs >> 1), nthrs);
-			nthrs = min(SOCKNAL_NSCHEDS_HIGH, nthrs);
+			nthrs = min(SOCKNAL_NSCHEDS_HIGH *
+				    ksocknal_conns_per_peer(), nthrs);
 		}
 		nthrs = min(nthrs, info->ksi_nthreads_max);
 	} else {
@@ -2897,8 +2898,199 @@ ksocknal_startup(struct lnet_ni *ni)
 }
 
 
+/*
+ * One line per scheduler thread: busy-poll spins and how many of them
+ * found work, time spent spinning, sleeps woken by data_ready and their
+ * mean wakeup latency.  "saved" estimates the latency busy polling took
+ * off the receive path as hits * mean wakeup latency.
+ */
+static int __proc_ksocknal_busy_poll(void *data, int write,
+				     loff_t pos, void __user *buffer,
+				     int nob)
+{
+	struct ksock_sched_info *info;
+	struct ksock_sched *sched;
+	char *s;
+	char *tmpstr;
+	int tmpsiz;
+	int len;
+	int rc;
+	int i;
+	int j;
+
+	LASSERT(!write);
+
+	mutex_lock(&the_lnet.ln_api_mutex);
+
+	tmpsiz = 128;
+	if (ksocknal_data.ksnd_init == SOCKNAL_INIT_ALL) {
+		cfs_percpt_for_each(info, i, ksocknal_data.ksnd_sched_info)
+			tmpsiz += 96 * info->ksi_nthreads;
+	}
+
+	LIBCFS_ALLOC(tmpstr, tmpsiz);
+	if (tmpstr == NULL) {
+		mutex_unlock(&the_lnet.ln_api_mutex);
+		return -ENOMEM;
+	}
+
+	s = tmpstr; /* points to current position in tmpstr[] */
+
+	s += snprintf(s, tmpstr + tmpsiz - s,
+		      "%3s %5s %10s %10s %10s %10s %8s %10s\n",
+		      "cpt", "sched", "polls", "hits", "spin_us", "wakes",
+		      "wake_ns", "saved_us");
+	LASSERT(tmpstr + tmpsiz - s > 0);
+
+	if (ksocknal_data.ksnd_init != SOCKNAL_INIT_ALL)
+		goto out;
+
+	cfs_percpt_for_each(info, i, ksocknal_data.ksnd_sched_info) {
+		for (j = 0; j < info->ksi_nthreads; j++) {
+			__u64 wake_ns = 0;
+
+			sched = &info->ksi_scheds[j];
+
+			spin_lock_bh(&sched->kss_lock);
+			if (sched->kss_nwakes != 0)
+				wake_ns = div64_u64(sched->kss_wake_ns,
+						    sched->kss_nwakes);
+
+			s += snprintf(s, tmpstr + tmpsiz - s,
+				      "%3d %5d %10llu %10llu %10llu %10llu %8llu %10llu\n",
+				      info->ksi_cpt, j, sched->kss_npolls,
+				      sched->kss_poll_hits,
+				      div64_u64(sched->kss_poll_ns, 1000),
+				      sched->kss_nwakes, wake_ns,
+				      div64_u64(sched->kss_poll_hits * wake_ns,
+						1000));
+			spin_unlock_bh(&sched->kss_lock);
+			LASSERT(tmpstr + tmpsiz - s > 0);
+		}
+	}
+
+ out:
+	mutex_unlock(&the_lnet.ln_api_mutex);
+
+	len = s - tmpstr;
+
+	if (pos >= min_t(int, len, strlen(tmpstr)))
+		rc = 0;
+	else
+		rc = cfs_trace_copyout_string(buffer, nob,
+					      tmpstr + pos, NULL);
+
+	LIBCFS_FREE(tmpstr, tmpsiz);
+	return rc;
+}
+
+static int
+proc_ksocknal_busy_poll(struct ctl_table *table, int write,
+			void __user *buffer, size_t *lenp, loff_t *ppos)
+{
+	return lprocfs_call_handler(table->data, write, ppos, buffer, lenp,
+				    __proc_ksocknal_busy_poll);
+}
+
+/*
+ * One line per scheduler thread: sendmsg() calls that carried more than
+ * one tx (tx_batch), the txs they carried, and receives that went
+ * through tcp_read_sock() (rx_direct).
+ */
+static int __proc_ksocknal_batch(void *data, int write,
+				 loff_t pos, void __user *buffer,
+				 int nob)
+{
+	struct ksock_sched_info *info;
+	struct ksock_sched *sched;
+	char *s;
+	char *tmpstr;
+	int tmpsiz;
+	int len;
+	int rc;
+	int i;
+	int j;
+
+	LASSERT(!write);
+
+	mutex_lock(&the_lnet.ln_api_mutex);
+
+	tmpsiz = 64;
+	if (ksocknal_data.ksnd_init == SOCKNAL_INIT_ALL) {
+		cfs_percpt_for_each(info, i, ksocknal_data.ksnd_sched_info)
+			tmpsiz += 64 * info->ksi_nthreads;
+	}
+
+	LIBCFS_ALLOC(tmpstr, tmpsiz);
+	if (tmpstr == NULL) {
+		mutex_unlock(&the_lnet.ln_api_mutex);
+		return -ENOMEM;
+	}
+
+	s = tmpstr; /* points to current position in tmpstr[] */
+
+	s += snprintf(s, tmpstr + tmpsiz - s, "%3s %5s %10s %10s %10s\n",
+		      "cpt", "sched", "batches", "batched", "rx_direct");
+	LASSERT(tmpstr + tmpsiz - s > 0);
+
+	if (ksocknal_data.ksnd_init != SOCKNAL_INIT_ALL)
+		goto out;
+
+	cfs_percpt_for_each(info, i, ksocknal_data.ksnd_sched_info) {
+		for (j = 0; j < info->ksi_nthreads; j++) {
+			sched = &info->ksi_scheds[j];
+
+			s += snprintf(s, tmpstr + tmpsiz - s,
+				      "%3d %5d %10llu %10llu %10llu\n",
+				      info->ksi_cpt, j, sched->kss_tx_batches,
+				      sched->kss_tx_batched,
+				      sched->kss_rx_direct);
+			LASSERT(tmpstr + tmpsiz - s > 0);
+		}
+	}
+
+ out:
+	mutex_unlock(&the_lnet.ln_api_mutex);
+
+	len = s - tmpstr;
+
+	if (pos >= min_t(int, len, strlen(tmpstr)))
+		rc = 0;
+	else
+		rc = cfs_trace_copyout_string(buffer, nob,
+					      tmpstr + pos, NULL);
+
+	LIBCFS_FREE(tmpstr, tmpsiz);
+	return rc;
+}
+
+static int
+proc_ksocknal_batch(struct ctl_table *table, int write,
+		    void __user *buffer, size_t *lenp, loff_t *ppos)
+{
+	return lprocfs_call_handler(table->data, write, ppos, buffer, lenp,
+				    __proc_ksocknal_batch);
+}
+
+static struct ctl_table ksocknal_table[] = {
+	{
+		INIT_CTL_NAME
+		.procname	= "socklnd_busy_poll",
+		.mode		= 0444,
+		.proc_handler	= &proc_ksocknal_busy_poll,
+	},
+	{
+		INIT_CTL_NAME
+		.procname	= "socklnd_batch",
+		.mode		= 0444,
+		.proc_handler	= &proc_ksocknal_batch,
+	},
+	{ 0 }
+};
+
 static void __exit ksocklnd_exit(void)
 {
+	lnet_remove_debugfs(ksocknal_table);
 	lnet_unregister_lnd(&the_ksocklnd);
 }
 
@@ -2926,6 +3118,7 @@ static int __init ksocklnd_init(void)
 		return rc;
 
 	lnet_register_lnd(&the_ksocklnd);
+	lnet_insert_debugfs(ksocknal_table, NULL);
 
 	return 0;
 }
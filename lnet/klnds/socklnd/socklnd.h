@@ -49,6 +49,9 @@
 #include <linux/unistd.h>
 #include <net/sock.h>
 #include <net/tcp.h>
+#ifdef HAVE_SK_BUSY_LOOP
+#include <net/busy_poll.h>
+#endif
 
 #include <libcfs/libcfs.h>
 #include <lnet/lib-lnet.h>
@@ -74,6 +77,7 @@
 #define SOCKNAL_RESCHED         100             /* # scheduler loops before reschedule */
 #define SOCKNAL_INSANITY_RECONN 5000            /* connd is trying on reconn infinitely */
 #define SOCKNAL_ENOMEM_RETRY    1		/* seconds between retries */
+#define SOCKNAL_CONNS_PER_PEER_MAX 16		/* max # conns of a type per route */
 
 #define SOCKNAL_SINGLE_FRAG_TX      0           /* disable multi-fragment sends */
 #define SOCKNAL_SINGLE_FRAG_RX      0           /* disable multi-fragment receives */
@@ -107,6 +111,19 @@ struct ksock_sched {				/* per scheduler state */
 #if !SOCKNAL_SINGLE_FRAG_TX || !SOCKNAL_SINGLE_FRAG_RX
 	struct kvec		kss_scratch_iov[LNET_MAX_IOV];
 #endif
+	/* conn whose NAPI context is polled while spinning (+1 ref) */
+	struct ksock_conn	*kss_poll_conn;
+	/* when a data_ready callback queued work for me while asleep */
+	ktime_t			kss_kick_time;
+	__u64			kss_nwakes;	/* # wakeups from sleep */
+	__u64			kss_wake_ns;	/* total wakeup latency */
+	__u64			kss_npolls;	/* # busy-poll spins */
+	__u64			kss_poll_hits;	/* # spins that found work */
+	__u64			kss_poll_ns;	/* total time spent spinning */
+	/* only bumped by the scheduler thread itself */
+	__u64			kss_tx_batches;	/* # sends of >1 tx */
+	__u64			kss_tx_batched;	/* # txs in those sends */
+	__u64			kss_rx_direct;	/* # tcp_read_sock() receives */
 };
 
 struct ksock_sched_info {
@@ -159,6 +176,11 @@ struct ksock_tunables {
         unsigned int     *ksnd_zc_min_payload;  /* minimum zero copy payload size */
         int              *ksnd_zc_recv;         /* enable ZC receive (for Chelsio TOE) */
         int              *ksnd_zc_recv_min_nfrags; /* minimum # of fragments to enable ZC receive */
+	int		 *ksnd_rx_direct;	/* copy rx data from skbs to pages */
+	int		 *ksnd_tx_batch;	/* max # small txs per sendmsg */
+	int		 *ksnd_conns_per_peer;	/* # conns of each type per route */
+	int		 *ksnd_busy_poll_threads; /* # busy-polling scheds per CPT */
+	int		 *ksnd_busy_poll_usecs;	/* spin budget before sleeping */
 #ifdef CPU_AFFINITY
         int              *ksnd_irq_affinity;    /* enable IRQ affinity? */
 #endif
@@ -393,6 +415,8 @@ struct ksock_route {
         unsigned int          ksnr_deleted:1;   /* been removed from peer_ni? */
         unsigned int          ksnr_share_count; /* created explicitly? */
         int                   ksnr_conn_count;  /* # conns established by this route */
+	/* # conns of each type currently associated with this route */
+	int		      ksnr_ntype_conns[SOCKLND_CONN_NTYPES];
 };
 
 #define SOCKNAL_KEEPALIVE_PING          1       /* cookie for keepalive ping */
@@ -489,6 +513,31 @@ ksocknal_route_mask(void)
                 (1 << SOCKLND_CONN_BULK_OUT));
 }
 
+/* conns_per_peer can be changed at any time, clamp it on use */
+static inline int
+ksocknal_conns_per_peer(void)
+{
+	return clamp(*ksocknal_tunables.ksnd_conns_per_peer, 1,
+		     SOCKNAL_CONNS_PER_PEER_MAX);
+}
+
+/* Types of connection 'route' still needs to establish */
+static inline int
+ksocknal_route_wanted(struct ksock_route *route)
+{
+	int conns_per_peer = ksocknal_conns_per_peer();
+	int wanted = 0;
+	int type;
+
+	for (type = 0; type < SOCKLND_CONN_NTYPES; type++) {
+		if ((ksocknal_route_mask() & (1 << type)) != 0 &&
+		    route->ksnr_ntype_conns[type] < conns_per_peer)
+			wanted |= (1 << type);
+	}
+
+	return wanted;
+}
+
 static inline struct list_head *
 ksocknal_nid2peerlist (lnet_nid_t nid)
 {
@@ -663,6 +712,8 @@ extern int ksocknal_lib_get_conn_addrs(struct ksock_conn *conn);
 extern int ksocknal_lib_setup_sock(struct socket *so);
 extern int ksocknal_lib_send_iov(struct ksock_conn *conn, struct ksock_tx *tx);
 extern int ksocknal_lib_send_kiov(struct ksock_conn *conn, struct ksock_tx *tx);
+extern int ksocknal_lib_send_iov_batch(struct ksock_conn *conn,
+				      struct list_head *txs);
 extern void ksocknal_lib_eager_ack(struct ksock_conn *conn);
 extern int ksocknal_lib_recv_iov(struct ksock_conn *conn);
 extern int ksocknal_lib_recv_kiov(struct ksock_conn *conn);
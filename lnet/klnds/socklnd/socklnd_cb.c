@@ -185,8 +185,66 @@ ksocknal_send_kiov(struct ksock_conn *conn, struct ksock_tx *tx)
 }
 
 static int
-ksocknal_transmit(struct ksock_conn *conn, struct ksock_tx *tx)
+ksocknal_send_iov_batch(struct ksock_conn *conn, struct list_head *txs)
 {
+	struct ksock_tx *tx;
+	struct kvec *iov;
+	int nob;
+	int fragnob;
+	int rc;
+
+	/* Never touch tx->tx_iov inside ksocknal_lib_send_iov_batch() */
+	rc = ksocknal_lib_send_iov_batch(conn, txs);
+
+	if (rc <= 0)				/* sent nothing? */
+		return rc;
+
+	conn->ksnc_scheduler->kss_tx_batches++;
+
+	/* "consume" the iovs of each tx in stream order */
+	nob = rc;
+	list_for_each_entry(tx, txs, tx_list) {
+		if (nob == 0)
+			break;
+
+		conn->ksnc_scheduler->kss_tx_batched++;
+
+		fragnob = min(nob, tx->tx_resid);
+		tx->tx_resid -= fragnob;
+		nob -= fragnob;
+
+		iov = tx->tx_iov;
+		while (fragnob != 0) {
+			LASSERT(tx->tx_niov > 0);
+
+			if (fragnob < (int)iov->iov_len) {
+				iov->iov_base += fragnob;
+				iov->iov_len -= fragnob;
+				break;
+			}
+
+			fragnob -= iov->iov_len;
+			tx->tx_iov = ++iov;
+			tx->tx_niov--;
+		}
+	}
+	LASSERT(nob == 0);
+
+	return rc;
+}
+
+/* The txs on a batch go out in order, so the batch is done when its
+ * last tx is */
+static inline int
+ksocknal_txs_resid(struct list_head *txs)
+{
+	return list_entry(txs->prev, struct ksock_tx, tx_list)->tx_resid;
+}
+
+static int
+ksocknal_transmit(struct ksock_conn *conn, struct list_head *txs)
+{
+	struct ksock_tx *tx = list_entry(txs->next, struct ksock_tx, tx_list);
 	int	rc;
 	int	bufnob;
 
@@ -208,6 +266,8 @@ ksocknal_transmit(struct ksock_conn *conn, struct ksock_tx *tx)
                         /* testing... */
                         ksocknal_data.ksnd_enomem_tx--;
                         rc = -EAGAIN;
+		} else if (!list_is_singular(txs)) {
+			rc = ksocknal_send_iov_batch(conn, txs);
                 } else if (tx->tx_niov != 0) {
                         rc = ksocknal_send_iov (conn, tx);
                 } else {
@@ -244,7 +304,7 @@ ksocknal_transmit(struct ksock_conn *conn, struct ksock_tx *tx)
 		atomic_sub (rc, &conn->ksnc_tx_nob);
                 rc = 0;
 
-        } while (tx->tx_resid != 0);
+	} while (ksocknal_txs_resid(txs) != 0);
 
         ksocknal_connsock_decref(conn);
         return (rc);
@@ -505,18 +565,19 @@ ksocknal_uncheck_zc_req(struct ksock_tx *tx)
 }
 
 static int
-ksocknal_process_transmit(struct ksock_conn *conn, struct ksock_tx *tx)
+ksocknal_process_transmit(struct ksock_conn *conn, struct list_head *txs)
 {
+	struct ksock_tx *tx = list_entry(txs->next, struct ksock_tx, tx_list);
 	int rc;
 
         if (tx->tx_zc_capable && !tx->tx_zc_checked)
                 ksocknal_check_zc_req(tx);
 
-        rc = ksocknal_transmit (conn, tx);
+	rc = ksocknal_transmit(conn, txs);
 
-        CDEBUG (D_NET, "send(%d) %d\n", tx->tx_resid, rc);
+	CDEBUG(D_NET, "send(%d) %d\n", ksocknal_txs_resid(txs), rc);
 
-        if (tx->tx_resid == 0) {
+	if (ksocknal_txs_resid(txs) == 0) {
                 /* Sent everything OK */
                 LASSERT (rc == 0);
 
@@ -589,7 +650,7 @@ ksocknal_launch_connection_locked(struct ksock_route *route)
 
         LASSERT (!route->ksnr_scheduled);
         LASSERT (!route->ksnr_connecting);
-        LASSERT ((ksocknal_route_mask() & ~route->ksnr_connected) != 0);
+	LASSERT(ksocknal_route_wanted(route) != 0);
 
         route->ksnr_scheduled = 1;              /* scheduling conn for connd */
         ksocknal_route_addref(route);           /* extra ref for connd */
@@ -790,9 +851,9 @@ ksocknal_find_connectable_route_locked(struct ksock_peer_ni *peer_ni)
                 if (route->ksnr_scheduled)      /* connections being established */
                         continue;
 
-                /* all route types connected ? */
-                if ((ksocknal_route_mask() & ~route->ksnr_connected) == 0)
-                        continue;
+		/* all route types fully connected ? */
+		if (ksocknal_route_wanted(route) == 0)
+			continue;
 
                 if (!(route->ksnr_retry_interval == 0 || /* first attempt */
 		      now >= route->ksnr_timeout)) {
@@ -1391,12 +1452,131 @@ ksocknal_sched_cansleep(struct ksock_sched *sched)
 	return rc;
 }
 
+/* Hold a ref on the conn I last received from so its NAPI context can be
+ * polled while I spin.  Only the owning scheduler thread touches this. */
+static void
+ksocknal_sched_set_poll_conn(struct ksock_sched *sched,
+			     struct ksock_conn *conn)
+{
+	if (sched->kss_poll_conn == conn)
+		return;
+
+	if (conn != NULL)
+		ksocknal_conn_addref(conn);
+	if (sched->kss_poll_conn != NULL)
+		ksocknal_conn_decref(sched->kss_poll_conn);
+	sched->kss_poll_conn = conn;
+}
+
+/* Spin for up to busy_poll_usecs waiting for work, busy polling the NAPI
+ * context of the last conn I received from.  Return true if work turned
+ * up, in which case a sleep and wakeup were avoided. */
+static bool
+ksocknal_sched_busy_poll(struct ksock_sched *sched)
+{
+	struct ksock_conn *conn = sched->kss_poll_conn;
+	ktime_t start = ktime_get();
+	ktime_t end = ktime_add_us(start,
+				   *ksocknal_tunables.ksnd_busy_poll_usecs);
+	bool napi = false;
+	bool found = false;
+
+	if (conn != NULL && ksocknal_connsock_addref(conn) == 0)
+		napi = true;
+
+	do {
+#ifdef HAVE_SK_BUSY_LOOP
+		if (napi)
+			sk_busy_loop(conn->ksnc_sock->sk, 1);
+#endif
+		/* unlocked peek; the caller re-checks under kss_lock */
+		if (!list_empty(&sched->kss_rx_conns) ||
+		    !list_empty(&sched->kss_tx_conns) ||
+		    ksocknal_data.ksnd_shuttingdown) {
+			found = true;
+			break;
+		}
+		cpu_relax();
+	} while (ktime_before(ktime_get(), end) && !need_resched());
+
+	if (napi)
+		ksocknal_connsock_decref(conn);
+
+	spin_lock_bh(&sched->kss_lock);
+	sched->kss_npolls++;
+	if (found)
+		sched->kss_poll_hits++;
+	sched->kss_poll_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+	spin_unlock_bh(&sched->kss_lock);
+
+	return found;
+}
+
+/* Small txs that are all header/iov can share a single sendmsg() */
+static inline bool
+ksocknal_tx_batchable(struct ksock_tx *tx)
+{
+	return !SOCKNAL_SINGLE_FRAG_TX && tx->tx_nkiov == 0 &&
+	       tx->tx_nob <= *ksocknal_tunables.ksnd_min_bulk;
+}
+
+/* Move the tx at the head of conn's queue onto 'txs', followed by as many
+ * small txs as tx_batch allows if it is small too */
+static void
+ksocknal_dequeue_txs_locked(struct ksock_conn *conn, struct list_head *txs)
+{
+	struct ksock_tx *tx;
+	int ntx = 0;
+	int niov = 0;
+
+	/* Called holding BH lock: conn->ksnc_scheduler->kss_lock */
+	LASSERT(!list_empty(&conn->ksnc_tx_queue));
+	LASSERT(list_empty(txs));
+
+	do {
+		tx = list_entry(conn->ksnc_tx_queue.next,
+				struct ksock_tx, tx_list);
+
+		if (ntx > 0 &&
+		    (ntx >= *ksocknal_tunables.ksnd_tx_batch ||
+		     !ksocknal_tx_batchable(tx) ||
+		     niov + tx->tx_niov > LNET_MAX_IOV))
+			break;
+
+		if (conn->ksnc_tx_carrier == tx)
+			ksocknal_next_tx_carrier(conn);
+
+		list_move_tail(&tx->tx_list, txs);
+		niov += tx->tx_niov;
+		ntx++;
+
+		if (ntx == 1 && !ksocknal_tx_batchable(tx))
+			break;
+	} while (!list_empty(&conn->ksnc_tx_queue));
+}
+
+/* Drop the scheduler's ref on the txs of a batch; if 'sent_only', stop at
+ * the first tx that still has data to go */
+static void
+ksocknal_txs_decref(struct list_head *txs, bool sent_only)
+{
+	struct ksock_tx *tx;
+
+	while (!list_empty(txs)) {
+		tx = list_entry(txs->next, struct ksock_tx, tx_list);
+		if (sent_only && tx->tx_resid != 0)
+			break;
+
+		list_del(&tx->tx_list);
+		ksocknal_tx_decref(tx);
+	}
+}
+
 int ksocknal_scheduler(void *arg)
 {
 	struct ksock_sched_info	*info;
 	struct ksock_sched *sched;
 	struct ksock_conn *conn;
-	struct ksock_tx	*tx;
 	int rc;
 	int nloops = 0;
 	long id = (long)arg;
@@ -1416,6 +1596,8 @@ int ksocknal_scheduler(void *arg)
 
         while (!ksocknal_data.ksnd_shuttingdown) {
                 int did_something = 0;
+		bool poller = KSOCK_THREAD_SID(id) <
+			      *ksocknal_tunables.ksnd_busy_poll_threads;
 
                 /* Ensure I progress everything semi-fairly */
 
@@ -1438,6 +1620,9 @@ int ksocknal_scheduler(void *arg)
 
 			spin_lock_bh(&sched->kss_lock);
 
+			if (poller)
+				ksocknal_sched_set_poll_conn(sched, conn);
+
                         /* I'm the only one that can clear this flag */
                         LASSERT(conn->ksnc_rx_scheduled);
 
@@ -1465,6 +1650,7 @@ int ksocknal_scheduler(void *arg)
 
 		if (!list_empty(&sched->kss_tx_conns)) {
 			struct list_head zlist = LIST_HEAD_INIT(zlist);
+			struct list_head txs = LIST_HEAD_INIT(txs);
 
 			if (!list_empty(&sched->kss_zombie_noop_txs)) {
 				list_add(&zlist,
@@ -1480,14 +1666,8 @@ int ksocknal_scheduler(void *arg)
                         LASSERT(conn->ksnc_tx_ready);
 			LASSERT(!list_empty(&conn->ksnc_tx_queue));
 
-			tx = list_entry(conn->ksnc_tx_queue.next,
-					struct ksock_tx, tx_list);
-
-                        if (conn->ksnc_tx_carrier == tx)
-                                ksocknal_next_tx_carrier(conn);
-
-                        /* dequeue now so empty list => more to send */
-			list_del(&tx->tx_list);
+			/* dequeue now so empty list => more to send */
+			ksocknal_dequeue_txs_locked(conn, &txs);
 
                         /* Clear tx_ready in case send isn't complete.  Do
                          * it BEFORE we call process_transmit, since
@@ -1502,16 +1682,18 @@ int ksocknal_scheduler(void *arg)
                                 ksocknal_txlist_done(NULL, &zlist, 0);
                         }
 
-                        rc = ksocknal_process_transmit(conn, tx);
+			rc = ksocknal_process_transmit(conn, &txs);
 
-                        if (rc == -ENOMEM || rc == -EAGAIN) {
-                                /* Incomplete send: replace tx on HEAD of tx_queue */
+			if (rc == -ENOMEM || rc == -EAGAIN) {
+				/* Incomplete send: drop the txs that made it
+				 * out and replace the rest on HEAD of
+				 * tx_queue */
+				ksocknal_txs_decref(&txs, true);
 				spin_lock_bh(&sched->kss_lock);
-				list_add(&tx->tx_list,
-					     &conn->ksnc_tx_queue);
+				list_splice(&txs, &conn->ksnc_tx_queue);
 			} else {
-				/* Complete send; tx -ref */
-				ksocknal_tx_decref(tx);
+				/* Complete send; txs -ref */
+				ksocknal_txs_decref(&txs, false);
 
 				spin_lock_bh(&sched->kss_lock);
                                 /* assume space for more */
@@ -1540,7 +1722,11 @@ int ksocknal_scheduler(void *arg)
 
                         nloops = 0;
 
-                        if (!did_something) {   /* wait for something to do */
+			if (!did_something && poller &&
+			    ksocknal_sched_busy_poll(sched)) {
+				/* work turned up while spinning */
+			} else if (!did_something) { /* wait for something to do */
+				ksocknal_sched_set_poll_conn(sched, NULL);
 				rc = wait_event_interruptible_exclusive(
 					sched->kss_waitq,
 					!ksocknal_sched_cansleep(sched));
@@ -1550,10 +1736,20 @@ int ksocknal_scheduler(void *arg)
 			}
 
 			spin_lock_bh(&sched->kss_lock);
+
+			if (ktime_to_ns(sched->kss_kick_time) != 0) {
+				/* woken by data_ready: account the latency */
+				sched->kss_nwakes++;
+				sched->kss_wake_ns += ktime_to_ns(
+					ktime_sub(ktime_get(),
+						  sched->kss_kick_time));
+				sched->kss_kick_time = ktime_set(0, 0);
+			}
 		}
 	}
 
 	spin_unlock_bh(&sched->kss_lock);
+	ksocknal_sched_set_poll_conn(sched, NULL);
 	ksocknal_thread_fini();
 	return 0;
 }
@@ -1580,6 +1776,11 @@ void ksocknal_read_callback(struct ksock_conn *conn)
 		/* extra ref for scheduler */
 		ksocknal_conn_addref(conn);
 
+		/* time how long the sleeping scheduler takes to wake */
+		if (waitqueue_active(&sched->kss_waitq) &&
+		    ktime_to_ns(sched->kss_kick_time) == 0)
+			sched->kss_kick_time = ktime_get();
+
 		wake_up (&sched->kss_waitq);
 	}
 	spin_unlock_bh(&sched->kss_lock);
@@ -1867,7 +2068,7 @@ ksocknal_connect(struct ksock_route *route)
         route->ksnr_connecting = 1;
 
         for (;;) {
-                wanted = ksocknal_route_mask() & ~route->ksnr_connected;
+		wanted = ksocknal_route_wanted(route);
 
                 /* stop connecting if peer_ni/route got closed under me, or
                  * route got connected while queued */
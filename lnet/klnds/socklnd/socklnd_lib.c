@@ -112,6 +112,43 @@ ksocknal_lib_send_iov(struct ksock_conn *conn, struct ksock_tx *tx)
 	return rc;
 }
 
+int
+ksocknal_lib_send_iov_batch(struct ksock_conn *conn, struct list_head *txs)
+{
+	struct kvec *scratchiov = conn->ksnc_scheduler->kss_scratch_iov;
+	struct msghdr msg = { .msg_flags = MSG_DONTWAIT };
+	struct ksock_tx *tx;
+	unsigned int niov = 0;
+	int nob = 0;
+	int i;
+
+	/* Gather whatever is left of every tx on the batch into a single
+	 * sendmsg() so several small messages share one trip down the stack.
+	 * NB we can't trust socket ops to either consume our iovs or leave
+	 * them alone. */
+	list_for_each_entry(tx, txs, tx_list) {
+		if (tx->tx_resid == 0)
+			continue;
+
+		if (*ksocknal_tunables.ksnd_enable_csum &&
+		    conn->ksnc_proto == &ksocknal_protocol_v2x &&
+		    tx->tx_nob == tx->tx_resid &&
+		    tx->tx_msg.ksm_csum == 0)
+			ksocknal_lib_csum_tx(tx);
+
+		for (i = 0; i < tx->tx_niov; i++) {
+			LASSERT(niov < LNET_MAX_IOV);
+			scratchiov[niov++] = tx->tx_iov[i];
+			nob += tx->tx_iov[i].iov_len;
+		}
+	}
+
+	if (!list_empty(&conn->ksnc_tx_queue))
+		msg.msg_flags |= MSG_MORE;
+
+	return kernel_sendmsg(conn->ksnc_sock, &msg, scratchiov, niov, nob);
+}
+
 int
 ksocknal_lib_send_kiov(struct ksock_conn *conn, struct ksock_tx *tx)
 {
@@ -300,6 +337,111 @@ ksocknal_lib_kiov_vmap(lnet_kiov_t *kiov, int niov,
         return addr;
 }
 
+struct ksock_rx_desc {
+	struct ksock_conn	*rxd_conn;
+	lnet_kiov_t		*rxd_kiov;	/* current destination frag */
+	unsigned int		 rxd_nkiov;	/* # frags left */
+	unsigned int		 rxd_offset;	/* bytes done in rxd_kiov */
+	bool			 rxd_csum;	/* accumulate checksum? */
+};
+
+static int
+ksocknal_lib_rx_actor(read_descriptor_t *desc, struct sk_buff *skb,
+		      unsigned int offset, size_t len)
+{
+	struct ksock_rx_desc *rxd = desc->arg.data;
+	struct ksock_conn *conn = rxd->rxd_conn;
+	lnet_kiov_t *kiov;
+	size_t copied = 0;
+	size_t fragnob;
+	void *base;
+
+	if (len > desc->count)
+		len = desc->count;
+
+	/* Copy straight out of the skb into the destination pages and
+	 * checksum each piece while it is still hot in the cache */
+	while (copied < len) {
+		LASSERT(rxd->rxd_nkiov > 0);
+
+		kiov = rxd->rxd_kiov;
+		fragnob = min_t(size_t, kiov->kiov_len - rxd->rxd_offset,
+				len - copied);
+
+		base = kmap_atomic(kiov->kiov_page) + kiov->kiov_offset +
+		       rxd->rxd_offset;
+		if (skb_copy_bits(skb, offset + copied, base, fragnob) != 0) {
+			kunmap_atomic(base);
+			desc->error = -EFAULT;
+			break;
+		}
+
+		if (rxd->rxd_csum)
+			conn->ksnc_rx_csum = ksocknal_csum(conn->ksnc_rx_csum,
+							   base, fragnob);
+		kunmap_atomic(base);
+
+		copied += fragnob;
+		rxd->rxd_offset += fragnob;
+		if (rxd->rxd_offset == kiov->kiov_len) {
+			rxd->rxd_kiov++;
+			rxd->rxd_nkiov--;
+			rxd->rxd_offset = 0;
+		}
+	}
+
+	desc->count -= copied;
+	return copied;
+}
+
+/* Receive into conn->ksnc_rx_kiov by walking the socket's receive queue
+ * with tcp_read_sock().  This skips the kmap/vmap of every destination
+ * page, the recvmsg() iov walk and the second pass over the data for the
+ * checksum.  Return values follow kernel_recvmsg(MSG_DONTWAIT). */
+static int
+ksocknal_lib_recv_kiov_direct(struct ksock_conn *conn)
+{
+	struct sock *sk = conn->ksnc_sock->sk;
+	struct ksock_rx_desc rxd = {
+		.rxd_conn	= conn,
+		.rxd_kiov	= conn->ksnc_rx_kiov,
+		.rxd_nkiov	= conn->ksnc_rx_nkiov,
+		.rxd_offset	= 0,
+		.rxd_csum	= conn->ksnc_msg.ksm_csum != 0,
+	};
+	read_descriptor_t desc = {
+		.arg.data	= &rxd,
+		.error		= 0,
+	};
+	int nob;
+	int i;
+	int rc;
+
+	for (nob = i = 0; i < conn->ksnc_rx_nkiov; i++)
+		nob += conn->ksnc_rx_kiov[i].kiov_len;
+	LASSERT(nob <= conn->ksnc_rx_nob_wanted);
+	desc.count = nob;
+
+	lock_sock(sk);
+	rc = tcp_read_sock(sk, &desc, ksocknal_lib_rx_actor);
+	release_sock(sk);
+
+	if (rc > 0)
+		return rc;
+	if (desc.error != 0)
+		return desc.error;
+	if (rc < 0)
+		return rc;
+
+	/* nothing queued */
+	if (sk->sk_err != 0)
+		return sock_error(sk);
+	if (sk->sk_shutdown & RCV_SHUTDOWN)
+		return 0;
+
+	return -EAGAIN;
+}
+
 int
 ksocknal_lib_recv_kiov(struct ksock_conn *conn)
 {
@@ -329,6 +471,15 @@ ksocknal_lib_recv_kiov(struct ksock_conn *conn)
         int          fragnob;
 	int n;
 
+	/* zc_recv is for TOE drivers that can't be read through the TCP
+	 * receive queue, so it takes precedence */
+	if (*ksocknal_tunables.ksnd_rx_direct &&
+	    !*ksocknal_tunables.ksnd_zc_recv &&
+	    conn->ksnc_sock->sk->sk_protocol == IPPROTO_TCP) {
+		conn->ksnc_scheduler->kss_rx_direct++;
+		return ksocknal_lib_recv_kiov_direct(conn);
+	}
+
         /* NB we can't trust socket ops to either consume our iovs
          * or leave them alone. */
 	if ((addr = ksocknal_lib_kiov_vmap(kiov, niov, scratchiov, pages)) != NULL) {
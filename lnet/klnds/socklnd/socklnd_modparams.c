@@ -139,6 +139,26 @@ static unsigned int zc_recv_min_nfrags = 16;
 module_param(zc_recv_min_nfrags, int, 0644);
 MODULE_PARM_DESC(zc_recv_min_nfrags, "minimum # of fragments to enable ZC recv");
 
+static int rx_direct = 1;
+module_param(rx_direct, int, 0644);
+MODULE_PARM_DESC(rx_direct, "receive bulk data straight from socket buffers into pages");
+
+static int tx_batch = 8;
+module_param(tx_batch, int, 0644);
+MODULE_PARM_DESC(tx_batch, "max # of small messages gathered into one send");
+
+static int conns_per_peer = 1;
+module_param(conns_per_peer, int, 0644);
+MODULE_PARM_DESC(conns_per_peer, "# connections of each type to each peer");
+
+static int busy_poll_threads;
+module_param(busy_poll_threads, int, 0644);
+MODULE_PARM_DESC(busy_poll_threads, "# scheduler threads per CPT that busy-poll before sleeping");
+
+static int busy_poll_usecs = 50;
+module_param(busy_poll_usecs, int, 0644);
+MODULE_PARM_DESC(busy_poll_usecs, "microseconds a busy-polling scheduler spins before sleeping");
+
 #ifdef SOCKNAL_BACKOFF
 static int backoff_init = 3;
 module_param(backoff_init, int, 0644);
@@ -188,6 +208,11 @@ int ksocknal_tunables_init(void)
         ksocknal_tunables.ksnd_zc_min_payload     = &zc_min_payload;
         ksocknal_tunables.ksnd_zc_recv            = &zc_recv;
         ksocknal_tunables.ksnd_zc_recv_min_nfrags = &zc_recv_min_nfrags;
+	ksocknal_tunables.ksnd_rx_direct	  = &rx_direct;
+	ksocknal_tunables.ksnd_tx_batch		  = &tx_batch;
+	ksocknal_tunables.ksnd_conns_per_peer	  = &conns_per_peer;
+	ksocknal_tunables.ksnd_busy_poll_threads  = &busy_poll_threads;
+	ksocknal_tunables.ksnd_busy_poll_usecs	  = &busy_poll_usecs;
 
 #ifdef CPU_AFFINITY
 	if (enable_irq_affinity) {
@@ -75,6 +75,31 @@ module_param(lnet_numa_range, uint, 0444);
 MODULE_PARM_DESC(lnet_numa_range,
 		"NUMA range to consider during Multi-Rail selection");
 
+unsigned int lnet_health_sensitivity = 100;
+module_param(lnet_health_sensitivity, uint, 0644);
+MODULE_PARM_DESC(lnet_health_sensitivity,
+		"Health lost by an interface on each failure, out of 1000");
+
+unsigned int lnet_recovery_interval = 1;
+module_param(lnet_recovery_interval, uint, 0644);
+MODULE_PARM_DESC(lnet_recovery_interval,
+		"Seconds for an interface to recover one failure, 0 to disable");
+
+unsigned int lnet_retry_count = 2;
+module_param(lnet_retry_count, uint, 0644);
+MODULE_PARM_DESC(lnet_retry_count,
+		"Times a failed PUT or GET is resent on another path");
+
+unsigned int lnet_transaction_timeout = 50;
+module_param(lnet_transaction_timeout, uint, 0644);
+MODULE_PARM_DESC(lnet_transaction_timeout,
+		"Seconds after which a failed message is no longer resent");
+
+unsigned int lnet_coalesce_size;
+module_param(lnet_coalesce_size, uint, 0644);
+MODULE_PARM_DESC(lnet_coalesce_size,
+		"Bytes of small PUTs waiting for peer credits to send as one message, 0 to disable");
+
 static int lnet_interfaces_max = LNET_INTERFACES_MAX_DEFAULT;
 static int intf_max_set(const char *val, struct kernel_param *kp);
 module_param_call(lnet_interfaces_max, intf_max_set, param_get_int,
@@ -224,6 +249,357 @@ struct kmem_cache *lnet_mes_cachep;	   /* MEs kmem_cache */
 struct kmem_cache *lnet_small_mds_cachep;  /* <= LNET_SMALL_MD_SIZE bytes
 					    *  MDs kmem_cache */
 
+/* fewest objects pooled per CPT and type, whatever the NI credits */
+#define LNET_OBJ_POOL_MIN	64
+
+static struct shrinker *lnet_obj_pool_shrinker;
+
+static unsigned int
+lnet_obj_pool_size(enum lnet_pool_type type)
+{
+	switch (type) {
+	default:
+		LBUG();
+	case LNET_POOL_MSG:
+		return sizeof(struct lnet_msg);
+	case LNET_POOL_MD:
+		return LNET_SMALL_MD_SIZE;
+	case LNET_POOL_ME:
+		return sizeof(struct lnet_me);
+	}
+}
+
+static void *
+lnet_obj_create(enum lnet_pool_type type)
+{
+	void *obj;
+
+	switch (type) {
+	default:
+		LBUG();
+	case LNET_POOL_MSG:
+		LIBCFS_ALLOC(obj, sizeof(struct lnet_msg));
+		return obj;
+	case LNET_POOL_MD:
+		return kmem_cache_alloc(lnet_small_mds_cachep,
+					GFP_NOFS | __GFP_ZERO);
+	case LNET_POOL_ME:
+		return kmem_cache_alloc(lnet_mes_cachep,
+					GFP_NOFS | __GFP_ZERO);
+	}
+}
+
+static void
+lnet_obj_destroy(enum lnet_pool_type type, void *obj)
+{
+	switch (type) {
+	default:
+		LBUG();
+	case LNET_POOL_MSG:
+		LIBCFS_FREE(obj, sizeof(struct lnet_msg));
+		break;
+	case LNET_POOL_MD:
+		kmem_cache_free(lnet_small_mds_cachep, obj);
+		break;
+	case LNET_POOL_ME:
+		kmem_cache_free(lnet_mes_cachep, obj);
+		break;
+	}
+}
+
+/**
+ * Take a zeroed object of \a type from the pool of the current CPT.
+ *
+ * \retval NULL if the pool is empty, the caller then allocates from
+ *		the slab as usual
+ */
+void *
+lnet_obj_pool_get(enum lnet_pool_type type)
+{
+	struct lnet_obj_pool *pool;
+	struct list_head *obj = NULL;
+
+	if (the_lnet.ln_obj_pools[type] == NULL)
+		return NULL;
+
+	pool = the_lnet.ln_obj_pools[type][lnet_cpt_current()];
+
+	spin_lock(&pool->op_lock);
+	if (pool->op_nfree > 0) {
+		obj = pool->op_free.next;
+		list_del(obj);
+		pool->op_nfree--;
+		pool->op_hits++;
+	} else {
+		pool->op_misses++;
+	}
+	spin_unlock(&pool->op_lock);
+
+	if (obj != NULL)
+		memset(obj, 0, lnet_obj_pool_size(type));
+
+	return obj;
+}
+
+/**
+ * Give \a obj back to the pool of the current CPT.
+ *
+ * \retval false if the pool is full, the caller then frees \a obj to
+ *		 the slab as usual
+ */
+bool
+lnet_obj_pool_put(enum lnet_pool_type type, void *obj)
+{
+	struct lnet_obj_pool *pool;
+	bool kept = false;
+
+	if (the_lnet.ln_obj_pools[type] == NULL)
+		return false;
+
+	pool = the_lnet.ln_obj_pools[type][lnet_cpt_current()];
+
+	spin_lock(&pool->op_lock);
+	if (pool->op_nfree < pool->op_max) {
+		list_add((struct list_head *)obj, &pool->op_free);
+		pool->op_nfree++;
+		kept = true;
+	}
+	spin_unlock(&pool->op_lock);
+
+	return kept;
+}
+
+/* free up to \a nr pooled objects above \a keep, returns # freed */
+static unsigned long
+lnet_obj_pool_drain(enum lnet_pool_type type, struct lnet_obj_pool *pool,
+		    int keep, unsigned long nr)
+{
+	struct list_head zombies;
+	struct list_head *obj;
+	unsigned long freed = 0;
+
+	INIT_LIST_HEAD(&zombies);
+
+	spin_lock(&pool->op_lock);
+	while (pool->op_nfree > keep && freed < nr) {
+		obj = pool->op_free.next;
+		list_move(obj, &zombies);
+		pool->op_nfree--;
+		freed++;
+	}
+	spin_unlock(&pool->op_lock);
+
+	while (!list_empty(&zombies)) {
+		obj = zombies.next;
+		list_del(obj);
+		lnet_obj_destroy(type, obj);
+	}
+
+	return freed;
+}
+
+static unsigned long
+lnet_obj_pools_count(void)
+{
+	struct lnet_obj_pool *pool;
+	unsigned long count = 0;
+	int type;
+	int i;
+
+	for (type = 0; type < LNET_POOL_MAX; type++) {
+		if (the_lnet.ln_obj_pools[type] == NULL)
+			continue;
+		cfs_percpt_for_each(pool, i, the_lnet.ln_obj_pools[type])
+			count += pool->op_nfree;
+	}
+
+	return count;
+}
+
+static unsigned long
+lnet_obj_pools_scan(unsigned long nr)
+{
+	struct lnet_obj_pool *pool;
+	unsigned long freed = 0;
+	int type;
+	int i;
+
+	for (type = 0; type < LNET_POOL_MAX && freed < nr; type++) {
+		if (the_lnet.ln_obj_pools[type] == NULL)
+			continue;
+		cfs_percpt_for_each(pool, i, the_lnet.ln_obj_pools[type]) {
+			freed += lnet_obj_pool_drain(type, pool, 0,
+						     nr - freed);
+			if (freed >= nr)
+				break;
+		}
+	}
+
+	return freed;
+}
+
+#ifdef HAVE_SHRINKER_COUNT
+static unsigned long
+lnet_obj_pools_shrink_count(struct shrinker *s, struct shrink_control *sc)
+{
+	return lnet_obj_pools_count();
+}
+
+static unsigned long
+lnet_obj_pools_shrink_scan(struct shrinker *s, struct shrink_control *sc)
+{
+	return lnet_obj_pools_scan(sc->nr_to_scan);
+}
+#else
+static int
+lnet_obj_pools_shrink(SHRINKER_ARGS(sc, nr_to_scan, gfp_mask))
+{
+	unsigned long nr = shrink_param(sc, nr_to_scan);
+
+	if (nr != 0)
+		lnet_obj_pools_scan(nr);
+
+	return lnet_obj_pools_count();
+}
+#endif /* HAVE_SHRINKER_COUNT */
+
+/**
+ * Size the pools from the transmit credits of the configured NIs: every
+ * credit in use pins a message on the way out and another one coming
+ * back, and roughly one MD and ME. Pools are filled up front so that the
+ * first burst of traffic does not go to the slab either.
+ *
+ * Called with ln_api_mutex held whenever NIs are added or removed.
+ */
+void
+lnet_obj_pools_resize(void)
+{
+	struct lnet_obj_pool *pool;
+	struct lnet_net *net;
+	struct lnet_ni *ni;
+	int credits = 0;
+	int type;
+	int max;
+	int i;
+
+	lnet_net_lock(0);
+	list_for_each_entry(net, &the_lnet.ln_nets, net_list) {
+		list_for_each_entry(ni, &net->net_ni_list, ni_netlist)
+			credits += net->net_tunables.lct_max_tx_credits;
+	}
+	lnet_net_unlock(0);
+
+	credits /= cfs_cpt_number(lnet_cpt_table());
+
+	for (type = 0; type < LNET_POOL_MAX; type++) {
+		if (the_lnet.ln_obj_pools[type] == NULL)
+			continue;
+
+		max = (type == LNET_POOL_MSG) ? 2 * credits : credits;
+		max = max(max, LNET_OBJ_POOL_MIN);
+
+		cfs_percpt_for_each(pool, i, the_lnet.ln_obj_pools[type]) {
+			void *obj;
+
+			spin_lock(&pool->op_lock);
+			pool->op_max = max;
+			spin_unlock(&pool->op_lock);
+
+			lnet_obj_pool_drain(type, pool, max, ULONG_MAX);
+
+			while (pool->op_nfree < max) {
+				obj = lnet_obj_create(type);
+				if (obj == NULL)
+					break;
+
+				spin_lock(&pool->op_lock);
+				list_add((struct list_head *)obj,
+					 &pool->op_free);
+				pool->op_nfree++;
+				spin_unlock(&pool->op_lock);
+			}
+		}
+	}
+
+	CDEBUG(D_NET, "LNet descriptor pools hold up to %d msgs per CPT\n",
+	       max(2 * credits, LNET_OBJ_POOL_MIN));
+}
+
+void
+lnet_obj_pools_counters(struct lnet_pool_counters *pc)
+{
+	struct lnet_obj_pool *pool;
+	int type;
+	int i;
+
+	memset(pc, 0, sizeof(*pc) * LNET_POOL_MAX);
+
+	for (type = 0; type < LNET_POOL_MAX; type++) {
+		if (the_lnet.ln_obj_pools[type] == NULL)
+			continue;
+		cfs_percpt_for_each(pool, i, the_lnet.ln_obj_pools[type]) {
+			spin_lock(&pool->op_lock);
+			pc[type].pc_hits += pool->op_hits;
+			pc[type].pc_misses += pool->op_misses;
+			pc[type].pc_free += pool->op_nfree;
+			pc[type].pc_max += pool->op_max;
+			spin_unlock(&pool->op_lock);
+		}
+	}
+}
+
+static int
+lnet_obj_pools_create(void)
+{
+	struct lnet_obj_pool *pool;
+	int type;
+	int i;
+	DEF_SHRINKER_VAR(shvar, lnet_obj_pools_shrink,
+			 lnet_obj_pools_shrink_count,
+			 lnet_obj_pools_shrink_scan);
+
+	for (type = 0; type < LNET_POOL_MAX; type++) {
+		the_lnet.ln_obj_pools[type] =
+			cfs_percpt_alloc(lnet_cpt_table(), sizeof(*pool));
+		if (the_lnet.ln_obj_pools[type] == NULL)
+			return -ENOMEM;
+
+		cfs_percpt_for_each(pool, i, the_lnet.ln_obj_pools[type]) {
+			spin_lock_init(&pool->op_lock);
+			INIT_LIST_HEAD(&pool->op_free);
+			pool->op_max = LNET_OBJ_POOL_MIN;
+		}
+	}
+
+	lnet_obj_pool_shrinker = set_shrinker(DEFAULT_SEEKS, &shvar);
+
+	return 0;
+}
+
+static void
+lnet_obj_pools_destroy(void)
+{
+	struct lnet_obj_pool *pool;
+	int type;
+	int i;
+
+	if (lnet_obj_pool_shrinker != NULL) {
+		remove_shrinker(lnet_obj_pool_shrinker);
+		lnet_obj_pool_shrinker = NULL;
+	}
+
+	for (type = 0; type < LNET_POOL_MAX; type++) {
+		if (the_lnet.ln_obj_pools[type] == NULL)
+			continue;
+
+		cfs_percpt_for_each(pool, i, the_lnet.ln_obj_pools[type])
+			lnet_obj_pool_drain(type, pool, 0, ULONG_MAX);
+
+		cfs_percpt_free(the_lnet.ln_obj_pools[type]);
+		the_lnet.ln_obj_pools[type] = NULL;
+	}
+}
+
 static int
 lnet_descriptor_setup(void)
 {
@@ -241,12 +617,13 @@ lnet_descriptor_setup(void)
 	if (!lnet_small_mds_cachep)
 		return -ENOMEM;
 
-	return 0;
+	return lnet_obj_pools_create();
 }
 
 static void
 lnet_descriptor_cleanup(void)
 {
+	lnet_obj_pools_destroy();
 
 	if (lnet_small_mds_cachep) {
 		kmem_cache_destroy(lnet_small_mds_cachep);
@@ -446,7 +823,8 @@ static void lnet_assert_wire_constants(void)
 	CLASSERT(LNET_PING_FEAT_RTE_DISABLED == 4);
 	CLASSERT(LNET_PING_FEAT_MULTI_RAIL == 8);
 	CLASSERT(LNET_PING_FEAT_DISCOVERY == 16);
-	CLASSERT(LNET_PING_FEAT_BITS == 31);
+	CLASSERT(LNET_PING_FEAT_COALESCE == 32);
+	CLASSERT(LNET_PING_FEAT_BITS == 63);
 
 	/* Checks for struct lnet_ping_info */
 	CLASSERT((int)sizeof(struct lnet_ping_info) == 16);
@@ -778,6 +1156,10 @@ lnet_prepare(lnet_pid_t requested_pid)
 	if (rc != 0)
 		goto failed;
 
+	rc = lnet_path_caches_create();
+	if (rc != 0)
+		goto failed;
+
 	rc = lnet_res_container_setup(&the_lnet.ln_eq_container, 0,
 				      LNET_COOKIE_TYPE_EQ);
 	if (rc != 0)
@@ -840,6 +1222,7 @@ lnet_unprepare (void)
 
 	lnet_res_container_cleanup(&the_lnet.ln_eq_container);
 
+	lnet_path_caches_destroy();
 	lnet_msg_containers_destroy();
 	lnet_peer_uninit();
 	lnet_rtrpools_free(0);
@@ -1103,8 +1486,8 @@ lnet_ping_target_create(int nnis)
 	pbuf->pb_info.pi_nnis = nnis;
 	pbuf->pb_info.pi_pid = the_lnet.ln_pid;
 	pbuf->pb_info.pi_magic = LNET_PROTO_PING_MAGIC;
-	pbuf->pb_info.pi_features =
-		LNET_PING_FEAT_NI_STATUS | LNET_PING_FEAT_MULTI_RAIL;
+	pbuf->pb_info.pi_features = LNET_PING_FEAT_NI_STATUS |
+		LNET_PING_FEAT_MULTI_RAIL | LNET_PING_FEAT_COALESCE;
 
 	return pbuf;
 }
@@ -1633,6 +2016,8 @@ lnet_shutdown_lndni(struct lnet_ni *ni)
 	ni->ni_state = LNET_NI_STATE_DELETING;
 	lnet_ni_unlink_locked(ni);
 	lnet_incr_dlc_seq();
+	/* cached paths hold references on the NI */
+	lnet_path_cache_flush_locked();
 	lnet_net_unlock(LNET_LOCK_EX);
 
 	/* clear messages for this NI on the lazy portal */
@@ -2187,6 +2572,8 @@ LNetNIInit(lnet_pid_t requested_pid)
 		goto err_empty_list;
 	}
 
+	lnet_obj_pools_resize();
+
 	if (!the_lnet.ln_nis_from_mod_params) {
 		rc = lnet_parse_routes(lnet_get_routes(), &im_a_router);
 		if (rc != 0)
@@ -2601,6 +2988,83 @@ int lnet_get_ni_stats(struct lnet_ioctl_element_msg_stats *msg_stats)
 	return rc;
 }
 
+/*
+ * Copy the counters of every local NI to @recs.  As lnet_get_peer_list()
+ * does, return -E2BIG with the size needed in *sizep if the buffer is too
+ * small.  The NI lists only change under ln_api_mutex, which the caller
+ * holds, so copy_to_user() can be called while walking them.
+ */
+static int
+lnet_get_ni_stats_bulk(__u32 *countp, __u32 *sizep,
+		       struct lnet_ioctl_stats_rec __user *recs)
+{
+	struct lnet_ioctl_stats_rec rec;
+	struct lnet_tx_queue *tq;
+	struct lnet_net *net;
+	struct lnet_ni *ni;
+	__u32 count = 0;
+	__u32 size;
+	int rc;
+	int i;
+
+	list_for_each_entry(net, &the_lnet.ln_nets, net_list) {
+		list_for_each_entry(ni, &net->net_ni_list, ni_netlist)
+			count++;
+	}
+
+	size = count * sizeof(rec);
+	rc = -E2BIG;
+	if (size > *sizep)
+		goto out;
+
+	rc = -EFAULT;
+	list_for_each_entry(net, &the_lnet.ln_nets, net_list) {
+		list_for_each_entry(ni, &net->net_ni_list, ni_netlist) {
+			lnet_usr_stats_rec(&rec, ni->ni_nid, &ni->ni_stats);
+			rec.isr_tx_credits = atomic_read(&ni->ni_tx_credits);
+			rec.isr_min_tx_credits = INT_MAX;
+			cfs_percpt_for_each(tq, i, ni->ni_tx_queues) {
+				rec.isr_min_tx_credits =
+					min(rec.isr_min_tx_credits,
+					    tq->tq_credits_min);
+				if (tq->tq_credits < 0)
+					rec.isr_txq_msgs += -tq->tq_credits;
+			}
+			rec.isr_health = lnet_health_read(&ni->ni_health);
+
+			if (copy_to_user(recs++, &rec, sizeof(rec)))
+				goto out;
+		}
+	}
+	rc = 0;
+out:
+	*countp = count;
+	*sizep = size;
+	return rc;
+}
+
+static int
+lnet_get_stats_bulk(struct lnet_ioctl_stats_bulk *sb)
+{
+	struct lnet_ioctl_stats_rec __user *recs = sb->sb_bulk;
+
+	if (the_lnet.ln_state != LNET_STATE_RUNNING)
+		return -ESHUTDOWN;
+
+	sb->sb_time_ns = ktime_get_ns();
+
+	switch (sb->sb_type) {
+	case LNET_STATS_BULK_NI:
+		return lnet_get_ni_stats_bulk(&sb->sb_count, &sb->sb_size,
+					      recs);
+	case LNET_STATS_BULK_PEER_NI:
+		return lnet_get_peer_ni_stats_bulk(&sb->sb_count,
+						   &sb->sb_size, recs);
+	default:
+		return -EINVAL;
+	}
+}
+
 static int lnet_add_net_common(struct lnet_net *net,
 			       struct lnet_ioctl_config_lnd_tunables *tun)
 {
@@ -2691,6 +3155,7 @@ static int lnet_add_net_common(struct lnet_net *net,
 	lnet_net_unlock(LNET_LOCK_EX);
 
 	lnet_ping_target_update(pbuf, ping_mdh);
+	lnet_obj_pools_resize();
 
 	return 0;
 
@@ -2829,6 +3294,7 @@ int lnet_dyn_del_ni(struct lnet_ioctl_config_ni *conf)
 			lnet_acceptor_stop();
 
 		lnet_ping_target_update(pbuf, ping_mdh);
+		lnet_obj_pools_resize();
 
 		goto unlock_api_mutex;
 	}
@@ -2862,6 +3328,8 @@ int lnet_dyn_del_ni(struct lnet_ioctl_config_ni *conf)
 	if (net_count == 1)
 		lnet_shutdown_lndnet(net);
 
+	lnet_obj_pools_resize();
+
 	goto unlock_api_mutex;
 
 unlock_net:
@@ -2970,6 +3438,7 @@ lnet_dyn_del_net(__u32 net_id)
 		lnet_acceptor_stop();
 
 	lnet_ping_target_update(pbuf, ping_mdh);
+	lnet_obj_pools_resize();
 
 out:
 	mutex_unlock(&the_lnet.ln_api_mutex);
@@ -2980,6 +3449,7 @@ out:
 void lnet_incr_dlc_seq(void)
 {
 	atomic_inc(&lnet_dlc_seq_no);
+	lnet_path_cache_invalidate();
 }
 
 __u32 lnet_get_dlc_seq_locked(void)
@@ -3101,6 +3571,18 @@ LNetCtl(unsigned int cmd, void *arg)
 		return rc;
 	}
 
+	case IOC_LIBCFS_GET_STATS_BULK: {
+		struct lnet_ioctl_stats_bulk *sb = arg;
+
+		if (sb->sb_hdr.ioc_len < sizeof(*sb))
+			return -EINVAL;
+
+		mutex_lock(&the_lnet.ln_api_mutex);
+		rc = lnet_get_stats_bulk(sb);
+		mutex_unlock(&the_lnet.ln_api_mutex);
+		return rc;
+	}
+
 	case IOC_LIBCFS_GET_NET: {
 		size_t total = sizeof(*config) +
 			       sizeof(struct lnet_ioctl_net_config);
@@ -3119,11 +3601,15 @@ LNetCtl(unsigned int cmd, void *arg)
 	{
 		struct lnet_ioctl_lnet_stats *lnet_stats = arg;
 
-		if (lnet_stats->st_hdr.ioc_len < sizeof(*lnet_stats))
+		/* older tools pass the struct without st_pools */
+		if (lnet_stats->st_hdr.ioc_len <
+		    offsetof(struct lnet_ioctl_lnet_stats, st_pools))
 			return -EINVAL;
 
 		mutex_lock(&the_lnet.ln_api_mutex);
 		lnet_counters_get(&lnet_stats->st_cntrs);
+		if (lnet_stats->st_hdr.ioc_len >= sizeof(*lnet_stats))
+			lnet_obj_pools_counters(lnet_stats->st_pools);
 		mutex_unlock(&the_lnet.ln_api_mutex);
 		return 0;
 	}
@@ -3180,6 +3666,43 @@ LNetCtl(unsigned int cmd, void *arg)
 		return 0;
 	}
 
+	case IOC_LIBCFS_SET_NET_SEL_POLICY: {
+		struct lnet_ioctl_net_sel_policy *sel = arg;
+		struct lnet_net *net;
+
+		if (sel->sp_hdr.ioc_len != sizeof(*sel))
+			return -EINVAL;
+		if (sel->sp_policy >= LNET_SEL_POLICY_MAX)
+			return -EINVAL;
+
+		lnet_net_lock(LNET_LOCK_EX);
+		net = lnet_get_net_locked(sel->sp_net);
+		if (net == NULL) {
+			lnet_net_unlock(LNET_LOCK_EX);
+			return -ENOENT;
+		}
+		net->net_sel_policy = sel->sp_policy;
+		lnet_path_cache_invalidate();
+		lnet_net_unlock(LNET_LOCK_EX);
+		return 0;
+	}
+
+	case IOC_LIBCFS_GET_NET_SEL_POLICY: {
+		struct lnet_ioctl_net_sel_policy *sel = arg;
+		struct lnet_net *net;
+		int cpt;
+
+		if (sel->sp_hdr.ioc_len != sizeof(*sel))
+			return -EINVAL;
+
+		cpt = lnet_net_lock_current();
+		net = lnet_get_net_locked(sel->sp_net);
+		if (net != NULL)
+			sel->sp_policy = net->net_sel_policy;
+		lnet_net_unlock(cpt);
+		return net == NULL ? -ENOENT : 0;
+	}
+
 	case IOC_LIBCFS_GET_BUF: {
 		struct lnet_ioctl_pool_cfg *pool_cfg;
 		size_t total = sizeof(*config) + sizeof(*pool_cfg);
@@ -104,10 +104,13 @@ LNetMEAttach(unsigned int portal,
 
 	lnet_res_lh_initialize(the_lnet.ln_me_containers[mtable->mt_cpt],
 			       &me->me_lh);
-	if (ignore_bits != 0)
+	if (ignore_bits != 0) {
+		/* NB: may drop and retake lnet_res_lock */
+		lnet_mt_mask_add(mtable, me, pos);
 		head = &mtable->mt_mhash[LNET_MT_HASH_IGNORE];
-	else
+	} else {
 		head = lnet_mt_match_head(mtable, match_id, match_bits);
+	}
 
 	me->me_pos = head - &mtable->mt_mhash[0];
 	if (pos == LNET_INS_AFTER || pos == LNET_INS_LOCAL)
@@ -190,6 +193,10 @@ LNetMEInsert(struct lnet_handle_me current_meh,
 	new_me->me_unlink = unlink;
 	new_me->me_md = NULL;
 
+	/* the ignore-bits index keeps MEs ordered by sequence, which
+	 * relative insertion can't be expressed in */
+	ptl->ptl_mtables[cpt]->mt_masks_off = 1;
+
 	lnet_res_lh_initialize(the_lnet.ln_me_containers[cpt], &new_me->me_lh);
 
 	if (pos == LNET_INS_AFTER)
@@ -267,6 +274,7 @@ lnet_me_unlink(struct lnet_me *me)
 		lnet_ptl_detach_md(me, md);
 		lnet_md_unlink(md);
 	}
+	lnet_mt_mask_del(me);
 
 	lnet_res_lh_invalidate(&me->me_lh);
 	lnet_me_free(me);
@@ -139,6 +139,16 @@ void lnet_usr_translate_stats(struct lnet_ioctl_element_msg_stats *msg_stats,
 	assign_stats(&msg_stats->im_drop_stats, counts);
 }
 
+void lnet_usr_stats_rec(struct lnet_ioctl_stats_rec *rec, lnet_nid_t nid,
+			struct lnet_element_stats *stats)
+{
+	memset(rec, 0, sizeof(*rec));
+	rec->isr_nid = nid;
+	assign_stats(&rec->isr_send, &stats->el_send_stats);
+	assign_stats(&rec->isr_recv, &stats->el_recv_stats);
+	assign_stats(&rec->isr_drop, &stats->el_drop_stats);
+}
+
 int
 lnet_fail_nid(lnet_nid_t nid, unsigned int threshold)
 {
@@ -652,6 +662,32 @@ lnet_extract_kiov(int dst_niov, lnet_kiov_t *dst,
 }
 EXPORT_SYMBOL(lnet_extract_kiov);
 
+/*
+ * The payload of a PUT unpacked from a bundle was received with the
+ * bundle, copy it from there instead of asking the LND for it.
+ */
+static void
+lnet_unbundled_recv(struct lnet_msg *msg, unsigned int niov,
+		    struct kvec *iov, lnet_kiov_t *kiov,
+		    unsigned int offset, unsigned int mlen)
+{
+	struct lnet_msg_bundle *mb = msg->msg_bundle;
+
+	LASSERT(mb != NULL);
+	LASSERT(msg->msg_bundle_offset + mlen <= mb->mb_size);
+
+	if (mlen != 0) {
+		if (iov != NULL)
+			lnet_copy_iov2iov(niov, iov, offset, 1, &mb->mb_iov,
+					  msg->msg_bundle_offset, mlen);
+		else
+			lnet_copy_iov2kiov(niov, kiov, offset, 1, &mb->mb_iov,
+					   msg->msg_bundle_offset, mlen);
+	}
+
+	lnet_finalize(msg, 0);
+}
+
 void
 lnet_ni_recv(struct lnet_ni *ni, void *private, struct lnet_msg *msg,
 	     int delayed, unsigned int offset, unsigned int mlen,
@@ -683,6 +719,15 @@ lnet_ni_recv(struct lnet_ni *ni, void *private, struct lnet_msg *msg,
 			LASSERT (niov > 0);
 			LASSERT ((iov == NULL) != (kiov == NULL));
 		}
+
+		if (msg->msg_unbundled) {
+			lnet_unbundled_recv(msg, niov, iov, kiov, offset, mlen);
+			return;
+		}
+	} else if (private == NULL) {
+		/* discarding a PUT unpacked from a bundle, the LND has
+		 * nothing left to drop */
+		return;
 	}
 
 	rc = (ni->ni_net->net_lnd->lnd_recv)(ni, private, msg, delayed,
@@ -743,6 +788,22 @@ lnet_ni_send(struct lnet_ni *ni, struct lnet_msg *msg)
 	LASSERT (LNET_NETTYP(LNET_NIDNET(ni->ni_nid)) == LOLND ||
 		 (msg->msg_txcredit && msg->msg_peertxcredit));
 
+	msg->msg_send_time = ktime_get();
+
+	/* a drop rule with an error simulates a failed send */
+	if (!list_empty(&the_lnet.ln_drop_rules)) {
+		rc = lnet_drop_rule_error(&msg->msg_hdr);
+		if (rc != 0) {
+			CDEBUG(D_NET, "%s: failing %s to %s to simulate "
+			       "send error %d\n",
+			       libcfs_nid2str(ni->ni_nid),
+			       lnet_msgtyp2str(msg->msg_type),
+			       libcfs_id2str(msg->msg_target), rc);
+			lnet_finalize(msg, rc);
+			return;
+		}
+	}
+
 	rc = (ni->ni_net->net_lnd->lnd_send)(ni, priv, msg);
 	if (rc < 0)
 		lnet_finalize(msg, rc);
@@ -756,6 +817,7 @@ lnet_ni_eager_recv(struct lnet_ni *ni, struct lnet_msg *msg)
 	LASSERT(!msg->msg_sending);
 	LASSERT(msg->msg_receiving);
 	LASSERT(!msg->msg_rx_ready_delay);
+	LASSERT(!msg->msg_unbundled);
 	LASSERT(ni->ni_net->net_lnd->lnd_eager_recv != NULL);
 
 	msg->msg_rx_ready_delay = 1;
@@ -1067,6 +1129,8 @@ lnet_post_routed_recv_locked(struct lnet_msg *msg, int do_recv)
 		rbp->rbp_credits--;
 		if (rbp->rbp_credits < rbp->rbp_mincredits)
 			rbp->rbp_mincredits = rbp->rbp_credits;
+		if (rbp->rbp_credits < rbp->rbp_win_mincredits)
+			rbp->rbp_win_mincredits = rbp->rbp_credits;
 
 		if (rbp->rbp_credits < 0) {
 			/* must have checked eager_recv before here */
@@ -1095,6 +1159,317 @@ lnet_post_routed_recv_locked(struct lnet_msg *msg, int do_recv)
 	return LNET_CREDIT_OK;
 }
 
+/*
+ * Tell which end of the path a send status should be blamed on. LNDs only
+ * report an errno, so this is a best guess: errors which can only come
+ * from this node are local, errors which tell the peer did not answer are
+ * remote, and errors which could be either count against both.
+ */
+unsigned int
+lnet_health_error_site(int status)
+{
+	switch (status) {
+	case 0:
+	case -ECANCELED:	/* shutdown or MD unlinked */
+	case -EINTR:
+		return 0;
+	case -ENETDOWN:
+	case -ENODEV:
+	case -ENOMEM:
+		return LNET_HEALTH_ERR_LOCAL;
+	case -EHOSTUNREACH:
+	case -ECONNREFUSED:
+	case -ECONNRESET:
+	case -ECONNABORTED:
+	case -EPROTO:
+		return LNET_HEALTH_ERR_REMOTE;
+	default:		/* -EIO, -ETIMEDOUT, ... */
+		return LNET_HEALTH_ERR_LOCAL | LNET_HEALTH_ERR_REMOTE;
+	}
+}
+
+void
+lnet_health_update(struct lnet_health *health, int delta)
+{
+	int value = lnet_health_read(health) + delta;
+
+	if (value > LNET_MAX_HEALTH_VALUE)
+		value = LNET_MAX_HEALTH_VALUE;
+	else if (value < 0)
+		value = 0;
+
+	/* no protection, races only lose an update which is harmless */
+	atomic_set(&health->lh_value, value);
+	health->lh_stamp = ktime_get_seconds();
+}
+
+/*
+ * Fold the send to completion time of \a msg into the smoothed latency of
+ * the peer NI it went to, used by LNET_SEL_POLICY_LATENCY.
+ */
+static void
+lnet_peer_ni_update_latency(struct lnet_msg *msg, struct lnet_peer_ni *lpni)
+{
+	unsigned long sample;
+
+	if (ktime_to_ns(msg->msg_send_time) == 0)
+		return;
+
+	sample = ktime_to_us(ktime_sub(ktime_get(), msg->msg_send_time));
+	if (sample == 0)
+		sample = 1;
+
+	/* completions of one peer NI can run on any CPT */
+	spin_lock(&lpni->lpni_lock);
+	if (lpni->lpni_latency_us == 0)
+		lpni->lpni_latency_us = sample;
+	else
+		lpni->lpni_latency_us = (7 * lpni->lpni_latency_us + sample) / 8;
+	spin_unlock(&lpni->lpni_lock);
+}
+
+/*
+ * Account the outcome of a send against the NI and peer NI it used, so
+ * that lnet_select_pathway() steers traffic away from failing interfaces.
+ * A success restores a little health, a failure costs
+ * lnet_health_sensitivity on the side(s) it is blamed on.
+ */
+static void
+lnet_handle_health(struct lnet_msg *msg, struct lnet_ni *txni,
+		   struct lnet_peer_ni *txpeer)
+{
+	int status = msg->msg_ev.status;
+	unsigned int site;
+
+	if (txni == the_lnet.ln_loni)
+		return;
+
+	if (status == 0) {
+		lnet_peer_ni_update_latency(msg, txpeer);
+		if (atomic_read(&txni->ni_health.lh_value) <
+		    LNET_MAX_HEALTH_VALUE)
+			lnet_health_update(&txni->ni_health, 1);
+		if (atomic_read(&txpeer->lpni_health.lh_value) <
+		    LNET_MAX_HEALTH_VALUE)
+			lnet_health_update(&txpeer->lpni_health, 1);
+		return;
+	}
+
+	site = lnet_health_error_site(status);
+	if (site != 0)
+		lnet_path_cache_invalidate();
+	if (site & LNET_HEALTH_ERR_LOCAL)
+		lnet_health_update(&txni->ni_health, -lnet_health_sensitivity);
+	if (site & LNET_HEALTH_ERR_REMOTE)
+		lnet_health_update(&txpeer->lpni_health,
+				   -lnet_health_sensitivity);
+
+	if (site != 0)
+		CDEBUG(D_NET, "%s -> %s: %s failed %d, health %d/%d\n",
+		       libcfs_nid2str(txni->ni_nid),
+		       libcfs_nid2str(txpeer->lpni_nid),
+		       lnet_msgtyp2str(msg->msg_type), status,
+		       lnet_health_read(&txni->ni_health),
+		       lnet_health_read(&txpeer->lpni_health));
+}
+
+/*
+ * Whether @msg, which waits for a credit of @lp, may be packed into a
+ * bundle that has @nob bytes left.  Only PUTs for @lp itself that want no
+ * ACK are bundled: they are finalized with the status of the carrier, so
+ * there is nothing an ACK could be matched with once they were sent.
+ */
+static bool
+lnet_msg_bundleable(struct lnet_msg *msg, struct lnet_peer_ni *lp,
+		    unsigned int nob)
+{
+	if (msg->msg_type != LNET_MSG_PUT || msg->msg_routing ||
+	    msg->msg_txni == the_lnet.ln_loni ||
+	    !(lp->lpni_peer_net->lpn_peer->lp_state & LNET_PEER_COALESCE))
+		return false;
+
+	if (le64_to_cpu(msg->msg_hdr.dest_nid) != lp->lpni_nid ||
+	    !lnet_is_wire_handle_none(&msg->msg_hdr.msg.put.ack_wmd))
+		return false;
+
+	if (msg->msg_md == NULL ||
+	    (msg->msg_md->md_flags & LNET_MD_FLAG_ABORTED) != 0)
+		return false;
+
+	return sizeof(struct lnet_hdr) +
+	       ALIGN(msg->msg_len, LNET_BUNDLE_ALIGN) <= nob;
+}
+
+/*
+ * @msg has just been given the peer credit it was waiting for.  Move the
+ * PUTs queued behind it that can share that credit onto @msgs, and give
+ * back the credits they hold, see lnet_post_bundle_locked().
+ */
+static void
+lnet_bundle_collect_locked(struct lnet_msg *msg, struct lnet_peer_ni *lp,
+			   struct list_head *msgs)
+{
+	unsigned int nob = min_t(unsigned int, lnet_coalesce_size, LNET_MTU);
+	struct lnet_msg *tmp;
+	int nmsgs = 1;
+
+	if (nob == 0 || !lnet_msg_bundleable(msg, lp, nob))
+		return;
+	nob -= sizeof(struct lnet_hdr) + ALIGN(msg->msg_len, LNET_BUNDLE_ALIGN);
+
+	while (!list_empty(&lp->lpni_txq) && nmsgs < LNET_BUNDLE_MAX_MSGS) {
+		tmp = list_entry(lp->lpni_txq.next, struct lnet_msg, msg_list);
+		if (tmp->msg_txni != msg->msg_txni ||
+		    tmp->msg_tx_cpt != msg->msg_tx_cpt ||
+		    !lnet_msg_bundleable(tmp, lp, nob))
+			break;
+
+		LASSERT(tmp->msg_peertxcredit);
+		LASSERT(lp->lpni_txcredits < 0);
+		list_move_tail(&tmp->msg_list, msgs);
+		tmp->msg_peertxcredit = 0;
+		lp->lpni_txqnob -= tmp->msg_len + sizeof(struct lnet_hdr);
+		lp->lpni_txcredits++;
+
+		nob -= sizeof(struct lnet_hdr) +
+		       ALIGN(tmp->msg_len, LNET_BUNDLE_ALIGN);
+		nmsgs++;
+	}
+}
+
+/* Copy the headers and payloads of @msgs into a new carrier message */
+static struct lnet_msg *
+lnet_bundle_pack(struct list_head *msgs)
+{
+	struct lnet_msg_bundle *mb;
+	struct lnet_msg *carrier;
+	struct lnet_msg *msg;
+	unsigned int nob = 0;
+	unsigned int nmsgs = 0;
+
+	list_for_each_entry(msg, msgs, msg_list)
+		nob += sizeof(struct lnet_hdr) +
+		       ALIGN(msg->msg_len, LNET_BUNDLE_ALIGN);
+
+	mb = lnet_msg_bundle_alloc(nob);
+	if (mb == NULL)
+		return NULL;
+
+	carrier = lnet_msg_alloc();
+	if (carrier == NULL) {
+		lnet_msg_bundle_decref(mb);
+		return NULL;
+	}
+
+	nob = 0;
+	list_for_each_entry(msg, msgs, msg_list) {
+		memcpy(mb->mb_data + nob, &msg->msg_hdr, sizeof(msg->msg_hdr));
+		nob += sizeof(msg->msg_hdr);
+
+		/* no payload buffer is set up for an empty PUT */
+		if (msg->msg_kiov != NULL)
+			lnet_copy_kiov2iov(1, &mb->mb_iov, nob,
+					   msg->msg_niov, msg->msg_kiov,
+					   msg->msg_offset, msg->msg_len);
+		else if (msg->msg_iov != NULL)
+			lnet_copy_iov2iov(1, &mb->mb_iov, nob,
+					  msg->msg_niov, msg->msg_iov,
+					  msg->msg_offset, msg->msg_len);
+
+		nob += ALIGN(msg->msg_len, LNET_BUNDLE_ALIGN);
+		nmsgs++;
+	}
+	LASSERT(nob == mb->mb_size);
+
+	msg = list_entry(msgs->next, struct lnet_msg, msg_list);
+	list_splice_init(msgs, &mb->mb_msgs);
+
+	lnet_prep_send(carrier, LNET_MSG_PUT, msg->msg_target, 0, 0);
+	carrier->msg_sending = 1;
+	carrier->msg_bundle_wire = 1;
+	carrier->msg_bundle = mb;
+	carrier->msg_len = nob;
+	carrier->msg_niov = 1;
+	carrier->msg_iov = &mb->mb_iov;
+
+	carrier->msg_hdr.src_nid = msg->msg_hdr.src_nid;
+	carrier->msg_hdr.dest_nid = msg->msg_hdr.dest_nid;
+	carrier->msg_hdr.payload_length = cpu_to_le32(nob);
+	carrier->msg_hdr.msg.put.ptl_index = cpu_to_le32(LNET_RESERVED_PORTAL);
+	carrier->msg_hdr.msg.put.match_bits =
+		cpu_to_le64(LNET_PROTO_BUNDLE_MATCHBITS);
+	carrier->msg_hdr.msg.put.hdr_data = cpu_to_le64(nmsgs);
+	carrier->msg_hdr.msg.put.ack_wmd.wh_interface_cookie =
+		LNET_WIRE_HANDLE_COOKIE_NONE;
+	carrier->msg_hdr.msg.put.ack_wmd.wh_object_cookie =
+		LNET_WIRE_HANDLE_COOKIE_NONE;
+
+	return carrier;
+}
+
+/*
+ * Send @msg, which holds a peer credit, together with the PUTs on @msgs,
+ * which were queued behind it, as a single message.  Queueing for credits
+ * means the peer is already receiving as fast as it can, so sending one
+ * larger message instead of several small ones costs no latency but saves
+ * per-message overhead on both sides.  The bundled messages are finalized
+ * with the status of the carrier, see lnet_msg_bundle_done().
+ *
+ * Called and returns with lnet_net_lock(msg->msg_tx_cpt) held, but drops
+ * it while copying.
+ */
+static void
+lnet_post_bundle_locked(struct lnet_msg *msg, struct list_head *msgs)
+{
+	struct lnet_peer_ni *lp = msg->msg_txpeer;
+	struct lnet_ni *ni = msg->msg_txni;
+	int cpt = msg->msg_tx_cpt;
+	struct lnet_msg *carrier;
+	struct lnet_msg *tmp;
+
+	list_add(&msg->msg_list, msgs);
+
+	lnet_net_unlock(cpt);
+	carrier = lnet_bundle_pack(msgs);
+	lnet_net_lock(cpt);
+
+	if (carrier == NULL) {
+		/* send them one by one, the followers queue for credits
+		 * again */
+		CDEBUG(D_NET, "no memory to bundle PUTs to %s\n",
+		       libcfs_nid2str(lp->lpni_nid));
+		while (!list_empty(msgs)) {
+			tmp = list_entry(msgs->next, struct lnet_msg,
+					 msg_list);
+			list_del(&tmp->msg_list);
+			(void) lnet_post_send_locked(tmp, 1);
+		}
+		return;
+	}
+
+	lnet_peer_ni_addref_locked(lp);
+	carrier->msg_txpeer = lp;
+	lnet_ni_addref_locked(ni, cpt);
+	carrier->msg_txni = ni;
+	carrier->msg_target.nid = lp->lpni_nid;
+	lnet_msg_commit(carrier, cpt);
+
+	/* the carrier takes over the peer credit of @msg */
+	spin_lock(&lp->lpni_lock);
+	lp->lpni_txqnob += carrier->msg_len - msg->msg_len;
+	spin_unlock(&lp->lpni_lock);
+	msg->msg_peertxcredit = 0;
+	carrier->msg_peertxcredit = 1;
+	carrier->msg_tx_delayed = 1;
+
+	CDEBUG(D_NET, "%s -> %s: %llu PUTs in %u bytes\n",
+	       libcfs_nid2str(ni->ni_nid), libcfs_nid2str(lp->lpni_nid),
+	       le64_to_cpu(carrier->msg_hdr.msg.put.hdr_data),
+	       carrier->msg_len);
+
+	(void) lnet_post_send_locked(carrier, 1);
+}
+
 void
 lnet_return_tx_credits_locked(struct lnet_msg *msg)
 {
@@ -1140,11 +1515,14 @@ lnet_return_tx_credits_locked(struct lnet_msg *msg)
 
 		txpeer->lpni_txcredits++;
 		if (txpeer->lpni_txcredits <= 0) {
+			struct list_head bundle;
 			int msg2_cpt;
 
 			msg2 = list_entry(txpeer->lpni_txq.next,
 					      struct lnet_msg, msg_list);
 			list_del(&msg2->msg_list);
+			INIT_LIST_HEAD(&bundle);
+			lnet_bundle_collect_locked(msg2, txpeer, &bundle);
 			spin_unlock(&txpeer->lpni_lock);
 
 			LASSERT(msg2->msg_txpeer == txpeer);
@@ -1167,7 +1545,10 @@ lnet_return_tx_credits_locked(struct lnet_msg *msg)
 				lnet_net_unlock(msg->msg_tx_cpt);
 				lnet_net_lock(msg2_cpt);
 			}
-                        (void) lnet_post_send_locked(msg2, 1);
+			if (list_empty(&bundle))
+				(void) lnet_post_send_locked(msg2, 1);
+			else
+				lnet_post_bundle_locked(msg2, &bundle);
 			if (msg2_cpt != msg->msg_tx_cpt) {
 				lnet_net_unlock(msg2_cpt);
 				lnet_net_lock(msg->msg_tx_cpt);
@@ -1177,21 +1558,15 @@ lnet_return_tx_credits_locked(struct lnet_msg *msg)
 		}
         }
 
+	if (txni != NULL && txpeer != NULL)
+		lnet_handle_health(msg, txni, txpeer);
+
 	if (txni != NULL) {
 		msg->msg_txni = NULL;
 		lnet_ni_decref_locked(txni, msg->msg_tx_cpt);
 	}
 
 	if (txpeer != NULL) {
-		/*
-		 * TODO:
-		 * Once the patch for the health comes in we need to set
-		 * the health of the peer ni to bad when we fail to send
-		 * a message.
-		 * int status = msg->msg_ev.status;
-		 * if (status != 0)
-		 *	lnet_set_peer_ni_health_locked(txpeer, false)
-		 */
 		msg->msg_txpeer = NULL;
 		lnet_peer_ni_decref_locked(txpeer);
 	}
@@ -1434,24 +1809,29 @@ lnet_get_best_ni(struct lnet_net *local_net, struct lnet_ni *cur_ni,
 	struct lnet_ni *ni = NULL, *best_ni = cur_ni;
 	unsigned int shortest_distance;
 	int best_credits;
+	int best_healthv;
 
 	if (best_ni == NULL) {
 		shortest_distance = UINT_MAX;
 		best_credits = INT_MIN;
+		best_healthv = -1;
 	} else {
 		shortest_distance = cfs_cpt_distance(lnet_cpt_table(), md_cpt,
 						     best_ni->ni_dev_cpt);
 		best_credits = atomic_read(&best_ni->ni_tx_credits);
+		best_healthv = lnet_health_read(&best_ni->ni_health);
 	}
 
 	while ((ni = lnet_get_next_ni_locked(local_net, ni))) {
 		unsigned int distance;
 		int ni_credits;
+		int ni_healthv;
 
 		if (!lnet_is_ni_healthy_locked(ni))
 			continue;
 
 		ni_credits = atomic_read(&ni->ni_tx_credits);
+		ni_healthv = lnet_health_read(&ni->ni_health);
 
 		/*
 		 * calculate the distance from the CPT on which
@@ -1470,10 +1850,16 @@ lnet_get_best_ni(struct lnet_net *local_net, struct lnet_ni *cur_ni,
 			distance = lnet_numa_range;
 
 		/*
-		 * Select on shorter distance, then available
-		 * credits, then round-robin.
+		 * Select on health, then shorter distance, then
+		 * available credits, then round-robin. A NI which
+		 * recently failed is only used when no healthier one
+		 * is available.
 		 */
-		if (distance > shortest_distance) {
+		if (ni_healthv < best_healthv) {
+			continue;
+		} else if (ni_healthv > best_healthv) {
+			shortest_distance = distance;
+		} else if (distance > shortest_distance) {
 			continue;
 		} else if (distance < shortest_distance) {
 			shortest_distance = distance;
@@ -1485,11 +1871,65 @@ lnet_get_best_ni(struct lnet_net *local_net, struct lnet_ni *cur_ni,
 		}
 		best_ni = ni;
 		best_credits = ni_credits;
+		best_healthv = ni_healthv;
 	}
 
 	return best_ni;
 }
 
+/*
+ * LNET_SEL_POLICY_LATENCY: each peer_ni has a virtual clock which advances
+ * by its smoothed latency every time it is picked, and the peer_ni whose
+ * clock is furthest behind goes next. A peer_ni twice as fast thus gets
+ * twice the traffic. Clocks are floored to the current time so that an
+ * idle peer_ni does not get a burst when it comes back.
+ *
+ * Peer_nis with send credits left are preferred over those without.
+ * Returns < 0 if \a lpni should be picked over \a best.
+ */
+static __u64
+lnet_lpni_sel_vtime(struct lnet_peer_ni *lpni, __u64 now)
+{
+	__u64 vtime;
+
+	/* the same peer NI is selected from every CPT */
+	spin_lock(&lpni->lpni_lock);
+	vtime = max(lpni->lpni_sel_vtime, now);
+	spin_unlock(&lpni->lpni_lock);
+
+	return vtime;
+}
+
+static int
+lnet_compare_lpni_latency(struct lnet_peer_ni *lpni, struct lnet_peer_ni *best,
+			  __u64 now)
+{
+	__u64 vtime;
+	__u64 best_vtime;
+
+	if (best == NULL)
+		return -1;
+
+	if ((lpni->lpni_txcredits > 0) != (best->lpni_txcredits > 0))
+		return lpni->lpni_txcredits > 0 ? -1 : 1;
+
+	vtime = lnet_lpni_sel_vtime(lpni, now);
+	best_vtime = lnet_lpni_sel_vtime(best, now);
+	if (vtime != best_vtime)
+		return vtime < best_vtime ? -1 : 1;
+
+	return 0;
+}
+
+static void
+lnet_lpni_latency_advance(struct lnet_peer_ni *lpni, __u64 now)
+{
+	spin_lock(&lpni->lpni_lock);
+	lpni->lpni_sel_vtime = max(lpni->lpni_sel_vtime, now) +
+			       max(lpni->lpni_latency_us, 1UL);
+	spin_unlock(&lpni->lpni_lock);
+}
+
 /*
  * Traffic to the LNET_RESERVED_PORTAL may not trigger peer discovery,
  * because such traffic is required to perform discovery. We therefore
@@ -1511,6 +1951,211 @@ lnet_msg_discovery(struct lnet_msg *msg)
 	return false;
 }
 
+/*
+ * Path cache.
+ *
+ * Each CPT keeps a small direct-mapped cache of the local NI and peer NI
+ * lnet_select_pathway() chose for a (src, dst, router) triple, so that
+ * steady-state traffic skips the peer lookup and NI ranking. Only paths
+ * for which the selection had a single possible answer are cached, so that
+ * round-robin and credit-based balancing over multiple rails is not
+ * affected. Entries are checked against the_lnet.ln_path_gen, which is
+ * bumped by anything which may change a selection, and hold a reference on
+ * their NI and peer NI until they are replaced or flushed.
+ */
+static struct lnet_path_entry *
+lnet_path_cache_slot(struct lnet_path_cache *pc, lnet_nid_t src_nid,
+		     lnet_nid_t dst_nid, lnet_nid_t rtr_nid)
+{
+	return &pc->pc_entries[hash_64(src_nid ^ (dst_nid * 31) ^ rtr_nid,
+				       LNET_PATH_CACHE_BITS)];
+}
+
+static void
+lnet_path_entry_clear(struct lnet_path_entry *pe, int cpt)
+{
+	if (pe->pe_ni == NULL)
+		return;
+
+	lnet_ni_decref_locked(pe->pe_ni, cpt);
+	lnet_peer_ni_decref_locked(pe->pe_lpni);
+	pe->pe_ni = NULL;
+	pe->pe_lpni = NULL;
+}
+
+static bool
+lnet_path_cache_lookup(struct lnet_msg *msg, int cpt, lnet_nid_t src_nid,
+		       lnet_nid_t dst_nid, lnet_nid_t rtr_nid,
+		       struct lnet_ni **ni, struct lnet_peer_ni **lpni)
+{
+	struct lnet_path_cache *pc;
+	struct lnet_path_entry *pe;
+	struct lnet_peer *peer;
+
+	if (the_lnet.ln_path_caches == NULL)
+		return false;
+
+	pc = the_lnet.ln_path_caches[cpt];
+	pe = lnet_path_cache_slot(pc, src_nid, dst_nid, rtr_nid);
+	if (pe->pe_ni == NULL || pe->pe_dst_nid != dst_nid ||
+	    pe->pe_src_nid != src_nid || pe->pe_rtr_nid != rtr_nid)
+		goto miss;
+
+	if (pe->pe_gen != atomic_read(&the_lnet.ln_path_gen)) {
+		lnet_path_entry_clear(pe, cpt);
+		goto miss;
+	}
+
+	/* discovery must still be triggered when it is due */
+	peer = pe->pe_lpni->lpni_peer_net->lpn_peer;
+	if (lnet_msg_discovery(msg) && !lnet_peer_is_uptodate(peer))
+		goto miss;
+
+	if (!lnet_is_ni_healthy_locked(pe->pe_ni) ||
+	    !lnet_is_peer_ni_healthy_locked(pe->pe_lpni))
+		goto miss;
+
+	pc->pc_hits++;
+	*ni = pe->pe_ni;
+	*lpni = pe->pe_lpni;
+	return true;
+
+miss:
+	pc->pc_misses++;
+	return false;
+}
+
+static void
+lnet_path_cache_fill(int cpt, unsigned int gen, lnet_nid_t src_nid,
+		     lnet_nid_t dst_nid, lnet_nid_t rtr_nid,
+		     struct lnet_ni *ni, struct lnet_peer_ni *lpni)
+{
+	struct lnet_path_entry *pe;
+
+	if (the_lnet.ln_path_caches == NULL)
+		return;
+
+	pe = lnet_path_cache_slot(the_lnet.ln_path_caches[cpt],
+				  src_nid, dst_nid, rtr_nid);
+	lnet_path_entry_clear(pe, cpt);
+
+	lnet_ni_addref_locked(ni, cpt);
+	lnet_peer_ni_addref_locked(lpni);
+	pe->pe_src_nid = src_nid;
+	pe->pe_dst_nid = dst_nid;
+	pe->pe_rtr_nid = rtr_nid;
+	pe->pe_gen = gen;
+	pe->pe_ni = ni;
+	pe->pe_lpni = lpni;
+}
+
+/*
+ * Whether lnet_select_pathway() had a single possible answer when it
+ * picked \a best_ni and a peer_ni of \a peer_net, i.e. the path can be
+ * cached without defeating load balancing.
+ */
+static bool
+lnet_path_is_unique(struct lnet_peer *peer, struct lnet_peer_net *peer_net,
+		    struct lnet_ni *best_ni, lnet_nid_t src_nid)
+{
+	if (!list_is_singular(&peer_net->lpn_peer_nis))
+		return false;
+
+	/* the local NI was imposed */
+	if (src_nid != LNET_NID_ANY)
+		return true;
+
+	return list_is_singular(&peer->lp_peer_nets) &&
+	       list_is_singular(&best_ni->ni_net->net_ni_list);
+}
+
+/* drop all cached paths, called with LNET_LOCK_EX held */
+void
+lnet_path_cache_flush_locked(void)
+{
+	struct lnet_path_cache *pc;
+	int cpt;
+	int i;
+
+	if (the_lnet.ln_path_caches == NULL)
+		return;
+
+	lnet_path_cache_invalidate();
+	cfs_percpt_for_each(pc, cpt, the_lnet.ln_path_caches) {
+		for (i = 0; i < LNET_PATH_CACHE_SIZE; i++)
+			lnet_path_entry_clear(&pc->pc_entries[i], cpt);
+	}
+}
+
+/*
+ * drop the cached paths going through \a lpni, so that its references go
+ * away when it is deleted, called with LNET_LOCK_EX held
+ */
+void
+lnet_path_cache_flush_peer_ni_locked(struct lnet_peer_ni *lpni)
+{
+	struct lnet_path_cache *pc;
+	int cpt;
+	int i;
+
+	if (the_lnet.ln_path_caches == NULL)
+		return;
+
+	lnet_path_cache_invalidate();
+	cfs_percpt_for_each(pc, cpt, the_lnet.ln_path_caches) {
+		for (i = 0; i < LNET_PATH_CACHE_SIZE; i++) {
+			if (pc->pc_entries[i].pe_lpni == lpni)
+				lnet_path_entry_clear(&pc->pc_entries[i], cpt);
+		}
+	}
+}
+
+void
+lnet_path_cache_counters(__u64 *hits, __u64 *misses)
+{
+	struct lnet_path_cache *pc;
+	int cpt;
+
+	*hits = 0;
+	*misses = 0;
+	if (the_lnet.ln_path_caches == NULL)
+		return;
+
+	cfs_percpt_for_each(pc, cpt, the_lnet.ln_path_caches) {
+		lnet_net_lock(cpt);
+		*hits += pc->pc_hits;
+		*misses += pc->pc_misses;
+		lnet_net_unlock(cpt);
+	}
+}
+
+int
+lnet_path_caches_create(void)
+{
+	the_lnet.ln_path_caches = cfs_percpt_alloc(lnet_cpt_table(),
+					sizeof(struct lnet_path_cache));
+	if (the_lnet.ln_path_caches == NULL) {
+		CERROR("Failed to allocate path caches for LNet\n");
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+void
+lnet_path_caches_destroy(void)
+{
+	if (the_lnet.ln_path_caches == NULL)
+		return;
+
+	lnet_net_lock(LNET_LOCK_EX);
+	lnet_path_cache_flush_locked();
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	cfs_percpt_free(the_lnet.ln_path_caches);
+	the_lnet.ln_path_caches = NULL;
+}
+
 static int
 lnet_select_pathway(lnet_nid_t src_nid, lnet_nid_t dst_nid,
 		    struct lnet_msg *msg, lnet_nid_t rtr_nid)
@@ -1529,8 +2174,13 @@ lnet_select_pathway(lnet_nid_t src_nid, lnet_nid_t dst_nid,
 	bool			ni_is_pref;
 	bool			preferred;
 	bool			local_found;
+	unsigned int		path_gen;
 	int			best_lpni_credits;
+	int			best_lpni_healthv;
+	int			lpni_healthv;
 	int			md_cpt;
+	bool			by_latency;
+	__u64			now_us;
 
 	/*
 	 * get an initial CPT to use for locking. The idea here is not to
@@ -1556,6 +2206,12 @@ again:
 	routing = false;
 	routing2 = false;
 	local_found = false;
+	path_gen = atomic_read(&the_lnet.ln_path_gen);
+
+	/* steady state: reuse the path picked for the previous message */
+	if (lnet_path_cache_lookup(msg, cpt, src_nid, dst_nid, rtr_nid,
+				   &best_ni, &best_lpni))
+		goto send;
 
 	/*
 	 * lnet_nid2peerni_locked() is the path that will find an
@@ -1574,7 +2230,8 @@ again:
 	 * the entire process and send over lolnd
 	 */
 	if (LNET_NETTYP(LNET_NIDNET(dst_nid)) == LOLND) {
-		lnet_peer_ni_decref_locked(lpni);
+		/* keep the ref, lnet_parse_loopback() receives from it */
+		best_lpni = lpni;
 		best_ni = the_lnet.ln_loni;
 		goto send;
 	}
@@ -1758,8 +2415,13 @@ again:
 	 * best_lpni because we are replying to a message then just send
 	 * the message
 	 */
-	if (best_ni && best_lpni)
+	if (best_ni && best_lpni) {
+		/* fully determined by src_nid and dst_nid */
+		if (!routing && src_nid != LNET_NID_ANY)
+			lnet_path_cache_fill(cpt, path_gen, src_nid, dst_nid,
+					     rtr_nid, best_ni, best_lpni);
 		goto send;
+	}
 
 	/*
 	 * If we already found a best_ni because src_nid is specified then
@@ -1934,12 +2596,17 @@ pick_peer:
 	 * best_ni to communicate, we use that one. If there is no
 	 * preferred peer_ni, or there are multiple preferred peer_ni,
 	 * the available transmit credits are used. If the transmit
-	 * credits are equal, we round-robin over the peer_ni.
+	 * credits are equal, we round-robin over the peer_ni. Health
+	 * comes first: a peer_ni which recently failed is only used
+	 * when no healthier one is available.
 	 */
 	lpni = NULL;
 	best_lpni_credits = INT_MIN;
+	best_lpni_healthv = -1;
 	preferred = false;
 	best_lpni = NULL;
+	by_latency = best_ni->ni_net->net_sel_policy == LNET_SEL_POLICY_LATENCY;
+	now_us = by_latency ? ktime_to_us(ktime_get()) : 0;
 	while ((lpni = lnet_get_next_peer_ni_locked(peer, peer_net, lpni))) {
 		/*
 		 * if this peer ni is not healthy just skip it, no point in
@@ -1949,9 +2616,15 @@ pick_peer:
 			continue;
 		ni_is_pref = lnet_peer_is_pref_nid_locked(lpni,
 							  best_ni->ni_nid);
+		lpni_healthv = lnet_health_read(&lpni->lpni_health);
 
-		/* if this is a preferred peer use it */
-		if (!preferred && ni_is_pref) {
+		if (lpni_healthv < best_lpni_healthv) {
+			continue;
+		} else if (lpni_healthv > best_lpni_healthv) {
+			/* a healthier peer_ni wins, preferred or not */
+			preferred = ni_is_pref;
+		} else if (!preferred && ni_is_pref) {
+			/* if this is a preferred peer use it */
 			preferred = true;
 		} else if (preferred && !ni_is_pref) {
 			/*
@@ -1959,6 +2632,14 @@ pick_peer:
 			 * it.
 			 */
 			continue;
+		} else if (by_latency) {
+			int cmp = lnet_compare_lpni_latency(lpni, best_lpni,
+							    now_us);
+
+			/* equal clocks are round-robined like credits */
+			if (cmp > 0 ||
+			    (cmp == 0 && best_lpni->lpni_seq <= lpni->lpni_seq))
+				continue;
 		} else if (lpni->lpni_txcredits < best_lpni_credits) {
 			/*
 			 * We already have a peer that has more credits
@@ -1981,6 +2662,7 @@ pick_peer:
 
 		best_lpni = lpni;
 		best_lpni_credits = lpni->lpni_txcredits;
+		best_lpni_healthv = lpni_healthv;
 	}
 
 	/* if we still can't find a peer ni then we can't reach it */
@@ -1993,6 +2675,14 @@ pick_peer:
 		return -EHOSTUNREACH;
 	}
 
+	if (by_latency)
+		lnet_lpni_latency_advance(best_lpni, now_us);
+
+	if (!routing && !routing2 &&
+	    lnet_path_is_unique(peer, peer_net, best_ni, src_nid))
+		lnet_path_cache_fill(cpt, path_gen, src_nid, dst_nid, rtr_nid,
+				     best_ni, best_lpni);
+
 
 send:
 	/* Shortcut for loopback. */
@@ -2005,6 +2695,7 @@ send:
 		msg->msg_target.nid = best_ni->ni_nid;
 		lnet_msg_commit(msg, cpt);
 		msg->msg_txni = best_ni;
+		msg->msg_txpeer = best_lpni;
 		lnet_net_unlock(cpt);
 
 		return LNET_CREDIT_OK;
@@ -2139,6 +2830,13 @@ lnet_send(lnet_nid_t src_nid, struct lnet_msg *msg, lnet_nid_t rtr_nid)
 
 	LASSERT(!msg->msg_tx_committed);
 
+	/* remember how to send it again, see lnet_msg_resend() */
+	msg->msg_src_nid_param = src_nid;
+	msg->msg_rtr_nid_param = rtr_nid;
+	if (msg->msg_retry_count == 0)
+		msg->msg_deadline = ktime_get_seconds() +
+				    lnet_transaction_timeout;
+
 	rc = lnet_select_pathway(src_nid, dst_nid, msg, rtr_nid);
 	if (rc < 0)
 		return rc;
@@ -2205,7 +2903,9 @@ lnet_parse_put(struct lnet_ni *ni, struct lnet_msg *msg)
 	info.mi_mbits	= hdr->msg.put.match_bits;
 	info.mi_cpt	= lnet_cpt_of_nid(msg->msg_rxpeer->lpni_nid, ni);
 
-	msg->msg_rx_ready_delay = ni->ni_net->net_lnd->lnd_eager_recv == NULL;
+	/* the payload of an unbundled PUT is already here */
+	msg->msg_rx_ready_delay = ni->ni_net->net_lnd->lnd_eager_recv == NULL ||
+				  msg->msg_unbundled;
 	ready_delay = msg->msg_rx_ready_delay;
 
  again:
@@ -2565,9 +3265,95 @@ lnet_print_hdr(struct lnet_hdr *hdr)
 
 }
 
-int
-lnet_parse(struct lnet_ni *ni, struct lnet_hdr *hdr, lnet_nid_t from_nid,
-	   void *private, int rdma_req)
+static inline bool
+lnet_is_bundle(struct lnet_hdr *hdr)
+{
+	return le32_to_cpu(hdr->type) == LNET_MSG_PUT &&
+	       le32_to_cpu(hdr->msg.put.ptl_index) == LNET_RESERVED_PORTAL &&
+	       le64_to_cpu(hdr->msg.put.match_bits) ==
+	       LNET_PROTO_BUNDLE_MATCHBITS;
+}
+
+static int lnet_parse_common(struct lnet_ni *ni, struct lnet_hdr *hdr,
+			     lnet_nid_t from_nid, void *private, int rdma_req,
+			     struct lnet_msg_bundle *mb, unsigned int mb_offset);
+
+/*
+ * Receive the payload of a bundle into a buffer of its own.  The records
+ * are parsed by lnet_unpack_bundle() once the LND has finalized @msg.
+ */
+static int
+lnet_parse_bundle(struct lnet_ni *ni, struct lnet_msg *msg)
+{
+	struct lnet_msg_bundle *mb;
+
+	if (msg->msg_len == 0)
+		return -EPROTO;
+
+	mb = lnet_msg_bundle_alloc(msg->msg_len);
+	if (mb == NULL)
+		return -ENOMEM;
+
+	msg->msg_bundle_wire = 1;
+	msg->msg_bundle = mb;
+	msg->msg_niov = 1;
+	msg->msg_iov = &mb->mb_iov;
+
+	lnet_ni_recv(ni, msg->msg_private, msg, 0, 0, msg->msg_len,
+		     msg->msg_len);
+	return 0;
+}
+
+void
+lnet_unpack_bundle(struct lnet_msg *msg)
+{
+	struct lnet_msg_bundle *mb = msg->msg_bundle;
+	__u64 nrecs = le64_to_cpu(msg->msg_hdr.msg.put.hdr_data);
+	unsigned int offset = 0;
+	struct lnet_hdr hdr;
+	__u32 nob;
+
+	LASSERT(msg->msg_bundle_wire && !msg->msg_sending);
+
+	for (; nrecs > 0; nrecs--) {
+		if (mb->mb_size - offset < sizeof(hdr))
+			goto bad;
+
+		memcpy(&hdr, mb->mb_data + offset, sizeof(hdr));
+		offset += sizeof(hdr);
+
+		/* the records must be PUTs from the sender of the bundle
+		 * to the NI it arrived on */
+		nob = le32_to_cpu(hdr.payload_length);
+		if (le32_to_cpu(hdr.type) != LNET_MSG_PUT ||
+		    lnet_is_bundle(&hdr) ||
+		    le64_to_cpu(hdr.src_nid) != msg->msg_hdr.src_nid ||
+		    le64_to_cpu(hdr.dest_nid) != msg->msg_rxni->ni_nid ||
+		    mb->mb_size - offset < nob)
+			goto bad;
+
+		/* no LND context: the payload is copied from the bundle by
+		 * lnet_unbundled_recv() */
+		lnet_parse_common(msg->msg_rxni, &hdr, msg->msg_from, NULL, 0,
+				  mb, offset);
+
+		offset += ALIGN(nob, LNET_BUNDLE_ALIGN);
+	}
+	return;
+ bad:
+	CERROR("%s: bad record at offset %u of bundle from %s, %llu dropped\n",
+	       libcfs_nid2str(msg->msg_rxni->ni_nid), offset,
+	       libcfs_nid2str(msg->msg_from), nrecs);
+}
+
+/*
+ * @mb is the bundle the message was unpacked from, and @mb_offset the
+ * offset of its payload there, or NULL if the message came from the LND.
+ */
+static int
+lnet_parse_common(struct lnet_ni *ni, struct lnet_hdr *hdr,
+		  lnet_nid_t from_nid, void *private, int rdma_req,
+		  struct lnet_msg_bundle *mb, unsigned int mb_offset)
 {
 	int		rc = 0;
 	int		cpt;
@@ -2779,6 +3565,21 @@ lnet_parse(struct lnet_ni *ni, struct lnet_hdr *hdr, lnet_nid_t from_nid,
 
 	lnet_msg_commit(msg, cpt);
 
+	if (mb != NULL) {
+		atomic_inc(&mb->mb_refcount);
+		msg->msg_bundle = mb;
+		msg->msg_bundle_offset = mb_offset;
+		msg->msg_unbundled = 1;
+	}
+
+	if (for_me && lnet_is_bundle(hdr)) {
+		lnet_net_unlock(cpt);
+		rc = lnet_parse_bundle(ni, msg);
+		if (rc != 0)
+			goto free_drop;
+		return 0;
+	}
+
 	/* message delay simulation */
 	if (unlikely(!list_empty(&the_lnet.ln_delay_rules) &&
 		     lnet_delay_rule_match_locked(hdr, msg))) {
@@ -2815,8 +3616,89 @@ lnet_parse(struct lnet_ni *ni, struct lnet_hdr *hdr, lnet_nid_t from_nid,
 	lnet_drop_message(ni, cpt, private, payload_length, type);
 	return 0;
 }
+
+int
+lnet_parse(struct lnet_ni *ni, struct lnet_hdr *hdr, lnet_nid_t from_nid,
+	   void *private, int rdma_req)
+{
+	return lnet_parse_common(ni, hdr, from_nid, private, rdma_req,
+				 NULL, 0);
+}
 EXPORT_SYMBOL(lnet_parse);
 
+/*
+ * Receive \a sendmsg, sent by this node to itself over lolnd.  The header
+ * was built by lnet_send() and the sender's peer NI is the receiver's, so
+ * the checks and the peer lookup of lnet_parse() are skipped.  Messages
+ * that fault injection may act on still go through lnet_parse().
+ */
+int
+lnet_parse_loopback(struct lnet_ni *ni, struct lnet_msg *sendmsg)
+{
+	struct lnet_hdr *hdr = &sendmsg->msg_hdr;
+	struct lnet_peer_ni *lpni = sendmsg->msg_txpeer;
+	struct lnet_msg *msg;
+	__u32 type;
+	__u32 payload_length;
+	int cpt;
+	int rc;
+
+	LASSERT(ni == the_lnet.ln_loni);
+
+	if (lpni == NULL ||
+	    !list_empty(&the_lnet.ln_test_peers) ||
+	    !list_empty(&the_lnet.ln_drop_rules) ||
+	    !list_empty(&the_lnet.ln_delay_rules))
+		return lnet_parse(ni, hdr, ni->ni_nid, sendmsg, 0);
+
+	msg = lnet_msg_alloc();
+	if (msg == NULL)
+		return lnet_parse(ni, hdr, ni->ni_nid, sendmsg, 0);
+
+	type = le32_to_cpu(hdr->type);
+	payload_length = le32_to_cpu(hdr->payload_length);
+
+	msg->msg_type = type;
+	msg->msg_private = sendmsg;
+	msg->msg_receiving = 1;
+	msg->msg_len = msg->msg_wanted = payload_length;
+	msg->msg_offset = 0;
+	msg->msg_from = ni->ni_nid;
+
+	msg->msg_hdr = *hdr;
+	msg->msg_hdr.type = type;
+	msg->msg_hdr.src_nid = le64_to_cpu(hdr->src_nid);
+	msg->msg_hdr.src_pid = le32_to_cpu(hdr->src_pid);
+	msg->msg_hdr.dest_nid = le64_to_cpu(hdr->dest_nid);
+	msg->msg_hdr.dest_pid = le32_to_cpu(hdr->dest_pid);
+	msg->msg_hdr.payload_length = payload_length;
+
+	LASSERT(msg->msg_hdr.dest_nid == ni->ni_nid);
+
+	CDEBUG(D_NET, "TRACE: %s <- %s : %s - loopback\n",
+	       libcfs_nid2str(ni->ni_nid),
+	       libcfs_nid2str(msg->msg_hdr.src_nid),
+	       lnet_msgtyp2str(type));
+
+	cpt = lnet_cpt_of_nid(ni->ni_nid, ni);
+	lnet_net_lock(cpt);
+	lnet_peer_ni_addref_locked(lpni);
+	msg->msg_rxpeer = lpni;
+	msg->msg_rxni = ni;
+	lnet_ni_addref_locked(ni, cpt);
+	msg->msg_initiator = lpni->lpni_peer_net->lpn_peer->lp_primary_nid;
+	lnet_msg_commit(msg, cpt);
+	lnet_net_unlock(cpt);
+
+	rc = lnet_parse_local(ni, msg);
+	if (rc != 0) {
+		LASSERT(msg->msg_md == NULL);
+		lnet_finalize(msg, rc);
+		lnet_drop_message(ni, cpt, sendmsg, payload_length, type);
+	}
+	return 0;
+}
+
 void
 lnet_drop_delayed_msg_list(struct list_head *head, char *reason)
 {
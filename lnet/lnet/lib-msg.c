@@ -178,7 +178,8 @@ lnet_msg_decommit_tx(struct lnet_msg *msg, int status)
 	struct lnet_event *ev = &msg->msg_ev;
 
 	LASSERT(msg->msg_tx_committed);
-	if (status != 0)
+	/* the PUTs in a bundle are counted one by one when finalized */
+	if (status != 0 || msg->msg_bundle_wire)
 		goto out;
 
 	counters = the_lnet.ln_counters[msg->msg_tx_cpt];
@@ -240,7 +241,8 @@ lnet_msg_decommit_rx(struct lnet_msg *msg, int status)
 	LASSERT(!msg->msg_tx_committed); /* decommitted or never committed */
 	LASSERT(msg->msg_rx_committed);
 
-	if (status != 0)
+	/* the PUTs in a bundle are counted one by one when parsed */
+	if (status != 0 || msg->msg_bundle_wire)
 		goto out;
 
 	counters = the_lnet.ln_counters[msg->msg_rx_cpt];
@@ -456,6 +458,163 @@ lnet_complete_msg_locked(struct lnet_msg *msg, int cpt)
 	return 0;
 }
 
+/*
+ * A PUT or GET failed on the path lnet_select_pathway() picked for it.
+ * While the message is within its deadline and retry budget, decommit it,
+ * which charges the failure to the NI and peer NI it used and returns their
+ * credits, and queue it for the router checker thread to send again, see
+ * lnet_msg_resend_pending().  The failure is usually reported from LND
+ * completion context, which must not go back into lnet_send().
+ *
+ * Return true if the message was queued, in which case it will be
+ * finalized again once it has been resent.
+ */
+static bool
+lnet_msg_resend(struct lnet_msg *msg, int status)
+{
+	int cpt;
+
+	if (!msg->msg_tx_committed || msg->msg_rx_committed ||
+	    msg->msg_routing || !msg->msg_sending)
+		return false;
+
+	if (msg->msg_type != LNET_MSG_PUT && msg->msg_type != LNET_MSG_GET)
+		return false;
+
+	/* a failed bundle is never resent as a whole, the PUTs in it were
+	 * finalized with its status and are resent one by one */
+	if (msg->msg_bundle_wire)
+		return false;
+
+	if (lnet_health_error_site(status) == 0 ||
+	    msg->msg_retry_count >= lnet_retry_count ||
+	    ktime_get_seconds() >= msg->msg_deadline)
+		return false;
+
+	cpt = msg->msg_tx_cpt;
+	lnet_net_lock(cpt);
+	if (the_lnet.ln_state != LNET_STATE_RUNNING ||
+	    the_lnet.ln_rc_state != LNET_RC_STATE_RUNNING ||
+	    msg->msg_txni == the_lnet.ln_loni) {
+		lnet_net_unlock(cpt);
+		return false;
+	}
+	lnet_msg_decommit(msg, cpt, status);
+	list_add_tail(&msg->msg_list,
+		      &the_lnet.ln_msg_containers[cpt]->msc_resending);
+	lnet_net_unlock(cpt);
+
+	wake_up(&the_lnet.ln_rc_waitq);
+	return true;
+}
+
+bool
+lnet_msg_resend_queued(void)
+{
+	struct lnet_msg_container *container;
+	int cpt;
+
+	if (the_lnet.ln_msg_containers == NULL)
+		return false;
+
+	cfs_percpt_for_each(container, cpt, the_lnet.ln_msg_containers) {
+		if (!list_empty(&container->msc_resending))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Send again the messages lnet_msg_resend() queued, from the router checker
+ * thread.  Selection now prefers healthier interfaces, so another rail or
+ * peer NI is used if there is one.  If @stopping, or if there is no other
+ * path, the messages are completed with their original error.
+ */
+void
+lnet_msg_resend_pending(bool stopping)
+{
+	struct lnet_msg_container *container;
+	struct lnet_msg *msg;
+	struct list_head resends;
+	int status;
+	int cpt;
+	int rc;
+
+	INIT_LIST_HEAD(&resends);
+	cfs_percpt_for_each(container, cpt, the_lnet.ln_msg_containers) {
+		if (list_empty(&container->msc_resending))
+			continue;
+		lnet_net_lock(cpt);
+		list_splice_init(&container->msc_resending, &resends);
+		lnet_net_unlock(cpt);
+	}
+
+	while (!list_empty(&resends)) {
+		msg = list_entry(resends.next, struct lnet_msg, msg_list);
+		list_del_init(&msg->msg_list);
+		status = msg->msg_ev.status;
+
+		if (stopping) {
+			lnet_finalize(msg, status);
+			continue;
+		}
+
+		CDEBUG(D_NET, "resending %s to %s after %d, retry %u\n",
+		       lnet_msgtyp2str(msg->msg_type),
+		       libcfs_id2str(msg->msg_target), status,
+		       msg->msg_retry_count + 1);
+
+		/* lnet_select_pathway() may have retargeted the message to a
+		 * peer NI or a router, restore the final destination from the
+		 * header */
+		msg->msg_retry_count++;
+		msg->msg_sending = 0;
+		msg->msg_tx_delayed = 0;
+		msg->msg_target_is_router = 0;
+		msg->msg_target.nid = le64_to_cpu(msg->msg_hdr.dest_nid);
+		msg->msg_target.pid = le32_to_cpu(msg->msg_hdr.dest_pid);
+		msg->msg_ev.status = 0;
+
+		rc = lnet_send(msg->msg_src_nid_param, msg,
+			       msg->msg_rtr_nid_param);
+		if (rc == 0)
+			continue;
+
+		/* no other path, complete with the original error */
+		CDEBUG(D_NET, "resend of %s failed: %d\n",
+		       libcfs_id2str(msg->msg_target), rc);
+		lnet_finalize(msg, status);
+	}
+}
+
+/*
+ * @msg is done with the bundle it points to.  If it carried the bundle to
+ * a peer, finalize the PUTs in it with its status; they are resent one by
+ * one if it failed.  If it received the bundle, parse the PUTs in it.
+ */
+static void
+lnet_msg_bundle_done(struct lnet_msg *msg, int status)
+{
+	struct lnet_msg_bundle *mb = msg->msg_bundle;
+	struct lnet_msg *tmp;
+	struct list_head msgs;
+
+	if (msg->msg_bundle_wire && msg->msg_sending) {
+		INIT_LIST_HEAD(&msgs);
+		list_splice_init(&mb->mb_msgs, &msgs);
+		while (!list_empty(&msgs)) {
+			tmp = list_entry(msgs.next, struct lnet_msg, msg_list);
+			list_del(&tmp->msg_list);
+			lnet_finalize(tmp, status);
+		}
+	} else if (msg->msg_bundle_wire && status == 0) {
+		lnet_unpack_bundle(msg);
+	}
+
+	msg->msg_bundle = NULL;
+	lnet_msg_bundle_decref(mb);
+}
+
 void
 lnet_finalize(struct lnet_msg *msg, int status)
 {
@@ -472,6 +631,12 @@ lnet_finalize(struct lnet_msg *msg, int status)
 
 	msg->msg_ev.status = status;
 
+	if (msg->msg_bundle != NULL)
+		lnet_msg_bundle_done(msg, status);
+
+	if (status != 0 && lnet_msg_resend(msg, status))
+		return;
+
 	if (msg->msg_md != NULL) {
 		cpt = lnet_cpt_of_cookie(msg->msg_md->md_lh.lh_cookie);
 
@@ -554,6 +719,9 @@ lnet_msg_container_cleanup(struct lnet_msg_container *container)
 	if (container->msc_init == 0)
 		return;
 
+	/* drained by the router checker before it stops */
+	LASSERT(list_empty(&container->msc_resending));
+
 	while (!list_empty(&container->msc_active)) {
 		struct lnet_msg *msg;
 
@@ -587,6 +755,7 @@ lnet_msg_container_setup(struct lnet_msg_container *container, int cpt)
 
 	INIT_LIST_HEAD(&container->msc_active);
 	INIT_LIST_HEAD(&container->msc_finalizing);
+	INIT_LIST_HEAD(&container->msc_resending);
 
 	/* number of CPUs */
 	container->msc_nfinalizers = cfs_cpt_weight(lnet_cpt_table(), cpt);
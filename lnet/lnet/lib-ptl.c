@@ -135,6 +135,16 @@ lnet_ptl_disable_mt(struct lnet_portal *ptl, int cpt)
 	}
 }
 
+/* \a me will never match again until a new MD is attached */
+static inline void
+lnet_me_set_dead(struct lnet_me *me)
+{
+	if (me->me_live) {
+		me->me_live = 0;
+		me->me_mask->mm_live--;
+	}
+}
+
 static int
 lnet_try_match_md(struct lnet_libmd *md,
 		  struct lnet_match_info *info, struct lnet_msg *msg)
@@ -205,6 +215,8 @@ lnet_try_match_md(struct lnet_libmd *md,
 	if (!lnet_md_exhausted(md))
 		return LNET_MATCHMD_OK;
 
+	lnet_me_set_dead(me);
+
 	/* Auto-unlink NOW, so the ME gets unlinked if required.
 	 * We bumped md->md_refcount above so the MD just gets flagged
 	 * for unlink when it is finalized. */
@@ -371,6 +383,210 @@ lnet_mt_match_head(struct lnet_match_table *mtable,
 	}
 }
 
+static inline struct list_head *
+lnet_mt_mask_head(struct lnet_mt_mask *mm, __u64 mbits)
+{
+	return &mm->mm_hash[hash_64(mbits & ~mm->mm_ignore_bits,
+				    LNET_MT_MASK_HASH_BITS)];
+}
+
+static struct lnet_mt_mask *
+lnet_mt_mask_find(struct lnet_match_table *mtable, __u64 ignore_bits)
+{
+	struct lnet_mt_mask *mm;
+
+	list_for_each_entry(mm, &mtable->mt_masks, mm_link) {
+		if (mm->mm_ignore_bits == ignore_bits)
+			return mm;
+	}
+	return NULL;
+}
+
+/**
+ * Index \a me, which has ignore bits, by its mask before it is put on
+ * mt_mhash[LNET_MT_HASH_IGNORE] at \a pos. Called with
+ * lnet_res_lock(mtable->mt_cpt) held, which is dropped to allocate a new
+ * mask; \a me is not visible to matching yet so that does not matter.
+ *
+ * If the mask cannot be indexed the whole index of \a mtable is turned
+ * off and matching falls back to scanning the list.
+ */
+void
+lnet_mt_mask_add(struct lnet_match_table *mtable, struct lnet_me *me,
+		 enum lnet_ins_pos pos)
+{
+	struct lnet_mt_mask *mm;
+	struct lnet_mt_mask *mm_new;
+	int i;
+
+	LASSERT(me->me_ignore_bits != 0);
+
+	if (mtable->mt_masks_off)
+		return;
+
+	mm = lnet_mt_mask_find(mtable, me->me_ignore_bits);
+	if (mm == NULL) {
+		if (mtable->mt_nmasks >= LNET_MT_MASKS_MAX) {
+			CDEBUG(D_NET, "portal %d: more than %d ignore masks, "
+			       "not indexing\n", mtable->mt_portal,
+			       LNET_MT_MASKS_MAX);
+			mtable->mt_masks_off = 1;
+			return;
+		}
+
+		lnet_res_unlock(mtable->mt_cpt);
+		LIBCFS_CPT_ALLOC(mm_new, lnet_cpt_table(), mtable->mt_cpt,
+				 sizeof(*mm_new));
+		lnet_res_lock(mtable->mt_cpt);
+
+		if (mm_new == NULL) {
+			mtable->mt_masks_off = 1;
+			return;
+		}
+
+		/* raced with another thread adding the same mask? */
+		mm = lnet_mt_mask_find(mtable, me->me_ignore_bits);
+		if (mm != NULL || mtable->mt_masks_off) {
+			LIBCFS_FREE(mm_new, sizeof(*mm_new));
+			if (mm == NULL)
+				return;
+		} else {
+			mm = mm_new;
+			mm->mm_mtable = mtable;
+			mm->mm_ignore_bits = me->me_ignore_bits;
+			for (i = 0; i < LNET_MT_MASK_HASH_SIZE; i++)
+				INIT_LIST_HEAD(&mm->mm_hash[i]);
+			list_add_tail(&mm->mm_link, &mtable->mt_masks);
+			mtable->mt_nmasks++;
+		}
+	}
+
+	me->me_mask = mm;
+	mm->mm_count++;
+	if (pos == LNET_INS_BEFORE) {
+		me->me_seq = --mtable->mt_seq_head;
+		list_add(&me->me_mask_list,
+			 lnet_mt_mask_head(mm, me->me_match_bits));
+	} else {
+		me->me_seq = ++mtable->mt_seq_tail;
+		list_add_tail(&me->me_mask_list,
+			      lnet_mt_mask_head(mm, me->me_match_bits));
+	}
+}
+
+/* called with lnet_res_lock held, after the MD of \a me is detached */
+void
+lnet_mt_mask_del(struct lnet_me *me)
+{
+	struct lnet_mt_mask *mm = me->me_mask;
+
+	if (mm == NULL)
+		return;
+
+	LASSERT(!me->me_live);
+	list_del(&me->me_mask_list);
+	me->me_mask = NULL;
+
+	if (--mm->mm_count == 0) {
+		list_del(&mm->mm_link);
+		mm->mm_mtable->mt_nmasks--;
+		LIBCFS_FREE(mm, sizeof(*mm));
+	}
+}
+
+/* can \a me match \a info? Same checks as lnet_try_match_md() */
+static bool
+lnet_me_may_match(struct lnet_me *me, struct lnet_match_info *info)
+{
+	struct lnet_libmd *md = me->me_md;
+
+	if (md == NULL || lnet_md_exhausted(md))
+		return false;
+
+	if ((md->md_options & info->mi_opc) == 0)
+		return false;
+
+	if (me->me_match_id.nid != LNET_NID_ANY &&
+	    me->me_match_id.nid != info->mi_id.nid)
+		return false;
+
+	if (me->me_match_id.pid != LNET_PID_ANY &&
+	    me->me_match_id.pid != info->mi_id.pid)
+		return false;
+
+	return ((me->me_match_bits ^ info->mi_mbits) &
+		~me->me_ignore_bits) == 0;
+}
+
+/*
+ * Match against the MEs with ignore bits through the mask index: only the
+ * hash chain for \a info in each mask is examined, and of the candidates
+ * the one first on mt_mhash[LNET_MT_HASH_IGNORE] (lowest me_seq) wins, as
+ * it would have with a scan of the whole list.
+ *
+ * Returns the lnet_try_match_md() result of the winner, or
+ * LNET_MATCHMD_NONE with LNET_MATCHMD_EXHAUSTED set if no ME on the list
+ * has an unexhausted MD.
+ */
+static int
+lnet_mt_match_masks(struct lnet_match_table *mtable,
+		    struct lnet_match_info *info, struct lnet_msg *msg)
+{
+	struct lnet_mt_mask *mm;
+	struct lnet_me *best = NULL;
+	struct lnet_me *me;
+	int live = 0;
+	int rc;
+
+	list_for_each_entry(mm, &mtable->mt_masks, mm_link) {
+		live += mm->mm_live;
+
+		list_for_each_entry(me, lnet_mt_mask_head(mm, info->mi_mbits),
+				    me_mask_list) {
+			/* chains are in list order, nothing better here */
+			if (best != NULL && me->me_seq > best->me_seq)
+				break;
+
+			mtable->mt_nscan++;
+			if (lnet_me_may_match(me, info)) {
+				best = me;
+				break;
+			}
+		}
+	}
+
+	if (best == NULL)
+		return LNET_MATCHMD_NONE |
+		       (live == 0 ? LNET_MATCHMD_EXHAUSTED : 0);
+
+	rc = lnet_try_match_md(best->me_md, info, msg);
+	LASSERT((rc & LNET_MATCHMD_FINISH) != 0);
+	return rc;
+}
+
+void
+lnet_mt_match_counters(__u64 *nmatch, __u64 *nscan, int *nmasks_off)
+{
+	struct lnet_match_table *mtable;
+	int i;
+	int j;
+
+	*nmatch = 0;
+	*nscan = 0;
+	*nmasks_off = 0;
+
+	for (i = 0; i < the_lnet.ln_nportals; i++) {
+		struct lnet_portal *ptl = the_lnet.ln_portals[i];
+
+		/* read w/o lock, these are only statistics */
+		cfs_percpt_for_each(mtable, j, ptl->ptl_mtables) {
+			*nmatch += mtable->mt_nmatch;
+			*nscan += mtable->mt_nscan;
+			*nmasks_off += mtable->mt_masks_off;
+		}
+	}
+}
+
 int
 lnet_mt_match_md(struct lnet_match_table *mtable,
 		 struct lnet_match_info *info, struct lnet_msg *msg)
@@ -386,12 +602,26 @@ lnet_mt_match_md(struct lnet_match_table *mtable,
 		head = &mtable->mt_mhash[LNET_MT_HASH_IGNORE];
 	else
 		head = lnet_mt_match_head(mtable, info->mi_id, info->mi_mbits);
+
+	mtable->mt_nmatch++;
  again:
 	/* NB: only wildcard portal needs to return LNET_MATCHMD_EXHAUSTED */
 	if (lnet_ptl_is_wildcard(the_lnet.ln_portals[mtable->mt_portal]))
 		exhausted = LNET_MATCHMD_EXHAUSTED;
 
+	if (head == &mtable->mt_mhash[LNET_MT_HASH_IGNORE] &&
+	    !mtable->mt_masks_off) {
+		rc = lnet_mt_match_masks(mtable, info, msg);
+		if ((rc & LNET_MATCHMD_FINISH) != 0)
+			return rc & ~LNET_MATCHMD_EXHAUSTED;
+		if ((rc & LNET_MATCHMD_EXHAUSTED) == 0)
+			exhausted = 0;
+		goto done;
+	}
+
 	list_for_each_entry_safe(me, tmp, head, me_list) {
+		mtable->mt_nscan++;
+
 		/* ME attached but MD not attached yet */
 		if (me->me_md == NULL)
 			continue;
@@ -408,7 +638,7 @@ lnet_mt_match_md(struct lnet_match_table *mtable,
 			return rc & ~LNET_MATCHMD_EXHAUSTED;
 		}
 	}
-
+ done:
 	if (exhausted == LNET_MATCHMD_EXHAUSTED) { /* @head is exhausted */
 		lnet_mt_set_exhausted(mtable, head - mtable->mt_mhash, 1);
 		if (!lnet_mt_test_exhausted(mtable, -1))
@@ -641,6 +871,7 @@ lnet_ptl_detach_md(struct lnet_me *me, struct lnet_libmd *md)
 {
 	LASSERT(me->me_md == md && md->md_me == me);
 
+	lnet_me_set_dead(me);
 	me->me_md = NULL;
 	md->md_me = NULL;
 }
@@ -662,6 +893,10 @@ lnet_ptl_attach_md(struct lnet_me *me, struct lnet_libmd *md,
 
 	me->me_md = md;
 	md->md_me = me;
+	if (me->me_mask != NULL && !lnet_md_exhausted(md)) {
+		me->me_live = 1;
+		me->me_mask->mm_live++;
+	}
 
 	cpt = lnet_cpt_of_cookie(md->md_lh.lh_cookie);
 	mtable = ptl->ptl_mtables[cpt];
@@ -768,6 +1003,8 @@ lnet_ptl_cleanup(struct lnet_portal *ptl)
 						struct lnet_me, me_list);
 				CERROR("Active ME %p on exit\n", me);
 				list_del(&me->me_list);
+				me->me_live = 0;
+				lnet_mt_mask_del(me);
 				lnet_me_free(me);
 			}
 		}
@@ -814,6 +1051,7 @@ lnet_ptl_setup(struct lnet_portal *ptl, int index)
 		mtable->mt_mhash = mhash;
 		for (j = 0; j < LNET_MT_HASH_SIZE + 1; j++)
 			INIT_LIST_HEAD(&mhash[j]);
+		INIT_LIST_HEAD(&mtable->mt_masks);
 
 		mtable->mt_portal = index;
 		mtable->mt_cpt = i;
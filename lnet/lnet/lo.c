@@ -37,7 +37,7 @@ lolnd_send(struct lnet_ni *ni, void *private, struct lnet_msg *lntmsg)
 	LASSERT(!lntmsg->msg_routing);
 	LASSERT(!lntmsg->msg_target_is_router);
 
-	return lnet_parse(ni, &lntmsg->msg_hdr, ni->ni_nid, lntmsg, 0);
+	return lnet_parse_loopback(ni, lntmsg);
 }
 
 static int
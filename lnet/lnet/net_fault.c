@@ -181,9 +181,11 @@ lnet_drop_rule_add(struct lnet_fault_attr *attr)
 	list_add(&rule->dr_link, &the_lnet.ln_drop_rules);
 	lnet_net_unlock(LNET_LOCK_EX);
 
-	CDEBUG(D_NET, "Added drop rule: src %s, dst %s, rate %d, interval %d\n",
+	CDEBUG(D_NET, "Added drop rule: src %s, dst %s, rate %d, interval %d, "
+	       "error %d\n",
 	       libcfs_nid2str(attr->fa_src), libcfs_nid2str(attr->fa_src),
-	       attr->u.drop.da_rate, attr->u.drop.da_interval);
+	       attr->u.drop.da_rate, attr->u.drop.da_interval,
+	       attr->u.drop.da_error);
 	RETURN(0);
 }
 
@@ -356,18 +358,18 @@ drop_rule_match(struct lnet_drop_rule *rule, lnet_nid_t src,
 }
 
 /**
- * Check if message from \a src to \a dst can match any existed drop rule
+ * Find the first rule matching message \a hdr among the drop rules which
+ * fail messages on the sender if \a sending, or among those which drop them
+ * on the receiver otherwise.
  */
-bool
-lnet_drop_rule_match(struct lnet_hdr *hdr)
+static struct lnet_drop_rule *
+lnet_drop_rule_find(struct lnet_hdr *hdr, bool sending)
 {
 	struct lnet_drop_rule	*rule;
 	lnet_nid_t		 src = le64_to_cpu(hdr->src_nid);
 	lnet_nid_t		 dst = le64_to_cpu(hdr->dest_nid);
 	unsigned int		 typ = le32_to_cpu(hdr->type);
 	unsigned int		 ptl = -1;
-	bool			 drop = false;
-	int			 cpt;
 
 	/* NB: if Portal is specified, then only PUT and GET will be
 	 * filtered by drop rule */
@@ -376,23 +378,78 @@ lnet_drop_rule_match(struct lnet_hdr *hdr)
 	else if (typ == LNET_MSG_GET)
 		ptl = le32_to_cpu(hdr->msg.get.ptl_index);
 
-	cpt = lnet_net_lock_current();
 	list_for_each_entry(rule, &the_lnet.ln_drop_rules, dr_link) {
-		drop = drop_rule_match(rule, src, dst, typ, ptl);
-		if (drop)
-			break;
+		if ((rule->dr_attr.u.drop.da_error != 0) != sending)
+			continue;
+		if (drop_rule_match(rule, src, dst, typ, ptl))
+			return rule;
 	}
+	return NULL;
+}
+
+/**
+ * Check if message from \a src to \a dst can match any existed drop rule
+ */
+bool
+lnet_drop_rule_match(struct lnet_hdr *hdr)
+{
+	bool	drop;
+	int	cpt;
 
+	cpt = lnet_net_lock_current();
+	drop = lnet_drop_rule_find(hdr, false) != NULL;
 	lnet_net_unlock(cpt);
 	return drop;
 }
 
+/**
+ * Check if the message \a hdr about to be sent should fail, and return the
+ * error of the matching drop rule, 0 if it should be sent.
+ */
+int
+lnet_drop_rule_error(struct lnet_hdr *hdr)
+{
+	struct lnet_drop_rule	*rule;
+	int			 rc = 0;
+	int			 cpt;
+
+	cpt = lnet_net_lock_current();
+	rule = lnet_drop_rule_find(hdr, true);
+	if (rule != NULL)
+		rc = -(int)rule->dr_attr.u.drop.da_error;
+	lnet_net_unlock(cpt);
+	return rc;
+}
+
 /**
  * LNet Delay Simulation
  */
 /** timestamp (second) to send delayed message */
 #define msg_delay_send		 msg_ev.hdr_data
 
+/** # of hash buckets for flows of a delay rule */
+#define LNET_DELAY_FLOW_BITS	6
+/** max # of flows tracked by a delay rule, the rest share dl_flow */
+#define LNET_DELAY_FLOW_MAX	4096
+
+/**
+ * state of a (source, destination, portal) matched by a delay rule with
+ * bandwidth cap or latency jitter
+ */
+struct lnet_delay_flow {
+	/** chain on lnet_delay_rule::dl_flows */
+	struct list_head	df_link;
+	lnet_nid_t		df_src;
+	lnet_nid_t		df_dst;
+	unsigned int		df_portal;
+	/** bytes in token bucket, negative if there is a backlog */
+	s64			df_tokens;
+	/** when tokens were last refilled */
+	ktime_t			df_stamp;
+	/** jiffies to send the last delayed message of this flow */
+	unsigned long		df_last_send;
+};
+
 struct lnet_delay_rule {
 	/** link chain on the_lnet.ln_delay_rules */
 	struct list_head	dl_link;
@@ -423,6 +480,12 @@ struct lnet_delay_rule {
 	struct lnet_fault_stat	dl_stat;
 	/** timer to wakeup delay_daemon */
 	struct timer_list	dl_timer;
+	/** hash of flows, only for rule with bandwidth cap or jitter */
+	struct list_head	dl_flows[1 << LNET_DELAY_FLOW_BITS];
+	/** # of flows on \a dl_flows */
+	unsigned int		dl_nflows;
+	/** shared by flows beyond LNET_DELAY_FLOW_MAX */
+	struct lnet_delay_flow	dl_flow;
 };
 
 struct delay_daemon_data {
@@ -451,6 +514,23 @@ round_timeout(cfs_time_t timeout)
 			cfs_duration_sec(cfs_time_sub(timeout, 0)) + 1);
 }
 
+static void
+delay_rule_free_flows(struct lnet_delay_rule *rule)
+{
+	struct lnet_delay_flow *flow;
+	int			i;
+
+	for (i = 0; i < ARRAY_SIZE(rule->dl_flows); i++) {
+		while (!list_empty(&rule->dl_flows[i])) {
+			flow = list_entry(rule->dl_flows[i].next,
+					  struct lnet_delay_flow, df_link);
+			list_del(&flow->df_link);
+			CFS_FREE_PTR(flow);
+		}
+	}
+	rule->dl_nflows = 0;
+}
+
 static void
 delay_rule_decref(struct lnet_delay_rule *rule)
 {
@@ -459,10 +539,165 @@ delay_rule_decref(struct lnet_delay_rule *rule)
 		LASSERT(list_empty(&rule->dl_msg_list));
 		LASSERT(list_empty(&rule->dl_link));
 
+		delay_rule_free_flows(rule);
 		CFS_FREE_PTR(rule);
 	}
 }
 
+static inline bool
+delay_rule_shaped(struct lnet_fault_attr *attr)
+{
+	return attr->u.delay.la_latency_ms != 0 ||
+	       attr->u.delay.la_jitter != 0 ||
+	       attr->u.delay.la_bandwidth != 0;
+}
+
+static void
+delay_flow_init(struct lnet_delay_flow *flow, struct lnet_fault_attr *attr)
+{
+	flow->df_tokens	   = attr->u.delay.la_burst != 0 ?
+			     (s64)attr->u.delay.la_burst << 10 : LNET_MTU;
+	flow->df_stamp	   = ktime_get();
+	flow->df_last_send = jiffies;
+}
+
+/** find or create the flow of \a rule for (\a src, \a dst, \a portal) */
+static struct lnet_delay_flow *
+delay_flow_find(struct lnet_delay_rule *rule, lnet_nid_t src, lnet_nid_t dst,
+		unsigned int portal)
+{
+	struct lnet_delay_flow	*flow;
+	struct list_head	*head;
+
+	head = &rule->dl_flows[hash_64(src ^ (dst * 31) ^ portal,
+				       LNET_DELAY_FLOW_BITS)];
+	list_for_each_entry(flow, head, df_link) {
+		if (flow->df_src == src && flow->df_dst == dst &&
+		    flow->df_portal == portal)
+			return flow;
+	}
+
+	if (rule->dl_nflows >= LNET_DELAY_FLOW_MAX)
+		return &rule->dl_flow;
+
+	/* called with lnet_net_lock and dl_lock held */
+	LIBCFS_ALLOC_ATOMIC(flow, sizeof(*flow));
+	if (flow == NULL)
+		return &rule->dl_flow;
+
+	flow->df_src	= src;
+	flow->df_dst	= dst;
+	flow->df_portal = portal;
+	delay_flow_init(flow, &rule->dl_attr);
+
+	list_add(&flow->df_link, head);
+	rule->dl_nflows++;
+	return flow;
+}
+
+/** random deviation of latency, in nanoseconds */
+static s64
+delay_jitter_ns(struct lnet_fault_attr *attr)
+{
+	s64 jitter = (s64)attr->u.delay.la_jitter * NSEC_PER_MSEC;
+	s64 r = 0;
+	int i;
+
+	if (jitter == 0)
+		return 0;
+
+	if (attr->u.delay.la_jitter_dist == LNET_JITTER_NORMAL) {
+		/* Irwin-Hall: the sum of 12 uniform variables on [0, 1)
+		 * less 6 is close to the standard normal distribution */
+		for (i = 0; i < 12; i++)
+			r += cfs_rand() & 0xffff;
+		r -= 6 << 16;
+	} else {
+		/* uniform on [-la_jitter, la_jitter] */
+		r = (s64)(cfs_rand() % ((2 << 16) + 1)) - (1 << 16);
+	}
+
+	return div_s64(jitter * r, 1 << 16);
+}
+
+/**
+ * jiffies to deliver a message of \a nob bytes on \a flow: latency plus
+ * jitter, plus the time the token bucket needs to cover the message.
+ * Messages of a flow are never reordered.
+ */
+static unsigned long
+delay_flow_send_time(struct lnet_delay_rule *rule,
+		     struct lnet_delay_flow *flow, unsigned int nob)
+{
+	struct lnet_fault_attr	*attr = &rule->dl_attr;
+	s64			 delay;
+	s64			 xmit = 0;
+	unsigned long		 send;
+
+	delay = (s64)attr->u.delay.la_latency * NSEC_PER_SEC +
+		(s64)attr->u.delay.la_latency_ms * NSEC_PER_MSEC +
+		delay_jitter_ns(attr);
+	if (delay < 0)
+		delay = 0;
+
+	if (attr->u.delay.la_bandwidth != 0) {
+		/* NB: KiB/s is ~bytes per (NSEC_PER_SEC >> 10) nsecs */
+		s64	kbps  = attr->u.delay.la_bandwidth;
+		s64	burst = attr->u.delay.la_burst != 0 ?
+				(s64)attr->u.delay.la_burst << 10 : LNET_MTU;
+		ktime_t	now   = ktime_get();
+		s64	elapsed;
+		s64	refill;
+
+		elapsed = ktime_to_ns(ktime_sub(now, flow->df_stamp));
+		flow->df_stamp = now;
+
+		/* time to refill the bucket from its current balance, which
+		 * is negative while earlier messages are still being paid
+		 * for; clamping elapsed to it keeps elapsed * kbps small */
+		refill = div_s64((burst - flow->df_tokens) *
+				 (NSEC_PER_SEC >> 10), kbps);
+		if (elapsed >= refill)
+			flow->df_tokens = burst;
+		else
+			flow->df_tokens += div_s64(elapsed * kbps,
+						   NSEC_PER_SEC >> 10);
+
+		flow->df_tokens -= nob;
+		if (flow->df_tokens < 0) {
+			delay += div_s64(-flow->df_tokens *
+					 (NSEC_PER_SEC >> 10), kbps);
+			rule->dl_stat.u.delay.ls_shaped++;
+		}
+		xmit = div_s64((s64)nob * (NSEC_PER_SEC >> 10), kbps);
+	}
+
+	send = jiffies + div_s64(delay + NSEC_PER_SEC / HZ - 1,
+				 NSEC_PER_SEC / HZ);
+	/* messages of a flow go out in order; one overtaken by jitter still
+	 * takes its own transmit time after the previous one */
+	if (time_before(send, flow->df_last_send))
+		send = flow->df_last_send + div_s64(xmit, NSEC_PER_SEC / HZ);
+	flow->df_last_send = send;
+
+	return send;
+}
+
+/** queue \a msg on \a rule in order of msg_delay_send */
+static void
+delay_msg_enqueue(struct lnet_delay_rule *rule, struct lnet_msg *msg)
+{
+	struct lnet_msg *tmp;
+
+	list_for_each_entry_reverse(tmp, &rule->dl_msg_list, msg_list) {
+		if (!time_before(msg->msg_delay_send, tmp->msg_delay_send)) {
+			list_add(&msg->msg_list, &tmp->msg_list);
+			return;
+		}
+	}
+	list_add(&msg->msg_list, &rule->dl_msg_list);
+}
+
 /**
  * check source/destination NID, portal, message type and delay rate,
  * decide whether should delay this message or not
@@ -525,10 +760,21 @@ delay_rule_match(struct lnet_delay_rule *rule, lnet_nid_t src,
 	lnet_fault_stat_inc(&rule->dl_stat, type);
 	rule->dl_stat.u.delay.ls_delayed++;
 
-	list_add_tail(&msg->msg_list, &rule->dl_msg_list);
-	msg->msg_delay_send = round_timeout(
-			cfs_time_shift(attr->u.delay.la_latency));
-	if (rule->dl_msg_send == -1) {
+	if (!delay_rule_shaped(attr)) {
+		list_add_tail(&msg->msg_list, &rule->dl_msg_list);
+		msg->msg_delay_send = round_timeout(
+				cfs_time_shift(attr->u.delay.la_latency));
+	} else {
+		struct lnet_delay_flow *flow;
+
+		flow = delay_flow_find(rule, src, dst, portal);
+		msg->msg_delay_send = delay_flow_send_time(rule, flow,
+				msg->msg_len + sizeof(struct lnet_hdr));
+		delay_msg_enqueue(rule, msg);
+	}
+
+	if (rule->dl_msg_send == -1 ||
+	    time_before(msg->msg_delay_send, rule->dl_msg_send)) {
 		rule->dl_msg_send = msg->msg_delay_send;
 		mod_timer(&rule->dl_timer, rule->dl_msg_send);
 	}
@@ -731,6 +977,7 @@ lnet_delay_rule_add(struct lnet_fault_attr *attr)
 {
 	struct lnet_delay_rule *rule;
 	int			rc = 0;
+	int			i;
 	ENTRY;
 
 	if (!((attr->u.delay.la_rate == 0) ^
@@ -742,11 +989,19 @@ lnet_delay_rule_add(struct lnet_fault_attr *attr)
 		RETURN(-EINVAL);
 	}
 
-	if (attr->u.delay.la_latency == 0) {
+	if (attr->u.delay.la_latency == 0 && !delay_rule_shaped(attr)) {
 		CDEBUG(D_NET, "delay latency cannot be zero\n");
 		RETURN(-EINVAL);
 	}
 
+	if (attr->u.delay.la_jitter > LNET_JITTER_MAX ||
+	    (attr->u.delay.la_jitter_dist != LNET_JITTER_UNIFORM &&
+	     attr->u.delay.la_jitter_dist != LNET_JITTER_NORMAL)) {
+		CDEBUG(D_NET, "invalid delay jitter %u/%u\n",
+		       attr->u.delay.la_jitter, attr->u.delay.la_jitter_dist);
+		RETURN(-EINVAL);
+	}
+
 	if (lnet_fault_attr_validate(attr) != 0)
 		RETURN(-EINVAL);
 
@@ -780,8 +1035,11 @@ lnet_delay_rule_add(struct lnet_fault_attr *attr)
 	spin_lock_init(&rule->dl_lock);
 	INIT_LIST_HEAD(&rule->dl_msg_list);
 	INIT_LIST_HEAD(&rule->dl_sched_link);
+	for (i = 0; i < ARRAY_SIZE(rule->dl_flows); i++)
+		INIT_LIST_HEAD(&rule->dl_flows[i]);
 
 	rule->dl_attr = *attr;
+	delay_flow_init(&rule->dl_flow, attr);
 	if (attr->u.delay.la_interval != 0) {
 		rule->dl_time_base = cfs_time_shift(attr->u.delay.la_interval);
 		rule->dl_delay_time = cfs_time_shift(cfs_rand() %
@@ -797,9 +1055,11 @@ lnet_delay_rule_add(struct lnet_fault_attr *attr)
 	list_add(&rule->dl_link, &the_lnet.ln_delay_rules);
 	lnet_net_unlock(LNET_LOCK_EX);
 
-	CDEBUG(D_NET, "Added delay rule: src %s, dst %s, rate %d\n",
+	CDEBUG(D_NET, "Added delay rule: src %s, dst %s, rate %d, "
+	       "jitter %u, bandwidth %u\n",
 	       libcfs_nid2str(attr->fa_src), libcfs_nid2str(attr->fa_src),
-	       attr->u.delay.la_rate);
+	       attr->u.delay.la_rate, attr->u.delay.la_jitter,
+	       attr->u.delay.la_bandwidth);
 
 	mutex_unlock(&delay_dd.dd_mutex);
 	RETURN(0);
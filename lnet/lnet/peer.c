@@ -170,6 +170,7 @@ lnet_peer_ni_alloc(lnet_nid_t nid)
 	lpni->lpni_nid = nid;
 	lpni->lpni_cpt = cpt;
 	lnet_set_peer_ni_health_locked(lpni, true);
+	lnet_health_init(&lpni->lpni_health);
 
 	net = lnet_get_net_locked(LNET_NIDNET(nid));
 	lpni->lpni_net = net;
@@ -314,6 +315,8 @@ lnet_peer_detach_peer_ni_locked(struct lnet_peer_ni *lpni)
 	 * partially connected peer_ni.
 	 */
 	lpn = lpni->lpni_peer_net;
+	/* cached paths hold references on the peer_ni */
+	lnet_path_cache_flush_peer_ni_locked(lpni);
 
 	list_del_init(&lpni->lpni_peer_nis);
 	/*
@@ -779,6 +782,86 @@ done:
 	return rc;
 }
 
+static void
+lnet_peer_ni_stats_rec(struct lnet_peer_ni *lpni,
+		       struct lnet_ioctl_stats_rec *rec)
+{
+	lnet_usr_stats_rec(rec, lpni->lpni_nid, &lpni->lpni_stats);
+	rec->isr_tx_credits = lpni->lpni_txcredits;
+	rec->isr_min_tx_credits = lpni->lpni_mintxcredits;
+	rec->isr_rtr_credits = lpni->lpni_rtrcredits;
+	rec->isr_min_rtr_credits = lpni->lpni_minrtrcredits;
+	if (lpni->lpni_txcredits < 0)
+		rec->isr_txq_msgs = -lpni->lpni_txcredits;
+	rec->isr_txq_nob = lpni->lpni_txqnob;
+	rec->isr_health = lnet_health_read(&lpni->lpni_health);
+}
+
+/*
+ * Copy the counters of every peer NI to @recs, see lnet_get_peer_list()
+ * for the locking and the size negotiation.
+ */
+int
+lnet_get_peer_ni_stats_bulk(__u32 *countp, __u32 *sizep,
+			    struct lnet_ioctl_stats_rec __user *recs)
+{
+	struct lnet_ioctl_stats_rec rec;
+	struct lnet_peer_table *ptable;
+	struct lnet_peer_net *lpn;
+	struct lnet_peer_ni *lpni;
+	struct lnet_peer *lp;
+	__u32 count = 0;
+	__u32 size;
+	__u32 i = 0;
+	int lncpt;
+	int cpt;
+	int rc;
+
+	lncpt = cfs_percpt_number(the_lnet.ln_peer_tables);
+	for (cpt = 0; cpt < lncpt; cpt++) {
+		ptable = the_lnet.ln_peer_tables[cpt];
+		list_for_each_entry(lp, &ptable->pt_peer_list, lp_peer_list) {
+			list_for_each_entry(lpn, &lp->lp_peer_nets,
+					    lpn_peer_nets) {
+				list_for_each_entry(lpni, &lpn->lpn_peer_nis,
+						    lpni_peer_nis)
+					count++;
+			}
+		}
+	}
+
+	size = count * sizeof(rec);
+	rc = -E2BIG;
+	if (size > *sizep)
+		goto done;
+
+	rc = -EFAULT;
+	for (cpt = 0; cpt < lncpt; cpt++) {
+		ptable = the_lnet.ln_peer_tables[cpt];
+		list_for_each_entry(lp, &ptable->pt_peer_list, lp_peer_list) {
+			list_for_each_entry(lpn, &lp->lp_peer_nets,
+					    lpn_peer_nets) {
+				list_for_each_entry(lpni, &lpn->lpn_peer_nis,
+						    lpni_peer_nis) {
+					if (i >= count)
+						goto done;
+
+					lnet_peer_ni_stats_rec(lpni, &rec);
+					if (copy_to_user(&recs[i], &rec,
+							 sizeof(rec)))
+						goto done;
+					i++;
+				}
+			}
+		}
+	}
+	rc = 0;
+done:
+	*countp = count;
+	*sizep = size;
+	return rc;
+}
+
 /*
  * Start pushes to peers that need to be updated for a configuration
  * change on this node.
@@ -904,6 +987,8 @@ lnet_peer_add_pref_nid(struct lnet_peer_ni *lpni, lnet_nid_t nid)
 	int i;
 	int rc = 0;
 
+	lnet_path_cache_invalidate();
+
 	if (nid == LNET_NID_ANY) {
 		rc = -EINVAL;
 		goto out;
@@ -978,6 +1063,8 @@ lnet_peer_del_pref_nid(struct lnet_peer_ni *lpni, lnet_nid_t nid)
 	int i, j;
 	int rc = 0;
 
+	lnet_path_cache_invalidate();
+
 	if (lpni->lpni_pref_nnids == 0) {
 		rc = -ENOENT;
 		goto out;
@@ -1123,6 +1210,7 @@ lnet_peer_attach_peer_ni(struct lnet_peer *lp,
 
 	/* Install the new peer_ni */
 	lnet_net_lock(LNET_LOCK_EX);
+	lnet_path_cache_invalidate();
 	/* Add peer_ni to global peer table hash, if necessary. */
 	if (list_empty(&lpni->lpni_hashlist)) {
 		int hash = lnet_nid2peerhash(lpni->lpni_nid);
@@ -1771,6 +1859,8 @@ static void lnet_peer_discovery_complete(struct lnet_peer *lp)
 	list_del_init(&lp->lp_dc_list);
 	list_splice_init(&lp->lp_dc_pendq, &pending_msgs);
 	wake_up_all(&lp->lp_dc_waitq);
+	/* the peer NIDs may have changed */
+	lnet_path_cache_invalidate();
 
 	lnet_net_unlock(LNET_LOCK_EX);
 
@@ -1891,6 +1981,11 @@ void lnet_peer_push_event(struct lnet_event *ev)
 		lp->lp_state &= ~LNET_PEER_NO_DISCOVERY;
 	}
 
+	if (pbuf->pb_info.pi_features & LNET_PING_FEAT_COALESCE)
+		lp->lp_state |= LNET_PEER_COALESCE;
+	else
+		lp->lp_state &= ~LNET_PEER_COALESCE;
+
 	/*
 	 * Check for truncation of the Put message. Clear the
 	 * NIDS_UPTODATE flag and set FORCE_PING to trigger a ping,
@@ -2198,6 +2293,11 @@ lnet_discovery_event_reply(struct lnet_peer *lp, struct lnet_event *ev)
 		lp->lp_state &= ~LNET_PEER_NO_DISCOVERY;
 	}
 
+	if (pbuf->pb_info.pi_features & LNET_PING_FEAT_COALESCE)
+		lp->lp_state |= LNET_PEER_COALESCE;
+	else
+		lp->lp_state &= ~LNET_PEER_COALESCE;
+
 	/*
 	 * Check for truncation of the Reply. Clear PING_SENT and set
 	 * PING_FAILED to trigger a retry.
@@ -91,6 +91,19 @@ static int router_ping_timeout = 50;
 module_param(router_ping_timeout, int, 0644);
 MODULE_PARM_DESC(router_ping_timeout, "Seconds to wait for the reply to a router health query");
 
+static int router_buffers_auto;
+module_param(router_buffers_auto, int, 0644);
+MODULE_PARM_DESC(router_buffers_auto, "Grow and shrink router buffer pools with demand (0 to disable)");
+
+static int router_buffers_max_mb;
+module_param(router_buffers_max_mb, int, 0644);
+MODULE_PARM_DESC(router_buffers_max_mb, "Memory cap in MiB for auto-sized router buffers (0 for 1/8 of RAM)");
+
+/* passes with more than half of a pool idle before it is shrunk */
+#define LNET_RTRPOOL_IDLE_PASSES	30
+
+static void lnet_rtrpools_autosize(void);
+
 int
 lnet_peers_start_down(void)
 {
@@ -128,6 +141,7 @@ lnet_notify_locked(struct lnet_peer_ni *lp, int notifylnd, int alive,
 
 	lp->lpni_alive_count++;
 	lp->lpni_alive = (alive) ? 1 : 0;
+	lnet_path_cache_invalidate();
 	lp->lpni_notify = 1;
 	lp->lpni_notifylnd = notifylnd;
 	if (lp->lpni_alive)
@@ -1288,6 +1302,10 @@ lnet_router_checker_active(void)
 	if (the_lnet.ln_rc_state != LNET_RC_STATE_RUNNING)
 		return true;
 
+	/* it resends the messages lnet_finalize() queued */
+	if (lnet_msg_resend_queued())
+		return true;
+
 	/* Router Checker thread needs to run when routing is enabled in
 	 * order to call lnet_update_ni_status_locked() */
 	if (the_lnet.ln_routing)
@@ -1311,6 +1329,8 @@ lnet_router_checker(void *arg)
 		int	cpt;
 		int	cpt2;
 
+		lnet_msg_resend_pending(false);
+
 		cpt = lnet_net_lock_current();
 rescan:
 		version = the_lnet.ln_routers_version;
@@ -1345,6 +1365,9 @@ rescan:
 
 		lnet_prune_rc_data(0); /* don't wait for UNLINK */
 
+		if (the_lnet.ln_routing && router_buffers_auto)
+			lnet_rtrpools_autosize();
+
 		/* Call schedule_timeout() here always adds 1 to load average
 		 * because kernel counts # active tasks as nr_running
 		 * + nr_uninterruptible. */
@@ -1356,10 +1379,16 @@ rescan:
 						 lnet_router_checker_active());
 		else
 			wait_event_interruptible_timeout(the_lnet.ln_rc_waitq,
-							 false,
-							 cfs_time_seconds(1));
+						lnet_msg_resend_queued(),
+						cfs_time_seconds(1));
 	}
 
+	/* lnet_msg_resend() no longer queues once the state has changed,
+	 * complete what it queued before */
+	lnet_net_lock(LNET_LOCK_EX);
+	lnet_net_unlock(LNET_LOCK_EX);
+	lnet_msg_resend_pending(true);
+
 	lnet_prune_rc_data(1); /* wait for UNLINK */
 
 	the_lnet.ln_rc_state = LNET_RC_STATE_SHUTDOWN;
@@ -1745,6 +1774,166 @@ lnet_rtrpools_adjust(int tiny, int small, int large)
 	return lnet_rtrpools_adjust_helper(tiny, small, large);
 }
 
+/* free idle buffers of \a rbp above its requested size right away */
+static void
+lnet_rtrpool_trim(struct lnet_rtrbufpool *rbp, int cpt)
+{
+	struct lnet_rtrbuf *rb;
+	struct list_head tmp;
+
+	INIT_LIST_HEAD(&tmp);
+
+	lnet_net_lock(cpt);
+	while (rbp->rbp_nbuffers > rbp->rbp_req_nbuffers &&
+	       rbp->rbp_credits > 0) {
+		rb = list_entry(rbp->rbp_bufs.next, struct lnet_rtrbuf,
+				rb_list);
+		list_move(&rb->rb_list, &tmp);
+		rbp->rbp_nbuffers--;
+		rbp->rbp_credits--;
+	}
+	if (rbp->rbp_mincredits > rbp->rbp_credits)
+		rbp->rbp_mincredits = rbp->rbp_credits;
+	lnet_net_unlock(cpt);
+
+	while (!list_empty(&tmp)) {
+		rb = list_entry(tmp.next, struct lnet_rtrbuf, rb_list);
+		list_del(&rb->rb_list);
+		lnet_destroy_rtrbuf(rb, rbp->rbp_npages);
+	}
+}
+
+static int
+lnet_rtrpool_floor(int idx)
+{
+	switch (idx) {
+	default:
+		LBUG();
+	case LNET_TINY_BUF_IDX:
+		return lnet_nrb_tiny_calculate();
+	case LNET_SMALL_BUF_IDX:
+		return lnet_nrb_small_calculate();
+	case LNET_LARGE_BUF_IDX:
+		return lnet_nrb_large_calculate();
+	}
+}
+
+/*
+ * Work out the new size of \a rbp from its low water mark since the last
+ * pass, and record the pass in its history. Messages having waited for a
+ * buffer (negative low water mark) grow the pool by at least a quarter;
+ * more than half of it idle for LNET_RTRPOOL_IDLE_PASSES shrinks it by
+ * half the idle buffers, never below the configured size.
+ *
+ * Returns the new size, or rbp_req_nbuffers if it should not change.
+ */
+static int
+lnet_rtrpool_autosize_locked(struct lnet_rtrbufpool *rbp, int floor)
+{
+	struct lnet_rtrpool_sample *rs;
+	int nbufs = rbp->rbp_req_nbuffers;
+	int low = rbp->rbp_win_mincredits;
+
+	rs = &rbp->rbp_hist[rbp->rbp_hist_idx++ % LNET_RTRPOOL_HIST];
+	rs->rs_nbuffers = rbp->rbp_nbuffers;
+	rs->rs_mincredits = low;
+
+	rbp->rbp_win_mincredits = rbp->rbp_credits;
+
+	if (low < 0) {
+		rbp->rbp_idle_passes = 0;
+		return nbufs + max(-low, nbufs / 4);
+	}
+
+	if (low <= nbufs / 2 || nbufs <= floor) {
+		rbp->rbp_idle_passes = 0;
+		return nbufs;
+	}
+
+	if (++rbp->rbp_idle_passes < LNET_RTRPOOL_IDLE_PASSES)
+		return nbufs;
+
+	rbp->rbp_idle_passes = 0;
+	return max(nbufs - low / 2, floor);
+}
+
+/*
+ * Called by the router checker about once a second when
+ * router_buffers_auto is set, to size each router buffer pool after the
+ * traffic it actually sees. All pools together stay under
+ * router_buffers_max_mb.
+ */
+static void
+lnet_rtrpools_autosize(void)
+{
+	struct lnet_rtrbufpool *rtrp;
+	long max_pages;
+	long used = 0;
+	int floor[LNET_NRBPOOLS];
+	int idx;
+	int i;
+
+	/* don't race with lnetctl or shutdown; try again next pass */
+	if (!mutex_trylock(&the_lnet.ln_api_mutex))
+		return;
+
+	if (!the_lnet.ln_routing || the_lnet.ln_rtrpools == NULL)
+		goto out;
+
+	if (router_buffers_max_mb > 0)
+		max_pages = (long)router_buffers_max_mb << (20 - PAGE_SHIFT);
+	else
+		max_pages = totalram_pages / 8;
+
+	for (idx = 0; idx < LNET_NRBPOOLS; idx++) {
+		floor[idx] = lnet_rtrpool_floor(idx);
+		if (floor[idx] < 0)
+			goto out;
+	}
+
+	cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
+		for (idx = 0; idx < LNET_NRBPOOLS; idx++)
+			used += (long)rtrp[idx].rbp_nbuffers *
+				max(rtrp[idx].rbp_npages, 1);
+	}
+
+	cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
+		for (idx = 0; idx < LNET_NRBPOOLS; idx++) {
+			struct lnet_rtrbufpool *rbp = &rtrp[idx];
+			int pages = max(rbp->rbp_npages, 1);
+			int nbufs;
+			int cur;
+
+			lnet_net_lock(i);
+			cur = rbp->rbp_req_nbuffers;
+			nbufs = lnet_rtrpool_autosize_locked(rbp, floor[idx]);
+			lnet_net_unlock(i);
+
+			if (nbufs > cur) {
+				long room = max(max_pages - used, 0L) / pages;
+
+				if (room < nbufs - cur) {
+					CDEBUG(D_NET, "router buffers capped at "
+					       "%ld pages\n", max_pages);
+					nbufs = cur + room;
+				}
+				used += (long)(nbufs - cur) * pages;
+			}
+
+			if (nbufs == cur)
+				continue;
+
+			CDEBUG(D_NET, "CPT %d: %d page router buffers %d -> %d\n",
+			       i, rbp->rbp_npages, cur, nbufs);
+			lnet_rtrpool_adjust_bufs(rbp, nbufs, i);
+			if (nbufs < cur)
+				lnet_rtrpool_trim(rbp, i);
+		}
+	}
+out:
+	mutex_unlock(&the_lnet.ln_api_mutex);
+}
+
 int
 lnet_rtrpools_enable(void)
 {
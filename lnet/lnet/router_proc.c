@@ -131,6 +131,85 @@ proc_lnet_stats(struct ctl_table *table, int write, void __user *buffer,
 				    __proc_lnet_stats);
 }
 
+static int __proc_lnet_path_cache(void *data, int write,
+				  loff_t pos, void __user *buffer, int nob)
+{
+	char	tmpstr[64];
+	__u64	hits;
+	__u64	misses;
+	int	len;
+
+	if (write)
+		return -EPERM;
+
+	lnet_net_lock(0);
+	if (the_lnet.ln_state != LNET_STATE_RUNNING) {
+		lnet_net_unlock(0);
+		return -ESHUTDOWN;
+	}
+	lnet_net_unlock(0);
+
+	lnet_path_cache_counters(&hits, &misses);
+	len = snprintf(tmpstr, sizeof(tmpstr), "hits: %llu misses: %llu",
+		       hits, misses);
+
+	if (pos >= min_t(int, len, strlen(tmpstr)))
+		return 0;
+
+	return cfs_trace_copyout_string(buffer, nob, tmpstr + pos, "\n");
+}
+
+static int
+proc_lnet_path_cache(struct ctl_table *table, int write, void __user *buffer,
+		     size_t *lenp, loff_t *ppos)
+{
+	return lprocfs_call_handler(table->data, write, ppos, buffer, lenp,
+				    __proc_lnet_path_cache);
+}
+
+static int __proc_lnet_portal_match(void *data, int write,
+				    loff_t pos, void __user *buffer, int nob)
+{
+	char	tmpstr[128];
+	__u64	nmatch;
+	__u64	nscan;
+	__u64	avg;
+	__u32	frac;
+	int	nmasks_off;
+	int	len;
+
+	if (write)
+		return -EPERM;
+
+	lnet_net_lock(0);
+	if (the_lnet.ln_state != LNET_STATE_RUNNING) {
+		lnet_net_unlock(0);
+		return -ESHUTDOWN;
+	}
+	lnet_net_unlock(0);
+
+	lnet_mt_match_counters(&nmatch, &nscan, &nmasks_off);
+	/* average scan length in hundredths */
+	avg = nmatch == 0 ? 0 : div64_u64(nscan * 100, nmatch);
+	frac = do_div(avg, 100);
+	len = snprintf(tmpstr, sizeof(tmpstr),
+		       "matches: %llu scanned: %llu avg_scan: %llu.%02u "
+		       "masks_off: %d", nmatch, nscan, avg, frac, nmasks_off);
+
+	if (pos >= min_t(int, len, strlen(tmpstr)))
+		return 0;
+
+	return cfs_trace_copyout_string(buffer, nob, tmpstr + pos, "\n");
+}
+
+static int
+proc_lnet_portal_match(struct ctl_table *table, int write,
+		       void __user *buffer, size_t *lenp, loff_t *ppos)
+{
+	return lprocfs_call_handler(table->data, write, ppos, buffer, lenp,
+				    __proc_lnet_portal_match);
+}
+
 static int
 proc_lnet_routes(struct ctl_table *table, int write, void __user *buffer,
 		 size_t *lenp, loff_t *ppos)
@@ -452,9 +531,9 @@ proc_lnet_peers(struct ctl_table *table, int write, void __user *buffer,
 
 	if (*ppos == 0) {
 		s += snprintf(s, tmpstr + tmpsiz - s,
-			      "%-24s %4s %5s %5s %5s %5s %5s %5s %5s %s\n",
+			      "%-24s %4s %5s %5s %5s %5s %5s %5s %5s %5s %s\n",
 			      "nid", "refs", "state", "last", "max",
-			      "rtr", "min", "tx", "min", "queue");
+			      "rtr", "min", "tx", "min", "queue", "latency");
 		LASSERT(tmpstr + tmpsiz - s > 0);
 
 		hoff++;
@@ -528,6 +607,7 @@ proc_lnet_peers(struct ctl_table *table, int write, void __user *buffer,
 			int rtrcr = peer->lpni_rtrcredits;
 			int minrtrcr = peer->lpni_minrtrcredits;
 			int txqnob = peer->lpni_txqnob;
+			unsigned long latency = peer->lpni_latency_us;
 
 			if (lnet_isrouter(peer) ||
 			    lnet_peer_aliveness_enabled(peer))
@@ -551,10 +631,10 @@ proc_lnet_peers(struct ctl_table *table, int write, void __user *buffer,
 			lnet_net_unlock(cpt);
 
 			s += snprintf(s, tmpstr + tmpsiz - s,
-				      "%-24s %4d %5s %5d %5d %5d %5d %5d %5d %d\n",
+				      "%-24s %4d %5s %5d %5d %5d %5d %5d %5d %5d %lu\n",
 				      libcfs_nid2str(nid), nrefs, aliveness,
 				      lastalive, maxcr, rtrcr, minrtrcr, txcr,
-				      mintxcr, txqnob);
+				      mintxcr, txqnob, latency);
 			LASSERT(tmpstr + tmpsiz - s > 0);
 
 		} else { /* peer is NULL */
@@ -655,6 +735,88 @@ proc_lnet_buffers(struct ctl_table *table, int write, void __user *buffer,
 				    __proc_lnet_buffers);
 }
 
+/*
+ * One line per CPT and router buffer pool, with the pool size and low
+ * water mark seen by each of the last LNET_RTRPOOL_HIST auto-sizing
+ * passes, oldest first, as "count/min".
+ */
+static int __proc_lnet_buffers_history(void *data, int write,
+				       loff_t pos, void __user *buffer,
+				       int nob)
+{
+	char		*s;
+	char		*tmpstr;
+	int		tmpsiz;
+	int		idx;
+	int		len;
+	int		rc;
+	int		i;
+	int		j;
+
+	LASSERT(!write);
+
+	tmpsiz = 64 + (16 + 24 * LNET_RTRPOOL_HIST) * LNET_NRBPOOLS *
+		 LNET_CPT_NUMBER;
+	LIBCFS_ALLOC(tmpstr, tmpsiz);
+	if (tmpstr == NULL)
+		return -ENOMEM;
+
+	s = tmpstr; /* points to current position in tmpstr[] */
+
+	s += snprintf(s, tmpstr + tmpsiz - s, "%3s %5s %s\n",
+		      "cpt", "pages", "history");
+	LASSERT(tmpstr + tmpsiz - s > 0);
+
+	if (the_lnet.ln_rtrpools == NULL)
+		goto out; /* I'm not a router */
+
+	for (idx = 0; idx < LNET_NRBPOOLS; idx++) {
+		struct lnet_rtrbufpool *rbp;
+
+		lnet_net_lock(LNET_LOCK_EX);
+		cfs_percpt_for_each(rbp, i, the_lnet.ln_rtrpools) {
+			struct lnet_rtrbufpool *pool = &rbp[idx];
+			unsigned int n = min_t(unsigned int, pool->rbp_hist_idx,
+					       LNET_RTRPOOL_HIST);
+
+			s += snprintf(s, tmpstr + tmpsiz - s, "%3d %5d",
+				      i, pool->rbp_npages);
+			for (j = n; j > 0; j--) {
+				struct lnet_rtrpool_sample *rs;
+
+				rs = &pool->rbp_hist[(pool->rbp_hist_idx - j) %
+						     LNET_RTRPOOL_HIST];
+				s += snprintf(s, tmpstr + tmpsiz - s,
+					      " %d/%d", rs->rs_nbuffers,
+					      rs->rs_mincredits);
+			}
+			s += snprintf(s, tmpstr + tmpsiz - s, "\n");
+			LASSERT(tmpstr + tmpsiz - s > 0);
+		}
+		lnet_net_unlock(LNET_LOCK_EX);
+	}
+
+ out:
+	len = s - tmpstr;
+
+	if (pos >= min_t(int, len, strlen(tmpstr)))
+		rc = 0;
+	else
+		rc = cfs_trace_copyout_string(buffer, nob,
+					      tmpstr + pos, NULL);
+
+	LIBCFS_FREE(tmpstr, tmpsiz);
+	return rc;
+}
+
+static int
+proc_lnet_buffers_history(struct ctl_table *table, int write,
+			  void __user *buffer, size_t *lenp, loff_t *ppos)
+{
+	return lprocfs_call_handler(table->data, write, ppos, buffer, lenp,
+				    __proc_lnet_buffers_history);
+}
+
 static int
 proc_lnet_nis(struct ctl_table *table, int write, void __user *buffer,
 	      size_t *lenp, loff_t *ppos)
@@ -712,9 +874,9 @@ proc_lnet_nis(struct ctl_table *table, int write, void __user *buffer,
 
 	if (*ppos == 0) {
 		s += snprintf(s, tmpstr + tmpsiz - s,
-			      "%-24s %6s %5s %4s %4s %4s %5s %5s %5s\n",
+			      "%-24s %6s %5s %4s %4s %4s %5s %5s %5s %6s\n",
 			      "nid", "status", "alive", "refs", "peer",
-			      "rtr", "max", "tx", "min");
+			      "rtr", "max", "tx", "min", "health");
 		LASSERT (tmpstr + tmpsiz - s > 0);
 	} else {
 		struct lnet_ni *ni   = NULL;
@@ -761,13 +923,14 @@ proc_lnet_nis(struct ctl_table *table, int write, void __user *buffer,
 					lnet_net_lock(i);
 
 				s += snprintf(s, tmpstr + tmpsiz - s,
-				      "%-24s %6s %5d %4d %4d %4d %5d %5d %5d\n",
+				      "%-24s %6s %5d %4d %4d %4d %5d %5d %5d %6d\n",
 				      libcfs_nid2str(ni->ni_nid), stat,
 				      last_alive, *ni->ni_refs[i],
 				      ni->ni_net->net_tunables.lct_peer_tx_credits,
 				      ni->ni_net->net_tunables.lct_peer_rtr_credits,
 				      tq->tq_credits_max,
-				      tq->tq_credits, tq->tq_credits_min);
+				      tq->tq_credits, tq->tq_credits_min,
+				      lnet_health_read(&ni->ni_health));
 				if (i != 0)
 					lnet_net_unlock(i);
 			}
@@ -938,6 +1101,12 @@ static struct ctl_table lnet_table[] = {
 		.mode		= 0444,
 		.proc_handler	= &proc_lnet_buffers,
 	},
+	{
+		INIT_CTL_NAME
+		.procname	= "buffers_history",
+		.mode		= 0444,
+		.proc_handler	= &proc_lnet_buffers_history,
+	},
 	{
 		INIT_CTL_NAME
 		.procname	= "nis",
@@ -950,6 +1119,18 @@ static struct ctl_table lnet_table[] = {
 		.mode		= 0644,
 		.proc_handler	= &proc_lnet_portal_rotor,
 	},
+	{
+		INIT_CTL_NAME
+		.procname	= "path_cache",
+		.mode		= 0444,
+		.proc_handler	= &proc_lnet_path_cache,
+	},
+	{
+		INIT_CTL_NAME
+		.procname	= "portal_match",
+		.mode		= 0444,
+		.proc_handler	= &proc_lnet_portal_match,
+	},
 	{ 0 }
 };
 
@@ -66,6 +66,45 @@ brw_client_fini(struct sfw_test_instance *tsi)
 	}
 }
 
+/* weights of a size mix must add up to 100% and sizes fit in blk_len */
+static int
+brw_check_mix(struct test_bulk_req_v2 *breq)
+{
+	int weight = 0;
+	int i;
+
+	if (breq->blk_nmix > SFW_BULK_MIX_MAX)
+		return -EINVAL;
+
+	for (i = 0; i < breq->blk_nmix; i++) {
+		if (breq->blk_mix_len[i] == 0 ||
+		    breq->blk_mix_len[i] % BRW_MSIZE != 0 ||
+		    breq->blk_mix_len[i] > breq->blk_v1.blk_len)
+			return -EINVAL;
+
+		weight += breq->blk_mix_weight[i];
+	}
+
+	return (breq->blk_nmix == 0 || weight == 100) ? 0 : -EINVAL;
+}
+
+/* draw the size of the next RPC from the size mix */
+static int
+brw_mix_len(struct test_bulk_req_v2 *breq)
+{
+	unsigned int pick = cfs_rand() % 100;
+	int i;
+
+	for (i = 0; i < breq->blk_nmix; i++) {
+		if (pick < breq->blk_mix_weight[i])
+			return breq->blk_mix_len[i];
+
+		pick -= breq->blk_mix_weight[i];
+	}
+
+	return breq->blk_v1.blk_len;
+}
+
 static int
 brw_client_init(struct sfw_test_instance *tsi)
 {
@@ -104,6 +143,11 @@ brw_client_init(struct sfw_test_instance *tsi)
 		len   = breq->blk_len;
 		off   = breq->blk_offset & ~PAGE_MASK;
 		npg   = (off + len + PAGE_SIZE - 1) >> PAGE_SHIFT;
+
+		/* per-unit bulk is sized for the largest size of the mix */
+		if ((sn->sn_features & LST_FEAT_BULK_MIX) != 0 &&
+		    brw_check_mix(&tsi->tsi_u.bulk_v2) != 0)
+			return -EINVAL;
 	}
 
 	if (off % BRW_MSIZE != 0)
@@ -267,6 +311,22 @@ brw_check_bulk(struct srpc_bulk *bk, int pattern, __u64 magic)
 	return 0;
 }
 
+/* cut a copy of the per-unit bulk down to the first @len bytes */
+static void
+brw_trim_bulk(struct srpc_bulk *bk, int npg, int len)
+{
+	int i;
+
+	bk->bk_len  = len;
+	bk->bk_niov = npg;
+
+	for (i = 0; i < npg - 1; i++)
+		len -= bk->bk_iovs[i].kiov_len;
+
+	LASSERT(len > 0 && len <= bk->bk_iovs[npg - 1].kiov_len);
+	bk->bk_iovs[npg - 1].kiov_len = len;
+}
+
 static int
 brw_client_prep_rpc(struct sfw_test_unit *tsu, struct lnet_process_id dest,
 		    struct srpc_client_rpc **rpcpp)
@@ -305,6 +365,10 @@ brw_client_prep_rpc(struct sfw_test_unit *tsu, struct lnet_process_id dest,
 		flags = breq->blk_flags;
 		len   = breq->blk_len;
 		off   = breq->blk_offset;
+
+		if ((sn->sn_features & LST_FEAT_BULK_MIX) != 0)
+			len = brw_mix_len(&tsi->tsi_u.bulk_v2);
+
 		npg   = (off + len + PAGE_SIZE - 1) >> PAGE_SHIFT;
 	}
 
@@ -313,6 +377,8 @@ brw_client_prep_rpc(struct sfw_test_unit *tsu, struct lnet_process_id dest,
 		return rc;
 
 	memcpy(&rpc->crpc_bulk, bulk, offsetof(struct srpc_bulk, bk_iovs[npg]));
+	if (len != bulk->bk_len)
+		brw_trim_bulk(&rpc->crpc_bulk, npg, len);
 	if (opc == LST_BRW_WRITE)
 		brw_fill_bulk(&rpc->crpc_bulk, flags, BRW_MAGIC);
 	else
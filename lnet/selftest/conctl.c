@@ -663,9 +663,10 @@ lst_batch_info_ioctl(struct lstio_batch_info_args *args)
 }
 
 static int
-lst_stat_query_ioctl(struct lstio_stat_args *args)
+lst_stat_query_ioctl(struct lstio_stat_args *args, int len)
 {
         int             rc;
+	int		type = LST_STAT_COUNTERS;
 	char           *name = NULL;
 
         /* TODO: not finished */
@@ -675,14 +676,22 @@ lst_stat_query_ioctl(struct lstio_stat_args *args)
 	if (args->lstio_sta_resultp == NULL)
 		return -EINVAL;
 
+	/* older lst passes the args without lstio_sta_type */
+	if (len >= offsetof(struct lstio_stat_args, lstio_sta_type) +
+		   sizeof(args->lstio_sta_type))
+		type = args->lstio_sta_type;
+
+	if (type != LST_STAT_COUNTERS && type != LST_STAT_LATENCY)
+		return -EINVAL;
+
 	if (args->lstio_sta_idsp != NULL) {
 		if (args->lstio_sta_count <= 0)
 			return -EINVAL;
 
 		rc = lstcon_nodes_stat(args->lstio_sta_count,
-                                       args->lstio_sta_idsp,
-                                       args->lstio_sta_timeout,
-                                       args->lstio_sta_resultp);
+				       args->lstio_sta_idsp, type,
+				       args->lstio_sta_timeout,
+				       args->lstio_sta_resultp);
 	} else if (args->lstio_sta_namep != NULL) {
 		if (args->lstio_sta_nmlen <= 0 ||
 		    args->lstio_sta_nmlen > LST_NAME_SIZE)
@@ -695,7 +704,8 @@ lst_stat_query_ioctl(struct lstio_stat_args *args)
 		rc = copy_from_user(name, args->lstio_sta_namep,
 				    args->lstio_sta_nmlen);
 		if (rc == 0)
-			rc = lstcon_group_stat(name, args->lstio_sta_timeout,
+			rc = lstcon_group_stat(name, type,
+					       args->lstio_sta_timeout,
 					       args->lstio_sta_resultp);
 		else
 			rc = -EFAULT;
@@ -715,6 +725,7 @@ static int lst_test_add_ioctl(struct lstio_test_args *args)
 	char		*src_name = NULL;
 	char		*dst_name = NULL;
 	void		*param = NULL;
+	int		paramlen = args->lstio_tes_param_len;
 	int		ret = 0;
 	int		rc = -ENOMEM;
 
@@ -744,6 +755,18 @@ static int lst_test_add_ioctl(struct lstio_test_args *args)
 	     PAGE_SIZE - sizeof(struct lstcon_test)))
                 return -EINVAL;
 
+	/* older lst passes the bulk param without the size mix */
+	if (args->lstio_tes_type == LST_TEST_BULK &&
+	    (args->lstio_tes_param == NULL ||
+	     args->lstio_tes_param_len <
+	     offsetof(struct lst_test_bulk_param, blk_nmix)))
+		return -EINVAL;
+
+	/* the rest of a short bulk param is zeroed, i.e. blk_nmix = 0 */
+	if (args->lstio_tes_type == LST_TEST_BULK &&
+	    paramlen < sizeof(struct lst_test_bulk_param))
+		paramlen = sizeof(struct lst_test_bulk_param);
+
 	LIBCFS_ALLOC(batch_name, args->lstio_tes_bat_nmlen + 1);
 	if (batch_name == NULL)
 		return rc;
@@ -757,7 +780,7 @@ static int lst_test_add_ioctl(struct lstio_test_args *args)
 		goto out;
 
 	if (args->lstio_tes_param != NULL) {
-		LIBCFS_ALLOC(param, args->lstio_tes_param_len);
+		LIBCFS_ALLOC(param, paramlen);
 		if (param == NULL)
 			goto out;
 		if (copy_from_user(param, args->lstio_tes_param,
@@ -781,8 +804,7 @@ static int lst_test_add_ioctl(struct lstio_test_args *args)
 			    args->lstio_tes_loop,
 			    args->lstio_tes_concur,
 			    args->lstio_tes_dist, args->lstio_tes_span,
-			    src_name, dst_name, param,
-			    args->lstio_tes_param_len,
+			    src_name, dst_name, param, paramlen,
 			    &ret, args->lstio_tes_resultp);
 
         if (ret != 0)
@@ -799,7 +821,7 @@ out:
 		LIBCFS_FREE(dst_name, args->lstio_tes_dgrp_nmlen + 1);
 
 	if (param != NULL)
-		LIBCFS_FREE(param, args->lstio_tes_param_len);
+		LIBCFS_FREE(param, paramlen);
 
 	return rc;
 }
@@ -906,7 +928,8 @@ lstcon_ioctl_entry(unsigned int cmd, struct libcfs_ioctl_hdr *hdr)
 		rc = lst_test_add_ioctl((struct lstio_test_args *)buf);
 		break;
 	case LSTIO_STAT_QUERY:
-		rc = lst_stat_query_ioctl((struct lstio_stat_args *)buf);
+		rc = lst_stat_query_ioctl((struct lstio_stat_args *)buf,
+					  data->ioc_plen1);
 		break;
 	default:
 		rc = -EINVAL;
@@ -686,7 +686,7 @@ lstcon_batrpc_prep(struct lstcon_node *nd, int transop, unsigned int feats,
 
 int
 lstcon_statrpc_prep(struct lstcon_node *nd, unsigned int feats,
-		    struct lstcon_rpc **crpc)
+		    int type, struct lstcon_rpc **crpc)
 {
 	struct srpc_stat_reqst *srq;
 	int rc;
@@ -698,7 +698,7 @@ lstcon_statrpc_prep(struct lstcon_node *nd, unsigned int feats,
         srq = &(*crpc)->crp_rpc->crpc_reqstmsg.msg_body.stat_reqst;
 
         srq->str_sid  = console_session.ses_id;
-        srq->str_type = 0; /* XXX remove it */
+	srq->str_type = type;
 
         return 0;
 }
@@ -812,6 +812,27 @@ lstcon_bulkrpc_v1_prep(struct lst_test_bulk_param *param, bool is_client,
 	return 0;
 }
 
+static int
+lstcon_bulkrpc_v2_prep(struct lst_test_bulk_param *param, bool is_client,
+		       struct srpc_test_reqst *req)
+{
+	struct test_bulk_req_v2 *brq = &req->tsr_u.bulk_v2;
+	int i;
+
+	if (param->blk_nmix < 0 || param->blk_nmix > SFW_BULK_MIX_MAX)
+		return -EINVAL;
+
+	lstcon_bulkrpc_v1_prep(param, is_client, req);
+
+	brq->blk_nmix = param->blk_nmix;
+	for (i = 0; i < param->blk_nmix; i++) {
+		brq->blk_mix_len[i]    = param->blk_mix_size[i];
+		brq->blk_mix_weight[i] = param->blk_mix_weight[i];
+	}
+
+	return 0;
+}
+
 int
 lstcon_testrpc_prep(struct lstcon_node *nd, int transop, unsigned int feats,
 		    struct lstcon_test *test, struct lstcon_rpc **crpc)
@@ -900,23 +921,34 @@ lstcon_testrpc_prep(struct lstcon_node *nd, int transop, unsigned int feats,
 					 &test->tes_param[0], trq);
 		break;
 
-	case LST_TEST_BULK:
+	case LST_TEST_BULK: {
+		struct lst_test_bulk_param *param =
+			(struct lst_test_bulk_param *)&test->tes_param[0];
+
 		trq->tsr_service = SRPC_SERVICE_BRW;
-		if ((feats & LST_FEAT_BULK_LEN) == 0) {
-			rc = lstcon_bulkrpc_v0_prep((struct lst_test_bulk_param *)
-						    &test->tes_param[0], trq);
+		if ((feats & LST_FEAT_BULK_MIX) != 0) {
+			rc = lstcon_bulkrpc_v2_prep(param, trq->tsr_is_client,
+						    trq);
+		} else if (param->blk_nmix != 0) {
+			CERROR("Size mix isn't supported by the session\n");
+			rc = -EOPNOTSUPP;
+		} else if ((feats & LST_FEAT_BULK_LEN) == 0) {
+			rc = lstcon_bulkrpc_v0_prep(param, trq);
 		} else {
-			rc = lstcon_bulkrpc_v1_prep((struct lst_test_bulk_param *)
-						    &test->tes_param[0],
-						    trq->tsr_is_client, trq);
+			rc = lstcon_bulkrpc_v1_prep(param, trq->tsr_is_client,
+						    trq);
 		}
 
-                break;
+		break;
+	}
         default:
                 LBUG();
                 break;
         }
 
+	if (rc != 0)
+		lstcon_rpc_put(*crpc);
+
         return rc;
 }
 
@@ -1148,7 +1180,7 @@ lstcon_rpc_trans_ndlist(struct list_head *ndlist,
 						&rpc);
 			break;
 		case LST_TRANS_STATQRY:
-			rc = lstcon_statrpc_prep(nd, feats, &rpc);
+			rc = lstcon_statrpc_prep(nd, feats, *(int *)arg, &rpc);
                         break;
                 default:
                         rc = -EINVAL;
@@ -1493,17 +1493,39 @@ lstcon_statrpc_readent(int transop, struct srpc_msg *msg,
 }
 
 static int
-lstcon_ndlist_stat(struct list_head *ndlist,
+lstcon_latrpc_readent(int transop, struct srpc_msg *msg,
+		      struct lstcon_rpc_ent __user *ent_up)
+{
+	struct srpc_stat_lat_reply *rep = &msg->msg_body.stat_lat_reply;
+
+	if (rep->str_status != 0)
+		return 0;
+
+	if (copy_to_user(&ent_up->rpe_payload[0], &rep->str_lat,
+			 sizeof(rep->str_lat)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static int
+lstcon_ndlist_stat(struct list_head *ndlist, int type,
 		   int timeout, struct list_head __user *result_up)
 {
 	struct list_head    head;
 	struct lstcon_rpc_trans *trans;
 	int		    rc;
 
+	if (type == LST_STAT_LATENCY &&
+	    (console_session.ses_features & LST_FEAT_LAT_STATS) == 0) {
+		CDEBUG(D_NET, "Latency stats aren't supported by session\n");
+		return -EOPNOTSUPP;
+	}
+
 	INIT_LIST_HEAD(&head);
 
-        rc = lstcon_rpc_trans_ndlist(ndlist, &head,
-                                     LST_TRANS_STATQRY, NULL, NULL, &trans);
+	rc = lstcon_rpc_trans_ndlist(ndlist, &head,
+				     LST_TRANS_STATQRY, &type, NULL, &trans);
         if (rc != 0) {
                 CERROR("Can't create transaction: %d\n", rc);
                 return rc;
@@ -1511,15 +1533,17 @@ lstcon_ndlist_stat(struct list_head *ndlist,
 
         lstcon_rpc_trans_postwait(trans, LST_VALIDATE_TIMEOUT(timeout));
 
-        rc = lstcon_rpc_trans_interpreter(trans, result_up,
-                                          lstcon_statrpc_readent);
+	rc = lstcon_rpc_trans_interpreter(trans, result_up,
+					  type == LST_STAT_LATENCY ?
+					  lstcon_latrpc_readent :
+					  lstcon_statrpc_readent);
         lstcon_rpc_trans_destroy(trans);
 
         return rc;
 }
 
 int
-lstcon_group_stat(char *grp_name, int timeout,
+lstcon_group_stat(char *grp_name, int type, int timeout,
 		  struct list_head __user *result_up)
 {
 	struct lstcon_group *grp;
@@ -1531,7 +1555,7 @@ lstcon_group_stat(char *grp_name, int timeout,
                 return rc;
         }
 
-        rc = lstcon_ndlist_stat(&grp->grp_ndl_list, timeout, result_up);
+	rc = lstcon_ndlist_stat(&grp->grp_ndl_list, type, timeout, result_up);
 
 	lstcon_group_decref(grp);
 
@@ -1540,7 +1564,7 @@ lstcon_group_stat(char *grp_name, int timeout,
 
 int
 lstcon_nodes_stat(int count, struct lnet_process_id __user *ids_up,
-		  int timeout, struct list_head __user *result_up)
+		  int type, int timeout, struct list_head __user *result_up)
 {
 	struct lstcon_ndlink *ndl;
 	struct lstcon_group *tmp;
@@ -1575,7 +1599,7 @@ lstcon_nodes_stat(int count, struct lnet_process_id __user *ids_up,
                 return rc;
         }
 
-        rc = lstcon_ndlist_stat(&tmp->grp_ndl_list, timeout, result_up);
+	rc = lstcon_ndlist_stat(&tmp->grp_ndl_list, type, timeout, result_up);
 
 	lstcon_group_decref(tmp);
 
@@ -1740,6 +1764,14 @@ lstcon_session_new(char *name, int key, unsigned feats,
 		return -EINVAL;
 	}
 
+	/* nodes decode a brw request without LST_FEAT_BULK_LEN as v0 */
+	if ((feats & LST_FEAT_BULK_MIX) != 0 &&
+	    (feats & LST_FEAT_BULK_LEN) == 0) {
+		CNETERR("Session feature %x requires feature %x\n",
+			LST_FEAT_BULK_MIX, LST_FEAT_BULK_LEN);
+		return -EINVAL;
+	}
+
 	for (i = 0; i < LST_GLOBAL_HASHSIZE; i++)
 		LASSERT(list_empty(&console_session.ses_ndl_hash[i]));
 
@@ -275,6 +275,7 @@ sfw_init_session(struct sfw_session *sn, struct lst_sid sid,
 	atomic_set(&sn->sn_refcount, 1);        /* +1 for caller */
 	atomic_set(&sn->sn_brw_errors, 0);
 	atomic_set(&sn->sn_ping_errors, 0);
+	spin_lock_init(&sn->sn_lat.lh_lock);
 	strlcpy(&sn->sn_name[0], name, sizeof(sn->sn_name));
 
         sn->sn_timer_active = 0;
@@ -410,6 +411,123 @@ sfw_get_stats(struct srpc_stat_reqst *request, struct srpc_stat_reply *reply)
 	return 0;
 }
 
+static inline unsigned int
+sfw_lat_bucket(__u32 usec)
+{
+	unsigned int msb;
+
+	if (usec < (1U << SFW_LAT_SUB_BITS))
+		return usec;
+
+	msb = fls(usec) - 1;
+	return ((msb - SFW_LAT_SUB_BITS + 1) << SFW_LAT_SUB_BITS) |
+	       ((usec >> (msb - SFW_LAT_SUB_BITS)) &
+		((1U << SFW_LAT_SUB_BITS) - 1));
+}
+
+/* the largest latency falling in bucket @idx */
+static __u32
+sfw_lat_bucket_max(unsigned int idx)
+{
+	unsigned int shift;
+	__u64 usec;
+
+	if (idx < (1U << SFW_LAT_SUB_BITS))
+		return idx;
+
+	shift = (idx >> SFW_LAT_SUB_BITS) - 1;
+	usec  = (1U << SFW_LAT_SUB_BITS) |
+		(idx & ((1U << SFW_LAT_SUB_BITS) - 1));
+	usec  = ((usec + 1) << shift) - 1;
+
+	return min_t(__u64, usec, UINT_MAX);
+}
+
+static void
+sfw_lat_record(struct sfw_lat_hist *lh, ktime_t start)
+{
+	s64   delta = ktime_us_delta(ktime_get(), start);
+	__u32 usec  = clamp_t(s64, delta, 0, UINT_MAX);
+
+	spin_lock(&lh->lh_lock);
+	if (lh->lh_count == 0 || usec < lh->lh_min)
+		lh->lh_min = usec;
+	if (usec > lh->lh_max)
+		lh->lh_max = usec;
+	lh->lh_sum += usec;
+	lh->lh_count++;
+	lh->lh_buckets[sfw_lat_bucket(usec)]++;
+	spin_unlock(&lh->lh_lock);
+}
+
+/* latency under which @permille of the samples fall, lh_lock is held */
+static __u32
+sfw_lat_percentile(struct sfw_lat_hist *lh, unsigned int permille)
+{
+	__u64 rank = div_u64((__u64)lh->lh_count * permille + 999, 1000);
+	__u64 seen = 0;
+	unsigned int i;
+
+	for (i = 0; i < SFW_LAT_NBUCKETS; i++) {
+		seen += lh->lh_buckets[i];
+		if (seen >= rank)
+			return min(sfw_lat_bucket_max(i), lh->lh_max);
+	}
+
+	return lh->lh_max;
+}
+
+/* report and reset latency of test RPCs completed since the last query */
+static int
+sfw_get_latency(struct srpc_stat_reqst *request,
+		struct srpc_stat_lat_reply *reply)
+{
+	struct sfw_session *sn = sfw_data.fw_session;
+	struct sfw_latency *lat = &reply->str_lat;
+	struct sfw_lat_hist *lh;
+
+	reply->str_sid = (sn == NULL) ? LST_INVALID_SID : sn->sn_id;
+
+	if (request->str_sid.ses_nid == LNET_NID_ANY) {
+		reply->str_status = EINVAL;
+		return 0;
+	}
+
+	if (sn == NULL || !sfw_sid_equal(request->str_sid, sn->sn_id)) {
+		reply->str_status = ESRCH;
+		return 0;
+	}
+
+	if ((sn->sn_features & LST_FEAT_LAT_STATS) == 0) {
+		reply->str_status = EPROTO;
+		return 0;
+	}
+
+	memset(lat, 0, sizeof(*lat));
+	lh = &sn->sn_lat;
+
+	spin_lock(&lh->lh_lock);
+	if (lh->lh_count > 0) {
+		lat->lat_count	 = lh->lh_count;
+		lat->lat_min_us	 = lh->lh_min;
+		lat->lat_max_us	 = lh->lh_max;
+		lat->lat_avg_us	 = div_u64(lh->lh_sum, lh->lh_count);
+		lat->lat_p50_us	 = sfw_lat_percentile(lh, 500);
+		lat->lat_p99_us	 = sfw_lat_percentile(lh, 990);
+		lat->lat_p999_us = sfw_lat_percentile(lh, 999);
+	}
+
+	lh->lh_count = 0;
+	lh->lh_min   = 0;
+	lh->lh_max   = 0;
+	lh->lh_sum   = 0;
+	memset(lh->lh_buckets, 0, sizeof(lh->lh_buckets));
+	spin_unlock(&lh->lh_lock);
+
+	reply->str_status = 0;
+	return 0;
+}
+
 int
 sfw_make_session(struct srpc_mksn_reqst *request, struct srpc_mksn_reply *reply)
 {
@@ -722,6 +840,14 @@ sfw_unpack_addtest_req(struct srpc_msg *msg)
 			__swab32s(&bulk->blk_len);
 		}
 
+		if ((msg->msg_ses_feats & LST_FEAT_BULK_MIX) != 0) {
+			struct test_bulk_req_v2 *bulk = &req->tsr_u.bulk_v2;
+			int i;
+
+			for (i = 0; i < SFW_BULK_MIX_MAX; i++)
+				__swab32s(&bulk->blk_mix_len[i]);
+		}
+
 		return;
 	}
 
@@ -884,6 +1010,10 @@ sfw_test_rpc_done(struct srpc_client_rpc *rpc)
 
         tsi->tsi_ops->tso_done_rpc(tsu, rpc);
 
+	if (rpc->crpc_status == 0)
+		sfw_lat_record(&tsi->tsi_batch->bat_session->sn_lat,
+			       rpc->crpc_start);
+
 	spin_lock(&tsi->tsi_lock);
 
 	LASSERT(sfw_test_active(tsi));
@@ -927,12 +1057,18 @@ sfw_create_test_rpc(struct sfw_test_unit *tsu, struct lnet_process_id peer,
 		/* pick request from buffer */
 		rpc = list_entry(tsi->tsi_free_rpcs.next,
 				 struct srpc_client_rpc, crpc_list);
-		LASSERT(nblk == rpc->crpc_bulk.bk_niov);
 		list_del_init(&rpc->crpc_list);
 	}
 
 	spin_unlock(&tsi->tsi_lock);
 
+	/* RPCs of a brw size mix don't all have the same # of pages */
+	if (rpc != NULL && rpc->crpc_bulk.bk_niov != nblk) {
+		LASSERT((features & LST_FEAT_BULK_MIX) != 0);
+		LIBCFS_FREE(rpc, srpc_client_rpc_size(rpc));
+		rpc = NULL;
+	}
+
 	if (rpc == NULL) {
 		rpc = srpc_create_client_rpc(peer, tsi->tsi_service, nblk,
 					     blklen, sfw_test_rpc_done,
@@ -1310,10 +1446,14 @@ sfw_handle_server_rpc(struct srpc_server_rpc *rpc)
                                        &reply->msg_body.bat_reply);
                 break;
 
-        case SRPC_SERVICE_QUERY_STAT:
-                rc = sfw_get_stats(&request->msg_body.stat_reqst,
-                                   &reply->msg_body.stat_reply);
-                break;
+	case SRPC_SERVICE_QUERY_STAT:
+		if (request->msg_body.stat_reqst.str_type == LST_STAT_LATENCY)
+			rc = sfw_get_latency(&request->msg_body.stat_reqst,
+					     &reply->msg_body.stat_lat_reply);
+		else
+			rc = sfw_get_stats(&request->msg_body.stat_reqst,
+					   &reply->msg_body.stat_reply);
+		break;
 
         case SRPC_SERVICE_DEBUG:
                 rc = sfw_debug_session(&request->msg_body.dbg_reqst,
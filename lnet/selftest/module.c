@@ -88,11 +88,19 @@ void
 lnet_selftest_structure_assertion(void)
 {
 	CLASSERT(sizeof(struct srpc_msg) == 160);
-	CLASSERT(sizeof(struct srpc_test_reqst) == 70);
+	CLASSERT(sizeof(struct srpc_test_reqst) == 94);
+	CLASSERT(offsetof(struct srpc_test_reqst, tsr_u.bulk_v2.blk_v1) ==
+		 offsetof(struct srpc_test_reqst, tsr_u.bulk_v1));
 	CLASSERT(offsetof(struct srpc_msg, msg_body.tes_reqst.tsr_concur) == 72);
 	CLASSERT(offsetof(struct srpc_msg, msg_body.tes_reqst.tsr_ndest) == 78);
 	CLASSERT(sizeof(struct srpc_stat_reply) == 136);
 	CLASSERT(sizeof(struct srpc_stat_reqst) == 28);
+	/* str_lat must only overlay __u32 fields of srpc_stat_reply */
+	CLASSERT(offsetof(struct srpc_stat_lat_reply, str_lat) ==
+		 offsetof(struct srpc_stat_reply, str_fw));
+	CLASSERT(offsetof(struct srpc_stat_lat_reply, str_lat) +
+		 sizeof(struct sfw_latency) <=
+		 offsetof(struct srpc_stat_reply, str_rpc.bulk_get));
 }
 
 static int __init
@@ -358,8 +358,15 @@ srpc_post_passive_rdma(int portal, int local, __u64 matchbits, void *buf,
 	int		 rc;
 	struct lnet_md	 md;
 	struct lnet_handle_me meh;
+	struct lnet_handle_me dummy;
+	__u64		 ignore_bits = 0;
 
-	rc = LNetMEAttach(portal, peer, matchbits, 0, LNET_UNLINK,
+	/* matchbits count up from the low bits, so ignoring bits 40-44
+	 * never makes two outstanding buffers match the same message */
+	if (CFS_FAIL_CHECK(CFS_FAIL_LST_ME_MASKS))
+		ignore_bits = (matchbits % 24 + 1) << 40;
+
+	rc = LNetMEAttach(portal, peer, matchbits, ignore_bits, LNET_UNLINK,
 			  local ? LNET_INS_LOCAL : LNET_INS_AFTER, &meh);
         if (rc != 0) {
                 CERROR ("LNetMEAttach failed: %d\n", rc);
@@ -367,6 +374,11 @@ srpc_post_passive_rdma(int portal, int local, __u64 matchbits, void *buf,
                 return -ENOMEM;
         }
 
+	if (CFS_FAIL_CHECK(CFS_FAIL_LST_ME_INSERT) &&
+	    LNetMEInsert(meh, peer, ~0ULL, 0, LNET_UNLINK, LNET_INS_AFTER,
+			 &dummy) == 0)
+		LNetMEUnlink(dummy);
+
         md.threshold = 1;
         md.user_ptr  = ev;
         md.start     = buf;
@@ -1341,6 +1353,7 @@ srpc_post_rpc(struct srpc_client_rpc *rpc)
                 libcfs_id2str(rpc->crpc_dest), rpc->crpc_service,
                 rpc->crpc_timeout);
 
+	rpc->crpc_start = ktime_get();
         srpc_add_client_rpc_timer(rpc);
         swi_schedule_workitem(&rpc->crpc_wi);
         return;
@@ -164,6 +164,14 @@ struct srpc_stat_reply {
 	struct lnet_counters	str_lnet;
 } WIRE_ATTR;
 
+/* reply to a LST_STAT_LATENCY query; str_lat overlays str_fw and the head
+ * of str_rpc of srpc_stat_reply, so swabbing it as a stat reply is fine */
+struct srpc_stat_lat_reply {
+	__u32			str_status;
+	struct lst_sid		str_sid;
+	struct sfw_latency	str_lat;
+} WIRE_ATTR;
+
 struct test_bulk_req {
         __u32                   blk_opc;        /* bulk operation code */
         __u32                   blk_npg;        /* # of pages */
@@ -181,6 +189,20 @@ struct test_bulk_req_v1 {
 	__u32                   blk_offset;
 } WIRE_ATTR;
 
+#define SFW_BULK_MIX_MAX	LST_BULK_MIX_MAX
+
+struct test_bulk_req_v2 {
+	/** blk_len is the largest size of the mix */
+	struct test_bulk_req_v1	blk_v1;
+	/** # of entries in the size mix, 0 for a fixed size */
+	__u8			blk_nmix;
+	__u8			blk_pad[3];
+	/** sizes of the mix */
+	__u32			blk_mix_len[SFW_BULK_MIX_MAX];
+	/** weight of each size, in percent */
+	__u8			blk_mix_weight[SFW_BULK_MIX_MAX];
+} WIRE_ATTR;
+
 struct test_ping_req {
 	__u32			png_size;       /* size of ping message */
 	__u32			png_flags;      /* reserved flags */
@@ -203,6 +225,7 @@ struct srpc_test_reqst {
 		struct test_ping_req	ping;
 		struct test_bulk_req	bulk_v0;
 		struct test_bulk_req_v1	bulk_v1;
+		struct test_bulk_req_v2	bulk_v2;
 	} tsr_u;
 } WIRE_ATTR;
 
@@ -266,6 +289,7 @@ struct srpc_msg {
 		struct srpc_batch_reply		bat_reply;
 		struct srpc_stat_reqst		stat_reqst;
 		struct srpc_stat_reply		stat_reply;
+		struct srpc_stat_lat_reply	stat_lat_reply;
 		struct srpc_test_reqst		tes_reqst;
 		struct srpc_test_reply		tes_reply;
 		struct srpc_join_reqst		join_reqst;
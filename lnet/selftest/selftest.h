@@ -89,6 +89,11 @@ struct sfw_test_instance;
 /* all reply/bulk RDMAs go to this portal */
 #define SRPC_RDMA_PORTAL                52
 
+/* fail_loc: post passive buffers with ignore bits, 24 distinct masks */
+#define CFS_FAIL_LST_ME_MASKS		0xe001
+/* fail_loc: LNetMEInsert() a dummy ME after each passive buffer */
+#define CFS_FAIL_LST_ME_INSERT		0xe002
+
 static inline enum srpc_msg_type
 srpc_service2request (int service)
 {
@@ -207,6 +212,7 @@ struct srpc_client_rpc {
 	struct stt_timer	crpc_timer;
 	struct swi_workitem	crpc_wi;
 	struct lnet_process_id	crpc_dest;
+	ktime_t			crpc_start;	/* time the RPC was posted */
 
         void               (*crpc_done)(struct srpc_client_rpc *);
         void               (*crpc_fini)(struct srpc_client_rpc *);
@@ -319,6 +325,21 @@ struct srpc_service {
 	int              (*sv_bulk_ready)(struct srpc_server_rpc *, int);
 };
 
+/* histogram of test RPC latency in usecs: values below 2^SFW_LAT_SUB_BITS
+ * have a bucket each, every power of 2 above is split in 2^SFW_LAT_SUB_BITS
+ * buckets, so the error is less than 1/2^SFW_LAT_SUB_BITS */
+#define SFW_LAT_SUB_BITS	3
+#define SFW_LAT_NBUCKETS	((32 - SFW_LAT_SUB_BITS + 1) << SFW_LAT_SUB_BITS)
+
+struct sfw_lat_hist {
+	spinlock_t		lh_lock;
+	__u32			lh_count;	/* # of samples */
+	__u32			lh_min;
+	__u32			lh_max;
+	__u64			lh_sum;
+	__u32			lh_buckets[SFW_LAT_NBUCKETS];
+};
+
 struct sfw_session {
 	/* chain on fw_zombie_sessions */
 	struct list_head	sn_list;
@@ -334,6 +355,7 @@ struct sfw_session {
 	atomic_t		sn_brw_errors;
 	atomic_t		sn_ping_errors;
 	cfs_time_t		sn_started;
+	struct sfw_lat_hist	sn_lat;		/* test RPC latency */
 };
 
 #define sfw_sid_equal(sid0, sid1)     ((sid0).ses_nid == (sid1).ses_nid && \
@@ -382,6 +404,7 @@ struct sfw_test_instance {
 		struct test_ping_req	ping;	  /* ping parameter */
 		struct test_bulk_req	bulk_v0;  /* bulk parameter */
 		struct test_bulk_req_v1	bulk_v1;  /* bulk v1 parameter */
+		struct test_bulk_req_v2	bulk_v2;  /* bulk v2 parameter */
 	} tsi_u;
 };
 
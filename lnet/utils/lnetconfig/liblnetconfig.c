@@ -1794,6 +1794,27 @@ get_counts(struct lnet_ioctl_element_msg_stats *msg_stats, int idx)
 	return NULL;
 }
 
+/* name of the peer NI selection policy of \a net, NULL if unknown */
+static char *lustre_lnet_net_sel_policy_str(__u32 net)
+{
+	struct lnet_ioctl_net_sel_policy data;
+
+	LIBCFS_IOC_INIT_V2(data, sp_hdr);
+	data.sp_net = net;
+
+	if (l_ioctl(LNET_DEV_ID, IOC_LIBCFS_GET_NET_SEL_POLICY, &data) != 0)
+		return NULL;
+
+	switch (data.sp_policy) {
+	case LNET_SEL_POLICY_CREDITS:
+		return "credits";
+	case LNET_SEL_POLICY_LATENCY:
+		return "latency";
+	default:
+		return NULL;
+	}
+}
+
 int lustre_lnet_show_net(char *nw, int detail, int seq_no,
 			 struct cYAML **show_rc, struct cYAML **err_rc)
 {
@@ -1813,6 +1834,7 @@ int lustre_lnet_show_net(char *nw, int detail, int seq_no,
 	int str_buf_len = LNET_MAX_SHOW_NUM_CPT * 2;
 	char str_buf[str_buf_len];
 	char *pos;
+	char *sel;
 	char err_str[LNET_MAX_STR_LEN];
 	bool exist = false, new_net = true;
 	int net_num = 0;
@@ -1891,6 +1913,11 @@ int lustre_lnet_show_net(char *nw, int detail, int seq_no,
 						 libcfs_net2str(rc_net)))
 				goto out;
 
+			sel = lustre_lnet_net_sel_policy_str(rc_net);
+			if (sel != NULL &&
+			    !cYAML_create_string(net_node, "selection", sel))
+				goto out;
+
 			tmp = cYAML_create_seq(net_node, "local NI(s)");
 			if (tmp == NULL)
 				goto out;
@@ -2189,6 +2216,54 @@ int lustre_lnet_config_numa_range(int range, int seq_no, struct cYAML **err_rc)
 			       "numa_range", seq_no, err_rc);
 }
 
+int lustre_lnet_config_net_sel_policy(char *net, char *policy, int seq_no,
+				      struct cYAML **err_rc)
+{
+	struct lnet_ioctl_net_sel_policy data;
+	int rc = LUSTRE_CFG_RC_NO_ERR;
+	char err_str[LNET_MAX_STR_LEN];
+	__u32 net_id;
+
+	snprintf(err_str, sizeof(err_str), "\"success\"");
+
+	LIBCFS_IOC_INIT_V2(data, sp_hdr);
+
+	net_id = (net == NULL) ? LNET_NIDNET(LNET_NID_ANY) :
+				 libcfs_str2net(net);
+	if (net_id == LNET_NIDNET(LNET_NID_ANY)) {
+		snprintf(err_str, sizeof(err_str),
+			 "\"invalid network: %s\"", net ? net : "<none>");
+		rc = LUSTRE_CFG_RC_BAD_PARAM;
+		goto out;
+	}
+	data.sp_net = net_id;
+
+	if (policy != NULL && strcmp(policy, "credits") == 0) {
+		data.sp_policy = LNET_SEL_POLICY_CREDITS;
+	} else if (policy != NULL && strcmp(policy, "latency") == 0) {
+		data.sp_policy = LNET_SEL_POLICY_LATENCY;
+	} else {
+		snprintf(err_str, sizeof(err_str),
+			 "\"invalid selection policy: %s\"",
+			 policy ? policy : "<none>");
+		rc = LUSTRE_CFG_RC_BAD_PARAM;
+		goto out;
+	}
+
+	rc = l_ioctl(LNET_DEV_ID, IOC_LIBCFS_SET_NET_SEL_POLICY, &data);
+	if (rc != 0) {
+		rc = -errno;
+		snprintf(err_str, sizeof(err_str),
+			 "\"cannot set selection policy of %s: %s\"",
+			 net, strerror(errno));
+	}
+
+out:
+	cYAML_build_error(rc, seq_no, ADD_CMD, "selection", err_str, err_rc);
+
+	return rc;
+}
+
 int lustre_lnet_config_buffers(int tiny, int small, int large, int seq_no,
 			       struct cYAML **err_rc)
 {
@@ -2930,6 +3005,39 @@ int lustre_lnet_show_numa_range(int seq_no, struct cYAML **show_rc,
 					"numa_range", show_rc, err_rc);
 }
 
+int lustre_lnet_get_stats_bulk(__u32 type, struct lnet_ioctl_stats_rec **recs,
+			       __u32 *size, __u32 *count, __u64 *time_ns)
+{
+	struct lnet_ioctl_stats_bulk data;
+	void *buf;
+	int rc;
+
+	for (;;) {
+		memset(&data, 0, sizeof(data));
+		LIBCFS_IOC_INIT_V2(data, sb_hdr);
+		data.sb_type = type;
+		data.sb_size = *recs != NULL ? *size : 0;
+		data.sb_bulk = *recs;
+
+		rc = l_ioctl(LNET_DEV_ID, IOC_LIBCFS_GET_STATS_BULK, &data);
+		if (rc == 0)
+			break;
+		if (errno != E2BIG)
+			return -errno;
+
+		/* elements may be added before the next try, leave room */
+		buf = realloc(*recs, data.sb_size + 16 * sizeof(**recs));
+		if (buf == NULL)
+			return -ENOMEM;
+		*recs = buf;
+		*size = data.sb_size + 16 * sizeof(**recs);
+	}
+
+	*count = data.sb_count;
+	*time_ns = data.sb_time_ns;
+	return 0;
+}
+
 int lustre_lnet_show_stats(int seq_no, struct cYAML **show_rc,
 			   struct cYAML **err_rc)
 {
@@ -2937,7 +3045,13 @@ int lustre_lnet_show_stats(int seq_no, struct cYAML **show_rc,
 	int rc;
 	int l_errno;
 	char err_str[LNET_MAX_STR_LEN];
-	struct cYAML *root = NULL, *stats = NULL;
+	struct cYAML *root = NULL, *stats = NULL, *pools = NULL;
+	static char *pool_names[LNET_POOL_MAX] = {
+		[LNET_POOL_MSG]	= "msg",
+		[LNET_POOL_MD]	= "md",
+		[LNET_POOL_ME]	= "me",
+	};
+	int i;
 
 	snprintf(err_str, sizeof(err_str), "\"out of memory\"");
 
@@ -3008,6 +3122,32 @@ int lustre_lnet_show_stats(int seq_no, struct cYAML **show_rc,
 				data.st_cntrs.drop_length) == NULL)
 		goto out;
 
+	pools = cYAML_create_object(stats, "pools");
+	if (pools == NULL)
+		goto out;
+
+	for (i = 0; i < LNET_POOL_MAX; i++) {
+		struct lnet_pool_counters *pc = &data.st_pools[i];
+		struct cYAML *pool;
+
+		pool = cYAML_create_object(pools, pool_names[i]);
+		if (pool == NULL)
+			goto out;
+
+		if (cYAML_create_number(pool, "hits", pc->pc_hits) == NULL)
+			goto out;
+
+		if (cYAML_create_number(pool, "misses",
+					pc->pc_misses) == NULL)
+			goto out;
+
+		if (cYAML_create_number(pool, "free", pc->pc_free) == NULL)
+			goto out;
+
+		if (cYAML_create_number(pool, "max", pc->pc_max) == NULL)
+			goto out;
+	}
+
 	if (show_rc == NULL)
 		cYAML_print_tree(root);
 
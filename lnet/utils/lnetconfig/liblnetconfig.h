@@ -204,6 +204,22 @@ int lustre_lnet_enable_routing(int enable, int seq_no,
 int lustre_lnet_config_numa_range(int range, int seq_no,
 				  struct cYAML **err_rc);
 
+/*
+ * lustre_lnet_config_net_sel_policy
+ *   Set how peer NIs are picked for traffic on a network.
+ *   "credits" picks the peer NI with the most send credits,
+ *   "latency" spreads traffic in inverse proportion to the
+ *   measured latency of each peer NI.
+ *
+ *   net - network name, e.g. tcp0
+ *   policy - "credits" or "latency"
+ *   seq_no - sequence number of the request
+ *   err_rc - [OUT] struct cYAML tree describing the error. Freed by
+ *   caller
+ */
+int lustre_lnet_config_net_sel_policy(char *net, char *policy, int seq_no,
+				      struct cYAML **err_rc);
+
 /*
  * lustre_lnet_show_num_range
  *   Get the currently set NUMA range
@@ -302,6 +318,24 @@ int lustre_lnet_show_routing(int seq_no, struct cYAML **show_rc,
 int lustre_lnet_show_stats(int seq_no, struct cYAML **show_rc,
 			   struct cYAML **err_rc);
 
+/*
+ * lustre_lnet_get_stats_bulk
+ *   Get the counters of all local NIs or all peer NIs as fixed-layout
+ *   records, without building any YAML, so they can be sampled often.
+ *
+ *     type - LNET_STATS_BULK_NI or LNET_STATS_BULK_PEER_NI
+ *     recs - [IN/OUT] buffer for the records, may be NULL.  It is grown
+ *	      as needed and can be passed again for the next sample.  Must
+ *	      be freed by caller.
+ *     size - [IN/OUT] size of the buffer at recs in bytes
+ *     count - [OUT] number of records returned
+ *     time_ns - [OUT] monotonic time of the sample in nanoseconds
+ *
+ *   Returns 0 or a negative errno.
+ */
+int lustre_lnet_get_stats_bulk(__u32 type, struct lnet_ioctl_stats_rec **recs,
+			       __u32 *size, __u32 *count, __u64 *time_ns);
+
 /*
  * lustre_lnet_config_peer_nid
  *   Add a peer nid to a peer with primary nid pnid. If no pnid is given
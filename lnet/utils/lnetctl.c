@@ -24,9 +24,11 @@
  *   Amir Shehata <amir.shehata@intel.com>
  */
 #include <getopt.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <limits.h>
 #include <libcfs/util/ioctl.h>
 #include <libcfs/util/parser.h>
@@ -43,10 +45,12 @@ static int jt_add_ni(int argc, char **argv);
 static int jt_set_routing(int argc, char **argv);
 static int jt_del_route(int argc, char **argv);
 static int jt_del_ni(int argc, char **argv);
+static int jt_set_net_sel(int argc, char **argv);
 static int jt_show_route(int argc, char **argv);
 static int jt_show_net(int argc, char **argv);
 static int jt_show_routing(int argc, char **argv);
 static int jt_show_stats(int argc, char **argv);
+static int jt_stream_stats(int argc, char **argv);
 static int jt_show_peer(int argc, char **argv);
 static int jt_show_global(int argc, char **argv);
 static int jt_set_tiny(int argc, char **argv);
@@ -77,14 +81,14 @@ static int jt_peers(int argc, char **argv);
 command_t cmd_list[] = {
 	{"lnet", jt_lnet, 0, "lnet {configure | unconfigure} [--all]"},
 	{"route", jt_route, 0, "route {add | del | show | help}"},
-	{"net", jt_net, 0, "net {add | del | show | help}"},
+	{"net", jt_net, 0, "net {add | del | show | set | help}"},
 	{"routing", jt_routing, 0, "routing {show | help}"},
 	{"set", jt_set, 0, "set {tiny_buffers | small_buffers | large_buffers"
 			   " | routing | numa_range | max_interfaces"
 			   " | discovery}"},
 	{"import", jt_import, 0, "import FILE.yaml"},
 	{"export", jt_export, 0, "export FILE.yaml"},
-	{"stats", jt_stats, 0, "stats {show | help}"},
+	{"stats", jt_stats, 0, "stats {show | stream | help}"},
 	{"global", jt_global, 0, "global {show | help}"},
 	{"peer", jt_peers, 0, "peer {add | del | show | help}"},
 	{"ping", jt_ping, 0, "ping nid,[nid,...]"},
@@ -138,6 +142,9 @@ command_t net_cmds[] = {
 	 "\t--net: net name (e.g. tcp0) to filter on\n"
 	 "\t--verbose: display detailed output per network."
 		       " Optional argument of '2' outputs more stats\n"},
+	{"set", jt_set_net_sel, 0, "set network tunables\n"
+	 "\t--net: net name (e.g. tcp0)\n"
+	 "\t--selection: peer NI selection policy (credits | latency)\n"},
 	{ 0, 0, 0, NULL }
 };
 
@@ -148,6 +155,11 @@ command_t routing_cmds[] = {
 
 command_t stats_cmds[] = {
 	{"show", jt_show_stats, 0, "show LNET statistics\n"},
+	{"stream", jt_stream_stats, 0, "print NI and peer NI counters as they "
+	 "change, also \"stats --stream\"\n"
+	 "\t--interval: seconds between samples (default 1)\n"
+	 "\t--count: number of samples to print, 0 for no limit (default 0)\n"
+	 "\t--all: print every element, even those without traffic\n"},
 	{ 0, 0, 0, NULL }
 };
 
@@ -789,6 +801,46 @@ out:
 	return rc;
 }
 
+static int jt_set_net_sel(int argc, char **argv)
+{
+	struct cYAML *err_rc = NULL;
+	char *network = NULL, *policy = NULL;
+	int rc, opt;
+
+	const char *const short_options = "n:s:";
+	static const struct option long_options[] = {
+	{ .name = "net",	.has_arg = required_argument,	.val = 'n' },
+	{ .name = "selection",	.has_arg = required_argument,	.val = 's' },
+	{ .name = NULL } };
+
+	rc = check_cmd(net_cmds, "net", "set", 0, argc, argv);
+	if (rc)
+		return rc;
+
+	while ((opt = getopt_long(argc, argv, short_options,
+				   long_options, NULL)) != -1) {
+		switch (opt) {
+		case 'n':
+			network = optarg;
+			break;
+		case 's':
+			policy = optarg;
+			break;
+		default:
+			return 0;
+		}
+	}
+
+	rc = lustre_lnet_config_net_sel_policy(network, policy, -1, &err_rc);
+
+	if (rc != LUSTRE_CFG_RC_NO_ERR)
+		cYAML_print_tree2file(stderr, err_rc);
+
+	cYAML_free_tree(err_rc);
+
+	return rc;
+}
+
 static int jt_show_route(int argc, char **argv)
 {
 	char *network = NULL, *gateway = NULL;
@@ -950,6 +1002,209 @@ static int jt_show_stats(int argc, char **argv)
 	return rc;
 }
 
+/* the records of one type from a sample, sorted by NID */
+struct stats_sample {
+	struct lnet_ioctl_stats_rec	*ss_recs;
+	__u32				 ss_size;
+	__u32				 ss_count;
+	__u64				 ss_time_ns;
+};
+
+static int stats_rec_cmp(const void *a, const void *b)
+{
+	const struct lnet_ioctl_stats_rec *ra = a;
+	const struct lnet_ioctl_stats_rec *rb = b;
+
+	return ra->isr_nid < rb->isr_nid ? -1 : ra->isr_nid > rb->isr_nid;
+}
+
+static int stats_sample(__u32 type, struct stats_sample *ss)
+{
+	int rc;
+
+	rc = lustre_lnet_get_stats_bulk(type, &ss->ss_recs, &ss->ss_size,
+					&ss->ss_count, &ss->ss_time_ns);
+	if (rc != 0) {
+		fprintf(stderr, "cannot get %s statistics: %s\n",
+			type == LNET_STATS_BULK_NI ? "NI" : "peer NI",
+			strerror(-rc));
+		return rc;
+	}
+
+	qsort(ss->ss_recs, ss->ss_count, sizeof(*ss->ss_recs), stats_rec_cmp);
+	return 0;
+}
+
+/* counters are 32 bits and wrap, so deltas are taken modulo 2^32 */
+static int stats_comm_delta(char *buf, size_t len,
+			    struct lnet_ioctl_comm_count *cur,
+			    struct lnet_ioctl_comm_count *prev, bool *busy)
+{
+	struct lnet_ioctl_comm_count d = *cur;
+
+	if (prev != NULL) {
+		d.ico_put_count -= prev->ico_put_count;
+		d.ico_get_count -= prev->ico_get_count;
+		d.ico_reply_count -= prev->ico_reply_count;
+		d.ico_ack_count -= prev->ico_ack_count;
+		d.ico_hello_count -= prev->ico_hello_count;
+	}
+
+	if (d.ico_put_count | d.ico_get_count | d.ico_reply_count |
+	    d.ico_ack_count | d.ico_hello_count)
+		*busy = true;
+
+	return snprintf(buf, len, " %u %u %u %u %u",
+			d.ico_put_count, d.ico_get_count, d.ico_reply_count,
+			d.ico_ack_count, d.ico_hello_count);
+}
+
+/*
+ * Print the change in the counters of @cur since @prev, which is NULL for
+ * an element that is new since the last sample, and the current credits
+ * and queue lengths.  Elements without traffic are skipped unless @all.
+ */
+static void stats_rec_print(const char *type, double secs,
+			    struct lnet_ioctl_stats_rec *cur,
+			    struct lnet_ioctl_stats_rec *prev, bool all)
+{
+	char line[256];
+	bool busy = false;
+	int n;
+
+	n = snprintf(line, sizeof(line), "%.3f %s %s", secs, type,
+		     libcfs_nid2str(cur->isr_nid));
+	n += stats_comm_delta(line + n, sizeof(line) - n, &cur->isr_send,
+			      prev ? &prev->isr_send : NULL, &busy);
+	n += stats_comm_delta(line + n, sizeof(line) - n, &cur->isr_recv,
+			      prev ? &prev->isr_recv : NULL, &busy);
+	n += stats_comm_delta(line + n, sizeof(line) - n, &cur->isr_drop,
+			      prev ? &prev->isr_drop : NULL, &busy);
+	if (!busy && !all)
+		return;
+
+	printf("%s %d %d %d %d %u %u %u\n", line,
+	       cur->isr_tx_credits, cur->isr_min_tx_credits,
+	       cur->isr_rtr_credits, cur->isr_min_rtr_credits,
+	       cur->isr_txq_msgs, cur->isr_txq_nob, cur->isr_health);
+}
+
+/* print @cur against @prev, matching the sorted records up by NID */
+static void stats_sample_print(const char *type, __u64 start_ns,
+			       struct stats_sample *cur,
+			       struct stats_sample *prev, bool all)
+{
+	double secs = (cur->ss_time_ns - start_ns) / 1e9;
+	__u32 i;
+	__u32 j = 0;
+
+	for (i = 0; i < cur->ss_count; i++) {
+		struct lnet_ioctl_stats_rec *rec = &cur->ss_recs[i];
+
+		while (j < prev->ss_count &&
+		       prev->ss_recs[j].isr_nid < rec->isr_nid)
+			j++;
+
+		stats_rec_print(type, secs, rec,
+				j < prev->ss_count &&
+				prev->ss_recs[j].isr_nid == rec->isr_nid ?
+				&prev->ss_recs[j] : NULL, all);
+	}
+}
+
+static int jt_stream_stats(int argc, char **argv)
+{
+	static const char * const types[LNET_STATS_BULK_MAX] = {
+		[LNET_STATS_BULK_NI]		= "ni",
+		[LNET_STATS_BULK_PEER_NI]	= "peer_ni",
+	};
+	struct stats_sample samples[LNET_STATS_BULK_MAX][2];
+	struct stats_sample tmp;
+	long int interval = 1;
+	long int count = 0;
+	bool all = false;
+	__u64 start_ns = 0;
+	long int n;
+	__u32 type;
+	int rc, opt;
+
+	const char *const short_options = "i:c:a";
+	static const struct option long_options[] = {
+	{ .name = "interval",	.has_arg = required_argument,	.val = 'i' },
+	{ .name = "count",	.has_arg = required_argument,	.val = 'c' },
+	{ .name = "all",	.has_arg = no_argument,		.val = 'a' },
+	{ .name = NULL } };
+
+	rc = check_cmd(stats_cmds, "stats", "stream", 0, argc, argv);
+	if (rc)
+		return rc;
+
+	while ((opt = getopt_long(argc, argv, short_options,
+				   long_options, NULL)) != -1) {
+		switch (opt) {
+		case 'i':
+			rc = parse_long(optarg, &interval);
+			if (rc != 0 || interval <= 0) {
+				fprintf(stderr, "bad interval: %s\n", optarg);
+				return -1;
+			}
+			break;
+		case 'c':
+			rc = parse_long(optarg, &count);
+			if (rc != 0 || count < 0) {
+				fprintf(stderr, "bad count: %s\n", optarg);
+				return -1;
+			}
+			break;
+		case 'a':
+			all = true;
+			break;
+		default:
+			return 0;
+		}
+	}
+
+	memset(samples, 0, sizeof(samples));
+	for (type = 0; type < LNET_STATS_BULK_MAX; type++) {
+		rc = stats_sample(type, &samples[type][0]);
+		if (rc != 0)
+			goto out;
+	}
+	start_ns = samples[LNET_STATS_BULK_NI][0].ss_time_ns;
+
+	printf("# time type nid send:put,get,reply,ack,hello recv:... "
+	       "drop:... tx_credits min_tx rtr_credits min_rtr txq_msgs "
+	       "txq_nob health\n");
+	fflush(stdout);
+
+	for (n = 0; count == 0 || n < count; n++) {
+		sleep(interval);
+
+		for (type = 0; type < LNET_STATS_BULK_MAX; type++) {
+			rc = stats_sample(type, &samples[type][1]);
+			if (rc != 0)
+				goto out;
+
+			stats_sample_print(types[type], start_ns,
+					   &samples[type][1],
+					   &samples[type][0], all);
+
+			tmp = samples[type][0];
+			samples[type][0] = samples[type][1];
+			samples[type][1] = tmp;
+		}
+		fflush(stdout);
+	}
+
+out:
+	for (type = 0; type < LNET_STATS_BULK_MAX; type++) {
+		free(samples[type][0].ss_recs);
+		free(samples[type][1].ss_recs);
+	}
+
+	return rc;
+}
+
 static int jt_show_global(int argc, char **argv)
 {
 	int rc;
@@ -1035,6 +1290,10 @@ static int jt_stats(int argc, char **argv)
 {
 	int rc;
 
+	/* "stats --stream" is short for "stats stream" */
+	if (argc > 1 && strcmp(argv[1], "--stream") == 0)
+		return jt_stream_stats(argc - 1, &argv[1]);
+
 	rc = check_cmd(stats_cmds, "stats", NULL, 2, argc, argv);
 	if (rc)
 		return rc;
@@ -60,8 +60,10 @@ static struct lst_sid session_id;
 static int                 session_key;
 static int lst_list_commands(int argc, char **argv);
 
-/* All nodes running 2.6.50 or later understand feature LST_FEAT_BULK_LEN */
-static unsigned		session_features = LST_FEATS_MASK;
+/* All nodes running 2.6.50 or later understand feature LST_FEAT_BULK_LEN.
+ * Test nodes with an older selftest module reject LST_FEAT_LAT_STATS and
+ * LST_FEAT_BULK_MIX, so these are only used if LST_FEATURES sets them */
+static unsigned		session_features = LST_FEAT_BULK_LEN;
 static struct lstcon_trans_stat	trans_stat;
 
 typedef struct list_string {
@@ -1488,11 +1490,12 @@ jt_lst_list_group(int argc, char **argv)
 
 int
 lst_stat_ioctl(char *name, int count, struct lnet_process_id *idsp,
-	       int timeout, struct list_head *resultp)
+	       int type, int timeout, struct list_head *resultp)
 {
 	struct lstio_stat_args args = { 0 };
 
 	args.lstio_sta_key     = session_key;
+	args.lstio_sta_type    = type;
 	args.lstio_sta_timeout = timeout;
 	args.lstio_sta_nmlen   = strlen(name);
 	args.lstio_sta_namep   = name;
@@ -1872,6 +1875,68 @@ lst_print_stat(char *name, struct list_head *resultp,
 	lst_print_lnet_stat(name, bwrt, rdwr, type, mbs);
 }
 
+/* latency is reset on the test nodes at each query, so every call prints
+ * the latency of test RPCs completed during the last interval. Group-wide
+ * percentiles are the worst of the per-node ones */
+static void
+lst_print_latency(char *name, struct list_head *resultp)
+{
+	struct lstcon_rpc_ent *ent;
+	struct sfw_latency    *lat;
+	struct sfw_latency     all;
+	unsigned long long     sum = 0;
+	int		       errcount = 0;
+
+	memset(&all, 0, sizeof(all));
+
+	list_for_each_entry(ent, resultp, rpe_link) {
+		if (ent->rpe_peer.nid == LNET_NID_ANY)
+			continue;
+
+		if (ent->rpe_rpc_errno != 0 || ent->rpe_fwk_errno != 0) {
+			errcount++;
+			continue;
+		}
+
+		lat = (struct sfw_latency *)&ent->rpe_payload[0];
+		if (lat->lat_count == 0)
+			continue;
+
+		fprintf(stdout, "%-24s count: %-8u min: %-8u avg: %-8u "
+			"p50: %-8u p99: %-8u p99.9: %-8u max: %u (usec)\n",
+			libcfs_id2str(ent->rpe_peer), lat->lat_count,
+			lat->lat_min_us, lat->lat_avg_us, lat->lat_p50_us,
+			lat->lat_p99_us, lat->lat_p999_us, lat->lat_max_us);
+
+		if (all.lat_count == 0 || lat->lat_min_us < all.lat_min_us)
+			all.lat_min_us = lat->lat_min_us;
+		if (lat->lat_max_us > all.lat_max_us)
+			all.lat_max_us = lat->lat_max_us;
+		if (lat->lat_p50_us > all.lat_p50_us)
+			all.lat_p50_us = lat->lat_p50_us;
+		if (lat->lat_p99_us > all.lat_p99_us)
+			all.lat_p99_us = lat->lat_p99_us;
+		if (lat->lat_p999_us > all.lat_p999_us)
+			all.lat_p999_us = lat->lat_p999_us;
+
+		sum += (unsigned long long)lat->lat_avg_us * lat->lat_count;
+		all.lat_count += lat->lat_count;
+	}
+
+	if (errcount > 0)
+		fprintf(stdout, "Failed to stat on %d nodes\n", errcount);
+
+	if (all.lat_count == 0)
+		return;
+
+	fprintf(stdout, "[RPC Latency of %s]\n", name);
+	fprintf(stdout, "count: %-8u min: %-8u avg: %-8llu "
+		"p50: %-8u p99: %-8u p99.9: %-8u max: %u (usec)\n",
+		all.lat_count, all.lat_min_us, sum / all.lat_count,
+		all.lat_p50_us, all.lat_p99_us, all.lat_p999_us,
+		all.lat_max_us);
+}
+
 int
 jt_lst_stat(int argc, char **argv)
 {
@@ -1890,6 +1955,7 @@ jt_lst_stat(int argc, char **argv)
 	int		      rc;
 	int		      c;
 	int		      mbs     = 0; /* report as MB/s */
+	int		      lat     = 0; /* test RPC latency */
 
 	static const struct option stat_opts[] = {
 		{ .name = "timeout", .has_arg = required_argument, .val = 't' },
@@ -1905,6 +1971,7 @@ jt_lst_stat(int argc, char **argv)
 		{ .name = "min",     .has_arg = no_argument,       .val = 'n' },
 		{ .name = "max",     .has_arg = no_argument,       .val = 'x' },
 		{ .name = "mbs",     .has_arg = no_argument,       .val = 'm' },
+		{ .name = "lat",     .has_arg = no_argument,       .val = 'L' },
 		{ .name = NULL } };
 
         if (session_key == 0) {
@@ -1914,7 +1981,7 @@ jt_lst_stat(int argc, char **argv)
         }
 
         while (1) {
-		c = getopt_long(argc, argv, "t:d:lcbarwgnxm", stat_opts,
+		c = getopt_long(argc, argv, "t:d:lcbarwgnxmL", stat_opts,
 				&optidx);
 
                 if (c == -1)
@@ -1972,6 +2039,9 @@ jt_lst_stat(int argc, char **argv)
 		case 'm':
 			mbs = 1;
 			break;
+		case 'L':
+			lat = 1;
+			break;
 
 		default:
 			lst_print_usage(argv[0]);
@@ -2018,17 +2088,30 @@ jt_lst_stat(int argc, char **argv)
 		last = now;
 
 		list_for_each_entry(srp, &head, srp_link) {
-                        rc = lst_stat_ioctl(srp->srp_name,
-                                            srp->srp_count, srp->srp_ids,
-                                            timeout, &srp->srp_result[idx]);
+			rc = lst_stat_ioctl(srp->srp_name,
+					    srp->srp_count, srp->srp_ids,
+					    lat ? LST_STAT_LATENCY :
+						  LST_STAT_COUNTERS,
+					    timeout, &srp->srp_result[idx]);
                         if (rc == -1) {
                                 lst_print_error("stat", "Failed to stat %s: %s\n",
                                                 srp->srp_name, strerror(errno));
+				if (lat && errno == EOPNOTSUPP)
+					fprintf(stderr,
+						"Latency needs session feature "
+						"%x, set LST_FEATURES before "
+						"new_session\n",
+						LST_FEAT_LAT_STATS);
                                 goto out;
                         }
 
-			lst_print_stat(srp->srp_name, srp->srp_result,
-				       idx, lnet, bwrt, rdwr, type, mbs);
+			if (lat)
+				lst_print_latency(srp->srp_name,
+						  &srp->srp_result[idx]);
+			else
+				lst_print_stat(srp->srp_name, srp->srp_result,
+					       idx, lnet, bwrt, rdwr, type,
+					       mbs);
 
 			lst_reset_rpcent(&srp->srp_result[1 - idx]);
 		}
@@ -2107,8 +2190,9 @@ jt_lst_show_error(int argc, char **argv)
         }
 
 	list_for_each_entry(srp, &head, srp_link) {
-                rc = lst_stat_ioctl(srp->srp_name, srp->srp_count,
-                                    srp->srp_ids, 10, &srp->srp_result[0]);
+		rc = lst_stat_ioctl(srp->srp_name, srp->srp_count,
+				    srp->srp_ids, LST_STAT_COUNTERS, 10,
+				    &srp->srp_result[0]);
 
                 if (rc == -1) {
                         lst_print_error(srp->srp_name, "Failed to show errors of %s: %s\n",
@@ -2925,6 +3009,59 @@ lst_parse_distribute(char *dstr, int *dist, int *span)
         return 0;
 }
 
+/* parse a brw size mix like "4k:70,1m:30", weights are in percent */
+static int
+lst_get_bulk_mix(char *str, struct lst_test_bulk_param *bulk)
+{
+	int	max_size = sysconf(_SC_PAGESIZE) * LNET_MAX_IOV;
+	int	weight = 0;
+	char   *end;
+	int	size;
+	int	n = 0;
+
+	while (*str != '\0') {
+		if (n == LST_BULK_MIX_MAX) {
+			fprintf(stderr, "Too many sizes in mix, max is %d\n",
+				LST_BULK_MIX_MAX);
+			return -1;
+		}
+
+		size = strtol(str, &end, 0);
+		if (*end == 'k' || *end == 'K') {
+			size *= 1024;
+			end++;
+		} else if (*end == 'm' || *end == 'M') {
+			size *= 1024 * 1024;
+			end++;
+		}
+
+		if (size <= 0 || size > max_size ||
+		    size % sizeof(__u64) != 0 || *end != ':') {
+			fprintf(stderr, "Invalid size in mix: %s\n", str);
+			return -1;
+		}
+
+		bulk->blk_mix_size[n] = size;
+		bulk->blk_mix_weight[n] = strtol(end + 1, &end, 0);
+		if (bulk->blk_mix_weight[n] <= 0 ||
+		    (*end != ',' && *end != '\0')) {
+			fprintf(stderr, "Invalid weight in mix: %s\n", str);
+			return -1;
+		}
+
+		weight += bulk->blk_mix_weight[n++];
+		str = *end == ',' ? end + 1 : end;
+	}
+
+	if (weight != 100) {
+		fprintf(stderr, "Weights of size mix should add up to 100\n");
+		return -1;
+	}
+
+	bulk->blk_nmix = n;
+	return 0;
+}
+
 int
 lst_get_bulk_param(int argc, char **argv, struct lst_test_bulk_param *bulk)
 {
@@ -2999,6 +3136,12 @@ lst_get_bulk_param(int argc, char **argv, struct lst_test_bulk_param *bulk)
 			if (end == NULL)
 				return 0;
 
+		} else if (strcasestr(argv[i], "mix=") == argv[i]) {
+			tok = strchr(argv[i], '=') + 1;
+
+			if (lst_get_bulk_mix(tok, bulk) != 0)
+				return -1;
+
                 } else if (strcasecmp(argv[i], "read") == 0 ||
                            strcasecmp(argv[i], "r") == 0) {
                         bulk->blk_opc = LST_BRW_READ;
@@ -3015,6 +3158,12 @@ lst_get_bulk_param(int argc, char **argv, struct lst_test_bulk_param *bulk)
                 i++;
         }
 
+	/* the bulk of each test unit is sized for the largest of the mix */
+	for (i = 0; i < bulk->blk_nmix; i++) {
+		if (i == 0 || bulk->blk_mix_size[i] > bulk->blk_size)
+			bulk->blk_size = bulk->blk_mix_size[i];
+	}
+
         return rc;
 }
 
@@ -3263,7 +3412,7 @@ static command_t lst_cmdlist[] = {
           "Usage: lst list_group [--active] [--busy] [--down] [--unknown] GROUP ..."    },
 	{"stat",                jt_lst_stat,            NULL,
 	 "Usage: lst stat [--bw] [--rate] [--read] [--write] [--max] [--min] [--avg] "
-	 " [--mbs] [--timeout #] [--delay #] [--count #] GROUP [GROUP]"                 },
+	 " [--mbs] [--lat] [--timeout #] [--delay #] [--count #] GROUP [GROUP]"         },
         {"show_error",          jt_lst_show_error,      NULL,
          "Usage: lst show_error NAME | IDS ..."                                         },
         {"add_batch",           jt_lst_add_batch,       NULL,
@@ -3302,6 +3451,15 @@ lst_initialize(void)
 		return -1;
 	}
 
+	/* the size mix extends the variable page size brw layout */
+	if ((session_features & LST_FEAT_BULK_MIX) != 0 &&
+	    (session_features & LST_FEAT_BULK_LEN) == 0) {
+		fprintf(stderr,
+			"Session feature %x requires feature %x\n",
+			LST_FEAT_BULK_MIX, LST_FEAT_BULK_LEN);
+		return -1;
+	}
+
         key = getenv("LST_SESSION");
 
         if (key == NULL) {
@@ -182,6 +182,7 @@ check_lnet_ping_info(void)
 	CHECK_VALUE(LNET_PING_FEAT_RTE_DISABLED);
 	CHECK_VALUE(LNET_PING_FEAT_MULTI_RAIL);
 	CHECK_VALUE(LNET_PING_FEAT_DISCOVERY);
+	CHECK_VALUE(LNET_PING_FEAT_COALESCE);
 	CHECK_VALUE(LNET_PING_FEAT_BITS);
 
 	CHECK_STRUCT(struct lnet_ping_info);
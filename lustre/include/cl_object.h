@@ -707,6 +707,14 @@ enum cl_page_type {
         CPT_TRANSIENT,
 };
 
+#define	CP_STATE_BITS	4
+#define	CP_TYPE_BITS	2
+/**
+ * Maximal number of slices in a cl_page: vvp (or echo), lov, lovsub and
+ * osc.
+ */
+#define	CP_MAX_LAYER	4
+
 /**
  * Fields are protected by the lock on struct page, except for atomics and
  * immutables.
@@ -719,38 +727,45 @@ enum cl_page_type {
 struct cl_page {
 	/** Reference counter. */
 	atomic_t		 cp_ref;
+	/**
+	 * Page state. This field is modified only internally within
+	 * cl_page.c, through cl_page_state_set_trust(). Protected by a VM
+	 * lock.
+	 */
+	enum cl_page_state	 cp_state:CP_STATE_BITS;
+	/**
+	 * Page type. Only CPT_TRANSIENT is used so far. Immutable after
+	 * creation.
+	 */
+	enum cl_page_type	 cp_type:CP_TYPE_BITS;
+	/** Number of slices in cp_layer_offset[]. Immutable after creation. */
+	unsigned int		 cp_layer_count:3;
+	/**
+	 * Offsets of the slices from the start of this page, top-to-bottom.
+	 * Slices live at fixed offsets in the same buffer as the cl_page
+	 * (\see cl_object_page_init()), so no list linkage is needed to
+	 * walk them. Immutable after creation.
+	 */
+	unsigned short		 cp_layer_offset[CP_MAX_LAYER];
 	/** An object this page is a part of. Immutable after creation. */
 	struct cl_object	*cp_obj;
 	/** vmpage */
 	struct page		*cp_vmpage;
-	/** Linkage of pages within group. Pages must be owned */
-	struct list_head	 cp_batch;
-	/** List of slices. Immutable after creation. */
-	struct list_head	 cp_layers;
 	/**
-	 * Page state. This field is const to avoid accidental update, it is
-	 * modified only internally within cl_page.c. Protected by a VM lock.
+	 * Owning IO in cl_page_state::CPS_OWNED state. Sub-page can be owned
+	 * by sub-io. Protected by a VM lock.
 	 */
-	const enum cl_page_state cp_state;
-        /**
-         * Page type. Only CPT_TRANSIENT is used so far. Immutable after
-         * creation.
-         */
-        enum cl_page_type        cp_type;
-
-        /**
-         * Owning IO in cl_page_state::CPS_OWNED state. Sub-page can be owned
-         * by sub-io. Protected by a VM lock.
-         */
-        struct cl_io            *cp_owner;
-        /** List of references to this page, for debugging. */
-        struct lu_ref            cp_reference;
+	struct cl_io		*cp_owner;
+	/** Assigned if doing a sync_io */
+	struct cl_sync_io	*cp_sync_io;
+	/** Linkage of pages within group. Pages must be owned */
+	struct list_head	 cp_batch;
+	/** List of references to this page, for debugging. */
+	struct lu_ref		 cp_reference;
 	/** Link to an object, for debugging. */
-	struct lu_ref_link       cp_obj_ref;
+	struct lu_ref_link	 cp_obj_ref;
 	/** Link to a queue, for debugging. */
-	struct lu_ref_link       cp_queue_ref;
-	/** Assigned if doing a sync_io */
-	struct cl_sync_io       *cp_sync_io;
+	struct lu_ref_link	 cp_queue_ref;
 };
 
 /**
@@ -759,16 +774,14 @@ struct cl_page {
  * \see vvp_page, lov_page, osc_page
  */
 struct cl_page_slice {
-        struct cl_page                  *cpl_page;
+	struct cl_page			*cpl_page;
 	pgoff_t				 cpl_index;
-        /**
-         * Object slice corresponding to this page slice. Immutable after
-         * creation.
-         */
-        struct cl_object                *cpl_obj;
-        const struct cl_page_operations *cpl_ops;
-        /** Linkage into cl_page::cp_layers. Immutable after creation. */
-	struct list_head		 cpl_linkage;
+	/**
+	 * Object slice corresponding to this page slice. Immutable after
+	 * creation.
+	 */
+	struct cl_object		*cpl_obj;
+	const struct cl_page_operations	*cpl_ops;
 };
 
 /**
@@ -1836,6 +1849,10 @@ struct cl_io {
 			enum cl_fsync_mode fi_mode;
 			/* how many pages were written/discarded */
 			unsigned int       fi_nr_written;
+			/** if set, CL_FSYNC_ALL sends the OST_SYNC RPCs of all
+			 * stripes through this set, and the caller waits for
+			 * them all at once */
+			struct ptlrpc_request_set *fi_rqset;
 		} ci_fsync;
 		struct cl_ladvise_io {
 			__u64			 li_start;
@@ -1957,6 +1974,11 @@ struct cl_site {
 	 */
 	struct cache_stats	cs_pages;
 	atomic_t		cs_pages_state[CPS_NR];
+	/**
+	 * Largest cl_page buffer (cl_page plus all its slices) allocated in
+	 * this site, in bytes. Updated racily, read-mostly.
+	 */
+	unsigned int		cs_page_bufsize_max;
 };
 
 int  cl_site_init(struct cl_site *s, struct cl_device *top);
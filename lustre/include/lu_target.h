@@ -515,6 +515,8 @@ void tgt_grant_prepare_read(const struct lu_env *env, struct obd_export *exp,
 void tgt_grant_prepare_write(const struct lu_env *env, struct obd_export *exp,
 			     struct obdo *oa, struct niobuf_remote *rnb,
 			     int niocount);
+void tgt_grant_prepare_hint(const struct lu_env *env, struct obd_export *exp,
+			    struct obdo *oa);
 void tgt_grant_commit(struct obd_export *exp, unsigned long grant_used, int rc);
 int tgt_grant_commit_cb_add(struct thandle *th, struct obd_export *exp,
 			    unsigned long grant);
@@ -43,6 +43,7 @@
  * @{
  */
 
+#include <linux/rbtree.h>
 #include <lustre_handles.h>
 #include <uapi/linux/lustre/lustre_idl.h>
 
@@ -180,6 +181,13 @@ struct obd_import {
 	struct list_head	imp_delayed_list;
         /** @} */
 
+	/**
+	 * Index of imp_replay_list ordered by (rq_transno, rq_xid), so that
+	 * retaining a request and finding the next one to replay do not
+	 * have to scan the list.
+	 */
+	struct rb_root		imp_replay_tree;
+
 	/**
 	 * List of requests that are retained for committed open replay. Once
 	 * open is committed, open replay request will be moved from the
@@ -191,6 +199,17 @@ struct obd_import {
 	struct list_head	*imp_replay_cursor;
 	/** @} */
 
+	/**
+	 * Number of requests on imp_replay_list and imp_committed_list, and
+	 * the total number of entries visited while inserting, pruning and
+	 * replaying them. Protected by imp_lock.
+	 * @{
+	 */
+	unsigned int		imp_replay_list_len;
+	unsigned int		imp_committed_list_len;
+	__u64			imp_replay_walk;
+	/** @} */
+
 	/** List of not replied requests */
 	struct list_head	imp_unreplied_list;
 	/** Known maximal replied XID */
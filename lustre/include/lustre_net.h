@@ -99,6 +99,12 @@
 #define PTLRPC_MAX_BRW_BITS	(LNET_MTU_BITS + PTLRPC_BULK_OPS_BITS)
 #define PTLRPC_MAX_BRW_SIZE	(1U << PTLRPC_MAX_BRW_BITS)
 #define PTLRPC_MAX_BRW_PAGES	(PTLRPC_MAX_BRW_SIZE >> PAGE_SHIFT)
+/**
+ * Maximum number of objects a client may pack into one OST_WRITE RPC when
+ * OBD_CONNECT2_MULTIOBJ_BRW was negotiated.  Each object is described by its
+ * own obd_ioobj, followed by its niobufs in the same order.
+ */
+#define PTLRPC_MAX_BRW_OBJS	16
 
 #define ONE_MB_BRW_SIZE		(1U << LNET_MTU_BITS)
 #define MD_MAX_BRW_SIZE		(1U << LNET_MTU_BITS)
@@ -1048,6 +1054,8 @@ struct ptlrpc_request {
 	 * It's also link chain on obd_export::exp_req_replay_queue
 	 */
 	struct list_head		 rq_replay_list;
+	/** node in obd_import::imp_replay_tree while on imp_replay_list */
+	struct rb_node			 rq_replay_node;
 	/** non-shared members for client & server request*/
 	union {
 		struct ptlrpc_cli_req	 rq_cli;
@@ -1507,6 +1515,7 @@ enum {
 	SVC_RUNNING	= 1 << 3,
 	SVC_EVENT	= 1 << 4,
 	SVC_SIGNAL	= 1 << 5,
+	SVC_IDLE_EXIT	= 1 << 6,
 };
 
 #define PTLRPC_THR_NAME_LEN		32
@@ -1694,6 +1703,11 @@ struct ptlrpc_service {
 	int				srv_nthrs_cpt_init;
 	/** limit of threads number for each partition */
 	int				srv_nthrs_cpt_limit;
+	/**
+	 * seconds a thread above srv_nthrs_cpt_init stays idle before it
+	 * exits; 0 means threads never exit
+	 */
+	int				srv_thread_idle_timeout;
         /** Root of /proc dir tree for this service */
 	struct proc_dir_entry           *srv_procroot;
         /** Pointer to statistic data for this service */
@@ -1769,10 +1783,14 @@ struct ptlrpc_service_part {
 	int				scp_thr_nextid;
 	/** # of starting threads */
 	int				scp_nthrs_starting;
-	/** # of stopping threads, reserved for shrinking threads */
+	/** # of threads exiting for being idle */
 	int				scp_nthrs_stopping;
 	/** # running threads */
 	int				scp_nthrs_running;
+	/** last time a thread was started */
+	time64_t			scp_thr_start_time;
+	/** last time a request was queued for long before being handled */
+	time64_t			scp_req_wait_time;
 	/** service threads list */
 	struct list_head		scp_threads;
 
@@ -1862,6 +1880,11 @@ struct ptlrpc_service_part {
 	struct list_head		scp_rep_active;
 	/** List of free reply_states */
 	struct list_head		scp_rep_idle;
+	/**
+	 * # of reply_states owed by threads that exited for being idle,
+	 * freed instead of going back to scp_rep_idle
+	 */
+	int				scp_rep_surplus;
 	/** waitq to run, when adding stuff to srv_free_rs_list */
 	wait_queue_head_t		scp_rep_waitq;
 	/** # 'difficult' replies */
@@ -2691,6 +2714,7 @@ void ptlrpcd_decref(void);
  */
 const char* ll_opcode2str(__u32 opcode);
 const int ll_str2opcode(const char *ops);
+const char *ll_opcode_offset2str(unsigned int offset);
 #ifdef CONFIG_PROC_FS
 void ptlrpc_lprocfs_register_obd(struct obd_device *obd);
 void ptlrpc_lprocfs_unregister_obd(struct obd_device *obd);
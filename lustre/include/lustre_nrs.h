@@ -237,6 +237,20 @@ struct ptlrpc_nrs_pol_ops {
 	 */
 	void	(*op_req_stop) (struct ptlrpc_nrs_policy *policy,
 				struct ptlrpc_nrs_request *nrq);
+	/**
+	 * Called for a queued request which is close to its deadline, so that
+	 * the policy can serve it ahead of requests which can still wait;
+	 * this operation is optional.
+	 *
+	 * \param[in,out] policy The policy the request \a nrq is queued on
+	 * \param[in,out] nrq	 The late request
+	 *
+	 * \pre assert_spin_locked(&svcpt->scp_req_lock)
+	 *
+	 * \see ptlrpc_nrs_req_late()
+	 */
+	void	(*op_req_late) (struct ptlrpc_nrs_policy *policy,
+				struct ptlrpc_nrs_request *nrq);
 	/**
 	 * Registers the policy's lprocfs interface with a PTLRPC service.
 	 *
@@ -676,6 +690,7 @@ enum {
 #include <lustre_nrs_crr.h>
 #include <lustre_nrs_orr.h>
 #include <lustre_nrs_delay.h>
+#include <lustre_nrs_edf.h>
 
 /**
  * NRS request
@@ -726,6 +741,10 @@ struct ptlrpc_nrs_request {
 		 * Fields for the delay policy
 		 */
 		struct nrs_delay_req	delay;
+		/**
+		 * Fields for the EDF policy
+		 */
+		struct nrs_edf_req	edf;
 	} nr_u;
 	/**
 	 * Externally-registering policies may want to use this to allocate
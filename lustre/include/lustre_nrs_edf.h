@@ -0,0 +1,106 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License version 2 for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ *
+ * Network Request Scheduler (NRS) Earliest Deadline First (EDF) policy
+ *
+ */
+
+#ifndef _LUSTRE_NRS_EDF_H
+#define _LUSTRE_NRS_EDF_H
+
+/* \name edf
+ *
+ * EDF policy
+ * @{
+ */
+
+/**
+ * Private data structure for the EDF policy
+ */
+struct nrs_edf_data {
+	struct ptlrpc_nrs_resource	 edf_res;
+
+	/**
+	 * Queued requests are stored in this binheap, ordered by their
+	 * weighted deadline, until they are removed for handling.
+	 */
+	struct cfs_binheap		*edf_binheap;
+
+	/**
+	 * Sequence number generator; used to keep requests with equal
+	 * deadlines in arrival order.
+	 */
+	__u64				 edf_sequence;
+
+	/**
+	 * Number of queued requests which have been promoted by
+	 * ptlrpc_at_check_timed() because they were about to expire.
+	 */
+	__u64				 edf_late;
+
+	/**
+	 * Per-opcode weights, in percent of the time the client has given
+	 * the server to handle a request, indexed by opcode_offset().
+	 */
+	__u16				 edf_weights[LUSTRE_MAX_OPCODES];
+};
+
+struct nrs_edf_req {
+	/**
+	 * Weighted deadline of the request, assigned upon enqueue.
+	 */
+	ktime_t		er_deadline;
+	/**
+	 * Sequence number assigned upon enqueue; breaks deadline ties.
+	 */
+	__u64		er_sequence;
+	/**
+	 * Set once the request has been promoted for being late.
+	 */
+	unsigned int	er_late:1;
+};
+
+/**
+ * Used for reading out the weights and counters of a policy instance via
+ * NRS_CTL_EDF_RD_WEIGHTS.
+ */
+struct nrs_edf_weights_info {
+	__u16		ewi_weights[LUSTRE_MAX_OPCODES];
+	__u64		ewi_late;
+};
+
+/**
+ * A single opcode weight update, passed with NRS_CTL_EDF_WR_WEIGHT.
+ */
+struct nrs_edf_weight {
+	__u32		ew_opc;
+	__u32		ew_weight;
+};
+
+enum nrs_ctl_edf {
+	NRS_CTL_EDF_RD_WEIGHTS = PTLRPC_NRS_CTL_1ST_POL_SPEC,
+	NRS_CTL_EDF_WR_WEIGHT,
+};
+
+/** @} edf */
+
+#endif
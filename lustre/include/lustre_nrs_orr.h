@@ -43,6 +43,8 @@ enum nrs_ctl_orr {
 	NRS_CTL_ORR_WR_OFF_TYPE,
 	NRS_CTL_ORR_RD_SUPP_REQ,
 	NRS_CTL_ORR_WR_SUPP_REQ,
+	NRS_CTL_ORR_RD_COALESCE,
+	NRS_CTL_ORR_WR_COALESCE,
 };
 
 /**
@@ -132,6 +134,20 @@ struct nrs_orr_data {
 	 * Whether to use physical disk offsets or logical file offsets.
 	 */
 	bool				od_physical;
+	/**
+	 * Maximum number of requests dispatched as one run of adjacent
+	 * requests on the same object; 0 disables coalescing.
+	 */
+	__u16				od_coalesce;
+	/**
+	 * Requests pulled ahead of their turn, as they are adjacent to the
+	 * request last dequeued from od_binheap; served before od_binheap.
+	 */
+	struct list_head		od_run;
+	/**
+	 * # of requests which have been pulled into od_run.
+	 */
+	__u64				od_nr_coalesced;
 	/**
 	 * XXX: We need to provide a persistently allocated string to hold
 	 * unique object names for this policy, since in currently supported
@@ -175,6 +191,20 @@ struct nrs_orr_object {
 	 * # of pending requests for this object or OST, on all existing rounds
 	 */
 	__u16				oo_active;
+	/**
+	 * Requests of this object or OST queued in nrs_orr_data::od_binheap,
+	 * sorted by the start of their offset range, so that the request
+	 * adjacent to another one can be found quickly; see nrs_orr_coalesce()
+	 */
+	struct rb_root			oo_tree;
+};
+
+/**
+ * Coalescing settings and statistics of an ORR policy instance
+ */
+struct nrs_orr_coalesce_info {
+	__u16				oci_max;
+	__u64				oci_coalesced;
 };
 
 /**
@@ -195,6 +225,14 @@ struct nrs_orr_req {
 	 * the same batch.
 	 */
 	__u64				or_sequence;
+	/**
+	 * Linkage into nrs_orr_object::oo_tree while in the binary heap.
+	 */
+	struct rb_node			or_node;
+	/**
+	 * Linkage into nrs_orr_data::od_run once coalesced.
+	 */
+	struct list_head		or_list;
 	/**
 	 * For debugging purposes.
 	 */
@@ -219,6 +257,10 @@ struct nrs_orr_req {
 	 * values.
 	 */
 	unsigned int			or_physical_set:1;
+	/**
+	 * The request has been pulled into nrs_orr_data::od_run.
+	 */
+	unsigned int			or_coalesced:1;
 };
 
 /** @} ORR/TRR */
@@ -89,7 +89,13 @@ struct nrs_tbf_client {
 	struct list_head		 tc_list;
 	/** Node in binary heap. */
 	struct cfs_binheap_node		 tc_node;
-	/** Whether the client is in heap. */
+	/** Linkage into a slot, or the ready list, of the timer wheel. */
+	struct list_head		 tc_wheel;
+	/** Tick at which the client expires from the timer wheel. */
+	__u64				 tc_wheel_expire;
+	/** Slot of the timer wheel the client is on. */
+	__u32				 tc_wheel_slot;
+	/** Whether the client is in heap, or in the timer wheel. */
 	bool				 tc_in_heap;
 	/** Sequence of the newest rule. */
 	__u32				 tc_rule_sequence;
@@ -144,8 +150,31 @@ struct nrs_tbf_rule {
 	atomic_t			 tr_ref;
 	/** Generation of the rule. */
 	__u64				 tr_generation;
+	/**
+	 * Parent rule; the classes of this rule may borrow tokens from the
+	 * bucket of the parent, and are charged to it.
+	 */
+	struct nrs_tbf_rule		*tr_parent;
+	/** Depth in the rule hierarchy, 0 for a rule without parent. */
+	__u32				 tr_level;
+	/** Number of running rules which have this rule as parent. */
+	atomic_t			 tr_nr_children;
+	/**
+	 * Tokens of the bucket shared by all classes under a parent rule;
+	 * every request dequeued in the subtree takes one.
+	 */
+	__s64				 tr_ntoken;
+	/** Time check-point of the shared bucket. */
+	__u64				 tr_check_time;
+	/** Number of requests dequeued under this rule. */
+	__u64				 tr_nr_served;
+	/** Number of requests of this rule dequeued with borrowed tokens. */
+	__u64				 tr_nr_borrowed;
 };
 
+/** Maximum depth of the TBF rule hierarchy. */
+#define NRS_TBF_MAX_LEVEL	4
+
 struct nrs_tbf_ops {
 	char *o_name;
 	int (*o_startup)(struct ptlrpc_nrs_policy *, struct nrs_tbf_head *);
@@ -184,6 +213,34 @@ struct nrs_tbf_type {
 	struct nrs_tbf_ops	*ntt_ops;
 };
 
+/**
+ * Hierarchical timer wheel used instead of the binary heap to schedule TBF
+ * classes by the time of their next token. A class is put in the slot of the
+ * lowest level which can hold its expiry time, and moved down a level each
+ * time the wheel turns over the slot of the level above, so both adding a
+ * class and expiring it are O(1).
+ */
+#define NRS_TBF_WHEEL_SHIFT	16	/* 65.5us per tick */
+#define NRS_TBF_WHEEL_BITS	6
+#define NRS_TBF_WHEEL_SIZE	(1 << NRS_TBF_WHEEL_BITS)
+#define NRS_TBF_WHEEL_MASK	(NRS_TBF_WHEEL_SIZE - 1)
+#define NRS_TBF_WHEEL_LEVELS	4
+/** tc_wheel_slot of the classes on the ready list */
+#define NRS_TBF_WHEEL_READY	(NRS_TBF_WHEEL_LEVELS * NRS_TBF_WHEEL_SIZE)
+
+struct nrs_tbf_wheel {
+	/** Next tick to be processed. */
+	__u64			tw_time;
+	/** Number of classes in the slots, not counting the ready list. */
+	__u32			tw_count;
+	/** Bitmap of the non-empty slots of each level. */
+	__u64			tw_pending[NRS_TBF_WHEEL_LEVELS];
+	/** Classes whose tick has passed. */
+	struct list_head	tw_ready;
+	/** Slots of each level. */
+	struct list_head	tw_slots[NRS_TBF_WHEEL_LEVELS][NRS_TBF_WHEEL_SIZE];
+};
+
 struct nrs_tbf_bucket {
 	/**
 	 * LRU list, updated on each access to client. Protected by
@@ -232,6 +289,23 @@ struct nrs_tbf_head {
 	 * Heap of queues.
 	 */
 	struct cfs_binheap		*th_binheap;
+	/**
+	 * Timer wheel of queues, used instead of th_binheap if set.
+	 */
+	struct nrs_tbf_wheel		*th_wheel;
+	/**
+	 * Number of classes with queued requests.
+	 */
+	__u32				 th_nr_active;
+	/**
+	 * Number of classes.
+	 */
+	atomic_t			 th_nr_classes;
+	/**
+	 * Number of dequeued requests, and time spent dequeuing them.
+	 */
+	__u64				 th_nr_dequeue;
+	__u64				 th_dequeue_ns;
 	/**
 	 * Hash of clients.
 	 */
@@ -254,6 +328,29 @@ struct nrs_tbf_head {
 	int				 th_purge_start;
 };
 
+/**
+ * Scheduler statistics of the TBF policy instance of one CPT, read out with
+ * NRS_CTL_TBF_RD_STATS so that they can be printed without nrs_lock.
+ */
+struct nrs_tbf_stats {
+	int				 ts_cpt;
+	bool				 ts_wheel;
+	int				 ts_nr_classes;
+	__u32				 ts_nr_active;
+	__u64				 ts_nr_dequeue;
+	__u64				 ts_dequeue_ns;
+};
+
+/**
+ * Passed with NRS_CTL_TBF_RD_STATS; each policy instance fills in the next
+ * of the \a tsi_max entries of \a tsi_stats.
+ */
+struct nrs_tbf_stats_info {
+	struct nrs_tbf_stats		*tsi_stats;
+	int				 tsi_count;
+	int				 tsi_max;
+};
+
 enum nrs_tbf_cmd_type {
 	NRS_CTL_TBF_START_RULE = 0,
 	NRS_CTL_TBF_STOP_RULE,
@@ -277,6 +374,7 @@ struct nrs_tbf_cmd {
 			__u32			 ts_valid_type;
 			__u32			 ts_rule_flags;
 			char			*ts_next_name;
+			char			*ts_parent_name;
 		} tc_start;
 		struct nrs_tbf_cmd_change {
 			__u64			 tc_rpc_rate;
@@ -337,6 +435,10 @@ enum nrs_ctl_tbf {
 	 * Read the TBF policy type preset by proc entry "nrs_policies".
 	 */
 	NRS_CTL_TBF_RD_TYPE_FLAG,
+	/**
+	 * Read the scheduling statistics of a TBF policy.
+	 */
+	NRS_CTL_TBF_RD_STATS,
 };
 
 /** @} tbf */
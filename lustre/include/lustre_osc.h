@@ -85,7 +85,6 @@ struct osc_async_page {
 	struct brw_page		oap_brw_page;
 
 	struct ptlrpc_request	*oap_request;
-	struct client_obd	*oap_cli;
 	struct osc_object	*oap_obj;
 
 	spinlock_t		 oap_lock;
@@ -117,6 +116,8 @@ struct osc_device {
 		uint64_t	os_lockless_writes;    /* by bytes */
 		uint64_t	os_lockless_reads;     /* by bytes */
 		uint64_t	os_lockless_truncates; /* by times */
+		uint64_t	os_multiobj_rpcs;      /* by times */
+		uint64_t	os_multiobj_objs;      /* by objects */
 	} od_stats;
 
 	/* configuration item(s) */
@@ -180,6 +181,8 @@ struct osc_thread_info {
 	struct cl_sync_io	oti_anchor;
 	struct cl_req_attr	oti_req_attr;
 	struct lu_buf		oti_ladvise_buf;
+	/** owner check of objects packed into one write RPC */
+	struct obdo		oti_oa;
 };
 
 struct osc_object {
@@ -206,6 +209,12 @@ struct osc_object {
 	struct list_head	oo_hp_ready_item;
 	struct list_head	oo_write_item;
 	struct list_head	oo_read_item;
+	/**
+	 * when this object was put on the ready list, used to bound how
+	 * long its small writes are held for multi-object RPCs.
+	 * Protected by client_obd->cli_loi_list_lock.
+	 */
+	ktime_t			oo_ready_time;
 
 	/**
 	 * extent is a red black tree to manage (async) dirty pages.
@@ -416,17 +425,17 @@ struct osc_page {
 	 * An offset within page from which next transfer starts. This is used
 	 * by cl_page_clip() to submit partial page transfers.
 	 */
-	int                   ops_from;
+	unsigned		ops_from:PAGE_SHIFT + 1,
 	/**
 	 * An offset within page at which next transfer ends.
 	 *
 	 * \see osc_page::ops_from.
 	 */
-	int                   ops_to;
+				ops_to:PAGE_SHIFT + 1,
 	/**
 	 * Boolean, true iff page is under transfer. Used for sanity checking.
 	 */
-	unsigned              ops_transfer_pinned:1,
+				ops_transfer_pinned:1,
 	/**
 	 * in LRU?
 	 */
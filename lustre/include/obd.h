@@ -133,6 +133,7 @@ struct timeout_item {
 #define OSC_MAX_DIRTY_DEFAULT	(OBD_MAX_RIF_DEFAULT * 4)
 #define OSC_MAX_DIRTY_MB_MAX	2048     /* arbitrary, but < MAX_LONG bytes */
 #define OSC_DEFAULT_RESENDS	10
+#define OSC_MULTIOBJ_DELAY_US	1000	/* hold small writes up to 1ms */
 
 /* possible values for fo_sync_lock_cancel */
 enum {
@@ -208,6 +209,16 @@ struct client_obd {
 	struct list_head	cl_grant_shrink_list;  /* Timeout event list */
 	time64_t		cl_grant_shrink_interval; /* seconds */
 
+	/* grant forecasting, see osc_grant_forecast(). Protected by
+	 * loi_list_lock as the grant values above. */
+	ktime_t			cl_grant_rate_stamp;
+	unsigned long		cl_grant_rate_bytes; /* since rate_stamp */
+	unsigned long		cl_grant_rate;	/* bytes/s, moving average */
+	unsigned int		cl_grant_horizon_ms; /* 0 disables */
+	unsigned int		cl_grant_req_pending:1;
+	unsigned long		cl_grant_hint_rpcs;
+	unsigned long		cl_grant_waits;
+
 	/* A chunk is an optimal size used by osc_extent to determine
 	 * the extent size. A chunk is max(PAGE_SIZE, OST block size) */
 	int			cl_chunkbits;
@@ -246,6 +257,10 @@ struct client_obd {
 	atomic_t		cl_pending_r_pages;
 	__u32			cl_max_pages_per_rpc;
 	__u32			cl_max_rpcs_in_flight;
+	/* max # of objects packed into one write RPC, 1 disables packing */
+	__u32			cl_max_objs_per_rpc;
+	/* how long a small write may wait for other objects to pack with */
+	__u32			cl_multiobj_delay_us;
 	struct obd_histogram	cl_read_rpc_hist;
 	struct obd_histogram	cl_write_rpc_hist;
 	struct obd_histogram	cl_read_page_hist;
@@ -285,6 +300,18 @@ struct client_obd {
 	 * An unstable page is a page state that WRITE RPC has finished but
 	 * the transaction has NOT yet committed. */
 	atomic_long_t            cl_unstable_count;
+	/** Budget of unstable pages for this client_obd, 0 means a quarter
+	 * of the shared LRU. Writers over budget are throttled, see
+	 * osc_unstable_throttle(). */
+	unsigned long		 cl_unstable_max_pages;
+	/** Set while write RPCs carry OBD_BRW_SOFT_SYNC to this target.
+	 * Accessed locklessly with READ_ONCE()/WRITE_ONCE(). */
+	bool			 cl_unstable_soft_sync;
+	/** Writers waiting for cl_unstable_count to drop below budget. */
+	wait_queue_head_t	 cl_unstable_waitq;
+	/** stats: # of writers throttled and the total time they waited */
+	atomic_long_t		 cl_unstable_wait_count;
+	atomic_long_t		 cl_unstable_wait_us;
 	/** Link to osc_shrinker_list */
 	struct list_head	 cl_shrink_list;
 
@@ -331,6 +358,8 @@ struct client_obd {
 	/* ptlrpc work for writeback in ptlrpcd context */
 	void			*cl_writeback_work;
 	void			*cl_lru_work;
+	/* grant-only request work */
+	void			*cl_grant_work;
 	/* hash tables for osc_quota_info */
 	struct cfs_hash		*cl_quota_hash[LL_MAXQUOTAS];
 	/* Links to the global list of registered changelog devices */
@@ -1050,7 +1079,7 @@ struct md_ops {
 			 size_t , struct ptlrpc_request **);
 
 	int (*m_fsync)(struct obd_export *, const struct lu_fid *,
-		       struct ptlrpc_request **);
+		       struct ptlrpc_request_set *, struct ptlrpc_request **);
 
 	int (*m_read_page)(struct obd_export *, struct md_op_data *,
 			   struct md_callback *cb_op, __u64 hash_offset,
@@ -1419,7 +1419,13 @@ static inline int md_setattr(struct obd_export *exp, struct md_op_data *op_data,
 	RETURN(rc);
 }
 
+/**
+ * Sync the metadata of \a fid on its MDT. If \a set is given, the request is
+ * only added to it, so it is sent along with other RPCs of the set, and
+ * \a request is left NULL.
+ */
 static inline int md_fsync(struct obd_export *exp, const struct lu_fid *fid,
+			   struct ptlrpc_request_set *set,
 			   struct ptlrpc_request **request)
 {
 	int rc;
@@ -1427,7 +1433,7 @@ static inline int md_fsync(struct obd_export *exp, const struct lu_fid *fid,
 	ENTRY;
 	EXP_CHECK_MD_OP(exp, fsync);
 	EXP_MD_COUNTER_INCREMENT(exp, fsync);
-	rc = MDP(exp->exp_obd, fsync)(exp, fid, request);
+	rc = MDP(exp->exp_obd, fsync)(exp, fid, set, request);
 
 	RETURN(rc);
 }
@@ -328,6 +328,8 @@ extern char obd_jobid_var[];
 #define OBD_FAIL_OST_LADVISE_PAUSE	 0x237
 #define OBD_FAIL_OST_FAKE_RW		 0x238
 #define OBD_FAIL_OST_LIST_ASSERT         0x239
+#define OBD_FAIL_OST_PAUSE_SYNC		 0x23a
+#define OBD_FAIL_OST_SYNC_ERR		 0x23b
 #define OBD_FAIL_OST_GL_WORK_ALLOC	 0x240
 
 #define OBD_FAIL_LDLM                    0x300
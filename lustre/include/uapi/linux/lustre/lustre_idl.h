@@ -803,6 +803,7 @@ struct ptlrpc_body_v2 {
 /* ocd_connect_flags2 flags */
 #define OBD_CONNECT2_FILE_SECCTX	0x1ULL /* set file security context at create */
 #define OBD_CONNECT2_LOCKAHEAD	0x2ULL /* ladvise lockahead v2 */
+#define OBD_CONNECT2_MULTIOBJ_BRW 0x4ULL /* multi-object bulk write */
 
 /* XXX README XXX:
  * Please DO NOT add flag values here before first ensuring that this same
@@ -871,7 +872,8 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT_BULK_MBITS | \
 				OBD_CONNECT_GRANT_PARAM | OBD_CONNECT_FLAGS2)
 
-#define OST_CONNECT_SUPPORTED2 OBD_CONNECT2_LOCKAHEAD
+#define OST_CONNECT_SUPPORTED2 (OBD_CONNECT2_LOCKAHEAD | \
+				OBD_CONNECT2_MULTIOBJ_BRW)
 
 #define ECHO_CONNECT_SUPPORTED 0
 #define ECHO_CONNECT_SUPPORTED2 0
@@ -1007,6 +1009,8 @@ enum obdo_flags {
         OBD_FL_NOSPC_BLK    = 0x00100000, /* no more block space on OST */
 	OBD_FL_FLUSH	    = 0x00200000, /* flush pages on the OST */
 	OBD_FL_SHORT_IO	    = 0x00400000, /* short io request */
+	OBD_FL_GRANT_HINT   = 0x00800000, /* client forecasts more grant demand
+					   * than it holds, see o_undirty */
 	/* OBD_FL_LOCAL_MASK = 0xF0000000, was local-only flags until 2.10 */
 
 	/* Note that while these checksum values are currently separate bits,
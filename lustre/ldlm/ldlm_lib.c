@@ -389,6 +389,11 @@ int client_obd_setup(struct obd_device *obddev, struct lustre_cfg *lcfg)
 	INIT_LIST_HEAD(&cli->cl_lru_list);
 	spin_lock_init(&cli->cl_lru_list_lock);
 	atomic_long_set(&cli->cl_unstable_count, 0);
+	cli->cl_unstable_max_pages = 0;
+	cli->cl_unstable_soft_sync = false;
+	init_waitqueue_head(&cli->cl_unstable_waitq);
+	atomic_long_set(&cli->cl_unstable_wait_count, 0);
+	atomic_long_set(&cli->cl_unstable_wait_us, 0);
 	INIT_LIST_HEAD(&cli->cl_shrink_list);
 
 	init_waitqueue_head(&cli->cl_destroy_waitq);
@@ -408,6 +413,8 @@ int client_obd_setup(struct obd_device *obddev, struct lustre_cfg *lcfg)
 	/* Set it to possible maximum size. It may be reduced by ocd_brw_size
 	 * from OFD after connecting. */
 	cli->cl_max_pages_per_rpc = PTLRPC_MAX_BRW_PAGES;
+	cli->cl_max_objs_per_rpc = 1;
+	cli->cl_multiobj_delay_us = OSC_MULTIOBJ_DELAY_US;
 
 	/* set cl_chunkbits default value to PAGE_SHIFT,
 	 * it will be updated at OSC connection time. */
@@ -3291,15 +3291,25 @@ static int ll_flush(struct file *file, fl_owner_t id)
  * Called to make sure a portion of file has been written out.
  * if @mode is not CL_FSYNC_LOCAL, it will send OST_SYNC RPCs to OST.
  *
+ * With CL_FSYNC_ALL the writeback of all stripes is started first, then the
+ * OST_SYNC RPCs of all stripes are added to @set and sent together, so the
+ * latency doesn't grow with the stripe count. @set is waited for before
+ * returning, including any RPCs the caller added to it. If @set is NULL one
+ * is allocated here.
+ *
  * Return how many pages have been written.
  */
-int cl_sync_file_range(struct inode *inode, loff_t start, loff_t end,
-		       enum cl_fsync_mode mode, int ignore_layout)
+static int cl_sync_file_range_set(struct inode *inode, loff_t start,
+				  loff_t end, enum cl_fsync_mode mode,
+				  int ignore_layout,
+				  struct ptlrpc_request_set *set)
 {
+	struct ptlrpc_request_set *own_set = NULL;
 	struct lu_env *env;
 	struct cl_io *io;
 	struct cl_fsync_io *fio;
 	int result;
+	int rc;
 	__u16 refcheck;
 	ENTRY;
 
@@ -3308,8 +3318,16 @@ int cl_sync_file_range(struct inode *inode, loff_t start, loff_t end,
 		RETURN(-EINVAL);
 
 	env = cl_env_get(&refcheck);
-	if (IS_ERR(env))
+	if (IS_ERR(env)) {
+		if (set != NULL)
+			ptlrpc_set_wait(set);
 		RETURN(PTR_ERR(env));
+	}
+
+	/* without a set, OST_SYNC RPCs are sent and waited for by each
+	 * stripe on its own */
+	if (mode == CL_FSYNC_ALL && set == NULL)
+		set = own_set = ptlrpc_prep_set();
 
 	io = vvp_env_thread_io(env);
 	io->ci_obj = ll_i2info(inode)->lli_clob;
@@ -3322,19 +3340,38 @@ int cl_sync_file_range(struct inode *inode, loff_t start, loff_t end,
 	fio->fi_fid = ll_inode2fid(inode);
 	fio->fi_mode = mode;
 	fio->fi_nr_written = 0;
+	fio->fi_rqset = mode == CL_FSYNC_ALL ? set : NULL;
 
 	if (cl_io_init(env, io, CIT_FSYNC, io->ci_obj) == 0)
 		result = cl_io_loop(env, io);
 	else
 		result = io->ci_result;
+
+	/* the set has to be completed before cl_io_fini() releases the
+	 * sub-IOs the OST_SYNC replies are interpreted into */
+	if (set != NULL) {
+		rc = ptlrpc_set_wait(set);
+		if (result == 0)
+			result = rc;
+	}
 	if (result == 0)
 		result = fio->fi_nr_written;
 	cl_io_fini(env, io);
 	cl_env_put(env, &refcheck);
 
+	if (own_set != NULL)
+		ptlrpc_set_destroy(own_set);
+
 	RETURN(result);
 }
 
+int cl_sync_file_range(struct inode *inode, loff_t start, loff_t end,
+		       enum cl_fsync_mode mode, int ignore_layout)
+{
+	return cl_sync_file_range_set(inode, start, end, mode, ignore_layout,
+				      NULL);
+}
+
 /*
  * When dentry is provided (the 'else' case), file_dentry() may be
  * null and dentry must be used directly rather than pulled from
@@ -3360,7 +3397,9 @@ int ll_fsync(struct file *file, struct dentry *dentry, int datasync)
 #endif
 	struct inode *inode = dentry->d_inode;
 	struct ll_inode_info *lli = ll_i2info(inode);
+	struct ptlrpc_request_set *set;
 	struct ptlrpc_request *req;
+	ktime_t kstart = ktime_get();
 	int rc, err;
 	ENTRY;
 
@@ -3393,28 +3432,42 @@ int ll_fsync(struct file *file, struct dentry *dentry, int datasync)
 		}
 	}
 
-	err = md_fsync(ll_i2sbi(inode)->ll_md_exp, ll_inode2fid(inode), &req);
+	/* MDS_SYNC is sent along with the OST_SYNC RPCs of all stripes if a
+	 * request set can be had, otherwise it is waited for right here */
+	set = ptlrpc_prep_set();
+	err = md_fsync(ll_i2sbi(inode)->ll_md_exp, ll_inode2fid(inode), set,
+		       &req);
 	if (!rc)
 		rc = err;
-	if (!err)
+	if (!err && req != NULL)
 		ptlrpc_req_finished(req);
 
 	if (S_ISREG(inode->i_mode)) {
 		struct ll_file_data *fd = LUSTRE_FPRIVATE(file);
 
-		err = cl_sync_file_range(inode, start, end, CL_FSYNC_ALL, 0);
+		err = cl_sync_file_range_set(inode, start, end, CL_FSYNC_ALL,
+					     0, set);
 		if (rc == 0 && err < 0)
 			rc = err;
 		if (rc < 0)
 			fd->fd_write_failed = true;
 		else
 			fd->fd_write_failed = false;
+	} else if (set != NULL) {
+		err = ptlrpc_set_wait(set);
+		if (rc == 0)
+			rc = err;
 	}
 
+	if (set != NULL)
+		ptlrpc_set_destroy(set);
+
 #ifdef HAVE_FILE_FSYNC_4ARGS
 	if (lock_inode)
 		inode_unlock(inode);
 #endif
+	lprocfs_oh_tally_log2(&ll_i2sbi(inode)->ll_fsync_hist,
+			      ktime_to_us(ktime_sub(ktime_get(), kstart)));
 	RETURN(rc);
 }
 
@@ -519,6 +519,8 @@ struct ll_sb_info {
         int                       ll_stats_track_id;
         enum stats_track_type     ll_stats_track_type;
         int                       ll_rw_stats_on;
+	/* fsync latency in usec, log2 buckets */
+	struct obd_histogram	  ll_fsync_hist;
 
 	/* metadata stat-ahead */
 	unsigned int		  ll_sa_max;     /* max statahead RPCs */
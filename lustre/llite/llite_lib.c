@@ -121,6 +121,7 @@ static struct ll_sb_info *ll_init_sbi(void)
 		spin_lock_init(&sbi->ll_rw_extents_info.pp_extents[i].
 			       pp_w_hist.oh_lock);
         }
+	spin_lock_init(&sbi->ll_fsync_hist.oh_lock);
 
 	/* metadata statahead is enabled by default */
 	sbi->ll_sa_max = LL_SA_RPC_DEF;
@@ -418,7 +419,8 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt,
 	data->ocd_connect_flags |= OBD_CONNECT_LOCKAHEAD_OLD;
 #endif
 
-	data->ocd_connect_flags2 = OBD_CONNECT2_LOCKAHEAD;
+	data->ocd_connect_flags2 = OBD_CONNECT2_LOCKAHEAD |
+				   OBD_CONNECT2_MULTIOBJ_BRW;
 
 	if (!OBD_FAIL_CHECK(OBD_FAIL_OSC_CONNECT_GRANT_PARAM))
 		data->ocd_connect_flags |= OBD_CONNECT_GRANT_PARAM;
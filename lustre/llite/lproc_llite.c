@@ -50,6 +50,7 @@ struct proc_dir_entry *proc_lustre_fs_root;
 static const struct file_operations ll_rw_extents_stats_fops;
 static const struct file_operations ll_rw_extents_stats_pp_fops;
 static const struct file_operations ll_rw_offset_stats_fops;
+static const struct file_operations ll_fsync_stats_fops;
 static __s64 ll_stats_pid_write(const char __user *buf, size_t len);
 
 static int ll_blksize_seq_show(struct seq_file *m, void *v)
@@ -277,6 +278,31 @@ static int ll_site_stats_seq_show(struct seq_file *m, void *v)
 }
 LPROC_SEQ_FOPS_RO(ll_site_stats);
 
+static int ll_page_overhead_seq_show(struct seq_file *m, void *v)
+{
+	struct super_block *sb = m->private;
+	struct ll_sb_info *sbi = ll_s2sbi(sb);
+	struct cl_site *site = lu2cl_site(sbi->ll_site);
+	struct cl_client_cache *cache = sbi->ll_cache;
+	unsigned int bufsize = site->cs_page_bufsize_max;
+	long cached;
+
+	cached = cache->ccc_lru_max - atomic_long_read(&cache->ccc_lru_left);
+	seq_printf(m, "cl_page_bytes: %zu\n"
+		   "vvp_page_bytes: %zu\n"
+		   "max_slices: %d\n"
+		   "page_bufsize_max: %u\n"
+		   "overhead_ppm: %lu\n"
+		   "cached_pages: %ld\n"
+		   "cached_overhead_kb: %ld\n",
+		   sizeof(struct cl_page), sizeof(struct vvp_page),
+		   CP_MAX_LAYER, bufsize,
+		   (unsigned long)bufsize * 1000000 / PAGE_SIZE,
+		   cached, (cached * bufsize) >> 10);
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(ll_page_overhead);
+
 static int ll_max_readahead_mb_seq_show(struct seq_file *m, void *v)
 {
 	struct super_block *sb = m->private;
@@ -1085,6 +1111,8 @@ struct lprocfs_vars lprocfs_llite_obd_vars[] = {
 	  .fops	=	&ll_fstype_fops				},
 	{ .name	=	"site",
 	  .fops	=	&ll_site_stats_fops			},
+	{ .name	=	"page_overhead",
+	  .fops	=	&ll_page_overhead_fops			},
 	{ .name	=	"blocksize",
 	  .fops	=	&ll_blksize_fops			},
 	{ .name	=	"stat_blocksize",
@@ -1290,6 +1318,11 @@ int lprocfs_ll_register_mountpoint(struct proc_dir_entry *parent,
 	if (rc)
 		CWARN("Error adding the offset_stats file\n");
 
+	rc = lprocfs_seq_create(sbi->ll_proc_root, "fsync_stats", 0644,
+				&ll_fsync_stats_fops, sbi);
+	if (rc)
+		CWARN("Error adding the fsync_stats file\n");
+
 	/* File operations stats */
 	sbi->ll_stats = lprocfs_alloc_stats(LPROC_LL_FILE_OPCODES,
 					    LPROCFS_STATS_FLAG_NONE);
@@ -1791,4 +1824,43 @@ static __s64 ll_stats_pid_write(const char __user *buf, size_t len)
 }
 
 LPROC_SEQ_FOPS(ll_rw_offset_stats);
+
+static int ll_fsync_stats_seq_show(struct seq_file *seq, void *v)
+{
+	struct ll_sb_info *sbi = seq->private;
+	struct obd_histogram *hist = &sbi->ll_fsync_hist;
+	struct timespec64 now;
+	unsigned long tot;
+	unsigned long cum = 0;
+	int i;
+
+	ktime_get_real_ts64(&now);
+	tot = lprocfs_oh_sum(hist);
+
+	seq_printf(seq, "snapshot_time:         %llu.%09lu (secs.nsecs)\n",
+		   (s64)now.tv_sec, now.tv_nsec);
+	seq_printf(seq, "fsync latency (usec)   calls   %% cum %%\n");
+	for (i = 0; i < OBD_HIST_MAX && cum < tot; i++) {
+		unsigned long count = hist->oh_buckets[i];
+
+		cum += count;
+		seq_printf(seq, "%u:\t\t%10lu %3lu %3lu\n",
+			   1U << i, count, pct(count, tot), pct(cum, tot));
+	}
+	return 0;
+}
+
+static ssize_t ll_fsync_stats_seq_write(struct file *file,
+					const char __user *buf,
+					size_t len, loff_t *off)
+{
+	struct seq_file *seq = file->private_data;
+	struct ll_sb_info *sbi = seq->private;
+
+	lprocfs_oh_clear(&sbi->ll_fsync_hist);
+
+	return len;
+}
+
+LPROC_SEQ_FOPS(ll_fsync_stats);
 #endif /* CONFIG_PROC_FS */
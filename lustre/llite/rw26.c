@@ -602,7 +602,7 @@ static int ll_prepare_partial_page(const struct lu_env *env, struct cl_io *io,
 		 * purposes here we can treat it like i_size.
 		 */
 		if (attr->cat_kms <= offset) {
-			char *kaddr = ll_kmap_atomic(vpg->vpg_page, KM_USER0);
+			char *kaddr = ll_kmap_atomic(vvp_vmpage(vpg), KM_USER0);
 
 			memset(kaddr, 0, cl_page_size(obj));
 			ll_kunmap_atomic(kaddr, KM_USER0);
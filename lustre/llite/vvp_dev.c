@@ -509,7 +509,7 @@ static void vvp_pgcache_page_show(const struct lu_env *env,
 	int              has_flags;
 
 	vpg = cl2vvp_page(cl_page_at(page, &vvp_device_type));
-	vmpage = vpg->vpg_page;
+	vmpage = vvp_vmpage(vpg);
 	seq_printf(seq, " %5i | %p %p %s %s %s | %p "DFID"(%p) %lu %u [",
 		   0 /* gen */,
 		   vpg, page,
@@ -231,8 +231,6 @@ struct vvp_page {
 	unsigned	vpg_defer_uptodate:1,
 			vpg_ra_updated:1,
 			vpg_ra_used:1;
-	/** VM page */
-	struct page	*vpg_page;
 };
 
 static inline struct vvp_page *cl2vvp_page(const struct cl_page_slice *slice)
@@ -245,6 +243,12 @@ static inline pgoff_t vvp_index(struct vvp_page *vpg)
 	return vpg->vpg_cl.cpl_index;
 }
 
+/** VM page, taken from cl_page::cp_vmpage rather than duplicated here. */
+static inline struct page *vvp_vmpage(const struct vvp_page *vpg)
+{
+	return vpg->vpg_cl.cpl_page->cp_vmpage;
+}
+
 struct vvp_device {
 	struct cl_device    vdv_cl;
 	struct cl_device   *vdv_next;
@@ -289,7 +293,7 @@ struct vvp_object *cl_inode2vvp(struct inode *inode);
 
 static inline struct page *cl2vm_page(const struct cl_page_slice *slice)
 {
-	return cl2vvp_page(slice)->vpg_page;
+	return slice->cpl_page->cp_vmpage;
 }
 
 static inline struct vvp_lock *cl2vvp_lock(const struct cl_lock_slice *slice)
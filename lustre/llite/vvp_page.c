@@ -56,7 +56,7 @@
 
 static void vvp_page_fini_common(struct vvp_page *vpg)
 {
-	struct page *vmpage = vpg->vpg_page;
+	struct page *vmpage = vvp_vmpage(vpg);
 
 	LASSERT(vmpage != NULL);
 	put_page(vmpage);
@@ -66,7 +66,7 @@ static void vvp_page_fini(const struct lu_env *env,
 			  struct cl_page_slice *slice)
 {
 	struct vvp_page *vpg     = cl2vvp_page(slice);
-	struct page     *vmpage  = vpg->vpg_page;
+	struct page     *vmpage  = vvp_vmpage(vpg);
 
 	/*
 	 * vmpage->private was already cleared when page was moved into
@@ -81,7 +81,7 @@ static int vvp_page_own(const struct lu_env *env,
 			int nonblock)
 {
 	struct vvp_page *vpg    = cl2vvp_page(slice);
-	struct page     *vmpage = vpg->vpg_page;
+	struct page     *vmpage = vvp_vmpage(vpg);
 
 	LASSERT(vmpage != NULL);
 	if (nonblock) {
@@ -255,7 +255,7 @@ static void vvp_page_completion_read(const struct lu_env *env,
 				     int ioret)
 {
 	struct vvp_page *vpg    = cl2vvp_page(slice);
-	struct page     *vmpage = vpg->vpg_page;
+	struct page     *vmpage = vvp_vmpage(vpg);
 	struct cl_page  *page   = slice->cpl_page;
 	struct inode    *inode  = vvp_object_inode(page->cp_obj);
 	ENTRY;
@@ -285,7 +285,7 @@ static void vvp_page_completion_write(const struct lu_env *env,
 {
 	struct vvp_page *vpg    = cl2vvp_page(slice);
 	struct cl_page  *pg     = slice->cpl_page;
-	struct page     *vmpage = vpg->vpg_page;
+	struct page     *vmpage = vvp_vmpage(vpg);
 	ENTRY;
 
 	CL_PAGE_HEADER(D_PAGE, env, pg, "completing WRITE with %d\n", ioret);
@@ -352,7 +352,7 @@ static int vvp_page_print(const struct lu_env *env,
 			  void *cookie, lu_printer_t printer)
 {
 	struct vvp_page *vpg	= cl2vvp_page(slice);
-	struct page     *vmpage	= vpg->vpg_page;
+	struct page     *vmpage	= vvp_vmpage(vpg);
 
 	(*printer)(env, cookie, LUSTRE_VVP_NAME"-page@%p(%d:%d) "
 		   "vm@%p ",
@@ -523,7 +523,6 @@ int vvp_page_init(const struct lu_env *env, struct cl_object *obj,
 
 	CLOBINVRNT(env, obj, vvp_object_invariant(obj));
 
-	vpg->vpg_page = vmpage;
 	get_page(vmpage);
 
 	if (page->cp_type == CPT_CACHEABLE) {
@@ -2052,6 +2052,7 @@ static int lmv_setattr(struct obd_export *exp, struct md_op_data *op_data,
 }
 
 static int lmv_fsync(struct obd_export *exp, const struct lu_fid *fid,
+		     struct ptlrpc_request_set *set,
 		     struct ptlrpc_request **request)
 {
 	struct obd_device	*obd = exp->exp_obd;
@@ -2064,7 +2065,7 @@ static int lmv_fsync(struct obd_export *exp, const struct lu_fid *fid,
 	if (IS_ERR(tgt))
 		RETURN(PTR_ERR(tgt));
 
-	rc = md_fsync(tgt->ltd_exp, fid, request);
+	rc = md_fsync(tgt->ltd_exp, fid, set, request);
 	RETURN(rc);
 }
 
@@ -2312,6 +2312,7 @@ static int mdc_get_info(const struct lu_env *env, struct obd_export *exp,
 }
 
 static int mdc_fsync(struct obd_export *exp, const struct lu_fid *fid,
+		     struct ptlrpc_request_set *set,
 		     struct ptlrpc_request **request)
 {
         struct ptlrpc_request *req;
@@ -2333,6 +2334,11 @@ static int mdc_fsync(struct obd_export *exp, const struct lu_fid *fid,
 
         ptlrpc_request_set_replen(req);
 
+	if (set != NULL) {
+		ptlrpc_set_add_req(set, req);
+		RETURN(0);
+	}
+
         rc = ptlrpc_queue_wait(req);
         if (rc)
                 ptlrpc_req_finished(req);
@@ -488,6 +488,7 @@ int cl_site_init(struct cl_site *s, struct cl_device *d)
                 cache_stats_init(&s->cs_pages, "pages");
                 for (i = 0; i < ARRAY_SIZE(s->cs_pages_state); ++i)
 			atomic_set(&s->cs_pages_state[0], 0);
+		s->cs_page_bufsize_max = 0;
 		cl_env_percpu_refill();
 	}
 	return result;
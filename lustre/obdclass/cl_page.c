@@ -47,6 +47,30 @@
 
 static void cl_page_delete0(const struct lu_env *env, struct cl_page *pg);
 
+/**
+ * Returns the \a index'th slice of \a page, counting from the top of the
+ * stack, or NULL if there is no such slice.
+ */
+static inline struct cl_page_slice *
+cl_page_slice_get(const struct cl_page *page, int index)
+{
+	if (index < 0 || index >= page->cp_layer_count)
+		return NULL;
+
+	return (struct cl_page_slice *)((char *)page +
+					page->cp_layer_offset[index]);
+}
+
+#define cl_page_slice_for_each(page, slice, i)				\
+	for (i = 0, slice = cl_page_slice_get(page, 0);			\
+	     i < (page)->cp_layer_count;				\
+	     slice = cl_page_slice_get(page, ++i))
+
+#define cl_page_slice_for_each_reverse(page, slice, i)			\
+	for (i = (page)->cp_layer_count - 1,				\
+	     slice = cl_page_slice_get(page, i); i >= 0;		\
+	     slice = cl_page_slice_get(page, --i))
+
 #ifdef LIBCFS_DEBUG
 # define PASSERT(env, page, expr)                                       \
   do {                                                                    \
@@ -133,9 +157,10 @@ cl_page_at_trusted(const struct cl_page *page,
                    const struct lu_device_type *dtype)
 {
 	const struct cl_page_slice *slice;
+	int i;
 	ENTRY;
 
-	list_for_each_entry(slice, &page->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(page, slice, i) {
 		if (slice->cpl_obj->co_lu.lo_dev->ld_type == dtype)
 			RETURN(slice);
 	}
@@ -146,18 +171,15 @@ static void cl_page_free(const struct lu_env *env, struct cl_page *page)
 {
 	struct cl_object *obj  = page->cp_obj;
 	int pagesize = cl_object_header(obj)->coh_page_bufsize;
+	struct cl_page_slice *slice;
+	int i;
 
 	PASSERT(env, page, list_empty(&page->cp_batch));
 	PASSERT(env, page, page->cp_owner == NULL);
 	PASSERT(env, page, page->cp_state == CPS_FREEING);
 
 	ENTRY;
-	while (!list_empty(&page->cp_layers)) {
-		struct cl_page_slice *slice;
-
-		slice = list_entry(page->cp_layers.next,
-				   struct cl_page_slice, cpl_linkage);
-		list_del_init(page->cp_layers.next);
+	cl_page_slice_for_each(page, slice, i) {
 		if (unlikely(slice->cpl_ops->cpo_fini != NULL))
 			slice->cpl_ops->cpo_fini(env, slice);
 	}
@@ -177,8 +199,7 @@ static void cl_page_free(const struct lu_env *env, struct cl_page *page)
 static inline void cl_page_state_set_trust(struct cl_page *page,
                                            enum cl_page_state state)
 {
-        /* bypass const. */
-        *(enum cl_page_state *)&page->cp_state = state;
+	page->cp_state = state;
 }
 
 struct cl_page *cl_page_alloc(const struct lu_env *env,
@@ -187,10 +208,11 @@ struct cl_page *cl_page_alloc(const struct lu_env *env,
 {
 	struct cl_page          *page;
 	struct lu_object_header *head;
+	struct cl_site		*site = cl_object_site(o);
+	unsigned int		 bufsize = cl_object_header(o)->coh_page_bufsize;
 
 	ENTRY;
-	OBD_ALLOC_GFP(page, cl_object_header(o)->coh_page_bufsize,
-			GFP_NOFS);
+	OBD_ALLOC_GFP(page, bufsize, GFP_NOFS);
 	if (page != NULL) {
 		int result = 0;
 		atomic_set(&page->cp_ref, 1);
@@ -201,7 +223,6 @@ struct cl_page *cl_page_alloc(const struct lu_env *env,
 		page->cp_vmpage = vmpage;
 		cl_page_state_set_trust(page, CPS_CACHED);
 		page->cp_type = type;
-		INIT_LIST_HEAD(&page->cp_layers);
 		INIT_LIST_HEAD(&page->cp_batch);
 		lu_ref_init(&page->cp_reference);
 		head = o->co_lu.lo_header;
@@ -219,6 +240,8 @@ struct cl_page *cl_page_alloc(const struct lu_env *env,
 			}
 		}
 		if (result == 0) {
+			if (unlikely(bufsize > site->cs_page_bufsize_max))
+				site->cs_page_bufsize_max = bufsize;
 			cs_page_inc(o, CS_total);
 			cs_page_inc(o, CS_create);
 			cs_pagestate_dec(o, CPS_CACHED);
@@ -459,6 +482,7 @@ void cl_page_disown0(const struct lu_env *env,
                      struct cl_io *io, struct cl_page *pg)
 {
 	const struct cl_page_slice *slice;
+	int i;
         enum cl_page_state state;
 
         ENTRY;
@@ -474,7 +498,7 @@ void cl_page_disown0(const struct lu_env *env,
          * uppermost layer (llite), responsible for VFS/VM interaction runs
          * last and can release locks safely.
          */
-	list_for_each_entry_reverse(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each_reverse(pg, slice, i) {
 		if (slice->cpl_ops->cpo_disown != NULL)
 			(*slice->cpl_ops->cpo_disown)(env, slice, io);
 	}
@@ -519,6 +543,7 @@ static int cl_page_own0(const struct lu_env *env, struct cl_io *io,
 {
 	int result = 0;
 	const struct cl_page_slice *slice;
+	int i;
 
         PINVRNT(env, pg, !cl_page_is_owned(pg, io));
 
@@ -530,7 +555,7 @@ static int cl_page_own0(const struct lu_env *env, struct cl_io *io,
 		goto out;
 	}
 
-	list_for_each_entry(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(pg, slice, i) {
 		if (slice->cpl_ops->cpo_own)
 			result = (*slice->cpl_ops->cpo_own)(env, slice,
 							    io, nonblock);
@@ -597,13 +622,14 @@ void cl_page_assume(const struct lu_env *env,
                     struct cl_io *io, struct cl_page *pg)
 {
 	const struct cl_page_slice *slice;
+	int i;
 
 	PINVRNT(env, pg, cl_object_same(pg->cp_obj, io->ci_obj));
 
 	ENTRY;
 	io = cl_io_top(io);
 
-	list_for_each_entry(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(pg, slice, i) {
 		if (slice->cpl_ops->cpo_assume != NULL)
 			(*slice->cpl_ops->cpo_assume)(env, slice, io);
 	}
@@ -631,6 +657,7 @@ void cl_page_unassume(const struct lu_env *env,
                       struct cl_io *io, struct cl_page *pg)
 {
 	const struct cl_page_slice *slice;
+	int i;
 
         PINVRNT(env, pg, cl_page_is_owned(pg, io));
         PINVRNT(env, pg, cl_page_invariant(pg));
@@ -640,7 +667,7 @@ void cl_page_unassume(const struct lu_env *env,
         cl_page_owner_clear(pg);
         cl_page_state_set(env, pg, CPS_CACHED);
 
-	list_for_each_entry_reverse(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each_reverse(pg, slice, i) {
 		if (slice->cpl_ops->cpo_unassume != NULL)
 			(*slice->cpl_ops->cpo_unassume)(env, slice, io);
 	}
@@ -687,11 +714,12 @@ void cl_page_discard(const struct lu_env *env,
                      struct cl_io *io, struct cl_page *pg)
 {
 	const struct cl_page_slice *slice;
+	int i;
 
 	PINVRNT(env, pg, cl_page_is_owned(pg, io));
 	PINVRNT(env, pg, cl_page_invariant(pg));
 
-	list_for_each_entry(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(pg, slice, i) {
 		if (slice->cpl_ops->cpo_discard != NULL)
 			(*slice->cpl_ops->cpo_discard)(env, slice, io);
 	}
@@ -706,6 +734,7 @@ EXPORT_SYMBOL(cl_page_discard);
 static void cl_page_delete0(const struct lu_env *env, struct cl_page *pg)
 {
 	const struct cl_page_slice *slice;
+	int i;
 
         ENTRY;
 
@@ -717,7 +746,7 @@ static void cl_page_delete0(const struct lu_env *env, struct cl_page *pg)
         cl_page_owner_clear(pg);
         cl_page_state_set0(env, pg, CPS_FREEING);
 
-	list_for_each_entry_reverse(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each_reverse(pg, slice, i) {
 		if (slice->cpl_ops->cpo_delete != NULL)
 			(*slice->cpl_ops->cpo_delete)(env, slice);
 	}
@@ -770,10 +799,11 @@ EXPORT_SYMBOL(cl_page_delete);
 void cl_page_export(const struct lu_env *env, struct cl_page *pg, int uptodate)
 {
 	const struct cl_page_slice *slice;
+	int i;
 
         PINVRNT(env, pg, cl_page_invariant(pg));
 
-	list_for_each_entry(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(pg, slice, i) {
 		if (slice->cpl_ops->cpo_export != NULL)
 			(*slice->cpl_ops->cpo_export)(env, slice, uptodate);
 	}
@@ -790,8 +820,7 @@ int cl_page_is_vmlocked(const struct lu_env *env, const struct cl_page *pg)
 	int result;
 
         ENTRY;
-        slice = container_of(pg->cp_layers.next,
-                             const struct cl_page_slice, cpl_linkage);
+	slice = cl_page_slice_get(pg, 0);
         PASSERT(env, pg, slice->cpl_ops->cpo_is_vmlocked != NULL);
         /*
          * Call ->cpo_is_vmlocked() directly instead of going through
@@ -833,6 +862,7 @@ int cl_page_prep(const struct lu_env *env, struct cl_io *io,
                  struct cl_page *pg, enum cl_req_type crt)
 {
 	const struct cl_page_slice *slice;
+	int i;
 	int result = 0;
 
         PINVRNT(env, pg, cl_page_is_owned(pg, io));
@@ -847,7 +877,7 @@ int cl_page_prep(const struct lu_env *env, struct cl_io *io,
 	if (crt >= CRT_NR)
 		return -EINVAL;
 
-	list_for_each_entry(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(pg, slice, i) {
 		if (slice->cpl_ops->cpo_own)
 			result = (*slice->cpl_ops->io[crt].cpo_prep)(env,
 								     slice,
@@ -887,6 +917,7 @@ void cl_page_completion(const struct lu_env *env,
                         struct cl_page *pg, enum cl_req_type crt, int ioret)
 {
 	const struct cl_page_slice *slice;
+	int i;
         struct cl_sync_io *anchor = pg->cp_sync_io;
 
         PASSERT(env, pg, crt < CRT_NR);
@@ -898,7 +929,7 @@ void cl_page_completion(const struct lu_env *env,
 	if (crt >= CRT_NR)
 		return;
 
-	list_for_each_entry_reverse(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each_reverse(pg, slice, i) {
 		if (slice->cpl_ops->io[crt].cpo_completion != NULL)
 			(*slice->cpl_ops->io[crt].cpo_completion)(env, slice,
 								  ioret);
@@ -926,6 +957,7 @@ int cl_page_make_ready(const struct lu_env *env, struct cl_page *pg,
                        enum cl_req_type crt)
 {
 	const struct cl_page_slice *sli;
+	int i;
 	int result = 0;
 
         PINVRNT(env, pg, crt < CRT_NR);
@@ -934,7 +966,7 @@ int cl_page_make_ready(const struct lu_env *env, struct cl_page *pg,
 	if (crt >= CRT_NR)
 		RETURN(-EINVAL);
 
-	list_for_each_entry(sli, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(pg, sli, i) {
 		if (sli->cpl_ops->io[crt].cpo_make_ready != NULL)
 			result = (*sli->cpl_ops->io[crt].cpo_make_ready)(env,
 									 sli);
@@ -964,6 +996,7 @@ int cl_page_flush(const struct lu_env *env, struct cl_io *io,
 		  struct cl_page *pg)
 {
 	const struct cl_page_slice *slice;
+	int i;
 	int result = 0;
 
 	PINVRNT(env, pg, cl_page_is_owned(pg, io));
@@ -971,7 +1004,7 @@ int cl_page_flush(const struct lu_env *env, struct cl_io *io,
 
 	ENTRY;
 
-	list_for_each_entry(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(pg, slice, i) {
 		if (slice->cpl_ops->cpo_flush != NULL)
 			result = (*slice->cpl_ops->cpo_flush)(env, slice, io);
 		if (result != 0)
@@ -994,11 +1027,12 @@ void cl_page_clip(const struct lu_env *env, struct cl_page *pg,
                   int from, int to)
 {
 	const struct cl_page_slice *slice;
+	int i;
 
         PINVRNT(env, pg, cl_page_invariant(pg));
 
         CL_PAGE_HEADER(D_TRACE, env, pg, "%d %d\n", from, to);
-	list_for_each_entry(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(pg, slice, i) {
 		if (slice->cpl_ops->cpo_clip != NULL)
 			(*slice->cpl_ops->cpo_clip)(env, slice, from, to);
 	}
@@ -1026,10 +1060,11 @@ void cl_page_print(const struct lu_env *env, void *cookie,
                    lu_printer_t printer, const struct cl_page *pg)
 {
 	const struct cl_page_slice *slice;
+	int i;
 	int result = 0;
 
 	cl_page_header_print(env, cookie, printer, pg);
-	list_for_each_entry(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(pg, slice, i) {
 		if (slice->cpl_ops->cpo_print != NULL)
 			result = (*slice->cpl_ops->cpo_print)(env, slice,
 							     cookie, printer);
@@ -1046,9 +1081,10 @@ EXPORT_SYMBOL(cl_page_print);
 int cl_page_cancel(const struct lu_env *env, struct cl_page *page)
 {
 	const struct cl_page_slice *slice;
+	int i;
 	int			    result = 0;
 
-	list_for_each_entry(slice, &page->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(page, slice, i) {
 		if (slice->cpl_ops->cpo_cancel != NULL)
 			result = (*slice->cpl_ops->cpo_cancel)(env, slice);
 		if (result != 0)
@@ -1089,7 +1125,7 @@ EXPORT_SYMBOL(cl_page_size);
  *
  * This is called by cl_object_operations::coo_page_init() methods to add a
  * per-layer state to the page. New state is added at the end of
- * cl_page::cp_layers list, that is, it is at the bottom of the stack.
+ * cl_page::cp_layer_offset[], that is, it is at the bottom of the stack.
  *
  * \see cl_lock_slice_add(), cl_req_slice_add(), cl_io_slice_add()
  */
@@ -1098,7 +1134,13 @@ void cl_page_slice_add(struct cl_page *page, struct cl_page_slice *slice,
 		       const struct cl_page_operations *ops)
 {
 	ENTRY;
-	list_add_tail(&slice->cpl_linkage, &page->cp_layers);
+	LASSERT(page->cp_layer_count < CP_MAX_LAYER);
+	LASSERT((char *)slice - (char *)page >= sizeof(*page));
+	LASSERT((char *)slice - (char *)page <
+		cl_object_header(page->cp_obj)->coh_page_bufsize);
+
+	page->cp_layer_offset[page->cp_layer_count++] =
+		(char *)slice - (char *)page;
 	slice->cpl_obj  = obj;
 	slice->cpl_index = index;
 	slice->cpl_ops  = ops;
@@ -848,6 +848,7 @@ static const char *obd_connect_names[] = {
 	/* flags2 names */
 	"file_secctx",
 	"lockaheadv2",
+	"multiobj_brw",
 	NULL
 };
 
@@ -1079,10 +1080,16 @@ int lprocfs_import_seq_show(struct seq_file *m, void *data)
 	seq_printf(m, "    transactions:\n"
 		   "       last_replay: %llu\n"
 		   "       peer_committed: %llu\n"
-		   "       last_checked: %llu\n",
+		   "       last_checked: %llu\n"
+		   "       replay_list: %u\n"
+		   "       committed_list: %u\n"
+		   "       replay_walk: %llu\n",
 		   imp->imp_last_replay_transno,
 		   imp->imp_peer_committed_transno,
-		   imp->imp_last_transno_checked);
+		   imp->imp_last_transno_checked,
+		   imp->imp_replay_list_len,
+		   imp->imp_committed_list_len,
+		   imp->imp_replay_walk);
 
 	/* avg data rates */
 	for (rw = 0; rw <= 1; rw++) {
@@ -938,9 +938,17 @@ static int ofd_set_info_hdl(struct tgt_session_info *tsi)
 		repbody = req_capsule_server_get(tsi->tsi_pill, &RMF_OST_BODY);
 		*repbody = *body;
 
-		/** handle grant shrink, similar to a read request */
-		tgt_grant_prepare_read(tsi->tsi_env, tsi->tsi_exp,
-				       &repbody->oa);
+		if ((repbody->oa.o_valid & OBD_MD_FLFLAGS) &&
+		    (repbody->oa.o_flags & OBD_FL_GRANT_HINT) &&
+		    !(repbody->oa.o_flags & OBD_FL_SHRINK_GRANT))
+			/** grant-only request from a client expecting a
+			 * burst of writes */
+			tgt_grant_prepare_hint(tsi->tsi_env, tsi->tsi_exp,
+					       &repbody->oa);
+		else
+			/** handle grant shrink, similar to a read request */
+			tgt_grant_prepare_read(tsi->tsi_env, tsi->tsi_exp,
+					       &repbody->oa);
 	} else if (KEY_IS(KEY_EVICT_BY_NID)) {
 		if (vallen > 0)
 			obd_export_evict_by_nid(tsi->tsi_exp->exp_obd, val);
@@ -1963,6 +1971,10 @@ static int ofd_sync_hdl(struct tgt_session_info *tsi)
 
 	repbody = req_capsule_server_get(tsi->tsi_pill, &RMF_OST_BODY);
 
+	CFS_FAIL_TIMEOUT(OBD_FAIL_OST_PAUSE_SYNC, cfs_fail_val);
+	if (OBD_FAIL_CHECK(OBD_FAIL_OST_SYNC_ERR))
+		RETURN(-EIO);
+
 	/* if no objid is specified, it means "sync whole filesystem" */
 	if (!fid_is_zero(&tsi->tsi_fid)) {
 		fo = ofd_object_find_exists(tsi->tsi_env, ofd, &tsi->tsi_fid);
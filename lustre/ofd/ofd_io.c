@@ -511,6 +511,83 @@ unlock:
 	return rc;
 }
 
+/**
+ * Re-create an object missing on the OST during recovery.
+ *
+ * If a write is replayed for an object which wasn't precreated before the
+ * server restarted, precreate objects up to the requested one.
+ *
+ * \param[in] env	execution environment
+ * \param[in] ofd	OFD device
+ * \param[in] fid	FID of object
+ * \param[in] obj	object data
+ *
+ * \retval		0 on success
+ * \retval		negative value on error
+ */
+static int ofd_preprw_write_recreate(const struct lu_env *env,
+				     struct ofd_device *ofd,
+				     const struct lu_fid *fid,
+				     struct obd_ioobj *obj)
+{
+	u64 seq = fid_seq(fid);
+	u64 oid = fid_oid(fid);
+	struct ofd_seq *oseq;
+	int rc = 0;
+
+	ENTRY;
+
+	oseq = ofd_seq_load(env, ofd, seq);
+	if (IS_ERR(oseq)) {
+		CERROR("%s: Can't find FID Sequence %#llx: rc = %d\n",
+		       ofd_name(ofd), seq, (int)PTR_ERR(oseq));
+		RETURN(-EINVAL);
+	}
+
+	if (oid > ofd_seq_last_oid(oseq)) {
+		int sync = 0;
+		int diff;
+
+		mutex_lock(&oseq->os_create_lock);
+		diff = oid - ofd_seq_last_oid(oseq);
+
+		/* Do sync create if the seq is about to used up */
+		if (fid_seq_is_idif(seq) || fid_seq_is_mdt0(seq)) {
+			if (unlikely(oid >= IDIF_MAX_OID - 1))
+				sync = 1;
+		} else if (fid_seq_is_norm(seq)) {
+			if (unlikely(oid >=
+				     LUSTRE_DATA_SEQ_MAX_WIDTH - 1))
+				sync = 1;
+		} else {
+			CERROR("%s : invalid o_seq "DOSTID"\n",
+			       ofd_name(ofd), POSTID(&obj->ioo_oid));
+			mutex_unlock(&oseq->os_create_lock);
+			GOTO(out, rc = -EINVAL);
+		}
+
+		while (diff > 0) {
+			u64 next_id = ofd_seq_last_oid(oseq) + 1;
+			int count = ofd_precreate_batch(ofd, diff);
+
+			rc = ofd_precreate_objects(env, ofd, next_id,
+						   oseq, count, sync);
+			if (rc < 0) {
+				mutex_unlock(&oseq->os_create_lock);
+				GOTO(out, rc);
+			}
+
+			diff -= rc;
+		}
+
+		mutex_unlock(&oseq->os_create_lock);
+	}
+	rc = 0;
+out:
+	ofd_seq_put(env, oseq);
+	RETURN(rc);
+}
+
 /**
  * Prepare buffers for write request processing.
  *
@@ -518,13 +595,20 @@ unlock:
  * and prepares the latter. If there is recovery in progress and required
  * object is missing then it can be re-created before write.
  *
+ * A client which negotiated OBD_CONNECT2_MULTIOBJ_BRW may pack several
+ * objects into one write. Their remote buffers follow each other in \a rnb
+ * in \a obj order, and so do the local buffers prepared here. Grant is
+ * processed once for the whole request, and only the first object is
+ * described by \a oa. Objects are locked in FID order so that concurrent
+ * multi-object writes can't deadlock with each other.
+ *
  * \param[in] env	execution environment
  * \param[in] exp	OBD export of client
  * \param[in] ofd	OFD device
- * \param[in] fid	FID of object
+ * \param[in] fid	FID of the first object
  * \param[in] la	object attributes
  * \param[in] oa	OBDO structure from client
- * \param[in] objcount	always 1
+ * \param[in] objcount	number of objects
  * \param[in] obj	object data
  * \param[in] rnb	remote buffers
  * \param[in] nr_local	number of local buffers
@@ -541,133 +625,134 @@ static int ofd_preprw_write(const struct lu_env *env, struct obd_export *exp,
 			    struct niobuf_remote *rnb, int *nr_local,
 			    struct niobuf_local *lnb, char *jobid)
 {
-	struct ofd_object *fo;
-	int i, j, k, rc = 0, tot_bytes = 0;
+	struct ofd_object *fo[PTLRPC_MAX_BRW_OBJS];
+	int order[PTLRPC_MAX_BRW_OBJS];
+	int nr_bufs[PTLRPC_MAX_BRW_OBJS];
+	int i, j, k, n, rc = 0, tot_bytes = 0;
+	int niocount = 0;
+	int locked = 0;
 	enum dt_bufs_type dbt = DT_BUFS_TYPE_WRITE;
 
 	ENTRY;
 	LASSERT(env != NULL);
-	LASSERT(objcount == 1);
+	LASSERT(objcount >= 1 && objcount <= PTLRPC_MAX_BRW_OBJS);
 
-	if (unlikely(exp->exp_obd->obd_recovering)) {
-		u64 seq = fid_seq(fid);
-		u64 oid = fid_oid(fid);
-		struct ofd_seq *oseq;
+	/* the first object is always named by the obdo, as with a single
+	 * object write, the other ones were converted by the target */
+	for (n = 0; n < objcount; n++) {
+		const struct lu_fid *ofid = n == 0 ? fid :
+					    &obj[n].ioo_oid.oi_fid;
 
-		oseq = ofd_seq_load(env, ofd, seq);
-		if (IS_ERR(oseq)) {
-			CERROR("%s: Can't find FID Sequence %#llx: rc = %d\n",
-			       ofd_name(ofd), seq, (int)PTR_ERR(oseq));
-			GOTO(out, rc = -EINVAL);
-		}
+		for (k = n; k > 0; k--) {
+			const struct lu_fid *pfid = order[k - 1] == 0 ? fid :
+					&obj[order[k - 1]].ioo_oid.oi_fid;
 
-		if (oid > ofd_seq_last_oid(oseq)) {
-			int sync = 0;
-			int diff;
-
-			mutex_lock(&oseq->os_create_lock);
-			diff = oid - ofd_seq_last_oid(oseq);
-
-			/* Do sync create if the seq is about to used up */
-			if (fid_seq_is_idif(seq) || fid_seq_is_mdt0(seq)) {
-				if (unlikely(oid >= IDIF_MAX_OID - 1))
-					sync = 1;
-			} else if (fid_seq_is_norm(seq)) {
-				if (unlikely(oid >=
-					     LUSTRE_DATA_SEQ_MAX_WIDTH - 1))
-					sync = 1;
-			} else {
-				CERROR("%s : invalid o_seq "DOSTID"\n",
-				       ofd_name(ofd), POSTID(&oa->o_oi));
-				mutex_unlock(&oseq->os_create_lock);
-				ofd_seq_put(env, oseq);
-				GOTO(out, rc = -EINVAL);
-			}
-
-			while (diff > 0) {
-				u64 next_id = ofd_seq_last_oid(oseq) + 1;
-				int count = ofd_precreate_batch(ofd, diff);
+			if (lu_fid_cmp(pfid, ofid) <= 0)
+				break;
+			order[k] = order[k - 1];
+		}
+		order[k] = n;
+		niocount += obj[n].ioo_bufcnt;
+	}
 
-				rc = ofd_precreate_objects(env, ofd, next_id,
-							   oseq, count, sync);
-				if (rc < 0) {
-					mutex_unlock(&oseq->os_create_lock);
-					ofd_seq_put(env, oseq);
-					GOTO(out, rc);
-				}
+	for (locked = 0; locked < objcount; locked++) {
+		const struct lu_fid *ofid;
 
-				diff -= rc;
-			}
+		n = order[locked];
+		ofid = n == 0 ? fid : &obj[n].ioo_oid.oi_fid;
 
-			mutex_unlock(&oseq->os_create_lock);
+		if (unlikely(exp->exp_obd->obd_recovering)) {
+			rc = ofd_preprw_write_recreate(env, ofd, ofid, &obj[n]);
+			if (rc < 0)
+				GOTO(out_unlock, rc);
 		}
 
-		ofd_seq_put(env, oseq);
-	}
-
-	fo = ofd_object_find(env, ofd, fid);
-	if (IS_ERR(fo))
-		GOTO(out, rc = PTR_ERR(fo));
-	LASSERT(fo != NULL);
-
-	ofd_read_lock(env, fo);
-	if (!ofd_object_exists(fo)) {
-		CERROR("%s: BRW to missing obj "DOSTID"\n",
-		       exp->exp_obd->obd_name, POSTID(&obj->ioo_oid));
-		ofd_read_unlock(env, fo);
-		ofd_object_put(env, fo);
-		GOTO(out, rc = -ENOENT);
-	}
+		fo[n] = ofd_object_find(env, ofd, ofid);
+		if (IS_ERR(fo[n]))
+			GOTO(out_unlock, rc = PTR_ERR(fo[n]));
+		LASSERT(fo[n] != NULL);
+
+		ofd_read_lock(env, fo[n]);
+		if (!ofd_object_exists(fo[n])) {
+			CERROR("%s: BRW to missing obj "DOSTID"\n",
+			       exp->exp_obd->obd_name, POSTID(&obj[n].ioo_oid));
+			ofd_read_unlock(env, fo[n]);
+			ofd_object_put(env, fo[n]);
+			GOTO(out_unlock, rc = -ENOENT);
+		}
 
-	if (ofd->ofd_lfsck_verify_pfid && oa->o_valid & OBD_MD_FLFID) {
-		rc = ofd_verify_ff(env, fo, oa);
-		if (rc != 0) {
-			ofd_read_unlock(env, fo);
-			ofd_object_put(env, fo);
-			GOTO(out, rc);
+		/* the parent FID in the obdo only matches the first object */
+		if (n == 0 && ofd->ofd_lfsck_verify_pfid &&
+		    oa->o_valid & OBD_MD_FLFID) {
+			rc = ofd_verify_ff(env, fo[n], oa);
+			if (rc != 0) {
+				ofd_read_unlock(env, fo[n]);
+				ofd_object_put(env, fo[n]);
+				GOTO(out_unlock, rc);
+			}
 		}
 	}
 
 	/* Process incoming grant info, set OBD_BRW_GRANTED flag and grant some
 	 * space back if possible */
-	tgt_grant_prepare_write(env, exp, oa, rnb, obj->ioo_bufcnt);
+	tgt_grant_prepare_write(env, exp, oa, rnb, niocount);
 
 	if (ptlrpc_connection_is_local(exp->exp_connection))
 		dbt |= DT_BUFS_TYPE_LOCAL;
 
 	/* parse remote buffers to local buffers and prepare the latter */
-	for (*nr_local = 0, i = 0, j = 0; i < obj->ioo_bufcnt; i++) {
-		rc = dt_bufs_get(env, ofd_object_child(fo),
-				 rnb + i, lnb + j, dbt);
-		if (unlikely(rc < 0))
-			GOTO(err, rc);
-		LASSERT(rc <= PTLRPC_MAX_BRW_PAGES);
-		/* correct index for local buffers to continue with */
-		for (k = 0; k < rc; k++) {
-			lnb[j+k].lnb_flags = rnb[i].rnb_flags;
-			lnb[j+k].lnb_flags &= ~OBD_BRW_LOCALS;
-			if (!(rnb[i].rnb_flags & OBD_BRW_GRANTED))
-				lnb[j+k].lnb_rc = -ENOSPC;
+	for (*nr_local = 0, i = 0, j = 0, n = 0; n < objcount; n++) {
+		struct niobuf_local *olnb = lnb + j;
+		int last = i + obj[n].ioo_bufcnt;
+
+		nr_bufs[n] = 0;
+		for (; i < last; i++) {
+			rc = dt_bufs_get(env, ofd_object_child(fo[n]),
+					 rnb + i, lnb + j, dbt);
+			if (unlikely(rc < 0))
+				GOTO(err, rc);
+			LASSERT(rc <= PTLRPC_MAX_BRW_PAGES);
+			/* correct index for local buffers to continue with */
+			for (k = 0; k < rc; k++) {
+				lnb[j+k].lnb_flags = rnb[i].rnb_flags;
+				lnb[j+k].lnb_flags &= ~OBD_BRW_LOCALS;
+				if (!(rnb[i].rnb_flags & OBD_BRW_GRANTED))
+					lnb[j+k].lnb_rc = -ENOSPC;
+			}
+			j += rc;
+			nr_bufs[n] += rc;
+			*nr_local += rc;
+			LASSERT(j <= PTLRPC_MAX_BRW_PAGES);
+			tot_bytes += rnb[i].rnb_len;
 		}
-		j += rc;
-		*nr_local += rc;
-		LASSERT(j <= PTLRPC_MAX_BRW_PAGES);
-		tot_bytes += rnb[i].rnb_len;
+
+		rc = dt_write_prep(env, ofd_object_child(fo[n]), olnb,
+				   nr_bufs[n]);
+		if (unlikely(rc != 0))
+			GOTO(err, rc);
 	}
 	LASSERT(*nr_local > 0 && *nr_local <= PTLRPC_MAX_BRW_PAGES);
 
-	rc = dt_write_prep(env, ofd_object_child(fo), lnb, *nr_local);
-	if (unlikely(rc != 0))
-		GOTO(err, rc);
-
 	ofd_counter_incr(exp, LPROC_OFD_STATS_WRITE, jobid, tot_bytes);
 	RETURN(0);
 err:
-	dt_bufs_put(env, ofd_object_child(fo), lnb, *nr_local);
-	ofd_read_unlock(env, fo);
-	ofd_object_put(env, fo);
+	for (j = 0, k = 0; k <= n; k++) {
+		dt_bufs_put(env, ofd_object_child(fo[k]), lnb + j, nr_bufs[k]);
+		j += nr_bufs[k];
+	}
+	for (k = 0; k < objcount; k++) {
+		ofd_read_unlock(env, fo[k]);
+		ofd_object_put(env, fo[k]);
+	}
 	/* tgt_grant_prepare_write() was called, so we must commit */
 	tgt_grant_commit(exp, oa->o_grant_used, rc);
+	GOTO(out, rc);
+out_unlock:
+	while (locked-- > 0) {
+		n = order[locked];
+		ofd_read_unlock(env, fo[n]);
+		ofd_object_put(env, fo[n]);
+	}
 out:
 	/* let's still process incoming grant information packed in the oa,
 	 * but without enforcing grant since we won't proceed with the write.
@@ -686,7 +771,7 @@ out:
  * \param[in] cmd	IO type (read/write)
  * \param[in] exp	OBD export of client
  * \param[in] oa	OBDO structure from request
- * \param[in] objcount	always 1
+ * \param[in] objcount	number of objects, only writes may have several
  * \param[in] obj	object data
  * \param[in] rnb	remote buffers
  * \param[in] nr_local	number of local buffers
@@ -745,7 +830,7 @@ int ofd_preprw(const struct lu_env *env, int cmd, struct obd_export *exp,
 		ofd_seq_put(env, oseq);
 	}
 
-	LASSERT(objcount == 1);
+	LASSERT(objcount == 1 || cmd == OBD_BRW_WRITE);
 	LASSERT(obj->ioo_bufcnt > 0);
 
 	if (cmd == OBD_BRW_WRITE) {
@@ -1172,6 +1257,118 @@ out:
 	RETURN(rc);
 }
 
+/**
+ * Count local buffers belonging to one object of a bulk write.
+ *
+ * Local buffers exactly cover the remote buffers they were prepared from,
+ * so the count is found by consuming the byte count of the object's remote
+ * buffers.
+ *
+ * \param[in] obj	object data
+ * \param[in] rnb	remote buffers of this object
+ * \param[in] lnb	local buffers starting with this object's ones
+ * \param[in] npages	number of local buffers left in \a lnb
+ *
+ * \retval		number of local buffers of this object
+ */
+static int ofd_ioobj_nr_local(struct obd_ioobj *obj,
+			      struct niobuf_remote *rnb,
+			      struct niobuf_local *lnb, int npages)
+{
+	int len = 0;
+	int i;
+
+	for (i = 0; i < obj->ioo_bufcnt; i++)
+		len += rnb[i].rnb_len;
+
+	for (i = 0; len > 0 && i < npages; i++)
+		len -= lnb[i].lnb_len;
+	LASSERT(len == 0);
+
+	return i;
+}
+
+/**
+ * Commit the additional objects of a multi-object bulk write.
+ *
+ * Only ownership and timestamps are taken from \a oa for these objects,
+ * since clients only pack objects with the same owner into one RPC. Grant
+ * was consumed for the whole request and is committed with the first
+ * object, see ofd_commitrw().
+ *
+ * \param[in] env	execution environment
+ * \param[in] exp	OBD export of client
+ * \param[in] ofd	OFD device
+ * \param[in] oa	OBDO structure from client
+ * \param[in] objcount	number of additional objects
+ * \param[in] obj	object data of the additional objects
+ * \param[in] rnb	remote buffers of the additional objects
+ * \param[in] npages	number of local buffers of the additional objects
+ * \param[in] lnb	local buffers of the additional objects
+ * \param[in] old_rc	result of processing at this point
+ *
+ * \retval		0 on successful commit
+ * \retval		negative value on error
+ */
+static int
+ofd_commitrw_write_extra(const struct lu_env *env, struct obd_export *exp,
+			 struct ofd_device *ofd, struct obdo *oa, int objcount,
+			 struct obd_ioobj *obj, struct niobuf_remote *rnb,
+			 int npages, struct niobuf_local *lnb, int old_rc)
+{
+	struct ofd_thread_info	*info = ofd_info(env);
+	struct tgt_session_info	*tsi = tgt_ses_info(env);
+	struct lu_attr		*la = &info->fti_attr2;
+	struct obdo		*attrs = NULL;
+	int			 rc = 0;
+	int			 n;
+
+	/* report the attributes of each object back to the client */
+	if (tsi != NULL && tsi->tsi_pill != NULL &&
+	    req_capsule_has_field(tsi->tsi_pill, &RMF_OST_BRW_ATTRS,
+				  RCL_SERVER))
+		attrs = req_capsule_server_sized_get(tsi->tsi_pill,
+						     &RMF_OST_BRW_ATTRS,
+						     objcount *
+						     sizeof(*attrs));
+
+	for (n = 0; n < objcount; n++) {
+		const struct lu_fid	*fid = &obj[n].ioo_oid.oi_fid;
+		struct ofd_mod_data	*fmd;
+		__u64			 valid;
+		int			 nr_local;
+		int			 rc2;
+
+		nr_local = ofd_ioobj_nr_local(&obj[n], rnb, lnb, npages);
+
+		valid = OBD_MD_FLUID | OBD_MD_FLGID | OBD_MD_FLPROJID;
+		fmd = ofd_fmd_find(exp, fid);
+		if (!fmd || fmd->fmd_mactime_xid < info->fti_xid)
+			valid |= OBD_MD_FLATIME | OBD_MD_FLMTIME |
+				 OBD_MD_FLCTIME;
+		ofd_fmd_put(exp, fmd);
+		la_from_obdo(la, oa, valid);
+
+		rc2 = ofd_commitrw_write(env, exp, ofd, fid, la, NULL, 1,
+					 nr_local, lnb, 0, old_rc);
+		if (rc == 0)
+			rc = rc2;
+		if (attrs != NULL) {
+			memset(&attrs[n], 0, sizeof(attrs[n]));
+			attrs[n].o_oi = obj[n].ioo_oid;
+			if (rc2 == 0)
+				obdo_from_la(&attrs[n], la, OFD_VALID_FLAGS);
+		}
+
+		rnb += obj[n].ioo_bufcnt;
+		lnb += nr_local;
+		npages -= nr_local;
+	}
+	LASSERT(npages == 0);
+
+	return rc;
+}
+
 /**
  * Commit bulk IO to the storage.
  *
@@ -1184,7 +1381,7 @@ out:
  * \param[in] cmd	IO type (READ/WRITE)
  * \param[in] exp	OBD export of client
  * \param[in] oa	OBDO structure from client
- * \param[in] objcount	always 1
+ * \param[in] objcount	number of objects, only writes may have several
  * \param[in] obj	object data
  * \param[in] rnb	remote buffers
  * \param[in] npages	number of local buffers
@@ -1211,6 +1408,22 @@ int ofd_commitrw(const struct lu_env *env, int cmd, struct obd_export *exp,
 
 	if (cmd == OBD_BRW_WRITE) {
 		struct lu_nodemap *nodemap;
+		int rc2 = 0;
+
+		/* objects after the first one of a multi-object write are
+		 * committed on their own, the obdo describes the first one */
+		if (objcount > 1) {
+			int nr_local = ofd_ioobj_nr_local(obj, rnb, lnb,
+							  npages);
+
+			rc2 = ofd_commitrw_write_extra(env, exp, ofd, oa,
+						       objcount - 1, obj + 1,
+						       rnb + obj->ioo_bufcnt,
+						       npages - nr_local,
+						       lnb + nr_local, old_rc);
+			objcount = 1;
+			npages = nr_local;
+		}
 
 		/* Don't update timestamps if this write is older than a
 		 * setattr which modifies the timestamps. b=10150 */
@@ -1235,6 +1448,8 @@ int ofd_commitrw(const struct lu_env *env, int cmd, struct obd_export *exp,
 		rc = ofd_commitrw_write(env, exp, ofd, fid, &info->fti_attr,
 					ff, objcount, npages, lnb,
 					oa->o_grant_used, old_rc);
+		if (rc == 0)
+			rc = rc2;
 		if (rc == 0)
 			obdo_from_la(oa, &info->fti_attr,
 				     OFD_VALID_FLAGS | LA_GID | LA_UID |
@@ -355,6 +355,59 @@ static ssize_t osc_grant_shrink_interval_seq_write(struct file *file,
 }
 LPROC_SEQ_FOPS(osc_grant_shrink_interval);
 
+static int osc_grant_forecast_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device *dev = m->private;
+	struct client_obd *cli = &dev->u.cli;
+	unsigned long forecast;
+
+	spin_lock(&cli->cl_loi_list_lock);
+	forecast = osc_grant_forecast(cli);
+	seq_printf(m, "rate_bytes_per_sec: %lu\n"
+		   "forecast_bytes:     %lu\n"
+		   "avail_bytes:        %lu\n"
+		   "hint_rpcs:          %lu\n"
+		   "grant_waits:        %lu\n",
+		   cli->cl_grant_rate, forecast, cli->cl_avail_grant,
+		   cli->cl_grant_hint_rpcs, cli->cl_grant_waits);
+	spin_unlock(&cli->cl_loi_list_lock);
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(osc_grant_forecast);
+
+static int osc_grant_horizon_ms_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device *dev = m->private;
+
+	seq_printf(m, "%u\n", dev->u.cli.cl_grant_horizon_ms);
+	return 0;
+}
+
+static ssize_t osc_grant_horizon_ms_seq_write(struct file *file,
+					      const char __user *buffer,
+					      size_t count, loff_t *off)
+{
+	struct obd_device *dev = ((struct seq_file *)file->private_data)->private;
+	struct client_obd *cli = &dev->u.cli;
+	int rc;
+	__s64 val;
+
+	rc = lprocfs_str_to_s64(buffer, count, &val);
+	if (rc)
+		return rc;
+
+	/* 0 disables grant forecasting */
+	if (val < 0 || val > 60 * MSEC_PER_SEC)
+		return -ERANGE;
+
+	spin_lock(&cli->cl_loi_list_lock);
+	cli->cl_grant_horizon_ms = val;
+	spin_unlock(&cli->cl_loi_list_lock);
+
+	return count;
+}
+LPROC_SEQ_FOPS(osc_grant_horizon_ms);
+
 static int osc_checksum_seq_show(struct seq_file *m, void *v)
 {
 	struct obd_device *obd = m->private;
@@ -470,6 +523,75 @@ static ssize_t osc_resend_count_seq_write(struct file *file,
 }
 LPROC_SEQ_FOPS(osc_resend_count);
 
+static int osc_max_objs_per_rpc_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device *dev = m->private;
+	struct client_obd *cli = &dev->u.cli;
+
+	spin_lock(&cli->cl_loi_list_lock);
+	seq_printf(m, "%u\n", cli->cl_max_objs_per_rpc);
+	spin_unlock(&cli->cl_loi_list_lock);
+	return 0;
+}
+
+static ssize_t osc_max_objs_per_rpc_seq_write(struct file *file,
+					      const char __user *buffer,
+					      size_t count, loff_t *off)
+{
+	struct obd_device *dev = ((struct seq_file *)file->private_data)->private;
+	struct client_obd *cli = &dev->u.cli;
+	int rc;
+	__s64 val;
+
+	rc = lprocfs_str_to_s64(buffer, count, &val);
+	if (rc)
+		return rc;
+	if (val < 1 || val > PTLRPC_MAX_BRW_OBJS)
+		return -ERANGE;
+
+	spin_lock(&cli->cl_loi_list_lock);
+	cli->cl_max_objs_per_rpc = val;
+	spin_unlock(&cli->cl_loi_list_lock);
+
+	return count;
+}
+LPROC_SEQ_FOPS(osc_max_objs_per_rpc);
+
+static int osc_multiobj_delay_us_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device *dev = m->private;
+	struct client_obd *cli = &dev->u.cli;
+
+	spin_lock(&cli->cl_loi_list_lock);
+	seq_printf(m, "%u\n", cli->cl_multiobj_delay_us);
+	spin_unlock(&cli->cl_loi_list_lock);
+	return 0;
+}
+
+static ssize_t osc_multiobj_delay_us_seq_write(struct file *file,
+					       const char __user *buffer,
+					       size_t count, loff_t *off)
+{
+	struct obd_device *dev = ((struct seq_file *)file->private_data)->private;
+	struct client_obd *cli = &dev->u.cli;
+	int rc;
+	__s64 val;
+
+	rc = lprocfs_str_to_s64(buffer, count, &val);
+	if (rc)
+		return rc;
+	/* small writes are never held for longer than a second */
+	if (val < 0 || val > USEC_PER_SEC)
+		return -ERANGE;
+
+	spin_lock(&cli->cl_loi_list_lock);
+	cli->cl_multiobj_delay_us = val;
+	spin_unlock(&cli->cl_loi_list_lock);
+
+	return count;
+}
+LPROC_SEQ_FOPS(osc_multiobj_delay_us);
+
 static int osc_checksum_dump_seq_show(struct seq_file *m, void *v)
 {
 	struct obd_device *obd = m->private;
@@ -585,11 +707,65 @@ static int osc_unstable_stats_seq_show(struct seq_file *m, void *v)
 	mb    = (pages * PAGE_SIZE) >> 20;
 
 	seq_printf(m, "unstable_pages: %20ld\n"
-		   "unstable_mb:              %10d\n",
-		   pages, mb);
+		   "unstable_mb:              %10d\n"
+		   "unstable_max_pages: %16lu\n"
+		   "soft_sync:                %10d\n"
+		   "throttle_waits: %20ld\n"
+		   "throttle_wait_us: %18ld\n",
+		   pages, mb, cli->cl_unstable_max_pages,
+		   READ_ONCE(cli->cl_unstable_soft_sync),
+		   atomic_long_read(&cli->cl_unstable_wait_count),
+		   atomic_long_read(&cli->cl_unstable_wait_us));
 	return 0;
 }
-LPROC_SEQ_FOPS_RO(osc_unstable_stats);
+
+static ssize_t osc_unstable_stats_seq_write(struct file *file,
+					    const char __user *buffer,
+					    size_t count, loff_t *off)
+{
+	struct obd_device *dev = ((struct seq_file *)file->private_data)->private;
+	struct client_obd *cli = &dev->u.cli;
+
+	atomic_long_set(&cli->cl_unstable_wait_count, 0);
+	atomic_long_set(&cli->cl_unstable_wait_us, 0);
+
+	return count;
+}
+LPROC_SEQ_FOPS(osc_unstable_stats);
+
+static int osc_unstable_max_mb_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device *dev = m->private;
+	struct client_obd *cli = &dev->u.cli;
+
+	return lprocfs_seq_read_frac_helper(m, cli->cl_unstable_max_pages,
+					    1 << (20 - PAGE_SHIFT));
+}
+
+/* 0 restores the default budget of a quarter of the shared LRU */
+static ssize_t osc_unstable_max_mb_seq_write(struct file *file,
+					     const char __user *buffer,
+					     size_t count, loff_t *off)
+{
+	struct obd_device *dev = ((struct seq_file *)file->private_data)->private;
+	struct client_obd *cli = &dev->u.cli;
+	__s64 pages_number;
+	int rc;
+
+	rc = lprocfs_str_with_units_to_s64(buffer, count, &pages_number, 'M');
+	if (rc)
+		return rc;
+
+	pages_number >>= PAGE_SHIFT;
+	if (pages_number < 0 || pages_number > totalram_pages / 4)
+		return -ERANGE;
+
+	cli->cl_unstable_max_pages = pages_number;
+	wake_up_all(&cli->cl_unstable_waitq);
+
+	return count;
+}
+LPROC_SEQ_FOPS(osc_unstable_max_mb);
 
 LPROC_SEQ_FOPS_RO_TYPE(osc, connect_flags);
 LPROC_SEQ_FOPS_RO_TYPE(osc, server_uuid);
@@ -618,6 +794,10 @@ struct lprocfs_vars lprocfs_osc_obd_vars[] = {
 	  .fops	=	&osc_obd_max_pages_per_rpc_fops	},
 	{ .name	=	"max_rpcs_in_flight",
 	  .fops	=	&osc_max_rpcs_in_flight_fops	},
+	{ .name	=	"max_objs_per_rpc",
+	  .fops	=	&osc_max_objs_per_rpc_fops	},
+	{ .name	=	"multiobj_delay_us",
+	  .fops	=	&osc_multiobj_delay_us_fops	},
 	{ .name	=	"destroys_in_flight",
 	  .fops	=	&osc_destroys_in_flight_fops	},
 	{ .name	=	"max_dirty_mb",
@@ -634,6 +814,10 @@ struct lprocfs_vars lprocfs_osc_obd_vars[] = {
 	  .fops	=	&osc_cur_dirty_grant_bytes_fops	},
 	{ .name	=	"grant_shrink_interval",
 	  .fops	=	&osc_grant_shrink_interval_fops	},
+	{ .name	=	"grant_forecast",
+	  .fops	=	&osc_grant_forecast_fops	},
+	{ .name	=	"grant_horizon_ms",
+	  .fops	=	&osc_grant_horizon_ms_fops	},
 	{ .name	=	"checksums",
 	  .fops	=	&osc_checksum_fops		},
 	{ .name	=	"checksum_type",
@@ -656,6 +840,8 @@ struct lprocfs_vars lprocfs_osc_obd_vars[] = {
 	  .fops	=	&osc_pinger_recov_fops		},
 	{ .name	=	"unstable_stats",
 	  .fops	=	&osc_unstable_stats_fops	},
+	{ .name	=	"unstable_max_mb",
+	  .fops	=	&osc_unstable_max_mb_fops	},
 	{ NULL }
 };
 
@@ -794,6 +980,10 @@ static int osc_stats_seq_show(struct seq_file *seq, void *v)
 		   stats->os_lockless_reads);
 	seq_printf(seq, "lockless_truncate\t\t%llu\n",
 		   stats->os_lockless_truncates);
+	seq_printf(seq, "multiobj_write_rpcs\t\t%llu\n",
+		   stats->os_multiobj_rpcs);
+	seq_printf(seq, "multiobj_write_objs\t\t%llu\n",
+		   stats->os_multiobj_objs);
 	return 0;
 }
 
@@ -1394,6 +1394,7 @@ static void osc_consume_write_grant(struct client_obd *cli,
 	LASSERT(!(pga->flag & OBD_BRW_FROM_GRANT));
 	atomic_long_inc(&obd_dirty_pages);
 	cli->cl_dirty_pages++;
+	cli->cl_grant_rate_bytes += PAGE_SIZE;
 	pga->flag |= OBD_BRW_FROM_GRANT;
 	CDEBUG(D_CACHE, "using %lu grant credits for brw %p page %p\n",
 	       PAGE_SIZE, pga, pga->pg);
@@ -1575,6 +1576,7 @@ static int osc_enter_cache(const struct lu_env *env, struct client_obd *cli,
 	struct lov_oinfo	*loi = osc->oo_oinfo;
 	struct osc_cache_waiter	 ocw;
 	struct l_wait_info	 lwi;
+	bool			 prefetch = false;
 	int			 rc = -EDQUOT;
 	ENTRY;
 
@@ -1609,6 +1611,7 @@ static int osc_enter_cache(const struct lu_env *env, struct client_obd *cli,
 	init_waitqueue_head(&ocw.ocw_waitq);
 	ocw.ocw_oap   = oap;
 	ocw.ocw_grant = bytes;
+	cli->cl_grant_waits++;
 	while (cli->cl_dirty_pages > 0 || cli->cl_w_in_flight > 0) {
 		list_add_tail(&ocw.ocw_entry, &cli->cl_cache_waiters);
 		ocw.ocw_rc = 0;
@@ -1667,7 +1670,11 @@ static int osc_enter_cache(const struct lu_env *env, struct client_obd *cli,
 	}
 	EXIT;
 out:
+	if (rc == 0)
+		prefetch = osc_grant_prefetch_check(cli);
 	spin_unlock(&cli->cl_loi_list_lock);
+	if (prefetch)
+		(void)ptlrpcd_queue_work(cli->cl_grant_work);
 	RETURN(rc);
 }
 
@@ -1807,10 +1814,13 @@ static int __osc_list_maint(struct client_obd *cli, struct osc_object *osc)
 		on_list(&osc->oo_ready_item, &cli->cl_loi_ready_list, 0);
 		on_list(&osc->oo_hp_ready_item, &cli->cl_loi_hp_ready_list, 1);
 	} else {
+		int ready = osc_makes_rpc(cli, osc, OBD_BRW_WRITE) ||
+			    osc_makes_rpc(cli, osc, OBD_BRW_READ);
+
 		on_list(&osc->oo_hp_ready_item, &cli->cl_loi_hp_ready_list, 0);
-		on_list(&osc->oo_ready_item, &cli->cl_loi_ready_list,
-			osc_makes_rpc(cli, osc, OBD_BRW_WRITE) ||
-			osc_makes_rpc(cli, osc, OBD_BRW_READ));
+		if (ready && list_empty(&osc->oo_ready_item))
+			osc->oo_ready_time = ktime_get();
+		on_list(&osc->oo_ready_item, &cli->cl_loi_ready_list, ready);
 	}
 
 	on_list(&osc->oo_write_item, &cli->cl_loi_write_list,
@@ -2025,40 +2035,36 @@ static inline unsigned osc_max_write_chunks(const struct client_obd *cli)
  * 4. If urgent list is not empty, goto 2;
  * 5. Traverse the extent tree from the 1st extent;
  * 6. Above steps exit if there is no space in this RPC.
+ *
+ * \a data may already hold the extents of other objects when several small
+ * objects are packed into one write RPC.
  */
 static unsigned int get_write_extents(struct osc_object *obj,
-				      struct list_head *rpclist)
+				      struct extent_rpc_data *data)
 {
 	struct client_obd *cli = osc_cli(obj);
 	struct osc_extent *ext;
-	struct extent_rpc_data data = {
-		.erd_rpc_list	= rpclist,
-		.erd_page_count	= 0,
-		.erd_max_pages	= cli->cl_max_pages_per_rpc,
-		.erd_max_chunks	= osc_max_write_chunks(cli),
-		.erd_max_extents = 256,
-	};
 
 	LASSERT(osc_object_is_locked(obj));
 	while (!list_empty(&obj->oo_hp_exts)) {
 		ext = list_entry(obj->oo_hp_exts.next, struct osc_extent,
 				 oe_link);
 		LASSERT(ext->oe_state == OES_CACHE);
-		if (!try_to_add_extent_for_io(cli, ext, &data))
-			return data.erd_page_count;
-		EASSERT(ext->oe_nr_pages <= data.erd_max_pages, ext);
+		if (!try_to_add_extent_for_io(cli, ext, data))
+			return data->erd_page_count;
+		EASSERT(ext->oe_nr_pages <= data->erd_max_pages, ext);
 	}
-	if (data.erd_page_count == data.erd_max_pages)
-		return data.erd_page_count;
+	if (data->erd_page_count == data->erd_max_pages)
+		return data->erd_page_count;
 
 	while (!list_empty(&obj->oo_urgent_exts)) {
 		ext = list_entry(obj->oo_urgent_exts.next,
 				 struct osc_extent, oe_link);
-		if (!try_to_add_extent_for_io(cli, ext, &data))
-			return data.erd_page_count;
+		if (!try_to_add_extent_for_io(cli, ext, data))
+			return data->erd_page_count;
 	}
-	if (data.erd_page_count == data.erd_max_pages)
-		return data.erd_page_count;
+	if (data->erd_page_count == data->erd_max_pages)
+		return data->erd_page_count;
 
 	/* One key difference between full extents and other extents: full
 	 * extents can usually only be added if the rpclist was empty, so if we
@@ -2068,11 +2074,11 @@ static unsigned int get_write_extents(struct osc_object *obj,
 	while (!list_empty(&obj->oo_full_exts)) {
 		ext = list_entry(obj->oo_full_exts.next,
 				 struct osc_extent, oe_link);
-		if (!try_to_add_extent_for_io(cli, ext, &data))
+		if (!try_to_add_extent_for_io(cli, ext, data))
 			break;
 	}
-	if (data.erd_page_count == data.erd_max_pages)
-		return data.erd_page_count;
+	if (data->erd_page_count == data->erd_max_pages)
+		return data->erd_page_count;
 
 	ext = first_extent(obj);
 	while (ext != NULL) {
@@ -2083,12 +2089,190 @@ static unsigned int get_write_extents(struct osc_object *obj,
 			continue;
 		}
 
-		if (!try_to_add_extent_for_io(cli, ext, &data))
-			return data.erd_page_count;
+		if (!try_to_add_extent_for_io(cli, ext, data))
+			return data->erd_page_count;
 
 		ext = next_extent(ext);
 	}
-	return data.erd_page_count;
+	return data->erd_page_count;
+}
+
+static inline bool osc_multiobj_enabled(struct client_obd *cli)
+{
+	return cli->cl_max_objs_per_rpc > 1 && cli->cl_import != NULL &&
+	       !cli->cl_import->imp_invalid &&
+	       imp_connect_multiobj_brw(cli->cl_import);
+}
+
+/**
+ * Whether the small writes of \a osc should wait for other objects to be
+ * packed with them. This is only done while write RPCs are in flight, as
+ * their completion runs osc_check_rpcs() again, and for no longer than
+ * cl_multiobj_delay_us after the object became ready.
+ */
+static bool osc_multiobj_hold(struct client_obd *cli, struct osc_object *osc)
+__must_hold(&cli->cl_loi_list_lock)
+{
+	if (!osc_multiobj_enabled(cli) || cli->cl_multiobj_delay_us == 0)
+		return false;
+
+	if (cli->cl_w_in_flight == 0 || !list_empty(&cli->cl_cache_waiters))
+		return false;
+
+	if (osc_makes_hprpc(osc) || !list_empty(&osc->oo_full_exts) ||
+	    atomic_read(&osc->oo_nr_reads) > 0 ||
+	    atomic_read(&osc->oo_nr_writes) == 0)
+		return false;
+
+	/* enough data is queued to fill an RPC */
+	if (atomic_read(&cli->cl_pending_w_pages) >= cli->cl_max_pages_per_rpc)
+		return false;
+
+	return ktime_before(ktime_get(),
+			    ktime_add_us(osc->oo_ready_time,
+					 cli->cl_multiobj_delay_us));
+}
+
+/**
+ * Add the write extents of other ready objects to the RPC started by
+ * \a first, so that many small files are written with a single RPC.
+ * The extents of each object are kept together in \a data->erd_rpc_list.
+ * An object none of whose extents can be added is not looked at again.
+ */
+static void osc_multiobj_gather(const struct lu_env *env,
+				struct client_obd *cli,
+				struct osc_object *first,
+				struct extent_rpc_data *data)
+{
+	struct list_head skipped = LIST_HEAD_INIT(skipped);
+	struct list_head *rpclist = data->erd_rpc_list;
+	unsigned int max_objs;
+	unsigned int nr_objs = 1;
+	ENTRY;
+
+	spin_lock(&cli->cl_loi_list_lock);
+	max_objs = min_t(unsigned int, cli->cl_max_objs_per_rpc,
+			 PTLRPC_MAX_BRW_OBJS);
+	while (nr_objs < max_objs &&
+	       data->erd_page_count < cli->cl_max_pages_per_rpc &&
+	       !list_empty(&cli->cl_loi_ready_list)) {
+		struct osc_object *osc;
+		struct osc_extent *ext;
+		struct osc_extent *tmp;
+		struct list_head *last;
+		unsigned int page_count;
+
+		osc = list_to_obj(&cli->cl_loi_ready_list, ready_item);
+		if (osc == first || osc_makes_hprpc(osc) ||
+		    atomic_read(&osc->oo_nr_writes) == 0) {
+			list_add_tail(&osc->oo_ready_item, &skipped);
+			continue;
+		}
+
+		cl_object_get(osc2cl(osc));
+		spin_unlock(&cli->cl_loi_list_lock);
+
+		last = rpclist->prev;
+		page_count = data->erd_page_count;
+
+		osc_object_lock(osc);
+		page_count = get_write_extents(osc, data) - page_count;
+		if (page_count > 0) {
+			osc_update_pending(osc, OBD_BRW_WRITE, -page_count);
+			ext = list_entry(last->next, struct osc_extent, oe_link);
+			list_for_each_entry_from(ext, rpclist, oe_link) {
+				if (ext->oe_state == OES_CACHE)
+					osc_extent_state_set(ext, OES_LOCKING);
+				else
+					osc_extent_state_set(ext, OES_RPC);
+			}
+		}
+		osc_object_unlock(osc);
+
+		if (page_count > 0) {
+			ext = list_entry(last->next, struct osc_extent, oe_link);
+			list_for_each_entry_safe_from(ext, tmp, rpclist,
+						      oe_link) {
+				int rc;
+
+				if (ext->oe_state != OES_LOCKING)
+					continue;
+				rc = osc_extent_make_ready(env, ext);
+				if (unlikely(rc < 0)) {
+					list_del_init(&ext->oe_link);
+					osc_extent_finish(env, ext, 0, rc);
+				}
+			}
+			nr_objs++;
+		}
+
+		spin_lock(&cli->cl_loi_list_lock);
+		if (page_count == 0) {
+			/* none of its extents fit, keep it from being picked
+			 * again in this loop, it stays ready */
+			list_del_init(&osc->oo_ready_item);
+			list_add_tail(&osc->oo_ready_item, &skipped);
+		} else {
+			__osc_list_maint(cli, osc);
+		}
+		spin_unlock(&cli->cl_loi_list_lock);
+
+		cl_object_put(env, osc2cl(osc));
+		spin_lock(&cli->cl_loi_list_lock);
+	}
+	list_splice(&skipped, &cli->cl_loi_ready_list);
+	spin_unlock(&cli->cl_loi_list_lock);
+
+	EXIT;
+}
+
+/**
+ * The OST enforces quota of a multi-object write for the owner in the obdo
+ * of the first object, so move the extents of objects owned by somebody
+ * else from \a rpclist to \a rest.
+ */
+static void osc_multiobj_split(const struct lu_env *env,
+			       struct list_head *rpclist,
+			       struct list_head *rest)
+{
+	struct osc_thread_info *info = osc_env_info(env);
+	struct cl_req_attr *crattr = &info->oti_req_attr;
+	struct obdo *oa = &info->oti_oa;
+	struct osc_object *prev = NULL;
+	struct osc_extent *ext;
+	struct osc_extent *tmp;
+	__u32 uid = 0;
+	__u32 gid = 0;
+	__u32 projid = 0;
+	bool same = true;
+
+	/* extents are kept together per object */
+	if (list_entry(rpclist->next, struct osc_extent, oe_link)->oe_obj ==
+	    list_entry(rpclist->prev, struct osc_extent, oe_link)->oe_obj)
+		return;
+
+	list_for_each_entry_safe(ext, tmp, rpclist, oe_link) {
+		if (ext->oe_obj != prev) {
+			memset(crattr, 0, sizeof(*crattr));
+			memset(oa, 0, sizeof(*oa));
+			crattr->cra_type = CRT_WRITE;
+			crattr->cra_flags = OBD_MD_FLUID | OBD_MD_FLGID;
+			crattr->cra_oa = oa;
+			cl_req_attr_set(env, osc2cl(ext->oe_obj), crattr);
+
+			if (prev == NULL) {
+				uid = oa->o_uid;
+				gid = oa->o_gid;
+				projid = oa->o_projid;
+			} else {
+				same = oa->o_uid == uid && oa->o_gid == gid &&
+				       oa->o_projid == projid;
+			}
+			prev = ext->oe_obj;
+		}
+		if (!same)
+			list_move_tail(&ext->oe_link, rest);
+	}
 }
 
 static int
@@ -2100,6 +2284,13 @@ __must_hold(osc)
 	struct osc_extent *ext;
 	struct osc_extent *tmp;
 	struct osc_extent *first = NULL;
+	struct extent_rpc_data data = {
+		.erd_rpc_list	= &rpclist,
+		.erd_page_count	= 0,
+		.erd_max_pages	= cli->cl_max_pages_per_rpc,
+		.erd_max_chunks	= osc_max_write_chunks(cli),
+		.erd_max_extents = 256,
+	};
 	unsigned int page_count = 0;
 	int srvlock = 0;
 	int rc = 0;
@@ -2107,7 +2298,7 @@ __must_hold(osc)
 
 	LASSERT(osc_object_is_locked(osc));
 
-	page_count = get_write_extents(osc, &rpclist);
+	page_count = get_write_extents(osc, &data);
 	LASSERT(equi(page_count == 0, list_empty(&rpclist)));
 
 	if (list_empty(&rpclist))
@@ -2145,10 +2336,19 @@ __must_hold(osc)
 		}
 	}
 
-	if (!list_empty(&rpclist)) {
-		LASSERT(page_count > 0);
+	/* top up a small RPC with the extents of other objects */
+	if (!list_empty(&rpclist) && !srvlock &&
+	    page_count < cli->cl_max_pages_per_rpc &&
+	    osc_multiobj_enabled(cli))
+		osc_multiobj_gather(env, cli, osc, &data);
+
+	while (!list_empty(&rpclist)) {
+		struct list_head rest = LIST_HEAD_INIT(rest);
+
+		osc_multiobj_split(env, &rpclist, &rest);
 		rc = osc_build_rpc(env, cli, &rpclist, OBD_BRW_WRITE);
 		LASSERT(list_empty(&rpclist));
+		list_splice(&rest, &rpclist);
 	}
 
 	osc_object_lock(osc);
@@ -2251,6 +2451,7 @@ static struct osc_object *osc_next_obj(struct client_obd *cli)
 static void osc_check_rpcs(const struct lu_env *env, struct client_obd *cli)
 __must_hold(&cli->cl_loi_list_lock)
 {
+	struct list_head held = LIST_HEAD_INIT(held);
 	struct osc_object *osc;
 	int rc = 0;
 	ENTRY;
@@ -2266,6 +2467,13 @@ __must_hold(&cli->cl_loi_list_lock)
 			break;
 		}
 
+		/* give small writes a chance to be packed with others */
+		if (list_empty(&osc->oo_ready_item) &&
+		    osc_multiobj_hold(cli, osc)) {
+			list_add_tail(&osc->oo_ready_item, &held);
+			continue;
+		}
+
 		cl_object_get(obj);
 		spin_unlock(&cli->cl_loi_list_lock);
 		lu_object_ref_add_at(&obj->co_lu, &link, "check", current);
@@ -2314,6 +2522,7 @@ __must_hold(&cli->cl_loi_list_lock)
 
 		spin_lock(&cli->cl_loi_list_lock);
 	}
+	list_splice(&held, &cli->cl_loi_ready_list);
 }
 
 static int osc_io_unplug0(const struct lu_env *env, struct client_obd *cli,
@@ -2351,7 +2560,6 @@ void osc_io_unplug(const struct lu_env *env, struct client_obd *cli,
 int osc_prep_async_page(struct osc_object *osc, struct osc_page *ops,
 			struct page *page, loff_t offset)
 {
-	struct obd_export     *exp = osc_export(osc);
 	struct osc_async_page *oap = &ops->ops_oap;
 	ENTRY;
 
@@ -2359,7 +2567,6 @@ int osc_prep_async_page(struct osc_object *osc, struct osc_page *ops,
 		return cfs_size_round(sizeof(*oap));
 
 	oap->oap_magic = OAP_MAGIC;
-	oap->oap_cli = &exp->exp_obd->u.cli;
 	oap->oap_obj = osc;
 
 	oap->oap_page = page;
@@ -2384,8 +2591,8 @@ int osc_queue_async_io(const struct lu_env *env, struct cl_io *io,
 	struct osc_io *oio = osc_env_io(env);
 	struct osc_extent     *ext = NULL;
 	struct osc_async_page *oap = &ops->ops_oap;
-	struct client_obd     *cli = oap->oap_cli;
 	struct osc_object     *osc = oap->oap_obj;
+	struct client_obd     *cli = osc_cli(osc);
 	pgoff_t index;
 	unsigned int tmp;
 	unsigned int grants = 0;
@@ -44,6 +44,12 @@ extern struct ptlrpc_request_pool *osc_rq_pool;
 void osc_wake_cache_waiters(struct client_obd *cli);
 int osc_shrink_grant_to_target(struct client_obd *cli, __u64 target_bytes);
 void osc_update_next_shrink(struct client_obd *cli);
+unsigned long osc_grant_forecast(struct client_obd *cli);
+bool osc_grant_prefetch_check(struct client_obd *cli);
+/* How far ahead grant demand is forecast by default, milliseconds */
+#define OSC_GRANT_HORIZON_MS		1000
+/* Sampling period of the grant consumption rate, milliseconds */
+#define OSC_GRANT_RATE_PERIOD_MS	100
 
 extern struct ptlrpc_request_set *PTLRPCD_SET;
 
@@ -153,6 +159,9 @@ int osc_quotactl(struct obd_device *unused, struct obd_export *exp,
 void osc_inc_unstable_pages(struct ptlrpc_request *req);
 void osc_dec_unstable_pages(struct ptlrpc_request *req);
 bool osc_over_unstable_soft_limit(struct client_obd *cli);
+void osc_unstable_throttle(const struct lu_env *env, struct client_obd *cli);
+/* Longest a writer waits for an OST to commit its unstable pages, seconds */
+#define OSC_UNSTABLE_WAIT_MAX	1
 /**
  * Bit flags for osc_dlm_lock_at_pageoff().
  */
@@ -740,6 +740,8 @@ static int osc_io_write_start(const struct lu_env *env,
 	ENTRY;
 
 	OBD_FAIL_TIMEOUT(OBD_FAIL_OSC_DELAY_SETTIME, 1);
+	osc_unstable_throttle(env, osc_cli(cl2osc(obj)));
+
 	cl_object_attr_lock(obj);
 	attr->cat_mtime = attr->cat_ctime = ktime_get_real_seconds();
 	rc = cl_object_attr_update(env, obj, attr, CAT_MTIME | CAT_CTIME);
@@ -748,6 +750,15 @@ static int osc_io_write_start(const struct lu_env *env,
 	RETURN(rc);
 }
 
+/**
+ * OST_SYNC sent through the request set of the caller: the reply status is
+ * returned by the interpret, so that ptlrpc_set_wait() reports it.
+ */
+static int osc_fsync_set_upcall(void *a, int rc)
+{
+	return rc;
+}
+
 static int osc_fsync_ost(const struct lu_env *env, struct osc_object *obj,
 			 struct cl_fsync_io *fio)
 {
@@ -769,6 +780,10 @@ static int osc_fsync_ost(const struct lu_env *env, struct osc_object *obj,
 
 	obdo_set_parent_fid(oa, fio->fi_fid);
 
+	if (fio->fi_rqset != NULL)
+		RETURN(osc_sync_base(obj, oa, osc_fsync_set_upcall, NULL,
+				     fio->fi_rqset));
+
 	init_completion(&cbargs->opc_sync);
 
 	rc = osc_sync_base(obj, oa, osc_async_upcall, cbargs, PTLRPCD_SET);
@@ -796,7 +811,9 @@ static int osc_io_fsync_start(const struct lu_env *env,
 		fio->fi_nr_written += result;
 		result = 0;
 	}
-	if (fio->fi_mode == CL_FSYNC_ALL) {
+	/* with a request set, OST_SYNC is sent in osc_io_fsync_end() once the
+	 * writeback of all stripes has been started */
+	if (fio->fi_mode == CL_FSYNC_ALL && fio->fi_rqset == NULL) {
 		int rc;
 
 		/* we have to wait for writeback to finish before we can
@@ -826,6 +843,15 @@ static void osc_io_fsync_end(const struct lu_env *env,
 
 	if (fio->fi_mode == CL_FSYNC_LOCAL) {
 		result = osc_cache_wait_range(env, cl2osc(obj), start, end);
+	} else if (fio->fi_mode == CL_FSYNC_ALL && fio->fi_rqset != NULL) {
+		int rc;
+
+		/* the caller waits for the whole set, see
+		 * cl_sync_file_range() */
+		result = osc_cache_wait_range(env, cl2osc(obj), start, end);
+		rc = osc_fsync_ost(env, cl2osc(obj), fio);
+		if (result == 0)
+			result = rc;
 	} else if (fio->fi_mode == CL_FSYNC_ALL) {
 		struct osc_io           *oio    = cl2osc_io(env, slice);
 		struct osc_async_cbargs *cbargs = &oio->oi_cbarg;
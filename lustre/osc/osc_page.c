@@ -151,7 +151,7 @@ static int osc_page_print(const struct lu_env *env,
                           /* 2 */
                           oap->oap_obj_off, oap->oap_page_off, oap->oap_count,
                           oap->oap_async_flags, oap->oap_brw_flags,
-			  oap->oap_request, oap->oap_cli, obj,
+			  oap->oap_request, cli, obj,
 			  /* 3 */
 			  opg->ops_transfer_pinned,
 			  osc_submit_duration(opg), opg->ops_srvlock,
@@ -867,6 +867,27 @@ void osc_lru_unreserve(struct client_obd *cli, unsigned long npages)
 	wake_up_all(&osc_lru_waitq);
 }
 
+/**
+ * Return the unstable page budget of \a cli.
+ *
+ * Unless set explicitly, an OSC may hold up to a quarter of the shared LRU
+ * in unstable pages, so that a single OST slow to commit cannot consume
+ * the LRU slots needed by writers to the other OSTs.
+ */
+static inline long osc_unstable_budget(struct client_obd *cli)
+{
+	if (cli->cl_unstable_max_pages > 0)
+		return cli->cl_unstable_max_pages;
+
+	return max_t(long, cli->cl_cache->ccc_lru_max >> 2, 1);
+}
+
+static inline bool osc_over_unstable_budget(struct client_obd *cli)
+{
+	return atomic_long_read(&cli->cl_unstable_count) >=
+	       osc_unstable_budget(cli);
+}
+
 /**
  * Atomic operations are expensive. We accumulate the accounting for the
  * same page zone to get better performance.
@@ -937,6 +958,9 @@ void osc_dec_unstable_pages(struct ptlrpc_request *req)
 	unstable_count = atomic_long_sub_return(page_count,
 						&cli->cl_unstable_count);
 	LASSERT(unstable_count >= 0);
+	if (waitqueue_active(&cli->cl_unstable_waitq) &&
+	    unstable_count < osc_unstable_budget(cli))
+		wake_up_all(&cli->cl_unstable_waitq);
 
 	unstable_count = atomic_long_sub_return(page_count,
 					   &cli->cl_cache->ccc_unstable_nr);
@@ -988,6 +1012,8 @@ void osc_inc_unstable_pages(struct ptlrpc_request *req)
 bool osc_over_unstable_soft_limit(struct client_obd *cli)
 {
 	long unstable_nr, osc_unstable_count;
+	long window;
+	int users;
 
 	/* Can't check cli->cl_unstable_count, therefore, no soft limit */
 	if (cli->cl_cache == NULL || !cli->cl_cache->ccc_unstable_check)
@@ -995,20 +1021,74 @@ bool osc_over_unstable_soft_limit(struct client_obd *cli)
 
 	osc_unstable_count = atomic_long_read(&cli->cl_unstable_count);
 	unstable_nr = atomic_long_read(&cli->cl_cache->ccc_unstable_nr);
+	window = cli->cl_max_pages_per_rpc * cli->cl_max_rpcs_in_flight;
 
 	CDEBUG(D_CACHE,
 	       "%s: cli: %p unstable pages: %lu, osc unstable pages: %lu\n",
 	       cli_name(cli), cli, unstable_nr, osc_unstable_count);
 
-	/* If the LRU slots are in shortage - 25% remaining AND this OSC
-	 * has one full RPC window of unstable pages, it's a good chance
-	 * to piggyback a SOFT_SYNC flag.
-	 * Please notice that the OST won't take immediate response for the
-	 * SOFT_SYNC request so active OSCs will have more chance to carry
-	 * the flag, this is reasonable. */
-	return unstable_nr > cli->cl_cache->ccc_lru_max >> 2 &&
-	       osc_unstable_count > cli->cl_max_pages_per_rpc *
-				    cli->cl_max_rpcs_in_flight;
+	/* The OST only starts a commit after ofd_soft_sync_limit consecutive
+	 * SOFT_SYNC RPCs, and any write without the flag resets its count.
+	 * So once this OSC asks for a soft sync, keep asking in every RPC
+	 * until the commit has released most of its unstable pages. */
+	if (READ_ONCE(cli->cl_unstable_soft_sync)) {
+		if (osc_unstable_count > window >> 1)
+			return true;
+		WRITE_ONCE(cli->cl_unstable_soft_sync, false);
+		return false;
+	}
+
+	/* Ask for a commit when this OSC is over its own budget, or when the
+	 * LRU slots are in shortage - 25% held by unstable pages - AND this
+	 * OSC holds one full RPC window and more than its fair share of
+	 * them. Only the OSTs holding the most unstable pages are asked to
+	 * commit, the others keep their transactions batched. */
+	users = max(atomic_read(&cli->cl_cache->ccc_users) - 1, 1);
+	if (osc_unstable_count >= osc_unstable_budget(cli) ||
+	    (unstable_nr > cli->cl_cache->ccc_lru_max >> 2 &&
+	     osc_unstable_count > window &&
+	     osc_unstable_count * users > unstable_nr)) {
+		WRITE_ONCE(cli->cl_unstable_soft_sync, true);
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * Throttle a writer while \a cli is over its unstable page budget.
+ *
+ * Unstable pages pin LRU slots shared by all OSCs until the OST commits
+ * them, so an OST slow to commit must not keep growing its share. Ask that
+ * OST for a soft sync, push out the pending dirty pages to carry it, and
+ * wait at most OSC_UNSTABLE_WAIT_MAX seconds for the commit. The writer
+ * proceeds on timeout or signal; this is a throttle, not a hard limit.
+ */
+void osc_unstable_throttle(const struct lu_env *env, struct client_obd *cli)
+{
+	struct l_wait_info lwi;
+	ktime_t start;
+
+	if (cli->cl_cache == NULL || !cli->cl_cache->ccc_unstable_check ||
+	    !osc_over_unstable_budget(cli))
+		return;
+
+	WRITE_ONCE(cli->cl_unstable_soft_sync, true);
+	osc_io_unplug(env, cli, NULL);
+
+	CDEBUG(D_CACHE, "%s: %ld unstable pages over budget %ld, waiting\n",
+	       cli_name(cli), atomic_long_read(&cli->cl_unstable_count),
+	       osc_unstable_budget(cli));
+
+	start = ktime_get();
+	lwi = LWI_TIMEOUT_INTR(cfs_time_seconds(OSC_UNSTABLE_WAIT_MAX), NULL,
+			       LWI_ON_SIGNAL_NOOP, NULL);
+	l_wait_event(cli->cl_unstable_waitq, !osc_over_unstable_budget(cli),
+		     &lwi);
+
+	atomic_long_inc(&cli->cl_unstable_wait_count);
+	atomic_long_add(ktime_to_us(ktime_sub(ktime_get(), start)),
+			&cli->cl_unstable_wait_us);
 }
 
 /**
@@ -456,14 +456,25 @@ static int osc_sync_interpret(const struct lu_env *env,
 {
 	struct osc_fsync_args	*fa = arg;
 	struct ost_body		*body;
-	struct cl_attr		*attr = &osc_env_info(env)->oti_attr;
+	struct cl_attr		*attr;
 	unsigned long		valid = 0;
 	struct cl_object	*obj;
+	struct lu_env		*lenv = NULL;
+	__u16			refcheck;
 	ENTRY;
 
 	if (rc != 0)
 		GOTO(out, rc);
 
+	/* requests of a set waited by ptlrpc_set_wait() come without env */
+	if (env == NULL) {
+		lenv = cl_env_get(&refcheck);
+		if (IS_ERR(lenv))
+			GOTO(out, rc = PTR_ERR(lenv));
+		env = lenv;
+	}
+	attr = &osc_env_info(env)->oti_attr;
+
 	body = req_capsule_server_get(&req->rq_pill, &RMF_OST_BODY);
 	if (body == NULL) {
 		CERROR("can't unpack ost_body\n");
@@ -485,6 +496,8 @@ static int osc_sync_interpret(const struct lu_env *env,
 	cl_object_attr_unlock(obj);
 
 out:
+	if (lenv != NULL && !IS_ERR(lenv))
+		cl_env_put(lenv, &refcheck);
 	rc = fa->fa_upcall(fa->fa_cookie, rc);
 	RETURN(rc);
 }
@@ -658,6 +671,87 @@ static int osc_destroy(const struct lu_env *env, struct obd_export *exp,
 	RETURN(0);
 }
 
+/**
+ * Estimate how much grant this OSC is going to consume within the next
+ * cl_grant_horizon_ms.
+ *
+ * The rate at which dirty pages consume grant is sampled every
+ * OSC_GRANT_RATE_PERIOD_MS and folded into a moving average, so that a
+ * short pause does not drop the forecast while a stream which stopped long
+ * ago is forgotten. The forecast is capped by what this OSC may cache.
+ *
+ * \param[in] cli	client_obd, cl_loi_list_lock held
+ *
+ * \retval		forecast grant demand in bytes, 0 if disabled
+ */
+unsigned long osc_grant_forecast(struct client_obd *cli)
+{
+	ktime_t now = ktime_get();
+	s64 elapsed;
+	unsigned long rate;
+
+	assert_spin_locked(&cli->cl_loi_list_lock);
+
+	if (cli->cl_grant_horizon_ms == 0)
+		return 0;
+
+	elapsed = ktime_to_ms(ktime_sub(now, cli->cl_grant_rate_stamp));
+	if (elapsed >= OSC_GRANT_RATE_PERIOD_MS) {
+		rate = cli->cl_grant_rate_bytes / elapsed * MSEC_PER_SEC;
+		if (elapsed > 8 * OSC_GRANT_RATE_PERIOD_MS)
+			/* idle for a while, restart from the last period */
+			cli->cl_grant_rate = rate;
+		else
+			cli->cl_grant_rate = (3 * cli->cl_grant_rate + rate) / 4;
+		cli->cl_grant_rate_bytes = 0;
+		cli->cl_grant_rate_stamp = now;
+	}
+
+	rate = cli->cl_grant_rate / MSEC_PER_SEC * cli->cl_grant_horizon_ms;
+
+	return min(rate, cli->cl_dirty_max_pages << PAGE_SHIFT);
+}
+
+/**
+ * Check whether this OSC should ask the OST for more grant ahead of time,
+ * i.e. the forecast demand is not covered by the grant it holds.
+ *
+ * \param[in] cli	client_obd, cl_loi_list_lock held
+ */
+static bool osc_grant_short(struct client_obd *cli)
+{
+	unsigned long forecast = osc_grant_forecast(cli);
+
+	return forecast > 0 &&
+	       forecast > cli->cl_avail_grant + cli->cl_reserved_grant;
+}
+
+/**
+ * Queue a grant-only request if the grant held by \a cli runs below half of
+ * the forecast demand and no such request is in flight yet. Called when grant
+ * is consumed for a new dirty page, with cl_loi_list_lock held.
+ *
+ * \retval true	the caller must queue cl_grant_work once the lock is
+ *			dropped
+ */
+bool osc_grant_prefetch_check(struct client_obd *cli)
+{
+	unsigned long forecast;
+
+	assert_spin_locked(&cli->cl_loi_list_lock);
+
+	if (cli->cl_grant_req_pending || cli->cl_grant_work == NULL ||
+	    !OCD_HAS_FLAG(&cli->cl_import->imp_connect_data, GRANT_SHRINK))
+		return false;
+
+	forecast = osc_grant_forecast(cli);
+	if (forecast == 0 || cli->cl_avail_grant >= forecast / 2)
+		return false;
+
+	cli->cl_grant_req_pending = 1;
+	return true;
+}
+
 static void osc_announce_cached(struct client_obd *cli, struct obdo *oa,
                                 long writing_bytes)
 {
@@ -714,6 +808,16 @@ static void osc_announce_cached(struct client_obd *cli, struct obdo *oa,
 	oa->o_grant = cli->cl_avail_grant + cli->cl_reserved_grant;
         oa->o_dropped = cli->cl_lost_grant;
         cli->cl_lost_grant = 0;
+	/* Let the OST know that more grant than usual would be welcome. Only
+	 * done on writes, as grant is not returned in read replies. */
+	if (writing_bytes > 0 && osc_grant_short(cli)) {
+		if (!(oa->o_valid & OBD_MD_FLFLAGS)) {
+			oa->o_valid |= OBD_MD_FLFLAGS;
+			oa->o_flags = 0;
+		}
+		oa->o_flags |= OBD_FL_GRANT_HINT;
+		cli->cl_grant_hint_rpcs++;
+	}
 	spin_unlock(&cli->cl_loi_list_lock);
 	CDEBUG(D_CACHE, "dirty: %llu undirty: %u dropped %u grant: %llu\n",
                oa->o_dirty, oa->o_undirty, oa->o_dropped, oa->o_grant);
@@ -752,21 +856,30 @@ static int osc_shrink_grant_interpret(const struct lu_env *env,
                                       struct ptlrpc_request *req,
                                       void *aa, int rc)
 {
-        struct client_obd *cli = &req->rq_import->imp_obd->u.cli;
-        struct obdo *oa = ((struct osc_grant_args *)aa)->aa_oa;
-        struct ost_body *body;
+	struct client_obd *cli = &req->rq_import->imp_obd->u.cli;
+	struct obdo *oa = ((struct osc_grant_args *)aa)->aa_oa;
+	struct ost_body *body;
+	bool shrink = (oa->o_valid & OBD_MD_FLFLAGS) &&
+		      (oa->o_flags & OBD_FL_SHRINK_GRANT);
 
-        if (rc != 0) {
-                __osc_update_grant(cli, oa->o_grant);
-                GOTO(out, rc);
-        }
+	if (rc != 0) {
+		/* a grant-only request did not give any grant away */
+		if (shrink)
+			__osc_update_grant(cli, oa->o_grant);
+		GOTO(out, rc);
+	}
 
-        body = req_capsule_server_get(&req->rq_pill, &RMF_OST_BODY);
-        LASSERT(body);
-        osc_update_grant(cli, body);
+	body = req_capsule_server_get(&req->rq_pill, &RMF_OST_BODY);
+	LASSERT(body);
+	osc_update_grant(cli, body);
 out:
-        OBDO_FREE(oa);
-        return rc;
+	if (!shrink) {
+		spin_lock(&cli->cl_loi_list_lock);
+		cli->cl_grant_req_pending = 0;
+		spin_unlock(&cli->cl_loi_list_lock);
+	}
+	OBDO_FREE(oa);
+	return rc;
 }
 
 static void osc_shrink_grant_local(struct client_obd *cli, struct obdo *oa)
@@ -845,6 +958,58 @@ int osc_shrink_grant_to_target(struct client_obd *cli, __u64 target_bytes)
         RETURN(rc);
 }
 
+/**
+ * Ask the OST for grant ahead of a forecast burst of writes, run from
+ * ptlrpcd when osc_grant_prefetch_check() found grant running short.
+ *
+ * The request reuses the KEY_GRANT_SHRINK set_info RPC, with
+ * OBD_FL_GRANT_HINT instead of OBD_FL_SHRINK_GRANT.
+ */
+static int osc_grant_work(const struct lu_env *env, void *data)
+{
+	struct client_obd *cli = data;
+	struct ost_body *body;
+	int rc;
+
+	ENTRY;
+
+	OBD_ALLOC_PTR(body);
+	if (body == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	/* announce the page about to be written so that the hint is set */
+	osc_announce_cached(cli, &body->oa, PAGE_SIZE);
+	if (!(body->oa.o_valid & OBD_MD_FLFLAGS) ||
+	    !(body->oa.o_flags & OBD_FL_GRANT_HINT)) {
+		/* grant came back in the meantime */
+		GOTO(out_free, rc = 0);
+	}
+
+	CDEBUG(D_CACHE, "%s: asking for grant ahead, avail %llu undirty %u\n",
+	       cli_name(cli), body->oa.o_grant, body->oa.o_undirty);
+
+	rc = osc_set_info_async(env, cli->cl_import->imp_obd->obd_self_export,
+				sizeof(KEY_GRANT_SHRINK), KEY_GRANT_SHRINK,
+				sizeof(*body), body, NULL);
+	if (rc == 0) {
+		OBD_FREE_PTR(body);
+		/* osc_shrink_grant_interpret() clears the pending flag */
+		RETURN(0);
+	}
+out_free:
+	/* the grant dropped by osc_announce_cached() was not reported to the
+	 * OST, leave it to the next RPC */
+	spin_lock(&cli->cl_loi_list_lock);
+	cli->cl_lost_grant += body->oa.o_dropped;
+	spin_unlock(&cli->cl_loi_list_lock);
+	OBD_FREE_PTR(body);
+out:
+	spin_lock(&cli->cl_loi_list_lock);
+	cli->cl_grant_req_pending = 0;
+	spin_unlock(&cli->cl_loi_list_lock);
+	RETURN(rc);
+}
+
 static int osc_should_shrink_grant(struct client_obd *client)
 {
 	time64_t next_shrink = client->cl_next_shrink_grant;
@@ -1035,8 +1200,28 @@ static int check_write_rcs(struct ptlrpc_request *req,
         return (0);
 }
 
+static inline bool osc_brw_same_obj(struct brw_page *p1, struct brw_page *p2)
+{
+	return brw_page2oap(p1)->oap_obj == brw_page2oap(p2)->oap_obj;
+}
+
+/* index past the last page of the object that pga[start] belongs to */
+static u32 osc_brw_obj_end(struct brw_page **pga, u32 start, u32 page_count)
+{
+	u32 end = start + 1;
+
+	while (end < page_count && osc_brw_same_obj(pga[start], pga[end]))
+		end++;
+
+	return end;
+}
+
 static inline int can_merge_pages(struct brw_page *p1, struct brw_page *p2)
 {
+	/* a multi-object write has separate niobufs for each object */
+	if (!osc_brw_same_obj(p1, p2))
+		return 0;
+
         if (p1->flag != p2->flag) {
 		unsigned mask = ~(OBD_BRW_FROM_GRANT | OBD_BRW_NOCACHE |
 				  OBD_BRW_SYNC       | OBD_BRW_ASYNC   |
@@ -1123,6 +1308,9 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
         struct osc_brw_async_args *aa;
         struct req_capsule      *pill;
         struct brw_page *pg_prev;
+	u32 objcount = 1;
+	u32 obj_start = 0;
+	u32 obj_end;
 
         ENTRY;
         if (OBD_FAIL_CHECK(OBD_FAIL_OSC_BRW_PREP_REQ))
@@ -1145,11 +1333,14 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
         for (niocount = i = 1; i < page_count; i++) {
                 if (!can_merge_pages(pga[i - 1], pga[i]))
                         niocount++;
+		if (!osc_brw_same_obj(pga[i - 1], pga[i]))
+			objcount++;
         }
+	LASSERT(objcount == 1 || opc == OST_WRITE);
 
         pill = &req->rq_pill;
         req_capsule_set_size(pill, &RMF_OBD_IOOBJ, RCL_CLIENT,
-                             sizeof(*ioobj));
+                             objcount * sizeof(*ioobj));
         req_capsule_set_size(pill, &RMF_NIOBUF_REMOTE, RCL_CLIENT,
                              niocount * sizeof(*niobuf));
 
@@ -1184,7 +1375,7 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
 	lustre_set_wire_obdo(&req->rq_import->imp_connect_data, &body->oa, oa);
 
 	obdo_to_ioobj(oa, ioobj);
-	ioobj->ioo_bufcnt = niocount;
+	ioobj->ioo_bufcnt = 0;
 	/* The high bits of ioo_max_brw tells server _maximum_ number of bulks
 	 * that might be send for this request.  The actual number is decided
 	 * when the RPC is finally sent in ptlrpc_register_bulk(). It sends
@@ -1193,20 +1384,31 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
 	ioobj_max_brw_set(ioobj, desc->bd_md_max_brw);
 	LASSERT(page_count > 0);
 	pg_prev = pga[0];
+	obj_end = osc_brw_obj_end(pga, 0, page_count);
         for (requested_nob = i = 0; i < page_count; i++, niobuf++) {
                 struct brw_page *pg = pga[i];
 		int poff = pg->off & ~PAGE_MASK;
 
+		if (i == obj_end) {
+			/* pages of the next object in a multi-object write */
+			ioobj++;
+			ioobj->ioo_oid = brw_page2oap(pg)->oap_obj->oo_oinfo->loi_oi;
+			ioobj->ioo_max_brw = 0;
+			ioobj->ioo_bufcnt = 0;
+			obj_start = i;
+			obj_end = osc_brw_obj_end(pga, i, page_count);
+		}
+
                 LASSERT(pg->count > 0);
                 /* make sure there is no gap in the middle of page array */
-		LASSERTF(page_count == 1 ||
-			 (ergo(i == 0, poff + pg->count == PAGE_SIZE) &&
-			  ergo(i > 0 && i < page_count - 1,
+		LASSERTF(obj_end - obj_start == 1 ||
+			 (ergo(i == obj_start, poff + pg->count == PAGE_SIZE) &&
+			  ergo(i > obj_start && i < obj_end - 1,
 			       poff == 0 && pg->count == PAGE_SIZE)   &&
-			  ergo(i == page_count - 1, poff == 0)),
+			  ergo(i == obj_end - 1, poff == 0)),
 			 "i: %d/%d pg: %p off: %llu, count: %u\n",
 			 i, page_count, pg, pg->off, pg->count);
-                LASSERTF(i == 0 || pg->off > pg_prev->off,
+                LASSERTF(i == obj_start || pg->off > pg_prev->off,
 			 "i %d p_c %u pg %p [pri %lu ind %lu] off %llu"
 			 " prev_pg %p [pri %lu ind %lu] off %llu\n",
                          i, page_count,
@@ -1226,9 +1428,11 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
 			niobuf->rnb_offset = pg->off;
 			niobuf->rnb_len    = pg->count;
 			niobuf->rnb_flags  = pg->flag;
+			ioobj->ioo_bufcnt++;
                 }
                 pg_prev = pg;
         }
+	LASSERT(obj_end == page_count);
 
         LASSERTF((void *)(niobuf - niocount) ==
                 req_capsule_client_get(&req->rq_pill, &RMF_NIOBUF_REMOTE),
@@ -1278,6 +1482,9 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
                 /* 1 RC per niobuf */
                 req_capsule_set_size(pill, &RMF_RCS, RCL_SERVER,
                                      sizeof(__u32) * niocount);
+		/* attributes of every object but the first one */
+		req_capsule_set_size(pill, &RMF_OST_BRW_ATTRS, RCL_SERVER,
+				     sizeof(struct obdo) * (objcount - 1));
         } else {
                 if (cli->cl_checksum &&
                     !sptlrpc_flavor_has_bulk(&req->rq_flvr)) {
@@ -1307,9 +1514,10 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
 
 	*reqp = req;
 	niobuf = req_capsule_client_get(pill, &RMF_NIOBUF_REMOTE);
-	CDEBUG(D_RPCTRACE, "brw rpc %p - object "DOSTID" offset %lld<>%lld\n",
-		req, POSTID(&oa->o_oi), niobuf[0].rnb_offset,
-		niobuf[niocount - 1].rnb_offset + niobuf[niocount - 1].rnb_len);
+	CDEBUG(D_RPCTRACE, "brw rpc %p - object "DOSTID" offset %lld<>%lld, "
+	       "%u objects\n", req, POSTID(&oa->o_oi), niobuf[0].rnb_offset,
+	       niobuf[niocount - 1].rnb_offset + niobuf[niocount - 1].rnb_len,
+	       objcount);
         RETURN(0);
 
  out:
@@ -1703,6 +1911,57 @@ static void osc_release_ppga(struct brw_page **ppga, size_t count)
         OBD_FREE(ppga, sizeof(*ppga) * count);
 }
 
+/* update the attributes of the object written up to page \a last */
+static void osc_brw_update_attr(const struct lu_env *env,
+				struct ptlrpc_request *req,
+				struct osc_async_page *last, struct obdo *oa)
+{
+	struct cl_attr *attr = &osc_env_info(env)->oti_attr;
+	struct cl_object *obj = osc2cl(last->oap_obj);
+	unsigned long valid = 0;
+
+	cl_object_attr_lock(obj);
+	if (oa != NULL && oa->o_valid & OBD_MD_FLBLOCKS) {
+		attr->cat_blocks = oa->o_blocks;
+		valid |= CAT_BLOCKS;
+	}
+	if (oa != NULL && oa->o_valid & OBD_MD_FLMTIME) {
+		attr->cat_mtime = oa->o_mtime;
+		valid |= CAT_MTIME;
+	}
+	if (oa != NULL && oa->o_valid & OBD_MD_FLATIME) {
+		attr->cat_atime = oa->o_atime;
+		valid |= CAT_ATIME;
+	}
+	if (oa != NULL && oa->o_valid & OBD_MD_FLCTIME) {
+		attr->cat_ctime = oa->o_ctime;
+		valid |= CAT_CTIME;
+	}
+
+	if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE) {
+		struct lov_oinfo *loi = cl2osc(obj)->oo_oinfo;
+		loff_t last_off = last->oap_count + last->oap_obj_off +
+			last->oap_page_off;
+
+		/* Change file size if this is an out of quota or
+		 * direct IO write and it extends the file size */
+		if (loi->loi_lvb.lvb_size < last_off) {
+			attr->cat_size = last_off;
+			valid |= CAT_SIZE;
+		}
+		/* Extend KMS if it's not a lockless write */
+		if (loi->loi_kms < last_off &&
+		    oap2osc_page(last)->ops_srvlock == 0) {
+			attr->cat_kms = last_off;
+			valid |= CAT_KMS;
+		}
+	}
+
+	if (valid != 0)
+		cl_object_attr_update(env, obj, attr, valid);
+	cl_object_attr_unlock(obj);
+}
+
 static int brw_interpret(const struct lu_env *env,
                          struct ptlrpc_request *req, void *data, int rc)
 {
@@ -1741,54 +2000,39 @@ static int brw_interpret(const struct lu_env *env,
 
 	if (rc == 0) {
 		struct obdo *oa = aa->aa_oa;
-		struct cl_attr *attr = &osc_env_info(env)->oti_attr;
-		unsigned long valid = 0;
-		struct cl_object *obj;
-		struct osc_async_page *last;
-
-		last = brw_page2oap(aa->aa_ppga[aa->aa_page_count - 1]);
-		obj = osc2cl(last->oap_obj);
-
-		cl_object_attr_lock(obj);
-		if (oa->o_valid & OBD_MD_FLBLOCKS) {
-			attr->cat_blocks = oa->o_blocks;
-			valid |= CAT_BLOCKS;
-		}
-		if (oa->o_valid & OBD_MD_FLMTIME) {
-			attr->cat_mtime = oa->o_mtime;
-			valid |= CAT_MTIME;
-		}
-		if (oa->o_valid & OBD_MD_FLATIME) {
-			attr->cat_atime = oa->o_atime;
-			valid |= CAT_ATIME;
-		}
-		if (oa->o_valid & OBD_MD_FLCTIME) {
-			attr->cat_ctime = oa->o_ctime;
-			valid |= CAT_CTIME;
-		}
+		struct obdo *attrs = NULL;
+		u32 nattrs = 0;
+		u32 i = 0;
 
 		if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE) {
-			struct lov_oinfo *loi = cl2osc(obj)->oo_oinfo;
-			loff_t last_off = last->oap_count + last->oap_obj_off +
-				last->oap_page_off;
-
-			/* Change file size if this is an out of quota or
-			 * direct IO write and it extends the file size */
-			if (loi->loi_lvb.lvb_size < last_off) {
-				attr->cat_size = last_off;
-				valid |= CAT_SIZE;
-			}
-			/* Extend KMS if it's not a lockless write */
-			if (loi->loi_kms < last_off &&
-			    oap2osc_page(last)->ops_srvlock == 0) {
-				attr->cat_kms = last_off;
-				valid |= CAT_KMS;
-			}
+			nattrs = req_capsule_get_size(&req->rq_pill,
+						      &RMF_OST_BRW_ATTRS,
+						      RCL_SERVER) /
+				 sizeof(*attrs);
+			if (nattrs > 0)
+				attrs = req_capsule_server_sized_get(
+						&req->rq_pill,
+						&RMF_OST_BRW_ATTRS,
+						nattrs * sizeof(*attrs));
+			if (attrs == NULL)
+				nattrs = 0;
 		}
 
-		if (valid != 0)
-			cl_object_attr_update(env, obj, attr, valid);
-		cl_object_attr_unlock(obj);
+		/* every object of a multi-object write ends its own run of
+		 * pages, the reply obdo describes the first one and
+		 * RMF_OST_BRW_ATTRS the others in the same order */
+		while (i < aa->aa_page_count) {
+			i = osc_brw_obj_end(aa->aa_ppga, i, aa->aa_page_count);
+			osc_brw_update_attr(env, req,
+					    brw_page2oap(aa->aa_ppga[i - 1]),
+					    oa);
+			if (nattrs > 0) {
+				oa = attrs++;
+				nattrs--;
+			} else {
+				oa = NULL;
+			}
+		}
 	}
 	OBDO_FREE(aa->aa_oa);
 
@@ -1841,7 +2085,8 @@ static void brw_commit(struct ptlrpc_request *req)
 /**
  * Build an RPC by the list of extent @ext_list. The caller must ensure
  * that the total pages in this list are NOT over max pages per RPC.
- * Extents in the list must be in OES_RPC state.
+ * Extents in the list must be in OES_RPC state. A write list may carry the
+ * extents of several objects, which must be kept together per object.
  */
 int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 		  struct list_head *ext_list, int cmd)
@@ -1853,15 +2098,19 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	struct obdo			*oa = NULL;
 	struct osc_async_page		*oap;
 	struct osc_object		*obj = NULL;
+	struct osc_object		*prev = NULL;
 	struct cl_req_attr		*crattr = NULL;
 	loff_t				starting_offset = OBD_OBJECT_EOF;
 	loff_t				ending_offset = 0;
+	loff_t				rpc_offset = OBD_OBJECT_EOF;
 	int				mpflag = 0;
 	int				mem_tight = 0;
 	int				page_count = 0;
 	bool				soft_sync = false;
 	bool				interrupted = false;
 	int				i;
+	int				start = 0;
+	int				objcount = 0;
 	int				grant = 0;
 	int				rc;
 	struct list_head		rpc_list = LIST_HEAD_INIT(rpc_list);
@@ -1893,6 +2142,17 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 
 	i = 0;
 	list_for_each_entry(ext, ext_list, oe_link) {
+		/* the extents of each object are kept together, and the pages
+		 * of each object are checked and sorted on their own */
+		if (ext->oe_obj != prev) {
+			if (prev != NULL)
+				sort_brw_pages(pga + start, i - start);
+			prev = ext->oe_obj;
+			starting_offset = OBD_OBJECT_EOF;
+			ending_offset = 0;
+			start = i;
+			objcount++;
+		}
 		list_for_each_entry(oap, &ext->oe_pages, oap_pending_item) {
 			if (mem_tight)
 				oap->oap_brw_flags |= OBD_BRW_MEMALLOC;
@@ -1917,7 +2177,10 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 			if (oap->oap_interrupted)
 				interrupted = true;
 		}
+		if (objcount == 1)
+			rpc_offset = starting_offset;
 	}
+	sort_brw_pages(pga + start, i - start);
 
 	/* first page in the list */
 	oap = list_entry(rpc_list.next, typeof(*oap), oap_rpc_item);
@@ -1933,7 +2196,6 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	if (cmd == OBD_BRW_WRITE)
 		oa->o_grant_used = grant;
 
-	sort_brw_pages(pga, page_count);
 	rc = osc_brw_prep_request(cmd, cli, oa, page_count, pga, &req, 0);
 	if (rc != 0) {
 		CERROR("prep_req failed: %d\n", rc);
@@ -1965,8 +2227,16 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	INIT_LIST_HEAD(&aa->aa_exts);
 	list_splice_init(ext_list, &aa->aa_exts);
 
+	if (objcount > 1) {
+		struct osc_stats *stats;
+
+		stats = &lu2osc_dev(osc2cl(obj)->co_lu.lo_dev)->od_stats;
+		stats->os_multiobj_rpcs++;
+		stats->os_multiobj_objs += objcount;
+	}
+
 	spin_lock(&cli->cl_loi_list_lock);
-	starting_offset >>= PAGE_SHIFT;
+	starting_offset = rpc_offset >> PAGE_SHIFT;
 	if (cmd == OBD_BRW_READ) {
 		cli->cl_r_in_flight++;
 		lprocfs_oh_tally_log2(&cli->cl_read_page_hist, page_count);
@@ -2860,11 +3130,18 @@ int osc_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
 		GOTO(out_ptlrpcd_work, rc = PTR_ERR(handler));
 	cli->cl_lru_work = handler;
 
+	handler = ptlrpcd_alloc_work(cli->cl_import, osc_grant_work, cli);
+	if (IS_ERR(handler))
+		GOTO(out_ptlrpcd_work, rc = PTR_ERR(handler));
+	cli->cl_grant_work = handler;
+
 	rc = osc_quota_setup(obd);
 	if (rc)
 		GOTO(out_ptlrpcd_work, rc);
 
 	cli->cl_grant_shrink_interval = GRANT_SHRINK_INTERVAL;
+	cli->cl_grant_horizon_ms = OSC_GRANT_HORIZON_MS;
+	cli->cl_grant_rate_stamp = ktime_get();
 
 #ifdef CONFIG_PROC_FS
 	obd->obd_vars = lprocfs_osc_obd_vars;
@@ -2930,6 +3207,10 @@ out_ptlrpcd_work:
 		ptlrpcd_destroy_work(cli->cl_lru_work);
 		cli->cl_lru_work = NULL;
 	}
+	if (cli->cl_grant_work != NULL) {
+		ptlrpcd_destroy_work(cli->cl_grant_work);
+		cli->cl_grant_work = NULL;
+	}
 out_client_setup:
 	client_obd_cleanup(obd);
 out_ptlrpcd:
@@ -2962,6 +3243,11 @@ static int osc_precleanup(struct obd_device *obd)
 		cli->cl_lru_work = NULL;
 	}
 
+	if (cli->cl_grant_work) {
+		ptlrpcd_destroy_work(cli->cl_grant_work);
+		cli->cl_grant_work = NULL;
+	}
+
 	obd_cleanup_client_import(obd);
 	ptlrpc_lprocfs_unregister_obd(obd);
 	lprocfs_obd_cleanup(obd);
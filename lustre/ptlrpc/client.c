@@ -2425,6 +2425,27 @@ int ptlrpc_set_wait(struct ptlrpc_request_set *set)
 }
 EXPORT_SYMBOL(ptlrpc_set_wait);
 
+/**
+ * Unlink \a req from the replay list or committed list of \a imp,
+ * whichever it is on.
+ * Must be called under imp_lock.
+ */
+static void ptlrpc_replay_list_del(struct obd_import *imp,
+				   struct ptlrpc_request *req)
+{
+	if (list_empty(&req->rq_replay_list))
+		return;
+
+	if (!RB_EMPTY_NODE(&req->rq_replay_node)) {
+		rb_erase(&req->rq_replay_node, &imp->imp_replay_tree);
+		RB_CLEAR_NODE(&req->rq_replay_node);
+		imp->imp_replay_list_len--;
+	} else {
+		imp->imp_committed_list_len--;
+	}
+	list_del_init(&req->rq_replay_list);
+}
+
 /**
  * Helper fuction for request freeing.
  * Called when request count reached zero and request needs to be freed.
@@ -2454,7 +2475,7 @@ static void __ptlrpc_free_req(struct ptlrpc_request *request, int locked)
 	if (request->rq_import != NULL) {
 		if (!locked)
 			spin_lock(&request->rq_import->imp_lock);
-		list_del_init(&request->rq_replay_list);
+		ptlrpc_replay_list_del(request->rq_import, request);
 		list_del_init(&request->rq_unreplied_list);
 		if (!locked)
 			spin_unlock(&request->rq_import->imp_lock);
@@ -2659,7 +2680,7 @@ static void ptlrpc_free_request(struct ptlrpc_request *req)
 
 	if (req->rq_commit_cb != NULL)
 		req->rq_commit_cb(req);
-	list_del_init(&req->rq_replay_list);
+	ptlrpc_replay_list_del(req->rq_import, req);
 
 	__ptlrpc_req_finished(req, 1);
 }
@@ -2724,6 +2745,7 @@ void ptlrpc_free_committed(struct obd_import *imp)
                 /* XXX ok to remove when 1357 resolved - rread 05/29/03  */
                 LASSERT(req != last_req);
                 last_req = req;
+		imp->imp_replay_walk++;
 
                 if (req->rq_transno == 0) {
                         DEBUG_REQ(D_EMERG, req, "zero transno during replay");
@@ -2742,8 +2764,10 @@ void ptlrpc_free_committed(struct obd_import *imp)
 
 		if (req->rq_replay) {
 			DEBUG_REQ(D_RPCTRACE, req, "keeping (FL_REPLAY)");
-			list_move_tail(&req->rq_replay_list,
-					   &imp->imp_committed_list);
+			ptlrpc_replay_list_del(imp, req);
+			list_add_tail(&req->rq_replay_list,
+				      &imp->imp_committed_list);
+			imp->imp_committed_list_len++;
 			continue;
 		}
 
@@ -2759,6 +2783,7 @@ free_req:
 	list_for_each_entry_safe(req, saved, &imp->imp_committed_list,
 				 rq_replay_list) {
 		LASSERT(req->rq_transno != 0);
+		imp->imp_replay_walk++;
 		if (req->rq_import_generation < imp->imp_generation ||
 		    !req->rq_replay) {
 			DEBUG_REQ(D_RPCTRACE, req, "free %s open request",
@@ -2836,6 +2861,34 @@ struct ptlrpc_request *ptlrpc_request_addref(struct ptlrpc_request *req)
 }
 EXPORT_SYMBOL(ptlrpc_request_addref);
 
+/**
+ * Find the first request on the replay list of \a imp with a transno
+ * above \a transno, or NULL if there is none.
+ * Must be called under imp_lock
+ */
+struct ptlrpc_request *ptlrpc_replay_tree_next(struct obd_import *imp,
+					      __u64 transno)
+{
+	struct rb_node		*node = imp->imp_replay_tree.rb_node;
+	struct ptlrpc_request	*iter;
+	struct ptlrpc_request	*req = NULL;
+
+	assert_spin_locked(&imp->imp_lock);
+
+	while (node != NULL) {
+		iter = rb_entry(node, struct ptlrpc_request, rq_replay_node);
+		imp->imp_replay_walk++;
+		if (iter->rq_transno > transno) {
+			req = iter;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
+		}
+	}
+
+	return req;
+}
+
 /**
  * Add a request to import replay_list.
  * Must be called under imp_lock
@@ -2843,7 +2896,9 @@ EXPORT_SYMBOL(ptlrpc_request_addref);
 void ptlrpc_retain_replayable_request(struct ptlrpc_request *req,
                                       struct obd_import *imp)
 {
-	struct list_head *tmp;
+	struct rb_node		**p = &imp->imp_replay_tree.rb_node;
+	struct rb_node		*parent = NULL;
+	struct ptlrpc_request	*iter;
 
 	assert_spin_locked(&imp->imp_lock);
 
@@ -2869,31 +2924,40 @@ void ptlrpc_retain_replayable_request(struct ptlrpc_request *req,
 	LASSERT(imp->imp_replayable);
 	/* Balanced in ptlrpc_free_committed, usually. */
 	ptlrpc_request_addref(req);
-	list_for_each_prev(tmp, &imp->imp_replay_list) {
-		struct ptlrpc_request *iter = list_entry(tmp,
-							 struct ptlrpc_request,
-							 rq_replay_list);
-
-                /* We may have duplicate transnos if we create and then
-                 * open a file, or for closes retained if to match creating
-                 * opens, so use req->rq_xid as a secondary key.
-                 * (See bugs 684, 685, and 428.)
-                 * XXX no longer needed, but all opens need transnos!
-                 */
-                if (iter->rq_transno > req->rq_transno)
-                        continue;
-
-                if (iter->rq_transno == req->rq_transno) {
-                        LASSERT(iter->rq_xid != req->rq_xid);
-                        if (iter->rq_xid > req->rq_xid)
-                                continue;
-                }
 
+	/* We may have duplicate transnos if we create and then
+	 * open a file, or for closes retained if to match creating
+	 * opens, so use req->rq_xid as a secondary key.
+	 * (See bugs 684, 685, and 428.)
+	 * XXX no longer needed, but all opens need transnos!
+	 */
+	while (*p != NULL) {
+		parent = *p;
+		iter = rb_entry(parent, struct ptlrpc_request, rq_replay_node);
+		imp->imp_replay_walk++;
+
+		if (req->rq_transno == iter->rq_transno)
+			LASSERT(iter->rq_xid != req->rq_xid);
+
+		if (req->rq_transno < iter->rq_transno ||
+		    (req->rq_transno == iter->rq_transno &&
+		     req->rq_xid < iter->rq_xid))
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+	rb_link_node(&req->rq_replay_node, parent, p);
+	rb_insert_color(&req->rq_replay_node, &imp->imp_replay_tree);
+	imp->imp_replay_list_len++;
+
+	/* keep imp_replay_list in the same order as the tree */
+	parent = rb_prev(&req->rq_replay_node);
+	if (parent != NULL) {
+		iter = rb_entry(parent, struct ptlrpc_request, rq_replay_node);
 		list_add(&req->rq_replay_list, &iter->rq_replay_list);
-		return;
+	} else {
+		list_add(&req->rq_replay_list, &imp->imp_replay_list);
 	}
-
-	list_add(&req->rq_replay_list, &imp->imp_replay_list);
 }
 
 /**
@@ -624,7 +624,8 @@ static const struct req_msg_field *ost_brw_read_server[] = {
 static const struct req_msg_field *ost_brw_write_server[] = {
         &RMF_PTLRPC_BODY,
         &RMF_OST_BODY,
-        &RMF_RCS
+	&RMF_RCS,
+	&RMF_OST_BRW_ATTRS
 };
 
 static const struct req_msg_field *ost_get_info_generic_server[] = {
@@ -1135,6 +1136,12 @@ struct req_msg_field RMF_RCS =
                     lustre_swab_generic_32s, dump_rcs);
 EXPORT_SYMBOL(RMF_RCS);
 
+/* attributes of the objects after the first one of a multi-object write */
+struct req_msg_field RMF_OST_BRW_ATTRS =
+	DEFINE_MSGF("ost_brw_attrs", RMF_F_STRUCT_ARRAY, sizeof(struct obdo),
+		    lustre_swab_obdo, dump_obdo);
+EXPORT_SYMBOL(RMF_OST_BRW_ATTRS);
+
 struct req_msg_field RMF_EAVALS_LENS =
 	DEFINE_MSGF("eavals_lens", RMF_F_STRUCT_ARRAY, sizeof(__u32),
 		lustre_swab_generic_32s, NULL);
@@ -187,6 +187,16 @@ const int ll_str2opcode(const char *ops)
 	return -EINVAL;
 }
 
+/* Returns the name of the opcode packed at \a offset by opcode_offset(),
+ * or NULL if there is no opcode there. */
+const char *ll_opcode_offset2str(unsigned int offset)
+{
+	if (offset >= LUSTRE_MAX_OPCODES)
+		return NULL;
+
+	return ll_rpc_opcode_table[offset].opname;
+}
+
 static const char *ll_eopcode2str(__u32 opcode)
 {
         LASSERT(ll_eopcode_table[opcode].opcode == opcode);
@@ -430,6 +440,39 @@ static ssize_t threads_max_store(struct kobject *kobj, struct attribute *attr,
 }
 LUSTRE_RW_ATTR(threads_max);
 
+static ssize_t threads_idle_timeout_show(struct kobject *kobj,
+					 struct attribute *attr, char *buf)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+
+	return sprintf(buf, "%d\n", svc->srv_thread_idle_timeout);
+}
+
+static ssize_t threads_idle_timeout_store(struct kobject *kobj,
+					  struct attribute *attr,
+					  const char *buffer, size_t count)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc < 0)
+		return rc;
+
+	if (val > INT_MAX / HZ)
+		return -ERANGE;
+
+	spin_lock(&svc->srv_lock);
+	svc->srv_thread_idle_timeout = val;
+	spin_unlock(&svc->srv_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(threads_idle_timeout);
+
 /**
  * Translates \e ptlrpc_nrs_pol_state values to human-readable strings.
  *
@@ -1100,6 +1143,7 @@ static struct attribute *ptlrpc_svc_attrs[] = {
 	&lustre_attr_threads_min.attr,
 	&lustre_attr_threads_started.attr,
 	&lustre_attr_threads_max.attr,
+	&lustre_attr_threads_idle_timeout.attr,
 	&lustre_attr_high_priority_ratio.attr,
 	NULL,
 };
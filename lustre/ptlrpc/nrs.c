@@ -1665,6 +1665,33 @@ bool ptlrpc_nrs_req_throttling_nolock(struct ptlrpc_service_part *svcpt,
 	return !!nrs->nrs_throttling;
 };
 
+/**
+ * Tells the policy request \a req is queued on that the request is about to
+ * miss its deadline, so that the policy can serve it sooner. This is a no-op
+ * if the request is not queued, has already been started, or if the policy
+ * does not implement ptlrpc_nrs_pol_ops::op_req_late().
+ *
+ * \param[in] req the late request
+ *
+ * \see ptlrpc_at_check_timed()
+ */
+void ptlrpc_nrs_req_late(struct ptlrpc_request *req)
+{
+	struct ptlrpc_service_part	*svcpt = req->rq_rqbd->rqbd_svcpt;
+	struct ptlrpc_nrs_request	*nrq = &req->rq_nrq;
+	struct ptlrpc_nrs_policy	*policy;
+
+	spin_lock(&svcpt->scp_req_lock);
+
+	if (nrq->nr_enqueued && !nrq->nr_started) {
+		policy = nrs_request_policy(nrq);
+		if (policy->pol_desc->pd_ops->op_req_late != NULL)
+			policy->pol_desc->pd_ops->op_req_late(policy, nrq);
+	}
+
+	spin_unlock(&svcpt->scp_req_lock);
+}
+
 /**
  * Moves request \a req from the regular to the high-priority NRS head.
  *
@@ -1815,6 +1842,10 @@ int ptlrpc_nrs_init(void)
 	rc = ptlrpc_nrs_policy_register(&nrs_conf_delay);
 	if (rc != 0)
 		GOTO(fail, rc);
+
+	rc = ptlrpc_nrs_policy_register(&nrs_conf_edf);
+	if (rc != 0)
+		GOTO(fail, rc);
 #endif /* HAVE_SERVER_SUPPORT */
 
 	RETURN(rc);
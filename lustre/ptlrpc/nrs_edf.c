@@ -0,0 +1,649 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License version 2 for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * lustre/ptlrpc/nrs_edf.c
+ *
+ * Network Request Scheduler (NRS) Earliest Deadline First (EDF) policy
+ *
+ * This policy serves requests in the order of the deadline the client has
+ * given the server to handle them in, so that requests which are about to
+ * expire are not starved by a stream of fresh ones.
+ */
+/**
+ * \addtogoup nrs
+ * @{
+ */
+
+#define DEBUG_SUBSYSTEM S_RPC
+#include <obd_support.h>
+#include <obd_class.h>
+#include "ptlrpc_internal.h"
+
+/**
+ * \name edf
+ *
+ * The EDF policy orders requests by their adaptive timeout deadline,
+ * ptlrpc_request::rq_deadline, as it stands when the request is enqueued.
+ *
+ * Each opcode can be given a weight, in percent of the time between the
+ * arrival of a request and its deadline. A weight below 100 makes requests
+ * with that opcode look as if they were due earlier, and so be served ahead
+ * of other requests with the same deadline; a weight above 100 does the
+ * opposite. Requests with equal weighted deadlines are served in arrival
+ * order.
+ *
+ * When ptlrpc_at_check_timed() finds a queued request close to its real
+ * deadline, the request is marked late and moved ahead of all requests which
+ * are not late, instead of only being sent an early reply.
+ *
+ * @{
+ */
+
+#define NRS_POL_NAME_EDF	"edf"
+
+/* Default weight of an opcode, in percent. */
+#define NRS_EDF_WEIGHT_DEFAULT	100
+/* Weights are bounded by these values. */
+#define NRS_EDF_WEIGHT_MIN	1
+#define NRS_EDF_WEIGHT_MAX	1000
+
+/**
+ * Binary heap predicate.
+ *
+ * Late requests come before all requests which are not late; requests are
+ * then ordered by their weighted deadline, and finally by their sequence
+ * number, i.e. in arrival order.
+ *
+ * \retval 0 e1 is to be served after e2
+ * \retval 1 e1 is to be served before e2
+ */
+static int edf_req_compare(struct cfs_binheap_node *e1,
+			   struct cfs_binheap_node *e2)
+{
+	struct ptlrpc_nrs_request *nrq1;
+	struct ptlrpc_nrs_request *nrq2;
+
+	nrq1 = container_of(e1, struct ptlrpc_nrs_request, nr_node);
+	nrq2 = container_of(e2, struct ptlrpc_nrs_request, nr_node);
+
+	if (nrq1->nr_u.edf.er_late != nrq2->nr_u.edf.er_late)
+		return nrq1->nr_u.edf.er_late;
+
+	if (ktime_before(nrq1->nr_u.edf.er_deadline,
+			 nrq2->nr_u.edf.er_deadline))
+		return 1;
+	else if (ktime_after(nrq1->nr_u.edf.er_deadline,
+			     nrq2->nr_u.edf.er_deadline))
+		return 0;
+
+	return nrq1->nr_u.edf.er_sequence < nrq2->nr_u.edf.er_sequence;
+}
+
+static struct cfs_binheap_ops nrs_edf_heap_ops = {
+	.hop_enter	= NULL,
+	.hop_exit	= NULL,
+	.hop_compare	= edf_req_compare,
+};
+
+/**
+ * Is called before the policy transitions into
+ * ptlrpc_nrs_pol_state::NRS_POL_STATE_STARTED; allocates and initializes
+ * the EDF-specific private data structure.
+ *
+ * \param[in] policy The policy to start
+ * \param[in] arg    Generic char buffer; unused in this policy
+ *
+ * \retval -ENOMEM OOM error
+ * \retval  0	   success
+ *
+ * \see nrs_policy_register()
+ * \see nrs_policy_ctl()
+ */
+static int nrs_edf_start(struct ptlrpc_nrs_policy *policy, char *arg)
+{
+	struct nrs_edf_data *edf_data;
+	int i;
+
+	ENTRY;
+
+	OBD_CPT_ALLOC_PTR(edf_data, nrs_pol2cptab(policy),
+			  nrs_pol2cptid(policy));
+	if (edf_data == NULL)
+		RETURN(-ENOMEM);
+
+	edf_data->edf_binheap = cfs_binheap_create(&nrs_edf_heap_ops,
+						   CBH_FLAG_ATOMIC_GROW,
+						   4096, NULL,
+						   nrs_pol2cptab(policy),
+						   nrs_pol2cptid(policy));
+	if (edf_data->edf_binheap == NULL) {
+		OBD_FREE_PTR(edf_data);
+		RETURN(-ENOMEM);
+	}
+
+	for (i = 0; i < LUSTRE_MAX_OPCODES; i++)
+		edf_data->edf_weights[i] = NRS_EDF_WEIGHT_DEFAULT;
+
+	policy->pol_private = edf_data;
+
+	RETURN(0);
+}
+
+/**
+ * Is called before the policy transitions into
+ * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED; deallocates the EDF-specific
+ * private data structure.
+ *
+ * \param[in] policy The policy to stop
+ *
+ * \see nrs_policy_stop0()
+ */
+static void nrs_edf_stop(struct ptlrpc_nrs_policy *policy)
+{
+	struct nrs_edf_data *edf_data = policy->pol_private;
+
+	LASSERT(edf_data != NULL);
+	LASSERT(edf_data->edf_binheap != NULL);
+	LASSERT(cfs_binheap_is_empty(edf_data->edf_binheap));
+
+	cfs_binheap_destroy(edf_data->edf_binheap);
+
+	OBD_FREE_PTR(edf_data);
+}
+
+/**
+ * Is called for obtaining an EDF policy resource.
+ *
+ * \param[in]  policy	  The policy on which the request is being asked for
+ * \param[in]  nrq	  The request for which resources are being taken
+ * \param[in]  parent	  Parent resource, unused in this policy
+ * \param[out] resp	  Resources references are placed in this array
+ * \param[in]  moving_req Signifies limited caller context; unused in this
+ *			  policy
+ *
+ * \retval 1 The EDF policy only has a one-level resource hierarchy
+ *
+ * \see nrs_resource_get_safe()
+ */
+static int nrs_edf_res_get(struct ptlrpc_nrs_policy *policy,
+			   struct ptlrpc_nrs_request *nrq,
+			   const struct ptlrpc_nrs_resource *parent,
+			   struct ptlrpc_nrs_resource **resp, bool moving_req)
+{
+	*resp = &((struct nrs_edf_data *)policy->pol_private)->edf_res;
+	return 1;
+}
+
+/**
+ * Called when getting a request from the EDF policy for handling, or just
+ * peeking; removes the request from the policy when it is to be handled.
+ *
+ * \param[in] policy The policy
+ * \param[in] peek   When set, signifies that we just want to examine the
+ *		     request, and not handle it, so the request is not removed
+ *		     from the policy.
+ * \param[in] force  Force the policy to return a request; unused in this
+ *		     policy
+ *
+ * \retval The request to be handled; this is the request with the earliest
+ *	   weighted deadline
+ * \retval NULL no request available
+ *
+ * \see ptlrpc_nrs_req_get_nolock()
+ * \see nrs_request_get()
+ */
+static
+struct ptlrpc_nrs_request *nrs_edf_req_get(struct ptlrpc_nrs_policy *policy,
+					   bool peek, bool force)
+{
+	struct nrs_edf_data *edf_data = policy->pol_private;
+	struct cfs_binheap_node *node;
+	struct ptlrpc_nrs_request *nrq;
+
+	node = cfs_binheap_root(edf_data->edf_binheap);
+	if (unlikely(node == NULL))
+		return NULL;
+
+	nrq = container_of(node, struct ptlrpc_nrs_request, nr_node);
+	if (likely(!peek))
+		cfs_binheap_remove(edf_data->edf_binheap, &nrq->nr_node);
+
+	return nrq;
+}
+
+/**
+ * Adds request \a nrq to an EDF \a policy instance's set of queued requests.
+ *
+ * The weighted deadline of the request is its arrival time plus the time the
+ * client has given the server to handle it, scaled by the weight of the
+ * request's opcode.  It is kept in nanoseconds: rq_deadline only has whole
+ * seconds, but the arrival time does not, so requests which arrived within
+ * the same second still get distinct weighted deadlines.
+ *
+ * \param[in] policy The policy
+ * \param[in] nrq    The request to add
+ *
+ * \retval 0 request added
+ * \retval != 0 error
+ */
+static int nrs_edf_req_add(struct ptlrpc_nrs_policy *policy,
+			   struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_edf_data *edf_data = policy->pol_private;
+	struct ptlrpc_request *req = container_of(nrq, struct ptlrpc_request,
+						  rq_nrq);
+	ktime_t arrival = timespec64_to_ktime(req->rq_arrival_time);
+	s64 slack = ktime_to_ns(ktime_sub(ktime_set(req->rq_deadline, 0),
+					  arrival));
+	unsigned int weight = NRS_EDF_WEIGHT_DEFAULT;
+	int offset;
+
+	offset = opcode_offset(lustre_msg_get_opc(req->rq_reqmsg));
+	if (offset >= 0 && offset < LUSTRE_MAX_OPCODES)
+		weight = edf_data->edf_weights[offset];
+
+	if (slack > 0 && weight != NRS_EDF_WEIGHT_DEFAULT)
+		slack = div_s64(slack * weight, NRS_EDF_WEIGHT_DEFAULT);
+
+	nrq->nr_u.edf.er_deadline = ktime_add(arrival, ns_to_ktime(slack));
+	nrq->nr_u.edf.er_sequence = edf_data->edf_sequence++;
+	nrq->nr_u.edf.er_late = 0;
+
+	return cfs_binheap_insert(edf_data->edf_binheap, &nrq->nr_node);
+}
+
+/**
+ * Removes request \a nrq from \a policy's list of queued requests.
+ *
+ * \param[in] policy The policy
+ * \param[in] nrq    The request to remove
+ */
+static void nrs_edf_req_del(struct ptlrpc_nrs_policy *policy,
+			    struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_edf_data *edf_data = policy->pol_private;
+
+	cfs_binheap_remove(edf_data->edf_binheap, &nrq->nr_node);
+}
+
+/**
+ * Moves request \a nrq, which is about to miss its deadline, ahead of all
+ * queued requests which are not late.
+ *
+ * \param[in] policy The policy
+ * \param[in] nrq    The late request
+ *
+ * \see ptlrpc_nrs_req_late()
+ */
+static void nrs_edf_req_late(struct ptlrpc_nrs_policy *policy,
+			     struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_edf_data *edf_data = policy->pol_private;
+	struct ptlrpc_request *req = container_of(nrq, struct ptlrpc_request,
+						  rq_nrq);
+
+	if (nrq->nr_u.edf.er_late)
+		return;
+
+	nrq->nr_u.edf.er_late = 1;
+	cfs_binheap_relocate(edf_data->edf_binheap, &nrq->nr_node);
+	edf_data->edf_late++;
+
+	DEBUG_REQ(D_RPCTRACE, req, "NRS: promoted late request, deadline in "
+		  "%llds", (s64)(req->rq_deadline - ktime_get_real_seconds()));
+}
+
+/**
+ * Prints a debug statement right before the request \a nrq stops being
+ * handled.
+ *
+ * \param[in] policy The policy handling the request
+ * \param[in] nrq    The request being handled
+ *
+ * \see ptlrpc_server_finish_request()
+ * \see ptlrpc_nrs_req_stop_nolock()
+ */
+static void nrs_edf_req_stop(struct ptlrpc_nrs_policy *policy,
+			     struct ptlrpc_nrs_request *nrq)
+{
+	struct ptlrpc_request *req = container_of(nrq, struct ptlrpc_request,
+						  rq_nrq);
+
+	DEBUG_REQ(D_RPCTRACE, req,
+		  "NRS: finished request with weighted deadline %lldns%s",
+		  ktime_to_ns(nrq->nr_u.edf.er_deadline),
+		  nrq->nr_u.edf.er_late ? " (late)" : "");
+}
+
+/**
+ * Performs ctl functions specific to EDF policy instances; similar to ioctl
+ *
+ * \param[in]     policy the policy instance
+ * \param[in]     opc    the opcode
+ * \param[in,out] arg    used for passing parameters and information
+ *
+ * \pre assert_spin_locked(&policy->pol_nrs->->nrs_lock)
+ * \post assert_spin_locked(&policy->pol_nrs->->nrs_lock)
+ *
+ * \retval 0   operation carried out successfully
+ * \retval -ve error
+ */
+static int nrs_edf_ctl(struct ptlrpc_nrs_policy *policy,
+		       enum ptlrpc_nrs_ctl opc, void *arg)
+{
+	struct nrs_edf_data *edf_data = policy->pol_private;
+
+	assert_spin_locked(&policy->pol_nrs->nrs_lock);
+
+	switch ((enum nrs_ctl_edf)opc) {
+	default:
+		RETURN(-EINVAL);
+
+	case NRS_CTL_EDF_RD_WEIGHTS: {
+		struct nrs_edf_weights_info *info = arg;
+
+		memcpy(info->ewi_weights, edf_data->edf_weights,
+		       sizeof(info->ewi_weights));
+		info->ewi_late = edf_data->edf_late;
+		break;
+	}
+	case NRS_CTL_EDF_WR_WEIGHT: {
+		struct nrs_edf_weight *w = arg;
+		int offset = opcode_offset(w->ew_opc);
+
+		if (offset < 0 || offset >= LUSTRE_MAX_OPCODES ||
+		    w->ew_weight < NRS_EDF_WEIGHT_MIN ||
+		    w->ew_weight > NRS_EDF_WEIGHT_MAX)
+			RETURN(-EINVAL);
+
+		edf_data->edf_weights[offset] = w->ew_weight;
+		break;
+	}
+	}
+	RETURN(0);
+}
+
+/**
+ * lprocfs interface
+ */
+
+#ifdef CONFIG_PROC_FS
+
+#define LPROCFS_NRS_EDF_WEIGHTS_NAME_REG	"reg_edf_weights:"
+#define LPROCFS_NRS_EDF_WEIGHTS_NAME_HP		"hp_edf_weights:"
+#define LPROCFS_NRS_EDF_LATE_NAME_REG		"reg_edf_late:"
+#define LPROCFS_NRS_EDF_LATE_NAME_HP		"hp_edf_late:"
+
+#define LPROCFS_WR_NRS_EDF_MAX_CMD		(1024)
+
+/**
+ * Prints the opcodes which have been given a weight other than the default,
+ * and the number of late requests, of the EDF policy instance on the NRS head
+ * \a queue of service \a svc.
+ */
+static int nrs_edf_weights_show_head(struct seq_file *m,
+				     struct ptlrpc_service *svc,
+				     enum ptlrpc_nrs_queue_type queue,
+				     struct nrs_edf_weights_info *info)
+{
+	bool hp = queue == PTLRPC_NRS_QUEUE_HP;
+	int rc;
+	int i;
+
+	rc = ptlrpc_nrs_policy_control(svc, queue, NRS_POL_NAME_EDF,
+				       NRS_CTL_EDF_RD_WEIGHTS, true, info);
+	if (rc != 0)
+		return rc;
+
+	seq_printf(m, "%s", hp ? LPROCFS_NRS_EDF_WEIGHTS_NAME_HP :
+				 LPROCFS_NRS_EDF_WEIGHTS_NAME_REG);
+	for (i = 0; i < LUSTRE_MAX_OPCODES; i++) {
+		const char *name = ll_opcode_offset2str(i);
+
+		if (info->ewi_weights[i] == NRS_EDF_WEIGHT_DEFAULT ||
+		    name == NULL)
+			continue;
+
+		seq_printf(m, " %s=%u", name, info->ewi_weights[i]);
+	}
+	seq_printf(m, "\n%s%llu\n", hp ? LPROCFS_NRS_EDF_LATE_NAME_HP :
+					 LPROCFS_NRS_EDF_LATE_NAME_REG,
+		   info->ewi_late);
+
+	return 0;
+}
+
+/**
+ * Retrieves the opcode weights and late request counters of EDF policy
+ * instances on both the regular and high-priority NRS head of a service, as
+ * long as a policy instance is not in the
+ * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state.
+ *
+ * Only opcodes with a weight other than the default of 100 are listed, e.g.:
+ *
+ * reg_edf_weights: ost_write=200 ost_punch=50
+ * reg_edf_late:3
+ * hp_edf_weights:
+ * hp_edf_late:0
+ */
+static int
+ptlrpc_lprocfs_nrs_edf_weights_seq_show(struct seq_file *m, void *data)
+{
+	struct ptlrpc_service *svc = m->private;
+	struct nrs_edf_weights_info *info;
+	int rc;
+
+	OBD_ALLOC_PTR(info);
+	if (info == NULL)
+		return -ENOMEM;
+
+	rc = nrs_edf_weights_show_head(m, svc, PTLRPC_NRS_QUEUE_REG, info);
+	/**
+	 * Ignore -ENODEV as the regular NRS head's policy may be in
+	 * the ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state.
+	 */
+	if (rc != 0 && rc != -ENODEV)
+		GOTO(out, rc);
+
+	if (!nrs_svc_has_hp(svc))
+		GOTO(out, rc = 0);
+
+	rc = nrs_edf_weights_show_head(m, svc, PTLRPC_NRS_QUEUE_HP, info);
+	if (rc == -ENODEV)
+		rc = 0;
+out:
+	OBD_FREE_PTR(info);
+
+	return rc;
+}
+
+/**
+ * Sets the weight of one or more opcodes for EDF policy instances of a
+ * service. The weights apply to both the regular and high-priority NRS heads,
+ * unless the list is prefixed by "reg" or "hp". A weight of 100 restores the
+ * default, unweighted, behaviour.
+ *
+ * For example:
+ *
+ * lctl set_param ost.OSS.ost_io.nrs_edf_weights="ost_write=200", to let
+ * writes wait twice as long as other requests with the same timeout, and
+ *
+ * lctl set_param ldlm.services.ldlm_canceld.nrs_edf_weights=\
+ *	"reg ldlm_cancel=50 ldlm_bl_callback=50"
+ * to serve lock cancels on the regular NRS head at half their deadline.
+ */
+static ssize_t
+ptlrpc_lprocfs_nrs_edf_weights_seq_write(struct file *file,
+					 const char __user *buffer,
+					 size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct ptlrpc_service *svc = m->private;
+	enum ptlrpc_nrs_queue_type queue = PTLRPC_NRS_QUEUE_BOTH;
+	struct nrs_edf_weight w;
+	char *kernbuf;
+	char *val;
+	char *token;
+	char *name;
+	int opc;
+	int rc = 0;
+	int rc2;
+
+	if (count > LPROCFS_WR_NRS_EDF_MAX_CMD - 1)
+		return -EINVAL;
+
+	OBD_ALLOC(kernbuf, LPROCFS_WR_NRS_EDF_MAX_CMD);
+	if (kernbuf == NULL)
+		return -ENOMEM;
+
+	if (copy_from_user(kernbuf, buffer, count))
+		GOTO(out, rc = -EFAULT);
+
+	val = strim(kernbuf);
+	if (strncmp(val, "reg ", 4) == 0) {
+		queue = PTLRPC_NRS_QUEUE_REG;
+		val += 4;
+	} else if (strncmp(val, "hp ", 3) == 0) {
+		queue = PTLRPC_NRS_QUEUE_HP;
+		val += 3;
+	}
+
+	if (queue == PTLRPC_NRS_QUEUE_HP && !nrs_svc_has_hp(svc))
+		GOTO(out, rc = -ENODEV);
+	else if (queue == PTLRPC_NRS_QUEUE_BOTH && !nrs_svc_has_hp(svc))
+		queue = PTLRPC_NRS_QUEUE_REG;
+
+	while ((token = strsep(&val, " \t\n")) != NULL) {
+		if (*token == '\0')
+			continue;
+
+		name = strsep(&token, "=");
+		if (token == NULL)
+			GOTO(out, rc = -EINVAL);
+
+		opc = ll_str2opcode(name);
+		if (opc < 0)
+			GOTO(out, rc = -EINVAL);
+
+		w.ew_opc = opc;
+		rc = kstrtouint(token, 10, &w.ew_weight);
+		if (rc != 0)
+			GOTO(out, rc = -EINVAL);
+
+		if (w.ew_weight < NRS_EDF_WEIGHT_MIN ||
+		    w.ew_weight > NRS_EDF_WEIGHT_MAX)
+			GOTO(out, rc = -EINVAL);
+
+		/**
+		 * Set the weight on the regular and HP NRS heads separately,
+		 * and only fail with -ENODEV if the policy is stopped on all
+		 * heads that have been specified, like the ORR policy does.
+		 */
+		rc = -ENODEV;
+		if (queue & PTLRPC_NRS_QUEUE_REG) {
+			rc = ptlrpc_nrs_policy_control(svc,
+						       PTLRPC_NRS_QUEUE_REG,
+						       NRS_POL_NAME_EDF,
+						       NRS_CTL_EDF_WR_WEIGHT,
+						       false, &w);
+			if (rc != 0 && rc != -ENODEV)
+				GOTO(out, rc);
+		}
+
+		if (queue & PTLRPC_NRS_QUEUE_HP) {
+			rc2 = ptlrpc_nrs_policy_control(svc,
+							PTLRPC_NRS_QUEUE_HP,
+							NRS_POL_NAME_EDF,
+							NRS_CTL_EDF_WR_WEIGHT,
+							false, &w);
+			if (rc2 != 0 && rc2 != -ENODEV)
+				GOTO(out, rc = rc2);
+			if (rc2 == 0)
+				rc = 0;
+		}
+
+		if (rc != 0)
+			GOTO(out, rc);
+	}
+out:
+	OBD_FREE(kernbuf, LPROCFS_WR_NRS_EDF_MAX_CMD);
+
+	return rc == 0 ? count : rc;
+}
+LPROC_SEQ_FOPS(ptlrpc_lprocfs_nrs_edf_weights);
+
+static int nrs_edf_lprocfs_init(struct ptlrpc_service *svc)
+{
+	struct lprocfs_vars nrs_edf_lprocfs_vars[] = {
+		{ .name		= "nrs_edf_weights",
+		  .fops		= &ptlrpc_lprocfs_nrs_edf_weights_fops,
+		  .data		= svc },
+		{ NULL }
+	};
+
+	if (svc->srv_procroot == NULL)
+		return 0;
+
+	return lprocfs_add_vars(svc->srv_procroot, nrs_edf_lprocfs_vars,
+				NULL);
+}
+
+static void nrs_edf_lprocfs_fini(struct ptlrpc_service *svc)
+{
+	if (svc->srv_procroot == NULL)
+		return;
+
+	lprocfs_remove_proc_entry("nrs_edf_weights", svc->srv_procroot);
+}
+
+#endif /* CONFIG_PROC_FS */
+
+/**
+ * EDF policy operations
+ */
+static const struct ptlrpc_nrs_pol_ops nrs_edf_ops = {
+	.op_policy_start	= nrs_edf_start,
+	.op_policy_stop		= nrs_edf_stop,
+	.op_policy_ctl		= nrs_edf_ctl,
+	.op_res_get		= nrs_edf_res_get,
+	.op_req_get		= nrs_edf_req_get,
+	.op_req_enqueue		= nrs_edf_req_add,
+	.op_req_dequeue		= nrs_edf_req_del,
+	.op_req_stop		= nrs_edf_req_stop,
+	.op_req_late		= nrs_edf_req_late,
+#ifdef CONFIG_PROC_FS
+	.op_lprocfs_init	= nrs_edf_lprocfs_init,
+	.op_lprocfs_fini	= nrs_edf_lprocfs_fini,
+#endif
+};
+
+/**
+ * EDF policy configuration
+ */
+struct ptlrpc_nrs_pol_conf nrs_conf_edf = {
+	.nc_name		= NRS_POL_NAME_EDF,
+	.nc_ops			= &nrs_edf_ops,
+	.nc_compat		= nrs_policy_compat_all,
+};
+
+/** @} edf */
+
+/** @} nrs */
@@ -682,6 +682,7 @@ static int nrs_orr_start(struct ptlrpc_nrs_policy *policy, char *arg)
 	orrd->od_quantum = NRS_ORR_QUANTUM_DFLT;
 	orrd->od_supp = NOS_DFLT;
 	orrd->od_physical = true;
+	INIT_LIST_HEAD(&orrd->od_run);
 	/**
 	 * Set to 1 so that the test inside nrs_orr_req_add() can evaluate to
 	 * true.
@@ -721,6 +722,7 @@ static void nrs_orr_stop(struct ptlrpc_nrs_policy *policy)
 	LASSERT(orrd->od_obj_hash != NULL);
 	LASSERT(orrd->od_cache != NULL);
 	LASSERT(cfs_binheap_is_empty(orrd->od_binheap));
+	LASSERT(list_empty(&orrd->od_run));
 
 	cfs_binheap_destroy(orrd->od_binheap);
 	cfs_hash_putref(orrd->od_obj_hash);
@@ -795,6 +797,28 @@ static int nrs_orr_ctl(struct ptlrpc_nrs_policy *policy,
 		LASSERT((orrd->od_supp & NOS_OST_RW) != 0);
 		}
 		break;
+
+	case NRS_CTL_ORR_RD_COALESCE: {
+		struct nrs_orr_data		*orrd = policy->pol_private;
+		struct nrs_orr_coalesce_info	*info = arg;
+
+		info->oci_max = orrd->od_coalesce;
+		info->oci_coalesced = orrd->od_nr_coalesced;
+		}
+		break;
+
+	case NRS_CTL_ORR_WR_COALESCE: {
+		struct nrs_orr_data	*orrd = policy->pol_private;
+
+		/* A TRR object is a whole OST, whose requests are for many
+		 * backend-fs objects */
+		if (strncmp(policy->pol_desc->pd_name, NRS_POL_NAME_TRR,
+			    NRS_POL_NAME_MAX) == 0)
+			RETURN(-EOPNOTSUPP);
+
+		orrd->od_coalesce = *(__u16 *)arg;
+		}
+		break;
 	}
 	RETURN(0);
 }
@@ -877,6 +901,7 @@ static int nrs_orr_res_get(struct ptlrpc_nrs_policy *policy,
 
 	orro->oo_key = key;
 	orro->oo_ref = 1;
+	orro->oo_tree = RB_ROOT;
 
 	tmp = cfs_hash_findadd_unique(orrd->od_obj_hash, &orro->oo_key,
 				      &orro->oo_hnode);
@@ -920,11 +945,134 @@ static void nrs_orr_res_put(struct ptlrpc_nrs_policy *policy,
 	cfs_hash_put(orrd->od_obj_hash, &orro->oo_hnode);
 }
 
+/**
+ * Adds request \a nrq to the offset-sorted tree of its object; requests
+ * which start at the same offset are kept in arrival order.
+ */
+static void nrs_orr_tree_add(struct nrs_orr_object *orro,
+			     struct ptlrpc_nrs_request *nrq)
+{
+	struct rb_node		  **p = &orro->oo_tree.rb_node;
+	struct rb_node		   *parent = NULL;
+	struct ptlrpc_nrs_request  *iter;
+	__u64			    start = nrq->nr_u.orr.or_range.or_start;
+
+	while (*p != NULL) {
+		parent = *p;
+		iter = rb_entry(parent, struct ptlrpc_nrs_request,
+				nr_u.orr.or_node);
+		if (start < iter->nr_u.orr.or_range.or_start)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+
+	rb_link_node(&nrq->nr_u.orr.or_node, parent, p);
+	rb_insert_color(&nrq->nr_u.orr.or_node, &orro->oo_tree);
+}
+
+/**
+ * Finds the first queued request of object \a orro which starts at offset
+ * \a start, or NULL if there is none.
+ */
+static struct ptlrpc_nrs_request *
+nrs_orr_tree_find(struct nrs_orr_object *orro, __u64 start)
+{
+	struct rb_node		   *node = orro->oo_tree.rb_node;
+	struct ptlrpc_nrs_request  *iter;
+	struct ptlrpc_nrs_request  *nrq = NULL;
+
+	while (node != NULL) {
+		iter = rb_entry(node, struct ptlrpc_nrs_request,
+				nr_u.orr.or_node);
+		if (iter->nr_u.orr.or_range.or_start < start) {
+			node = node->rb_right;
+		} else {
+			if (iter->nr_u.orr.or_range.or_start == start)
+				nrq = iter;
+			node = node->rb_left;
+		}
+	}
+
+	return nrq;
+}
+
+/**
+ * Pulls the queued requests of the same object which directly follow
+ * request \a nrq, just dequeued from the binary heap, into the run of
+ * requests to be served next, in ascending offset order. Requests are pulled
+ * regardless of the client that sent them and of the round they have been
+ * scheduled against, so that the backend-fs sees a sequential stream of I/O
+ * instead of interleaved strided requests. Only ORR policy instances
+ * coalesce, as the requests of a TRR object are for many backend-fs objects.
+ *
+ * \param[in] orrd the ORR policy scheduler instance
+ * \param[in] orro the object of \a nrq
+ * \param[in] nrq  the request which has just been dequeued
+ */
+static void nrs_orr_coalesce(struct nrs_orr_data *orrd,
+			     struct nrs_orr_object *orro,
+			     struct ptlrpc_nrs_request *nrq)
+{
+	struct ptlrpc_request	  *req;
+	struct ptlrpc_nrs_request *prev = nrq;
+	struct ptlrpc_nrs_request *next;
+	struct rb_node		  *node;
+	__u32			   opc;
+	int			   i;
+
+	req = container_of(nrq, struct ptlrpc_request, rq_nrq);
+	opc = lustre_msg_get_opc(req->rq_reqmsg);
+
+	for (i = 1; i < orrd->od_coalesce; i++) {
+		next = nrs_orr_tree_find(orro,
+					 prev->nr_u.orr.or_range.or_end + 1);
+
+		/* Skip the requests of another kind at the same offset */
+		while (next != NULL) {
+			req = container_of(next, struct ptlrpc_request, rq_nrq);
+			if (lustre_msg_get_opc(req->rq_reqmsg) == opc &&
+			    next->nr_u.orr.or_physical_set ==
+			    nrq->nr_u.orr.or_physical_set)
+				break;
+
+			node = rb_next(&next->nr_u.orr.or_node);
+			next = node == NULL ? NULL :
+			       rb_entry(node, struct ptlrpc_nrs_request,
+					nr_u.orr.or_node);
+			if (next != NULL &&
+			    next->nr_u.orr.or_range.or_start !=
+			    prev->nr_u.orr.or_range.or_end + 1)
+				next = NULL;
+		}
+
+		if (next == NULL)
+			break;
+
+		cfs_binheap_remove(orrd->od_binheap, &next->nr_node);
+		rb_erase(&next->nr_u.orr.or_node, &orro->oo_tree);
+		list_add_tail(&next->nr_u.orr.or_list, &orrd->od_run);
+		next->nr_u.orr.or_coalesced = 1;
+		orrd->od_nr_coalesced++;
+
+		CDEBUG(D_RPCTRACE, "NRS: %s coalesced "DFID" %llu-%llu after "
+		       DFID" %llu-%llu\n", NRS_POL_NAME_ORR,
+		       PFID(&next->nr_u.orr.or_key.ok_fid),
+		       next->nr_u.orr.or_range.or_start,
+		       next->nr_u.orr.or_range.or_end,
+		       PFID(&prev->nr_u.orr.or_key.ok_fid),
+		       prev->nr_u.orr.or_range.or_start,
+		       prev->nr_u.orr.or_range.or_end);
+		prev = next;
+	}
+}
+
 /**
  * Called when polling an ORR/TRR policy instance for a request so that it can
- * be served. Returns the request that is at the root of the binary heap, as
- * that is the lowest priority one (i.e. libcfs_heap is an implementation of a
- * min-heap)
+ * be served. Returns the first request of the run of coalesced requests if
+ * there is one, otherwise the request that is at the root of the binary heap,
+ * as that is the lowest priority one (i.e. libcfs_heap is an implementation of
+ * a min-heap)
  *
  * \param[in] policy the policy instance being polled
  * \param[in] peek   when set, signifies that we just want to examine the
@@ -943,9 +1091,25 @@ struct ptlrpc_nrs_request *nrs_orr_req_get(struct ptlrpc_nrs_policy *policy,
 					   bool peek, bool force)
 {
 	struct nrs_orr_data	  *orrd = policy->pol_private;
-	struct cfs_binheap_node	  *node = cfs_binheap_root(orrd->od_binheap);
+	struct cfs_binheap_node	  *node;
 	struct ptlrpc_nrs_request *nrq;
 
+	if (!list_empty(&orrd->od_run)) {
+		nrq = list_entry(orrd->od_run.next, struct ptlrpc_nrs_request,
+				 nr_u.orr.or_list);
+		if (!peek) {
+			struct nrs_orr_object *orro;
+
+			orro = container_of(nrs_request_resource(nrq),
+					    struct nrs_orr_object, oo_res);
+			list_del_init(&nrq->nr_u.orr.or_list);
+			nrq->nr_u.orr.or_coalesced = 0;
+			orro->oo_active--;
+		}
+		return nrq;
+	}
+
+	node = cfs_binheap_root(orrd->od_binheap);
 	nrq = unlikely(node == NULL) ? NULL :
 	      container_of(node, struct ptlrpc_nrs_request, nr_node);
 
@@ -958,8 +1122,12 @@ struct ptlrpc_nrs_request *nrs_orr_req_get(struct ptlrpc_nrs_policy *policy,
 		LASSERT(nrq->nr_u.orr.or_round <= orro->oo_round);
 
 		cfs_binheap_remove(orrd->od_binheap, &nrq->nr_node);
+		rb_erase(&nrq->nr_u.orr.or_node, &orro->oo_tree);
 		orro->oo_active--;
 
+		if (orrd->od_coalesce > 1)
+			nrs_orr_coalesce(orrd, orro, nrq);
+
 		if (strncmp(policy->pol_desc->pd_name, NRS_POL_NAME_ORR,
 				 NRS_POL_NAME_MAX) == 0)
 			CDEBUG(D_RPCTRACE,
@@ -1079,6 +1247,8 @@ static int nrs_orr_req_add(struct ptlrpc_nrs_policy *policy,
 
 	rc = cfs_binheap_insert(orrd->od_binheap, &nrq->nr_node);
 	if (rc == 0) {
+		nrq->nr_u.orr.or_coalesced = 0;
+		nrs_orr_tree_add(orro, nrq);
 		orro->oo_active++;
 		if (--orro->oo_quantum == 0)
 			orro->oo_round++;
@@ -1107,10 +1277,20 @@ static void nrs_orr_req_del(struct ptlrpc_nrs_policy *policy,
 
 	LASSERT(nrq->nr_u.orr.or_round <= orro->oo_round);
 
+	orro->oo_active--;
+
+	/** The request has already left the binary heap */
+	if (nrq->nr_u.orr.or_coalesced) {
+		list_del_init(&nrq->nr_u.orr.or_list);
+		nrq->nr_u.orr.or_coalesced = 0;
+		return;
+	}
+
+	rb_erase(&nrq->nr_u.orr.or_node, &orro->oo_tree);
+
 	is_root = &nrq->nr_node == cfs_binheap_root(orrd->od_binheap);
 
 	cfs_binheap_remove(orrd->od_binheap, &nrq->nr_node);
-	orro->oo_active--;
 
 	/**
 	 * If we just deleted the node at the root of the binheap, we may have
@@ -1859,6 +2039,163 @@ ptlrpc_lprocfs_nrs_orr_supported_seq_write(struct file *file,
 }
 LPROC_SEQ_FOPS(ptlrpc_lprocfs_nrs_orr_supported);
 
+#define LPROCFS_NRS_COALESCE_NAME_REG		"reg_coalesce:"
+#define LPROCFS_NRS_COALESCE_NAME_HP		"hp_coalesce:"
+#define LPROCFS_NRS_COALESCE_MAX		256
+#define LPROCFS_NRS_WR_COALESCE_MAX_CMD					       \
+	sizeof(LPROCFS_NRS_COALESCE_NAME_REG "65535 "			       \
+	       LPROCFS_NRS_COALESCE_NAME_HP "65535")
+
+/**
+ * Retrieves the maximum number of adjacent requests on the same object that
+ * ORR policy instances dispatch as one run, and the number of requests that
+ * have been pulled into such runs, for the regular and high-priority NRS
+ * heads of a service.
+ *
+ * For example:
+ *
+ *	reg_coalesce:16
+ *	reg_coalesced:1024
+ *	hp_coalesce:0
+ *	hp_coalesced:0
+ */
+static int
+ptlrpc_lprocfs_nrs_orr_coalesce_seq_show(struct seq_file *m, void *data)
+{
+	struct nrs_lprocfs_orr_data	*orr_data = m->private;
+	struct ptlrpc_service		*svc = orr_data->svc;
+	struct nrs_orr_coalesce_info	 info;
+	int				 rc;
+
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
+				       orr_data->name,
+				       NRS_CTL_ORR_RD_COALESCE,
+				       true, &info);
+	if (rc == 0) {
+		seq_printf(m, LPROCFS_NRS_COALESCE_NAME_REG "%u\n"
+			   "reg_coalesced:%llu\n", info.oci_max,
+			   info.oci_coalesced);
+	} else if (rc != -ENODEV) {
+		return rc;
+	}
+
+	if (!nrs_svc_has_hp(svc))
+		goto no_hp;
+
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
+				       orr_data->name,
+				       NRS_CTL_ORR_RD_COALESCE,
+				       true, &info);
+	if (rc == 0) {
+		seq_printf(m, LPROCFS_NRS_COALESCE_NAME_HP "%u\n"
+			   "hp_coalesced:%llu\n", info.oci_max,
+			   info.oci_coalesced);
+	} else if (rc != -ENODEV) {
+		return rc;
+	}
+
+no_hp:
+
+	return rc;
+}
+
+/**
+ * Sets the maximum number of adjacent requests on the same object that ORR
+ * policy instances dispatch as one run; 0 disables coalescing. The value can
+ * be set for the regular and high priority NRS heads separately, or for both
+ * together.
+ *
+ * For example:
+ *
+ * lctl set_param ost.OSS.ost_io.nrs_orr_coalesce=reg_coalesce:16
+ * lctl set_param ost.OSS.ost_io.nrs_orr_coalesce=0
+ */
+static ssize_t
+ptlrpc_lprocfs_nrs_orr_coalesce_seq_write(struct file *file,
+					  const char __user *buffer,
+					  size_t count, loff_t *off)
+{
+	struct seq_file		    *m = file->private_data;
+	struct nrs_lprocfs_orr_data *orr_data = m->private;
+	struct ptlrpc_service	    *svc = orr_data->svc;
+	enum ptlrpc_nrs_queue_type   queue = 0;
+	char			     kernbuf[LPROCFS_NRS_WR_COALESCE_MAX_CMD];
+	char			    *val;
+	long			     coalesce_reg = 0;
+	long			     coalesce_hp = 0;
+	__u16			     coalesce;
+	size_t			     count_copy;
+	int			     rc = 0;
+	int			     rc2 = 0;
+
+	if (count > (sizeof(kernbuf) - 1))
+		return -EINVAL;
+
+	if (copy_from_user(kernbuf, buffer, count))
+		return -EFAULT;
+
+	kernbuf[count] = '\0';
+
+	count_copy = count;
+	val = lprocfs_find_named_value(kernbuf, LPROCFS_NRS_COALESCE_NAME_REG,
+				       &count_copy);
+	if (val != kernbuf) {
+		coalesce_reg = simple_strtol(val, NULL, 10);
+		queue |= PTLRPC_NRS_QUEUE_REG;
+	}
+
+	count_copy = count;
+	val = lprocfs_find_named_value(kernbuf, LPROCFS_NRS_COALESCE_NAME_HP,
+				       &count_copy);
+	if (val != kernbuf) {
+		if (!nrs_svc_has_hp(svc))
+			return -ENODEV;
+
+		coalesce_hp = simple_strtol(val, NULL, 10);
+		queue |= PTLRPC_NRS_QUEUE_HP;
+	}
+
+	if (queue == 0) {
+		if (!isdigit(kernbuf[0]))
+			return -EINVAL;
+
+		coalesce_reg = simple_strtol(kernbuf, NULL, 10);
+		coalesce_hp = coalesce_reg;
+		queue = PTLRPC_NRS_QUEUE_REG;
+		if (nrs_svc_has_hp(svc))
+			queue |= PTLRPC_NRS_QUEUE_HP;
+	}
+
+	if (coalesce_reg < 0 || coalesce_reg > LPROCFS_NRS_COALESCE_MAX ||
+	    coalesce_hp < 0 || coalesce_hp > LPROCFS_NRS_COALESCE_MAX)
+		return -EINVAL;
+
+	if ((queue & PTLRPC_NRS_QUEUE_REG) != 0) {
+		coalesce = coalesce_reg;
+		rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
+					       orr_data->name,
+					       NRS_CTL_ORR_WR_COALESCE, false,
+					       &coalesce);
+		if ((rc < 0 && rc != -ENODEV) ||
+		    (rc == -ENODEV && queue == PTLRPC_NRS_QUEUE_REG))
+			return rc;
+	}
+
+	if ((queue & PTLRPC_NRS_QUEUE_HP) != 0) {
+		coalesce = coalesce_hp;
+		rc2 = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
+						orr_data->name,
+						NRS_CTL_ORR_WR_COALESCE, false,
+						&coalesce);
+		if ((rc2 < 0 && rc2 != -ENODEV) ||
+		    (rc2 == -ENODEV && queue == PTLRPC_NRS_QUEUE_HP))
+			return rc2;
+	}
+
+	return rc == -ENODEV && rc2 == -ENODEV ? -ENODEV : count;
+}
+LPROC_SEQ_FOPS(ptlrpc_lprocfs_nrs_orr_coalesce);
+
 static int nrs_orr_lprocfs_init(struct ptlrpc_service *svc)
 {
 	int	i;
@@ -1870,6 +2207,8 @@ static int nrs_orr_lprocfs_init(struct ptlrpc_service *svc)
 		  .fops		= &ptlrpc_lprocfs_nrs_orr_offset_type_fops },
 		{ .name		= "nrs_orr_supported",
 		  .fops		= &ptlrpc_lprocfs_nrs_orr_supported_fops },
+		{ .name		= "nrs_orr_coalesce",
+		  .fops		= &ptlrpc_lprocfs_nrs_orr_coalesce_fops },
 		{ NULL }
 	};
 
@@ -1892,6 +2231,7 @@ static void nrs_orr_lprocfs_fini(struct ptlrpc_service *svc)
 	lprocfs_remove_proc_entry("nrs_orr_quantum", svc->srv_procroot);
 	lprocfs_remove_proc_entry("nrs_orr_offset_type", svc->srv_procroot);
 	lprocfs_remove_proc_entry("nrs_orr_supported", svc->srv_procroot);
+	lprocfs_remove_proc_entry("nrs_orr_coalesce", svc->srv_procroot);
 }
 
 #endif /* CONFIG_PROC_FS */
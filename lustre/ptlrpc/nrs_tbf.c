@@ -66,6 +66,11 @@ static int tbf_depth = 3;
 module_param(tbf_depth, int, 0644);
 MODULE_PARM_DESC(tbf_depth, "How many tokens that a client can save up");
 
+static int tbf_timer_wheel;
+module_param(tbf_timer_wheel, int, 0644);
+MODULE_PARM_DESC(tbf_timer_wheel, "Schedule TBF classes with a timer wheel "
+		 "instead of a binary heap, from the next policy start");
+
 static enum hrtimer_restart nrs_tbf_timer_cb(struct hrtimer *timer)
 {
 	struct nrs_tbf_head *head = container_of(timer, struct nrs_tbf_head,
@@ -79,16 +84,271 @@ static enum hrtimer_restart nrs_tbf_timer_cb(struct hrtimer *timer)
 	return HRTIMER_NORESTART;
 }
 
+static inline __u64 nrs_tbf_wheel_tick(__u64 nsecs)
+{
+	return (nsecs + (1ULL << NRS_TBF_WHEEL_SHIFT) - 1) >>
+	       NRS_TBF_WHEEL_SHIFT;
+}
+
+static void nrs_tbf_wheel_init(struct nrs_tbf_wheel *wheel)
+{
+	int i;
+	int j;
+
+	wheel->tw_time = ktime_to_ns(ktime_get()) >> NRS_TBF_WHEEL_SHIFT;
+	INIT_LIST_HEAD(&wheel->tw_ready);
+	for (i = 0; i < NRS_TBF_WHEEL_LEVELS; i++)
+		for (j = 0; j < NRS_TBF_WHEEL_SIZE; j++)
+			INIT_LIST_HEAD(&wheel->tw_slots[i][j]);
+}
+
+/**
+ * Adds class \a cli to the timer wheel, to expire at tick \a expire. A
+ * class which has already expired goes straight to the ready list.
+ */
+static void nrs_tbf_wheel_add(struct nrs_tbf_wheel *wheel,
+			      struct nrs_tbf_client *cli, __u64 expire)
+{
+	__u64 delta;
+	int level = 0;
+	int idx;
+
+	if (expire < wheel->tw_time) {
+		list_add_tail(&cli->tc_wheel, &wheel->tw_ready);
+		cli->tc_wheel_slot = NRS_TBF_WHEEL_READY;
+		cli->tc_wheel_expire = expire;
+		return;
+	}
+
+	delta = expire - wheel->tw_time;
+	while (level < NRS_TBF_WHEEL_LEVELS - 1 &&
+	       delta >= 1ULL << (NRS_TBF_WHEEL_BITS * (level + 1)))
+		level++;
+
+	/* Beyond the range of the wheel; the class will be re-added when
+	 * it comes out of the last slot */
+	if (delta >= 1ULL << (NRS_TBF_WHEEL_BITS * NRS_TBF_WHEEL_LEVELS))
+		expire = wheel->tw_time +
+			 (1ULL << (NRS_TBF_WHEEL_BITS * NRS_TBF_WHEEL_LEVELS)) - 1;
+
+	idx = (expire >> (NRS_TBF_WHEEL_BITS * level)) & NRS_TBF_WHEEL_MASK;
+	list_add_tail(&cli->tc_wheel, &wheel->tw_slots[level][idx]);
+	wheel->tw_pending[level] |= 1ULL << idx;
+	wheel->tw_count++;
+	cli->tc_wheel_slot = level * NRS_TBF_WHEEL_SIZE + idx;
+	cli->tc_wheel_expire = expire;
+}
+
+static void nrs_tbf_wheel_del(struct nrs_tbf_wheel *wheel,
+			      struct nrs_tbf_client *cli)
+{
+	int level = cli->tc_wheel_slot / NRS_TBF_WHEEL_SIZE;
+	int idx = cli->tc_wheel_slot % NRS_TBF_WHEEL_SIZE;
+
+	list_del_init(&cli->tc_wheel);
+	if (cli->tc_wheel_slot == NRS_TBF_WHEEL_READY)
+		return;
+
+	if (list_empty(&wheel->tw_slots[level][idx]))
+		wheel->tw_pending[level] &= ~(1ULL << idx);
+	wheel->tw_count--;
+}
+
+/**
+ * Moves the classes of the current slot of \a level down the wheel.
+ *
+ * \retval the index of the slot which has been cascaded
+ */
+static int nrs_tbf_wheel_cascade(struct nrs_tbf_wheel *wheel, int level)
+{
+	struct nrs_tbf_client *cli;
+	struct nrs_tbf_client *tmp;
+	struct list_head list;
+	int idx;
+
+	idx = (wheel->tw_time >> (NRS_TBF_WHEEL_BITS * level)) &
+	      NRS_TBF_WHEEL_MASK;
+	if (list_empty(&wheel->tw_slots[level][idx]))
+		return idx;
+
+	INIT_LIST_HEAD(&list);
+	list_splice_init(&wheel->tw_slots[level][idx], &list);
+	wheel->tw_pending[level] &= ~(1ULL << idx);
+	list_for_each_entry_safe(cli, tmp, &list, tc_wheel) {
+		list_del_init(&cli->tc_wheel);
+		wheel->tw_count--;
+		nrs_tbf_wheel_add(wheel, cli, cli->tc_wheel_expire);
+	}
+
+	return idx;
+}
+
+/**
+ * Turns the wheel up to tick \a now, moving the classes which expire on the
+ * way to the ready list. Runs of empty slots of the first level are skipped
+ * using its bitmap.
+ */
+static void nrs_tbf_wheel_advance(struct nrs_tbf_wheel *wheel, __u64 now)
+{
+	while (wheel->tw_time <= now) {
+		int idx = wheel->tw_time & NRS_TBF_WHEEL_MASK;
+		struct list_head *slot = &wheel->tw_slots[0][idx];
+		struct nrs_tbf_client *cli;
+		__u64 rest;
+		int level;
+		int step;
+
+		if (wheel->tw_count == 0) {
+			wheel->tw_time = now + 1;
+			break;
+		}
+
+		if (idx == 0) {
+			for (level = 1; level < NRS_TBF_WHEEL_LEVELS; level++)
+				if (nrs_tbf_wheel_cascade(wheel, level) != 0)
+					break;
+		}
+
+		if (!list_empty(slot)) {
+			list_for_each_entry(cli, slot, tc_wheel) {
+				cli->tc_wheel_slot = NRS_TBF_WHEEL_READY;
+				wheel->tw_count--;
+			}
+			list_splice_tail_init(slot, &wheel->tw_ready);
+			wheel->tw_pending[0] &= ~(1ULL << idx);
+		}
+
+		rest = idx == NRS_TBF_WHEEL_MASK ? 0 :
+		       wheel->tw_pending[0] >> (idx + 1);
+		step = rest != 0 ? __ffs64(rest) + 1 : NRS_TBF_WHEEL_SIZE - idx;
+		wheel->tw_time = min(wheel->tw_time + step, now + 1);
+	}
+}
+
+/**
+ * Returns the earliest tick at which a class in the slots of the wheel may
+ * become ready, or 0 if the slots are empty. For slots above the first
+ * level this is the tick at which the slot is cascaded.
+ *
+ * \param[in]  wheel the timer wheel
+ * \param[out] first the earliest non-empty slot
+ */
+static __u64 nrs_tbf_wheel_next(struct nrs_tbf_wheel *wheel,
+				struct list_head **first)
+{
+	__u64 next = 0;
+	int level;
+
+	for (level = 0; level < NRS_TBF_WHEEL_LEVELS; level++) {
+		int shift = NRS_TBF_WHEEL_BITS * level;
+		__u64 pending = wheel->tw_pending[level];
+		__u64 base = wheel->tw_time >> shift;
+		__u64 hi;
+		__u64 tick;
+		int cur = base & NRS_TBF_WHEEL_MASK;
+		int n;
+
+		if (pending == 0)
+			continue;
+
+		/* The current slot of an upper level has been cascaded
+		 * already, unless the wheel is right at its start */
+		if (level > 0 &&
+		    (wheel->tw_time & ((1ULL << shift) - 1)) != 0)
+			hi = cur == NRS_TBF_WHEEL_MASK ? 0 :
+			     pending >> (cur + 1) << (cur + 1);
+		else
+			hi = pending >> cur << cur;
+
+		n = hi != 0 ? __ffs64(hi) :
+		    __ffs64(pending) + NRS_TBF_WHEEL_SIZE;
+		tick = ((base & ~(__u64)NRS_TBF_WHEEL_MASK) + n) << shift;
+		if (next == 0 || tick < next) {
+			next = tick;
+			*first = &wheel->tw_slots[level][n & NRS_TBF_WHEEL_MASK];
+		}
+	}
+
+	return next;
+}
+
+/**
+ * Returns the tick by which class \a cli has a token. A class which has
+ * saved up tokens is ready right away.
+ */
+static __u64 nrs_tbf_cli_expire(struct nrs_tbf_client *cli)
+{
+	if (cli->tc_ntoken > 0)
+		return 0;
+
+	return nrs_tbf_wheel_tick(cli->tc_check_time + cli->tc_nsecs);
+}
+
+/**
+ * Starts scheduling class \a cli, by the time of its next token.
+ */
+static int nrs_tbf_sched_add(struct nrs_tbf_head *head,
+			     struct nrs_tbf_client *cli)
+{
+	int rc = 0;
+
+	if (head->th_wheel != NULL)
+		nrs_tbf_wheel_add(head->th_wheel, cli,
+				  nrs_tbf_cli_expire(cli));
+	else
+		rc = cfs_binheap_insert(head->th_binheap, &cli->tc_node);
+
+	if (rc == 0) {
+		cli->tc_in_heap = true;
+		head->th_nr_active++;
+	}
+	return rc;
+}
+
+static void nrs_tbf_sched_del(struct nrs_tbf_head *head,
+			      struct nrs_tbf_client *cli)
+{
+	if (head->th_wheel != NULL)
+		nrs_tbf_wheel_del(head->th_wheel, cli);
+	else
+		cfs_binheap_remove(head->th_binheap, &cli->tc_node);
+
+	cli->tc_in_heap = false;
+	head->th_nr_active--;
+}
+
+/**
+ * Called whenever the time of the next token of class \a cli changes.
+ */
+static void nrs_tbf_sched_relocate(struct nrs_tbf_head *head,
+				   struct nrs_tbf_client *cli)
+{
+	if (head->th_wheel != NULL) {
+		nrs_tbf_wheel_del(head->th_wheel, cli);
+		nrs_tbf_wheel_add(head->th_wheel, cli,
+				  nrs_tbf_cli_expire(cli));
+	} else {
+		cfs_binheap_relocate(head->th_binheap, &cli->tc_node);
+	}
+}
+
 #define NRS_TBF_DEFAULT_RULE "default"
 
+static void nrs_tbf_rule_put(struct nrs_tbf_rule *rule);
+
 static void nrs_tbf_rule_fini(struct nrs_tbf_rule *rule)
 {
+	struct nrs_tbf_rule *parent = rule->tr_parent;
+
 	LASSERT(atomic_read(&rule->tr_ref) == 0);
 	LASSERT(list_empty(&rule->tr_cli_list));
 	LASSERT(list_empty(&rule->tr_linkage));
 
 	rule->tr_head->th_ops->o_rule_fini(rule);
 	OBD_FREE_PTR(rule);
+
+	if (parent != NULL)
+		nrs_tbf_rule_put(parent);
 }
 
 /**
@@ -139,8 +399,7 @@ nrs_tbf_cli_reset_value(struct nrs_tbf_head *head,
 	cli->tc_rule_generation = rule->tr_generation;
 
 	if (cli->tc_in_heap)
-		cfs_binheap_relocate(head->th_binheap,
-				     &cli->tc_node);
+		nrs_tbf_sched_relocate(head, cli);
 }
 
 static void
@@ -167,7 +426,21 @@ nrs_tbf_cli_reset(struct nrs_tbf_head *head,
 static int
 nrs_tbf_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	return rule->tr_head->th_ops->o_rule_dump(rule, m);
+	int rc;
+
+	rc = rule->tr_head->th_ops->o_rule_dump(rule, m);
+	if (rc != 0)
+		return rc;
+
+	/* Flat rules keep their single line of output */
+	if (rule->tr_parent == NULL && atomic_read(&rule->tr_nr_children) == 0)
+		return 0;
+
+	seq_printf(m, "  level %u, parent %s, tokens %lld, served %llu, "
+		   "borrowed %llu\n", rule->tr_level,
+		   rule->tr_parent != NULL ? rule->tr_parent->tr_name : "none",
+		   rule->tr_ntoken, rule->tr_nr_served, rule->tr_nr_borrowed);
+	return 0;
 }
 
 static int
@@ -259,6 +532,8 @@ nrs_tbf_cli_init(struct nrs_tbf_head *head,
 	head->th_ops->o_cli_init(cli, req);
 	INIT_LIST_HEAD(&cli->tc_list);
 	INIT_LIST_HEAD(&cli->tc_linkage);
+	INIT_LIST_HEAD(&cli->tc_wheel);
+	atomic_inc(&head->th_nr_classes);
 	spin_lock_init(&cli->tc_rule_lock);
 	atomic_set(&cli->tc_ref, 1);
 	rule = nrs_tbf_rule_match(head, cli);
@@ -271,6 +546,7 @@ nrs_tbf_cli_fini(struct nrs_tbf_client *cli)
 	LASSERT(list_empty(&cli->tc_list));
 	LASSERT(!cli->tc_in_heap);
 	LASSERT(atomic_read(&cli->tc_ref) == 0);
+	atomic_dec(&cli->tc_rule->tr_head->th_nr_classes);
 	spin_lock(&cli->tc_rule_lock);
 	nrs_tbf_cli_rule_put(cli);
 	spin_unlock(&cli->tc_rule_lock);
@@ -285,7 +561,9 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 	struct nrs_tbf_rule	*rule;
 	struct nrs_tbf_rule	*tmp_rule;
 	struct nrs_tbf_rule	*next_rule;
+	struct nrs_tbf_rule	*parent = NULL;
 	char			*next_name = start->u.tc_start.ts_next_name;
+	char			*parent_name = start->u.tc_start.ts_parent_name;
 	int			 rc;
 
 	rule = nrs_tbf_rule_find(head, start->tc_name);
@@ -303,7 +581,10 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 	rule->tr_nsecs = NSEC_PER_SEC;
 	do_div(rule->tr_nsecs, rule->tr_rpc_rate);
 	rule->tr_depth = tbf_depth;
+	rule->tr_ntoken = rule->tr_depth;
+	rule->tr_check_time = ktime_to_ns(ktime_get());
 	atomic_set(&rule->tr_ref, 1);
+	atomic_set(&rule->tr_nr_children, 0);
 	INIT_LIST_HEAD(&rule->tr_cli_list);
 	INIT_LIST_HEAD(&rule->tr_nids);
 	INIT_LIST_HEAD(&rule->tr_linkage);
@@ -326,6 +607,24 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 		return -EEXIST;
 	}
 
+	if (parent_name) {
+		parent = nrs_tbf_rule_find_nolock(head, parent_name);
+		if (!parent) {
+			spin_unlock(&head->th_rule_lock);
+			nrs_tbf_rule_put(rule);
+			return -ENOENT;
+		}
+
+		/* The rule keeps the reference taken on its parent */
+		rule->tr_parent = parent;
+		rule->tr_level = parent->tr_level + 1;
+		if (rule->tr_level >= NRS_TBF_MAX_LEVEL) {
+			spin_unlock(&head->th_rule_lock);
+			nrs_tbf_rule_put(rule);
+			return -EINVAL;
+		}
+	}
+
 	if (next_name) {
 		next_rule = nrs_tbf_rule_find_nolock(head, next_name);
 		if (!next_rule) {
@@ -340,6 +639,8 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 		/* Add on the top of the rule list */
 		list_add(&rule->tr_linkage, &head->th_list);
 	}
+	if (parent)
+		atomic_inc(&parent->tr_nr_children);
 	spin_unlock(&head->th_rule_lock);
 	atomic_inc(&head->th_rule_sequence);
 	if (start->u.tc_start.ts_rule_flags & NTRS_DEFAULT) {
@@ -348,8 +649,9 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 		head->th_rule = rule;
 	}
 
-	CDEBUG(D_RPCTRACE, "TBF starts rule@%p rate %llu gen %llu\n",
-	       rule, rule->tr_rpc_rate, rule->tr_generation);
+	CDEBUG(D_RPCTRACE, "TBF starts rule@%p rate %llu gen %llu parent %s\n",
+	       rule, rule->tr_rpc_rate, rule->tr_generation,
+	       parent ? parent->tr_name : "none");
 
 	return 0;
 }
@@ -465,8 +767,18 @@ nrs_tbf_rule_stop(struct ptlrpc_nrs_policy *policy,
 	if (rule == NULL)
 		return -ENOENT;
 
+	spin_lock(&head->th_rule_lock);
+	/* Children have to be stopped before their parent */
+	if (atomic_read(&rule->tr_nr_children) > 0) {
+		spin_unlock(&head->th_rule_lock);
+		nrs_tbf_rule_put(rule);
+		return -EBUSY;
+	}
 	list_del_init(&rule->tr_linkage);
+	spin_unlock(&head->th_rule_lock);
 	rule->tr_flags |= NTRS_STOPPING;
+	if (rule->tr_parent)
+		atomic_dec(&rule->tr_parent->tr_nr_children);
 	nrs_tbf_rule_put(rule);
 	nrs_tbf_rule_put(rule);
 
@@ -2201,14 +2513,25 @@ static int nrs_tbf_start(struct ptlrpc_nrs_policy *policy, char *arg)
 	head->th_ops = ops;
 	head->th_type_flag = type;
 
-	head->th_binheap = cfs_binheap_create(&nrs_tbf_heap_ops,
-					      CBH_FLAG_ATOMIC_GROW, 4096, NULL,
-					      nrs_pol2cptab(policy),
-					      nrs_pol2cptid(policy));
-	if (head->th_binheap == NULL)
-		GOTO(out_free_head, rc = -ENOMEM);
+	/* The classes are scheduled by either the wheel or the binheap */
+	if (tbf_timer_wheel) {
+		OBD_CPT_ALLOC_PTR(head->th_wheel, nrs_pol2cptab(policy),
+				  nrs_pol2cptid(policy));
+		if (head->th_wheel == NULL)
+			GOTO(out_free_head, rc = -ENOMEM);
+		nrs_tbf_wheel_init(head->th_wheel);
+	} else {
+		head->th_binheap = cfs_binheap_create(&nrs_tbf_heap_ops,
+						      CBH_FLAG_ATOMIC_GROW,
+						      4096, NULL,
+						      nrs_pol2cptab(policy),
+						      nrs_pol2cptid(policy));
+		if (head->th_binheap == NULL)
+			GOTO(out_free_head, rc = -ENOMEM);
+	}
 
 	atomic_set(&head->th_rule_sequence, 0);
+	atomic_set(&head->th_nr_classes, 0);
 	spin_lock_init(&head->th_rule_lock);
 	INIT_LIST_HEAD(&head->th_list);
 	hrtimer_init(&head->th_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
@@ -2220,7 +2543,10 @@ static int nrs_tbf_start(struct ptlrpc_nrs_policy *policy, char *arg)
 	policy->pol_private = head;
 	return 0;
 out_free_heap:
-	cfs_binheap_destroy(head->th_binheap);
+	if (head->th_wheel != NULL)
+		OBD_FREE_PTR(head->th_wheel);
+	else
+		cfs_binheap_destroy(head->th_binheap);
 out_free_head:
 	OBD_FREE_PTR(head);
 out:
@@ -2252,9 +2578,15 @@ static void nrs_tbf_stop(struct ptlrpc_nrs_policy *policy)
 		nrs_tbf_rule_put(rule);
 	}
 	LASSERT(list_empty(&head->th_list));
-	LASSERT(head->th_binheap != NULL);
-	LASSERT(cfs_binheap_is_empty(head->th_binheap));
-	cfs_binheap_destroy(head->th_binheap);
+	if (head->th_wheel != NULL) {
+		LASSERT(head->th_wheel->tw_count == 0);
+		LASSERT(list_empty(&head->th_wheel->tw_ready));
+		OBD_FREE_PTR(head->th_wheel);
+	} else {
+		LASSERT(head->th_binheap != NULL);
+		LASSERT(cfs_binheap_is_empty(head->th_binheap));
+		cfs_binheap_destroy(head->th_binheap);
+	}
 	OBD_FREE_PTR(head);
 	nrs->nrs_throttling = 0;
 	wake_up(&policy->pol_nrs->nrs_svcpt->scp_waitq);
@@ -2324,6 +2656,26 @@ static int nrs_tbf_ctl(struct ptlrpc_nrs_policy *policy,
 		*(__u32 *)arg = head->th_type_flag;
 		}
 		break;
+	/**
+	 * Read the scheduler statistics of a policy instance.
+	 */
+	case NRS_CTL_TBF_RD_STATS: {
+		struct nrs_tbf_head *head = policy->pol_private;
+		struct nrs_tbf_stats_info *info = arg;
+		struct nrs_tbf_stats *stats;
+
+		if (info->tsi_count >= info->tsi_max)
+			RETURN(-EOVERFLOW);
+
+		stats = &info->tsi_stats[info->tsi_count++];
+		stats->ts_cpt = policy->pol_nrs->nrs_svcpt->scp_cpt;
+		stats->ts_wheel = head->th_wheel != NULL;
+		stats->ts_nr_classes = atomic_read(&head->th_nr_classes);
+		stats->ts_nr_active = head->th_nr_active;
+		stats->ts_nr_dequeue = head->th_nr_dequeue;
+		stats->ts_dequeue_ns = head->th_dequeue_ns;
+		}
+		break;
 	}
 
 	RETURN(rc);
@@ -2435,6 +2787,220 @@ static void nrs_tbf_res_put(struct ptlrpc_nrs_policy *policy,
 	head->th_ops->o_cli_put(head, cli);
 }
 
+/**
+ * Returns the first rule of the hierarchy above class \a cli whose bucket is
+ * shared by the class, or NULL if the class is not part of a hierarchy.
+ *
+ * A rule with children caps the traffic of its whole subtree, including its
+ * own classes; the classes of a leaf rule are only capped by its ancestors.
+ */
+static struct nrs_tbf_rule *nrs_tbf_cli_cap(struct nrs_tbf_client *cli)
+{
+	struct nrs_tbf_rule *rule = cli->tc_rule;
+
+	if (atomic_read(&rule->tr_nr_children) > 0)
+		return rule;
+
+	return rule->tr_parent;
+}
+
+/**
+ * Adds the tokens a shared bucket has earned since its last check-point.
+ * Only whole tokens move the check-point forward, so that slow rates do
+ * not lose the time between tokens.
+ */
+static void nrs_tbf_rule_refill(struct nrs_tbf_rule *rule, __u64 now)
+{
+	__u64 passed;
+	__u64 ntoken;
+
+	LASSERT(now >= rule->tr_check_time);
+	passed = now - rule->tr_check_time;
+	/* Also avoids overflowing below after a long idle period */
+	if (passed >= (rule->tr_depth - rule->tr_ntoken) * rule->tr_nsecs) {
+		rule->tr_ntoken = rule->tr_depth;
+		rule->tr_check_time = now;
+		return;
+	}
+
+	ntoken = passed * rule->tr_rpc_rate;
+	do_div(ntoken, NSEC_PER_SEC);
+	rule->tr_ntoken += ntoken;
+	rule->tr_check_time += ntoken * rule->tr_nsecs;
+}
+
+/**
+ * Checks whether every shared bucket above class \a cli has a token. Each
+ * request dequeued under a parent rule takes one, whether its class has a
+ * token of its own or borrows one, so that a parent rate is a hard cap for
+ * its whole subtree, including the classes of the parent rule itself.
+ *
+ * \param[in]  cli	 the class, which is part of a hierarchy
+ * \param[in]  now	 current time in nanoseconds
+ * \param[out] deadline the time at which all the buckets have a token, if
+ *			 they do not have one now
+ *
+ * \retval true every shared bucket has a token
+ */
+static bool nrs_tbf_cli_cap_token(struct nrs_tbf_client *cli, __u64 now,
+				  __u64 *deadline)
+{
+	struct nrs_tbf_rule *rule;
+	__u64 wait = 0;
+
+	for (rule = nrs_tbf_cli_cap(cli); rule != NULL;
+	     rule = rule->tr_parent) {
+		__u64 time;
+
+		nrs_tbf_rule_refill(rule, now);
+		if (rule->tr_ntoken > 0)
+			continue;
+
+		time = rule->tr_check_time +
+		       (1 - rule->tr_ntoken) * rule->tr_nsecs;
+		if (time > wait)
+			wait = time;
+	}
+
+	if (wait == 0)
+		return true;
+
+	if (wait < *deadline)
+		*deadline = wait;
+	return false;
+}
+
+/**
+ * Charges a request dequeued from class \a cli to the rule of the class and
+ * to every shared bucket above it, all of which have been checked to have a
+ * token by nrs_tbf_cli_cap_token().
+ */
+static void nrs_tbf_cli_charge(struct nrs_tbf_client *cli, __u64 now,
+			       bool borrowed)
+{
+	struct nrs_tbf_rule *rule = nrs_tbf_cli_cap(cli);
+
+	if (rule != cli->tc_rule)
+		cli->tc_rule->tr_nr_served++;
+
+	if (borrowed)
+		cli->tc_rule->tr_nr_borrowed++;
+
+	for (; rule != NULL; rule = rule->tr_parent) {
+		LASSERT(rule->tr_ntoken > 0);
+		rule->tr_ntoken--;
+		rule->tr_nr_served++;
+	}
+}
+
+/**
+ * Dequeues the first request of class \a cli if the class has a token of
+ * its own, or is part of a hierarchy and can borrow one, and every shared
+ * bucket above the class has a token.
+ *
+ * \param[in]	  head	   the TBF head
+ * \param[in]	  cli	   the class
+ * \param[in]	  now	   current time in nanoseconds
+ * \param[in,out] deadline lowered to the time at which the class may be
+ *			   served, if it cannot be served now
+ *
+ * \retval the dequeued request, or NULL
+ */
+static struct ptlrpc_nrs_request *
+nrs_tbf_cli_dequeue(struct nrs_tbf_head *head, struct nrs_tbf_client *cli,
+		    __u64 now, __u64 *deadline)
+{
+	struct ptlrpc_nrs_request *nrq;
+	__u64 passed;
+	__u64 ntoken;
+	bool borrowed;
+
+	LASSERT(now >= cli->tc_check_time);
+	passed = now - cli->tc_check_time;
+	ntoken = passed * cli->tc_rpc_rate;
+	do_div(ntoken, NSEC_PER_SEC);
+	ntoken += cli->tc_ntoken;
+	if (ntoken > cli->tc_depth)
+		ntoken = cli->tc_depth;
+	if (ntoken == 0 && nrs_tbf_cli_cap(cli) == NULL) {
+		if (cli->tc_check_time + cli->tc_nsecs < *deadline)
+			*deadline = cli->tc_check_time + cli->tc_nsecs;
+		return NULL;
+	}
+	if (!nrs_tbf_cli_cap_token(cli, now, deadline))
+		return NULL;
+
+	borrowed = ntoken == 0;
+	nrq = list_entry(cli->tc_list.next,
+			     struct ptlrpc_nrs_request,
+			     nr_u.tbf.tr_list);
+	if (!borrowed)
+		ntoken--;
+	cli->tc_ntoken = ntoken;
+	cli->tc_check_time = now;
+	nrs_tbf_cli_charge(cli, now, borrowed);
+	list_del_init(&nrq->nr_u.tbf.tr_list);
+	if (list_empty(&cli->tc_list))
+		nrs_tbf_sched_del(head, cli);
+	else
+		nrs_tbf_sched_relocate(head, cli);
+	CDEBUG(D_RPCTRACE,
+	       "TBF dequeues: class@%p rate %llu gen %llu "
+	       "token %llu%s, rule@%p rate %llu gen %llu\n",
+	       cli, cli->tc_rpc_rate,
+	       cli->tc_rule_generation, cli->tc_ntoken,
+	       borrowed ? " (borrowed)" : "",
+	       cli->tc_rule, cli->tc_rule->tr_rpc_rate,
+	       cli->tc_rule->tr_generation);
+
+	return nrq;
+}
+
+/**
+ * Dequeues a request from the classes of the timer wheel which have a token
+ * by \a now. If none has, the earliest class of the wheel is given a chance
+ * to borrow a token.
+ */
+static struct ptlrpc_nrs_request *
+nrs_tbf_wheel_dequeue(struct nrs_tbf_head *head, __u64 now, __u64 *deadline)
+{
+	struct nrs_tbf_wheel *wheel = head->th_wheel;
+	struct ptlrpc_nrs_request *nrq;
+	struct nrs_tbf_client *cli;
+	struct list_head *first = NULL;
+	__u64 next;
+
+	nrs_tbf_wheel_advance(wheel, now >> NRS_TBF_WHEEL_SHIFT);
+	while (!list_empty(&wheel->tw_ready)) {
+		__u64 when = ~0ULL;
+
+		cli = list_entry(wheel->tw_ready.next, struct nrs_tbf_client,
+				 tc_wheel);
+		nrq = nrs_tbf_cli_dequeue(head, cli, now, &when);
+		if (nrq != NULL)
+			return nrq;
+
+		/* Came out of the wheel early, i.e. its rate was lowered, it
+		 * was beyond the range of the wheel, or a rule above it is
+		 * out of tokens */
+		if (when < *deadline)
+			*deadline = when;
+		nrs_tbf_wheel_del(wheel, cli);
+		nrs_tbf_wheel_add(wheel, cli, max(nrs_tbf_wheel_tick(when),
+						  wheel->tw_time));
+	}
+
+	next = nrs_tbf_wheel_next(wheel, &first);
+	if (next == 0)
+		return NULL;
+
+	if ((next << NRS_TBF_WHEEL_SHIFT) < *deadline)
+		*deadline = next << NRS_TBF_WHEEL_SHIFT;
+	cli = list_entry(first->next, struct nrs_tbf_client, tc_wheel);
+
+	return nrs_tbf_cli_dequeue(head, cli, now, deadline);
+}
+
 /**
  * Called when getting a request from the TBF policy for handling, or just
  * peeking; removes the request from the policy when it is to be handled.
@@ -2460,76 +3026,62 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 	struct ptlrpc_nrs_request *nrq = NULL;
 	struct nrs_tbf_client     *cli;
 	struct cfs_binheap_node	  *node;
+	struct list_head	  *first = NULL;
+	__u64			   now;
+	__u64			   deadline = ~0ULL;
+	ktime_t			   time;
 
 	assert_spin_locked(&policy->pol_nrs->nrs_svcpt->scp_req_lock);
 
 	if (!peek && policy->pol_nrs->nrs_throttling)
 		return NULL;
 
-	node = cfs_binheap_root(head->th_binheap);
-	if (unlikely(node == NULL))
+	if (unlikely(head->th_nr_active == 0))
 		return NULL;
 
-	cli = container_of(node, struct nrs_tbf_client, tc_node);
-	LASSERT(cli->tc_in_heap);
 	if (peek) {
-		nrq = list_entry(cli->tc_list.next,
-				     struct ptlrpc_nrs_request,
-				     nr_u.tbf.tr_list);
-	} else {
-		__u64 now = ktime_to_ns(ktime_get());
-		__u64 passed;
-		__u64 ntoken;
-		__u64 deadline;
-
-		deadline = cli->tc_check_time +
-			  cli->tc_nsecs;
-		LASSERT(now >= cli->tc_check_time);
-		passed = now - cli->tc_check_time;
-		ntoken = passed * cli->tc_rpc_rate;
-		do_div(ntoken, NSEC_PER_SEC);
-		ntoken += cli->tc_ntoken;
-		if (ntoken > cli->tc_depth)
-			ntoken = cli->tc_depth;
-		if (ntoken > 0) {
-			struct ptlrpc_request *req;
-			nrq = list_entry(cli->tc_list.next,
-					     struct ptlrpc_nrs_request,
-					     nr_u.tbf.tr_list);
-			req = container_of(nrq,
-					   struct ptlrpc_request,
-					   rq_nrq);
-			ntoken--;
-			cli->tc_ntoken = ntoken;
-			cli->tc_check_time = now;
-			list_del_init(&nrq->nr_u.tbf.tr_list);
-			if (list_empty(&cli->tc_list)) {
-				cfs_binheap_remove(head->th_binheap,
-						   &cli->tc_node);
-				cli->tc_in_heap = false;
-			} else {
-				cfs_binheap_relocate(head->th_binheap,
-						     &cli->tc_node);
-			}
-			CDEBUG(D_RPCTRACE,
-			       "TBF dequeues: class@%p rate %llu gen %llu "
-			       "token %llu, rule@%p rate %llu gen %llu\n",
-			       cli, cli->tc_rpc_rate,
-			       cli->tc_rule_generation, cli->tc_ntoken,
-			       cli->tc_rule, cli->tc_rule->tr_rpc_rate,
-			       cli->tc_rule->tr_generation);
+		if (head->th_wheel == NULL) {
+			node = cfs_binheap_root(head->th_binheap);
+			cli = container_of(node, struct nrs_tbf_client,
+					   tc_node);
+		} else if (!list_empty(&head->th_wheel->tw_ready)) {
+			cli = list_entry(head->th_wheel->tw_ready.next,
+					 struct nrs_tbf_client, tc_wheel);
 		} else {
-			ktime_t time;
-
-			policy->pol_nrs->nrs_throttling = 1;
-			head->th_deadline = deadline;
-			time = ktime_set(0, 0);
-			time = ktime_add_ns(time, deadline);
-			hrtimer_start(&head->th_timer, time, HRTIMER_MODE_ABS);
+			nrs_tbf_wheel_next(head->th_wheel, &first);
+			cli = list_entry(first->next, struct nrs_tbf_client,
+					 tc_wheel);
 		}
+		LASSERT(cli->tc_in_heap);
+
+		return list_entry(cli->tc_list.next,
+				  struct ptlrpc_nrs_request,
+				  nr_u.tbf.tr_list);
 	}
 
-	return nrq;
+	now = ktime_to_ns(ktime_get());
+	if (head->th_wheel == NULL) {
+		node = cfs_binheap_root(head->th_binheap);
+		cli = container_of(node, struct nrs_tbf_client, tc_node);
+		LASSERT(cli->tc_in_heap);
+		nrq = nrs_tbf_cli_dequeue(head, cli, now, &deadline);
+	} else {
+		nrq = nrs_tbf_wheel_dequeue(head, now, &deadline);
+	}
+
+	if (nrq != NULL) {
+		head->th_nr_dequeue++;
+		head->th_dequeue_ns += ktime_to_ns(ktime_get()) - now;
+		return nrq;
+	}
+
+	policy->pol_nrs->nrs_throttling = 1;
+	head->th_deadline = deadline;
+	time = ktime_set(0, 0);
+	time = ktime_add_ns(time, deadline);
+	hrtimer_start(&head->th_timer, time, HRTIMER_MODE_ABS);
+
+	return NULL;
 }
 
 /**
@@ -2556,9 +3108,8 @@ static int nrs_tbf_req_add(struct ptlrpc_nrs_policy *policy,
 			    struct nrs_tbf_head, th_res);
 	if (list_empty(&cli->tc_list)) {
 		LASSERT(!cli->tc_in_heap);
-		rc = cfs_binheap_insert(head->th_binheap, &cli->tc_node);
+		rc = nrs_tbf_sched_add(head, cli);
 		if (rc == 0) {
-			cli->tc_in_heap = true;
 			nrq->nr_u.tbf.tr_sequence = head->th_sequence++;
 			list_add_tail(&nrq->nr_u.tbf.tr_list,
 					  &cli->tc_list);
@@ -2617,14 +3168,10 @@ static void nrs_tbf_req_del(struct ptlrpc_nrs_policy *policy,
 
 	LASSERT(!list_empty(&nrq->nr_u.tbf.tr_list));
 	list_del_init(&nrq->nr_u.tbf.tr_list);
-	if (list_empty(&cli->tc_list)) {
-		cfs_binheap_remove(head->th_binheap,
-				   &cli->tc_node);
-		cli->tc_in_heap = false;
-	} else {
-		cfs_binheap_relocate(head->th_binheap,
-				     &cli->tc_node);
-	}
+	if (list_empty(&cli->tc_list))
+		nrs_tbf_sched_del(head, cli);
+	else
+		nrs_tbf_sched_relocate(head, cli);
 }
 
 /**
@@ -2805,6 +3352,12 @@ nrs_tbf_parse_value_pair(struct nrs_tbf_cmd *cmd, char *buffer)
 			cmd->u.tc_change.tc_next_name = val;
 		else
 			return -EINVAL;
+	} else if (strcmp(key, "parent") == 0) {
+		if (!name_is_valid(val) ||
+		    cmd->tc_cmd != NRS_CTL_TBF_START_RULE)
+			return -EINVAL;
+
+		cmd->u.tc_start.ts_parent_name = val;
 	} else {
 		return -EINVAL;
 	}
@@ -3016,6 +3569,82 @@ out:
 }
 LPROC_SEQ_FOPS(ptlrpc_lprocfs_nrs_tbf_rule);
 
+/**
+ * Reads the scheduler statistics of the TBF policy instances of \a queue
+ * and prints them; they are copied out under nrs_lock and printed after it
+ * has been dropped.
+ */
+static int
+ptlrpc_lprocfs_nrs_tbf_stats_show(struct seq_file *m,
+				  struct ptlrpc_service *svc,
+				  enum ptlrpc_nrs_queue_type queue,
+				  struct nrs_tbf_stats_info *info)
+{
+	struct nrs_tbf_stats *stats;
+	int rc;
+	int i;
+
+	info->tsi_count = 0;
+	rc = ptlrpc_nrs_policy_control(svc, queue, NRS_POL_NAME_TBF,
+				       NRS_CTL_TBF_RD_STATS, false, info);
+	if (rc != 0)
+		return rc;
+
+	for (i = 0; i < info->tsi_count; i++) {
+		stats = &info->tsi_stats[i];
+		seq_printf(m, "CPT %d:\n"
+			   "  scheduler: %s\n"
+			   "  classes: %d\n"
+			   "  active_classes: %u\n"
+			   "  dequeues: %llu\n"
+			   "  dequeue_avg_ns: %llu\n",
+			   stats->ts_cpt, stats->ts_wheel ? "wheel" : "heap",
+			   stats->ts_nr_classes, stats->ts_nr_active,
+			   stats->ts_nr_dequeue,
+			   stats->ts_nr_dequeue == 0 ? 0 :
+			   div64_u64(stats->ts_dequeue_ns,
+				     stats->ts_nr_dequeue));
+	}
+
+	return 0;
+}
+
+/**
+ * Shows the scheduler statistics of each TBF policy instance: the number of
+ * classes and of classes with queued requests, and the number and average
+ * cost of dequeues.
+ */
+static int
+ptlrpc_lprocfs_nrs_tbf_stats_seq_show(struct seq_file *m, void *data)
+{
+	struct ptlrpc_service	    *svc = m->private;
+	struct nrs_tbf_stats_info    info;
+	int			     rc;
+
+	info.tsi_max = svc->srv_ncpts;
+	OBD_ALLOC(info.tsi_stats, info.tsi_max * sizeof(*info.tsi_stats));
+	if (info.tsi_stats == NULL)
+		return -ENOMEM;
+
+	seq_printf(m, "regular_requests:\n");
+	rc = ptlrpc_lprocfs_nrs_tbf_stats_show(m, svc, PTLRPC_NRS_QUEUE_REG,
+					       &info);
+	if (rc == -ENODEV)
+		rc = 0;
+	if (rc != 0 || !nrs_svc_has_hp(svc))
+		GOTO(out, rc);
+
+	seq_printf(m, "high_priority_requests:\n");
+	rc = ptlrpc_lprocfs_nrs_tbf_stats_show(m, svc, PTLRPC_NRS_QUEUE_HP,
+					       &info);
+	if (rc == -ENODEV)
+		rc = 0;
+out:
+	OBD_FREE(info.tsi_stats, info.tsi_max * sizeof(*info.tsi_stats));
+	return rc;
+}
+LPROC_SEQ_FOPS_RO(ptlrpc_lprocfs_nrs_tbf_stats);
+
 /**
  * Initializes a TBF policy's lprocfs interface for service \a svc
  *
@@ -3030,6 +3659,9 @@ static int nrs_tbf_lprocfs_init(struct ptlrpc_service *svc)
 		{ .name		= "nrs_tbf_rule",
 		  .fops		= &ptlrpc_lprocfs_nrs_tbf_rule_fops,
 		  .data = svc },
+		{ .name		= "nrs_tbf_stats",
+		  .fops		= &ptlrpc_lprocfs_nrs_tbf_stats_fops,
+		  .data = svc },
 		{ NULL }
 	};
 
@@ -3050,6 +3682,7 @@ static void nrs_tbf_lprocfs_fini(struct ptlrpc_service *svc)
 		return;
 
 	lprocfs_remove_proc_entry("nrs_tbf_rule", svc->srv_procroot);
+	lprocfs_remove_proc_entry("nrs_tbf_stats", svc->srv_procroot);
 }
 
 #endif /* CONFIG_PROC_FS */
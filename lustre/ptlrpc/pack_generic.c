@@ -319,6 +319,13 @@ void lustre_put_emerg_rs(struct ptlrpc_reply_state *rs)
 	struct ptlrpc_service_part *svcpt = rs->rs_svcpt;
 
 	spin_lock(&svcpt->scp_rep_lock);
+	if (svcpt->scp_rep_surplus > 0) {
+		/* the thread which brought it has exited */
+		svcpt->scp_rep_surplus--;
+		spin_unlock(&svcpt->scp_rep_lock);
+		OBD_FREE_LARGE(rs, svcpt->scp_service->srv_max_reply_size);
+		return;
+	}
 	list_add(&rs->rs_list, &svcpt->scp_rep_idle);
 	spin_unlock(&svcpt->scp_rep_lock);
 	wake_up(&svcpt->scp_rep_waitq);
@@ -52,6 +52,7 @@ extern struct ptlrpc_nrs_pol_conf nrs_conf_orr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_trr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_tbf;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_delay;
+extern struct ptlrpc_nrs_pol_conf nrs_conf_edf;
 #endif /* HAVE_SERVER_SUPPORT */
 
 /**
@@ -89,6 +90,8 @@ void ptlrpc_set_bulk_mbits(struct ptlrpc_request *req);
 void ptlrpc_assign_next_xid_nolock(struct ptlrpc_request *req);
 __u64 ptlrpc_known_replied_xid(struct obd_import *imp);
 void ptlrpc_add_unreplied(struct ptlrpc_request *req);
+struct ptlrpc_request *ptlrpc_replay_tree_next(struct obd_import *imp,
+					      __u64 transno);
 
 /* events.c */
 int ptlrpc_init_portals(void);
@@ -174,6 +177,7 @@ void ptlrpc_nrs_req_del_nolock(struct ptlrpc_request *req);
 bool ptlrpc_nrs_req_pending_nolock(struct ptlrpc_service_part *svcpt, bool hp);
 bool ptlrpc_nrs_req_throttling_nolock(struct ptlrpc_service_part *svcpt,
 				      bool hp);
+void ptlrpc_nrs_req_late(struct ptlrpc_request *req);
 
 int ptlrpc_nrs_policy_control(const struct ptlrpc_service *svc,
 			      enum ptlrpc_nrs_queue_type queue, char *name,
@@ -364,6 +368,7 @@ static inline void ptlrpc_req_comm_init(struct ptlrpc_request *req)
 	atomic_set(&req->rq_refcount, 1);
 	INIT_LIST_HEAD(&req->rq_list);
 	INIT_LIST_HEAD(&req->rq_replay_list);
+	RB_CLEAR_NODE(&req->rq_replay_node);
 }
 
 /** initialise client side ptlrpc request */
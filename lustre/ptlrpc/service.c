@@ -55,6 +55,12 @@ module_param(at_early_margin, int, 0644);
 MODULE_PARM_DESC(at_early_margin, "How soon before an RPC deadline to send an early reply");
 module_param(at_extra, int, 0644);
 MODULE_PARM_DESC(at_extra, "How much extra time to give with each early reply");
+static int thread_idle_timeout;
+module_param(thread_idle_timeout, int, 0644);
+MODULE_PARM_DESC(thread_idle_timeout, "Seconds a service thread above threads_min stays idle before it exits, 0 to never exit");
+
+/* a request queued for longer than this holds idle threads back from exiting */
+#define PTLRPC_THR_RETIRE_WAIT_USEC	1000
 
 /* forward ref */
 static int ptlrpc_server_post_idle_rqbds(struct ptlrpc_service_part *svcpt);
@@ -775,6 +781,7 @@ ptlrpc_register_service(struct ptlrpc_service_conf *conf,
 	service->srv_thread_name	= conf->psc_thr.tc_thr_name;
 	service->srv_ctx_tags		= conf->psc_thr.tc_ctx_tags;
 	service->srv_hpreq_ratio	= PTLRPC_SVC_HP_RATIO;
+	service->srv_thread_idle_timeout = thread_idle_timeout;
 	service->srv_ops		= conf->psc_ops;
 
 	for (i = 0; i < ncpts; i++) {
@@ -1528,6 +1535,10 @@ static int ptlrpc_at_check_timed(struct ptlrpc_service_part *svcpt)
                                     rq_timed_list);
 		list_del_init(&rq->rq_timed_list);
 
+		/* let the NRS policy serve it before it expires, if the
+		 * request is still queued */
+		ptlrpc_nrs_req_late(rq);
+
                 if (ptlrpc_at_send_early_reply(rq) == 0)
                         ptlrpc_at_add_timed(rq);
 
@@ -2059,6 +2070,12 @@ ptlrpc_server_handle_request(struct ptlrpc_service_part *svcpt,
 	work_start = ktime_get_real();
 	arrived = timespec64_to_ktime(request->rq_arrival_time);
 	timediff_usecs = ktime_us_delta(work_start, arrived);
+	if (timediff_usecs > PTLRPC_THR_RETIRE_WAIT_USEC) {
+		/* only looked at by ptlrpc_thread_retire() */
+		spin_lock(&svcpt->scp_lock);
+		svcpt->scp_req_wait_time = ktime_get_seconds();
+		spin_unlock(&svcpt->scp_lock);
+	}
 	if (likely(svc->srv_stats != NULL)) {
                 lprocfs_counter_add(svc->srv_stats, PTLRPC_REQWAIT_CNTR,
 				    timediff_usecs);
@@ -2388,6 +2405,56 @@ ptlrpc_thread_stopping(struct ptlrpc_thread *thread)
 	       thread->t_svcpt->scp_service->srv_is_stopping;
 }
 
+/**
+ * Lets a thread which has been idle for srv_thread_idle_timeout exit, so
+ * that a partition does not keep the threads, and their lu_env, which a past
+ * burst of requests made it start.
+ *
+ * Threads are started as soon as all of them are busy, but one only exits
+ * when less than half of them are busy, no request is queued, and for an
+ * idle timeout neither has a thread been started nor has a request waited
+ * for long; so that the pool does not oscillate under a steady load. The
+ * pool never shrinks below srv_nthrs_cpt_init threads.
+ *
+ * \retval true the thread has been taken off scp_threads and must exit
+ */
+static bool ptlrpc_thread_retire(struct ptlrpc_service_part *svcpt,
+				 struct ptlrpc_thread *thread)
+{
+	struct ptlrpc_service *svc = svcpt->scp_service;
+	bool retire = false;
+	int running;
+
+	spin_lock(&svcpt->scp_lock);
+	running = svcpt->scp_nthrs_running - svcpt->scp_nthrs_stopping;
+
+	if (thread_is_stopping(thread) || !thread_is_running(thread) ||
+	    running <= svc->srv_nthrs_cpt_init)
+		goto out;
+
+	if (ktime_get_seconds() < svc->srv_thread_idle_timeout +
+	    max(svcpt->scp_thr_start_time, svcpt->scp_req_wait_time))
+		goto out;
+
+	if (svcpt->scp_nreqs_active * 2 >= running ||
+	    svcpt->scp_nreqs_incoming > 0 ||
+	    ptlrpc_server_request_pending(svcpt, true))
+		goto out;
+
+	/* ptlrpc_svcpt_stop_threads() waits for scp_nthrs_stopping instead */
+	list_del_init(&thread->t_link);
+	thread_add_flags(thread, SVC_IDLE_EXIT);
+	svcpt->scp_nthrs_stopping++;
+	retire = true;
+out:
+	spin_unlock(&svcpt->scp_lock);
+
+	if (retire)
+		CDEBUG(D_RPCTRACE, "%s: idle thread %s exits, %d left\n",
+		       svc->srv_name, thread->t_name, running - 1);
+	return retire;
+}
+
 static inline int
 ptlrpc_rqbd_pending(struct ptlrpc_service_part *svcpt)
 {
@@ -2419,12 +2486,21 @@ ptlrpc_wait_event(struct ptlrpc_service_part *svcpt,
 	/* Don't exit while there are replies to be handled */
 	struct l_wait_info lwi = LWI_TIMEOUT(svcpt->scp_rqbd_timeout,
 					     ptlrpc_retry_rqbds, svcpt);
+	int idle = svcpt->scp_service->srv_thread_idle_timeout;
+	int rc;
+
+	/* Threads wait LIFO, so the ones at the tail of the queue time out
+	 * once the load goes down */
+	if (idle > 0 && svcpt->scp_rqbd_timeout == 0)
+		lwi = LWI_TIMEOUT(cfs_time_seconds(idle), NULL, NULL);
+	else
+		idle = 0;
 
 	lc_watchdog_disable(thread->t_watchdog);
 
 	cond_resched();
 
-	l_wait_event_exclusive_head(svcpt->scp_waitq,
+	rc = l_wait_event_exclusive_head(svcpt->scp_waitq,
 				ptlrpc_thread_stopping(thread) ||
 				ptlrpc_server_request_incoming(svcpt) ||
 				ptlrpc_server_request_pending(svcpt, false) ||
@@ -2434,6 +2510,10 @@ ptlrpc_wait_event(struct ptlrpc_service_part *svcpt,
 	if (ptlrpc_thread_stopping(thread))
 		return -EINTR;
 
+	if (rc == -ETIMEDOUT && idle > 0 &&
+	    ptlrpc_thread_retire(svcpt, thread))
+		return -EINTR;
+
 	lc_watchdog_touch(thread->t_watchdog,
 			  ptlrpc_server_get_timeout(svcpt));
 	return 0;
@@ -2594,6 +2674,31 @@ static int ptlrpc_main(void *arg)
         lc_watchdog_delete(thread->t_watchdog);
         thread->t_watchdog = NULL;
 
+	if (thread->t_flags & SVC_IDLE_EXIT) {
+		struct list_head surplus;
+
+		/* give back the reply state the thread brought; if they are
+		 * all in use, lustre_put_emerg_rs() frees the next one put */
+		INIT_LIST_HEAD(&surplus);
+		spin_lock(&svcpt->scp_rep_lock);
+		svcpt->scp_rep_surplus++;
+		while (svcpt->scp_rep_surplus > 0 &&
+		       !list_empty(&svcpt->scp_rep_idle)) {
+			rs = list_entry(svcpt->scp_rep_idle.next,
+					struct ptlrpc_reply_state, rs_list);
+			list_move(&rs->rs_list, &surplus);
+			svcpt->scp_rep_surplus--;
+		}
+		spin_unlock(&svcpt->scp_rep_lock);
+
+		while (!list_empty(&surplus)) {
+			rs = list_entry(surplus.next,
+					struct ptlrpc_reply_state, rs_list);
+			list_del(&rs->rs_list);
+			OBD_FREE_LARGE(rs, svc->srv_max_reply_size);
+		}
+	}
+
 out_srv_fini:
         /*
          * deconstruct service specific state created by ptlrpc_start_thread()
@@ -2618,6 +2723,17 @@ out:
 		svcpt->scp_nthrs_running--;
 	}
 
+	if (thread->t_flags & SVC_IDLE_EXIT) {
+		/* off scp_threads already, nobody else can see this thread */
+		svcpt->scp_nthrs_stopping--;
+		/* ptlrpc_svcpt_stop_threads() may be waiting for us */
+		if (svcpt->scp_nthrs_stopping == 0)
+			wake_up_all(&svcpt->scp_waitq);
+		spin_unlock(&svcpt->scp_lock);
+		OBD_FREE_PTR(thread);
+		return rc;
+	}
+
 	thread->t_id = rc;
 	thread_add_flags(thread, SVC_STOPPED);
 
@@ -2791,6 +2907,19 @@ static void ptlrpc_svcpt_stop_threads(struct ptlrpc_service_part *svcpt)
 		spin_lock(&svcpt->scp_lock);
 	}
 
+	/* threads exiting for being idle are not on scp_threads any more,
+	 * the last of them wakes us up; take scp_lock again so that it
+	 * has let go of svcpt before we return */
+	if (svcpt->scp_nthrs_stopping > 0) {
+		spin_unlock(&svcpt->scp_lock);
+		CDEBUG(D_INFO, "waiting for %d idle threads %s to exit\n",
+		       svcpt->scp_nthrs_stopping,
+		       svcpt->scp_service->srv_thread_name);
+		l_wait_event(svcpt->scp_waitq,
+			     svcpt->scp_nthrs_stopping == 0, &lwi);
+		spin_lock(&svcpt->scp_lock);
+	}
+
 	spin_unlock(&svcpt->scp_lock);
 
 	while (!list_empty(&zombie)) {
@@ -2890,7 +3019,8 @@ int ptlrpc_start_thread(struct ptlrpc_service_part *svcpt, int wait)
 
 	if (svcpt->scp_nthrs_starting != 0) {
 		/* serialize starting because some modules (obdfilter)
-		 * might require unique and contiguous t_id */
+		 * might require unique t_id; t_id is not contiguous once
+		 * idle threads have exited */
 		LASSERT(svcpt->scp_nthrs_starting == 1);
 		spin_unlock(&svcpt->scp_lock);
 		OBD_FREE_PTR(thread);
@@ -2907,6 +3037,7 @@ int ptlrpc_start_thread(struct ptlrpc_service_part *svcpt, int wait)
 	}
 
 	svcpt->scp_nthrs_starting++;
+	svcpt->scp_thr_start_time = ktime_get_seconds();
 	thread->t_id = svcpt->scp_thr_nextid++;
 	thread_add_flags(thread, SVC_STARTING);
 	thread->t_svcpt = svcpt;
@@ -80,6 +80,9 @@
 
 /* Clients typically hold 2x their max_rpcs_in_flight of grant space */
 #define TGT_GRANT_SHRINK_LIMIT(exp)	(2ULL * 8 * exp_max_brw_size(exp))
+/* Grant chunks a client forecasting more demand (OBD_FL_GRANT_HINT) may be
+ * given in a single reply, instead of one */
+#define TGT_GRANT_HINT_CHUNKS		4
 
 /* Helpers to inflate/deflate grants for clients that do not support the grant
  * parameters */
@@ -101,6 +104,12 @@ static inline u64 tgt_grant_deflate(struct tg_grants_data *tgd, u64 val)
 	return val;
 }
 
+static inline bool tgt_grant_hinted(const struct obdo *oa)
+{
+	return (oa->o_valid & OBD_MD_FLFLAGS) &&
+	       (oa->o_flags & OBD_FL_GRANT_HINT);
+}
+
 /* Grant chunk is used as a unit for grant allocation. It should be inflated
  * if the client does not support the grant paramaters.
  * Check connection flag against \a data if not NULL. This is used during
@@ -868,12 +877,16 @@ static void tgt_grant_check(const struct lu_env *env, struct obd_export *exp,
  *				and limit how much space is granted back to the
  *				client. Otherwise, the server should try hard to
  *				satisfy the client request.
+ * \param[in] hinted		the client forecasts more demand than it holds
+ *				(OBD_FL_GRANT_HINT), a conservative allocation
+ *				may then return up to TGT_GRANT_HINT_CHUNKS
+ *				chunks instead of one
  *
  * \retval			amount of grant space allocated
  */
 static long tgt_grant_alloc(struct obd_export *exp, u64 curgrant,
 			    u64 want, u64 left, long chunk,
-			    bool conservative)
+			    bool conservative, bool hinted)
 {
 	struct obd_device	*obd = exp->exp_obd;
 	struct tg_grants_data	*tgd = &obd->u.obt.obt_lut->lut_tgd;
@@ -923,9 +936,16 @@ static long tgt_grant_alloc(struct obd_export *exp, u64 curgrant,
 	if (!grant)
 		RETURN(0);
 
-	/* Limit to grant_chunk if not reconnect/recovery */
-	if ((grant > chunk) && conservative)
-		grant = chunk;
+	/* Limit to grant_chunk if not reconnect/recovery. A client which
+	 * forecasts a burst may get a few chunks at once so that it does not
+	 * stall on grant, still bounded by what it asked for (want) and by
+	 * 1/8th of the remaining free space. */
+	if (conservative) {
+		long limit = hinted ? chunk * TGT_GRANT_HINT_CHUNKS : chunk;
+
+		if (grant > limit)
+			grant = limit;
+	}
 
 	tgd->tgd_tot_granted += grant;
 	ted->ted_grant += grant;
@@ -1010,7 +1030,8 @@ refresh:
 		goto refresh;
 	}
 
-	tgt_grant_alloc(exp, (u64)ted->ted_grant, want, left, chunk, new_conn);
+	tgt_grant_alloc(exp, (u64)ted->ted_grant, want, left, chunk, new_conn,
+			false);
 
 	/* return to client its current grant */
 	if (OCD_HAS_FLAG(data, GRANT_PARAM))
@@ -1150,6 +1171,54 @@ void tgt_grant_prepare_read(const struct lu_env *env,
 }
 EXPORT_SYMBOL(tgt_grant_prepare_read);
 
+/**
+ * Process a grant-only request.
+ *
+ * A client forecasting more write demand than its grant covers announces its
+ * grant state with OBD_FL_GRANT_HINT in a KEY_GRANT_SHRINK set_info RPC, ahead
+ * of its next write. Incoming grant information is processed like for a read,
+ * and more space is granted back like for a write, within the same per-export
+ * limits. Only used by the set_info handler, whose reply carries \a oa back.
+ *
+ * \param[in] env	LU environment provided by the caller
+ * \param[in] exp	export of the client which sent the request
+ * \param[in,out] oa	incoming obdo sent by the client
+ */
+void tgt_grant_prepare_hint(const struct lu_env *env,
+			    struct obd_export *exp, struct obdo *oa)
+{
+	struct lu_target	*lut = exp->exp_obd->u.obt.obt_lut;
+	struct tg_grants_data	*tgd = &lut->lut_tgd;
+	long			 chunk = tgt_grant_chunk(exp, lut, NULL);
+	int			 from_cache;
+	u64			 left;
+
+	ENTRY;
+
+	if (!(oa->o_valid & OBD_MD_FLGRANT))
+		RETURN_EXIT;
+
+	tgt_grant_statfs(env, exp, 0, &from_cache);
+
+	spin_lock(&tgd->tgd_grant_lock);
+	left = tgt_grant_space_left(exp);
+	tgt_grant_incoming(env, exp, oa, chunk);
+
+	/* don't bother refreshing statfs for a hint, if space is short the
+	 * next write will do it */
+	if (from_cache && left < 32 * chunk)
+		oa->o_grant = 0;
+	else
+		oa->o_grant = tgt_grant_alloc(exp, oa->o_grant, oa->o_undirty,
+					      left, chunk, true, true);
+
+	if (!exp_grant_param_supp(exp))
+		oa->o_grant = tgt_grant_deflate(tgd, oa->o_grant);
+	spin_unlock(&tgd->tgd_grant_lock);
+	EXIT;
+}
+EXPORT_SYMBOL(tgt_grant_prepare_hint);
+
 /**
  * Process grant information from incoming bulk write request.
  *
@@ -1249,7 +1318,8 @@ refresh:
 	else
 		/* grant more space back to the client if possible */
 		oa->o_grant = tgt_grant_alloc(exp, oa->o_grant, oa->o_undirty,
-					      left, chunk, true);
+					      left, chunk, true,
+					      tgt_grant_hinted(oa));
 
 	if (!exp_grant_param_supp(exp))
 		oa->o_grant = tgt_grant_deflate(tgd, oa->o_grant);
@@ -1354,7 +1424,7 @@ long tgt_grant_create(const struct lu_env *env, struct obd_export *exp, s64 *nr)
 		chunk = tgt_grant_chunk(exp, lut, NULL);
 		wanted -= ted->ted_grant;
 		tgt_grant_alloc(exp, ted->ted_grant, wanted, left, chunk,
-				false);
+				false, false);
 	}
 	spin_unlock(&tgd->tgd_grant_lock);
 	RETURN(granted);
@@ -185,12 +185,83 @@ out:
 }
 EXPORT_SYMBOL(tgt_validate_obdo);
 
+/**
+ * Validate and convert the additional objects of a multi-object OST_WRITE.
+ *
+ * The first obd_ioobj always describes the object carried in the ost_body,
+ * which has been verified already by tgt_validate_obdo().  The remaining
+ * ones only carry an ost_id, so they are checked and converted to FIDs here
+ * the same way, so that the OFD can use ioo_oid.oi_fid directly.
+ */
+static int tgt_io_multiobj_unpack(struct tgt_session_info *tsi,
+				  struct obd_ioobj *ioo, int obj_count)
+{
+	struct tgt_thread_info	*tti = tgt_th_info(tsi->tsi_env);
+	int			 nrbufs = ioo[0].ioo_bufcnt;
+	int			 i;
+	int			 rc;
+
+	ENTRY;
+
+	if (!exp_connect_multiobj_brw(tsi->tsi_exp) ||
+	    lustre_msg_get_opc(tgt_ses_req(tsi)->rq_reqmsg) != OST_WRITE) {
+		CERROR("%s: client %s sent %d ioobjs without multiobj_brw\n",
+		       tgt_name(tsi->tsi_tgt),
+		       obd_export_nid2str(tsi->tsi_exp), obj_count);
+		RETURN(-EPROTO);
+	}
+
+	if (obj_count > PTLRPC_MAX_BRW_OBJS) {
+		CERROR("%s: too many ioobjs (%d)\n", tgt_name(tsi->tsi_tgt),
+		       obj_count);
+		RETURN(-EPROTO);
+	}
+
+	for (i = 1; i < obj_count; i++) {
+		struct ost_id	*oi = &ioo[i].ioo_oid;
+		u64		 seq = ostid_seq(oi);
+
+		if (ioo[i].ioo_bufcnt == 0) {
+			CERROR("%s: ioo %d has zero bufcnt\n",
+			       tgt_name(tsi->tsi_tgt), i);
+			RETURN(-EPROTO);
+		}
+		nrbufs += ioo[i].ioo_bufcnt;
+
+		if (unlikely(ostid_id(oi) == 0 ||
+			     !(fid_seq_is_idif(seq) || fid_seq_is_mdt0(seq) ||
+			       fid_seq_is_norm(seq))))
+			GOTO(out, rc = -EPROTO);
+
+		rc = ostid_to_fid(&tti->tti_fid1, oi,
+				  tsi->tsi_tgt->lut_lsd.lsd_osd_index);
+		if (unlikely(rc != 0))
+			GOTO(out, rc);
+
+		oi->oi_fid = tti->tti_fid1;
+	}
+
+	if (nrbufs > PTLRPC_MAX_BRW_PAGES) {
+		DEBUG_REQ(D_RPCTRACE, tgt_ses_req(tsi),
+			  "bulk has too many pages (%d)", nrbufs);
+		RETURN(-EPROTO);
+	}
+
+	RETURN(0);
+out:
+	CERROR("%s: client %s sent bad object "DOSTID" in ioobj %d: rc = %d\n",
+	       tgt_name(tsi->tsi_tgt), obd_export_nid2str(tsi->tsi_exp),
+	       POSTID(&ioo[i].ioo_oid), i, rc);
+	return rc;
+}
+
 static int tgt_io_data_unpack(struct tgt_session_info *tsi, struct ost_id *oi)
 {
 	unsigned		 max_brw;
 	struct niobuf_remote	*rnb;
 	struct obd_ioobj	*ioo;
 	int			 obj_count;
+	int			 rc;
 
 	ENTRY;
 
@@ -217,10 +288,6 @@ static int tgt_io_data_unpack(struct tgt_session_info *tsi, struct ost_id *oi)
 	if (obj_count == 0) {
 		CERROR("%s: short ioobj\n", tgt_name(tsi->tsi_tgt));
 		RETURN(-EPROTO);
-	} else if (obj_count > 1) {
-		CERROR("%s: too many ioobjs (%d)\n", tgt_name(tsi->tsi_tgt),
-		       obj_count);
-		RETURN(-EPROTO);
 	}
 
 	if (ioo->ioo_bufcnt == 0) {
@@ -228,6 +295,12 @@ static int tgt_io_data_unpack(struct tgt_session_info *tsi, struct ost_id *oi)
 		RETURN(-EPROTO);
 	}
 
+	if (obj_count > 1) {
+		rc = tgt_io_multiobj_unpack(tsi, ioo, obj_count);
+		if (rc != 0)
+			RETURN(rc);
+	}
+
 	if (ioo->ioo_bufcnt > PTLRPC_MAX_BRW_PAGES) {
 		DEBUG_REQ(D_RPCTRACE, tgt_ses_req(tsi),
 			  "bulk has too many pages (%d)",
@@ -2185,12 +2258,23 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 			sizeof(*remote_nb))
 		RETURN(err_serious(-EPROTO));
 
+	/* server-side locking covers a single object only, so a client is
+	 * not expected to pack lockless pages of several objects together */
+	if (objcount > 1) {
+		for (i = 0; i < niocount; i++)
+			if (remote_nb[i].rnb_flags & OBD_BRW_SRVLOCK)
+				RETURN(err_serious(-EPROTO));
+	}
+
 	if ((remote_nb[0].rnb_flags & OBD_BRW_MEMALLOC) &&
 	    ptlrpc_connection_is_local(exp->exp_connection))
 		memory_pressure_set();
 
 	req_capsule_set_size(&req->rq_pill, &RMF_RCS, RCL_SERVER,
 			     niocount * sizeof(*rcs));
+	/* filled by obd_commitrw() for the objects after the first one */
+	req_capsule_set_size(&req->rq_pill, &RMF_OST_BRW_ATTRS, RCL_SERVER,
+			     (objcount - 1) * sizeof(struct obdo));
 	rc = req_capsule_server_pack(&req->rq_pill);
 	if (rc != 0)
 		GOTO(out, rc = err_serious(rc));
@@ -4110,6 +4110,46 @@ test_53b() {
 }
 run_test 53b "check MDS thread count params"
 
+test_53c() {
+	[ $(lustre_version_code ost1) -lt $(version_code 2.10.54) ] &&
+		skip "Need OST version at least 2.10.54" && return
+
+	setup
+	local param=ost.OSS.ost_io
+	local tmin=$(do_facet ost1 "$LCTL get_param -n $param.threads_min")
+	local old=$(do_facet ost1 \
+		    "$LCTL get_param -n $param.threads_idle_timeout")
+	local i
+
+	do_facet ost1 "$LCTL set_param $param.threads_idle_timeout=2" ||
+		error "failed to set threads_idle_timeout"
+
+	# make the thread pool grow
+	for i in $(seq 32); do
+		dd if=/dev/zero of=$DIR/$tfile.$i bs=1M count=8 \
+			oflag=direct 2>/dev/null &
+	done
+	wait
+	local grown=$(do_facet ost1 "$LCTL get_param -n $param.threads_started")
+
+	# idle timeout, twice, for the hysteresis
+	sleep 10
+	local started=$(do_facet ost1 \
+			"$LCTL get_param -n $param.threads_started")
+	echo "threads_min $tmin, after load $grown, when idle $started"
+
+	do_facet ost1 "$LCTL set_param $param.threads_idle_timeout=$old"
+	rm -f $DIR/$tfile.*
+
+	(( grown > tmin )) ||
+		error "thread pool did not grow: $grown, threads_min $tmin"
+	(( started >= tmin )) || error "$started threads below threads_min"
+	(( started < grown )) ||
+		error "idle threads did not exit: $started of $grown"
+	cleanup || error "cleanup failed with $?"
+}
+run_test 53c "check idle OSS threads exit"
+
 test_54a() {
 	if [ $(facet_fstype $SINGLEMDS) != ldiskfs ]; then
 		skip "ldiskfs only test"
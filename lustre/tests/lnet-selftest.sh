@@ -28,6 +28,9 @@ if [ "$SLOW" = no ]; then
     [ $smoke_DURATION -le 300 ] || smoke_DURATION=300
 fi
 
+# a router forwarding between the clients and the servers, if any
+LNET_ROUTER=${LNET_ROUTER:-}
+
 nodes=$(comma_list "$(osts_nodes) $(mdts_nodes)")
 lst_SERVERS=${lst_SERVERS:-$(comma_list "$(host_nids_address $nodes $NETTYPE)")}
 lst_CLIENTS=${lst_CLIENTS:-$(comma_list "$(host_nids_address $CLIENTS $NETTYPE)")}
@@ -181,6 +184,771 @@ test_smoke () {
 }
 run_test smoke "lst regression test"
 
+test_lat_mix_sub () {
+	local servers=$1
+	local clients=$2
+
+	local nc=$(echo ${clients//,/ } | wc -w)
+	local ns=$(echo ${servers//,/ } | wc -w)
+
+	echo '#!/bin/bash'
+	echo 'set -e'
+	# LST_FEAT_BULK_LEN | LST_FEAT_LAT_STATS | LST_FEAT_BULK_MIX
+	echo 'export LST_FEATURES=7'
+
+	echo "$LST new_session --timeo 100000 hh"
+	echo "$LST add_group c $(nids_list $clients)"
+	echo "$LST add_group s $(nids_list $servers)"
+	echo "$LST add_batch b"
+
+	for t in "brw read" "brw write" ; do
+		echo -n "$LST add_test --batch b --loop $lst_LOOP"
+		echo -n " --concurrency 8 --distribute ${nc}:${ns}"
+		echo " --from c --to s $t check=full mix=4k:70,64k:20,1m:10"
+	done
+
+	echo $LST run b
+	echo sleep 1
+	echo "$LST stat --lat --delay 5 --timeout 10 --count 2 c"
+}
+
+test_lat_mix () {
+	lst_prepare
+
+	local servers=$lst_SERVERS
+	local clients=$lst_CLIENTS
+
+	local runlst=$TMP/lat_mix.sh
+
+	local log=$TMP/$tfile.log
+	local rc=0
+
+	test_lat_mix_sub $servers $clients 2>&1 > $runlst
+
+	cat $runlst
+
+	run_lst $runlst | tee $log
+	rc=${PIPESTATUS[0]}
+	[ $rc = 0 ] || { _restore_mount; error "$runlst failed: $rc"; }
+
+	grep -q "RPC Latency of c" $log ||
+		{ _restore_mount; error "no RPC latency reported"; }
+
+	lst_end_session --verbose | tee -a $log
+
+	check_lst_err $log
+	lst_cleanup_all
+}
+run_test lat_mix "lst brw size mix and RPC latency"
+
+# first NID of the MDS, if it is not a NID of this node
+remote_server_nid () {
+	local nid=$(do_facet mds1 $LCTL list_nids | head -n1)
+
+	$LCTL list_nids | grep -qx "$nid" || echo $nid
+}
+
+# lowest health of the local NIs on network $1
+ni_health () {
+	$LCTL get_param -n nis | awk -v net="@$1" '
+		index($1, net) && (min == "" || $NF < min) { min = $NF }
+		END { print min }'
+}
+
+test_health_resend () {
+	local nid=$(remote_server_nid)
+	local param=/sys/module/lnet/parameters
+	local interval
+	local resent
+	local health
+
+	[ -n "$nid" ] || { skip "needs a remote server NID"; return 0; }
+	[ -w $param/lnet_retry_count ] ||
+		{ skip "LNet has no health support"; return 0; }
+	[ $(cat $param/lnet_retry_count) -gt 0 ] ||
+		{ skip "lnet_retry_count is 0"; return 0; }
+
+	# keep the failures charged to the NI for the length of the test
+	interval=$(cat $param/lnet_recovery_interval)
+	echo 3600 > $param/lnet_recovery_interval
+
+	# fail every GET to $nid on this node with ENETDOWN, a local error
+	$LCTL net_drop_add -s '*' -d $nid -r 1 -m GET -e 100 || {
+		echo $interval > $param/lnet_recovery_interval
+		_restore_mount
+		error "net_drop_add failed"
+	}
+	$LCTL ping $nid && echo "ping $nid went through a failing rule"
+	$LCTL net_drop_list
+	resent=$($LCTL net_drop_list |
+		 sed -ne 's/.* GET \([0-9]*\),.*/\1/p' | head -n1)
+	health=$(ni_health ${nid#*@})
+	$LCTL get_param nis
+	$LCTL net_drop_del -a
+	echo $interval > $param/lnet_recovery_interval
+
+	# the first GET and at least one resend of it failed
+	[ ${resent:-0} -ge 2 ] ||
+		{ _restore_mount; error "failed GET was not resent: $resent"; }
+	[ -n "$health" ] && [ $health -lt 1000 ] ||
+		{ _restore_mount; error "NI health did not drop: $health"; }
+	$LCTL ping $nid ||
+		{ _restore_mount; error "ping $nid failed after rule removal"; }
+}
+run_test health_resend "failed sends lower NI health and are resent"
+
+# references held on the local NIs of network $1, summed over all CPTs
+ni_refs () {
+	$LCTL get_param -n nis | awk -v net="@$1" '
+		index($1, net) { refs += $4 } END { print refs + 0 }'
+}
+
+# field $1 ("hits" or "misses") of lnet.path_cache
+path_cache_count () {
+	$LCTL get_param -n path_cache | sed -ne "s/.*$1: \([0-9]*\).*/\1/p"
+}
+
+test_path_cache_del () {
+	local nid=$(remote_server_nid)
+	local hits
+	local misses
+	local refs
+	local new_refs
+	local i
+
+	[ -n "$nid" ] || { skip "needs a remote server NID"; return 0; }
+	which lnetctl > /dev/null 2>&1 || { skip "needs lnetctl"; return 0; }
+
+	for i in 1 2 3; do
+		$LCTL ping $nid > /dev/null ||
+			{ _restore_mount; error "ping $nid failed"; }
+	done
+	hits=$(path_cache_count hits)
+	$LCTL ping $nid > /dev/null
+	[ $(path_cache_count hits) -gt $hits ] ||
+		{ skip "path to $nid is not cached"; return 0; }
+
+	refs=$(ni_refs ${nid#*@})
+	lnetctl peer del --prim_nid $nid ||
+		{ _restore_mount; error "lnetctl peer del $nid failed"; }
+	# the cached paths to $nid held NI references, which must go
+	for i in $(seq 10); do
+		new_refs=$(ni_refs ${nid#*@})
+		[ $new_refs -lt $refs ] && break
+		sleep 1
+	done
+	echo "NI refs before peer del $refs, after $new_refs"
+	[ $new_refs -lt $refs ] ||
+		{ _restore_mount; error "NI refs not dropped: $new_refs"; }
+
+	# the next send must go through a full selection to the new peer_ni
+	misses=$(path_cache_count misses)
+	$LCTL ping $nid > /dev/null ||
+		{ _restore_mount; error "ping $nid failed after peer del"; }
+	[ $(path_cache_count misses) -gt $misses ] ||
+		{ _restore_mount; error "ping used the path of a deleted peer"; }
+}
+run_test path_cache_del "deleting a peer NI flushes its cached paths"
+
+# selection policy of network $1, as shown by lnetctl
+net_sel_policy () {
+	lnetctl net show --net $1 | awk '/selection:/ { print $2 }'
+}
+
+test_sel_policy () {
+	local net=$($LCTL list_nids | head -n1)
+	local policy
+
+	which lnetctl > /dev/null 2>&1 || { skip "needs lnetctl"; return 0; }
+	net=${net#*@}
+
+	lnetctl net set --net $net --selection latency ||
+		{ _restore_mount; error "cannot set $net selection to latency"; }
+	policy=$(net_sel_policy $net)
+	lnetctl net set --net $net --selection credits ||
+		{ _restore_mount; error "cannot set $net selection to credits"; }
+	[ "$policy" = "latency" ] ||
+		{ _restore_mount; error "$net selection is '$policy'"; }
+	policy=$(net_sel_policy $net)
+	[ "$policy" = "credits" ] ||
+		{ _restore_mount; error "$net selection is '$policy'"; }
+
+	lnetctl net set --net $net --selection fastest 2> /dev/null &&
+		{ _restore_mount; error "invalid selection policy accepted"; }
+	policy=$(net_sel_policy $net)
+	[ "$policy" = "credits" ] ||
+		{ _restore_mount; error "$net selection is '$policy'"; }
+}
+run_test sel_policy "set and read back the peer NI selection policy"
+
+# run a short lst load of test $2 (e.g. "ping") from the clients to the
+# servers, $3 (default 8) at a time, logged in $TMP/$1.log
+lst_load_run () {
+	local name=$1
+	local test=$2
+	local concur=${3:-8}
+	local servers=$lst_SERVERS
+	local clients=$lst_CLIENTS
+	local nc=$(echo ${clients//,/ } | wc -w)
+	local ns=$(echo ${servers//,/ } | wc -w)
+	local runlst=$TMP/$name.sh
+	local log=$TMP/$name.log
+	local rc
+
+	lst_prepare
+
+	{
+		echo '#!/bin/bash'
+		echo 'set -e'
+		echo "$LST new_session --timeo 100000 hh"
+		echo "$LST add_group c $(nids_list $clients)"
+		echo "$LST add_group s $(nids_list $servers)"
+		echo "$LST add_batch b"
+		echo -n "$LST add_test --batch b --loop $lst_LOOP"
+		echo -n " --concurrency $concur --distribute ${nc}:${ns}"
+		echo " --from c --to s $test"
+		echo "$LST run b"
+		echo sleep 1
+		echo "$LST stat --delay 5 --timeout 10 --count 2 c"
+	} > $runlst
+	cat $runlst
+
+	run_lst $runlst | tee $log
+	rc=${PIPESTATUS[0]}
+	[ $rc = 0 ] || { _restore_mount; error "$runlst failed: $rc"; }
+
+	lst_end_session --verbose | tee -a $log
+	check_lst_err $log
+	lst_cleanup_all
+}
+
+# lst brw write load of $2 sized bulks, see lst_load_run
+lst_brw_run () {
+	lst_load_run $1 "brw write check=full size=${2:-1M}"
+}
+
+# last average "Rates" (RPC/s) or "Bandwidth" (MiB/s) of the clients in
+# lst log $1, sent ($3 = W, the default) or received ($3 = R)
+lst_log_avg () {
+	awk -v what="$2" -v dir="[${3:-W}]" '
+		$0 ~ "^\\[LNet " what " of c\\]" { hdr = 1; next }
+		/^\[LNet / { hdr = 0 }
+		hdr && $1 == dir { v = $3 }
+		END { print v + 0 }' $1
+}
+
+# field $2 of descriptor pool $1 in "lnetctl stats show"
+lnet_pool_count () {
+	lnetctl stats show | awk -v pool="$1:" -v field="$2:" '
+		$1 == "pools:" { in_pools = 1; next }
+		in_pools && $1 == pool { in_pool = 1; next }
+		in_pool && $1 == field { print $2; exit }'
+}
+
+test_obj_pools () {
+	local net=$($LCTL list_nids | head -n1)
+	local hits
+	local free
+	local max
+	local iface
+
+	which lnetctl > /dev/null 2>&1 || { skip "needs lnetctl"; return 0; }
+	[ -n "$(lnet_pool_count msg max)" ] ||
+		{ skip "LNet has no descriptor pools"; return 0; }
+	net=${net#*@}
+
+	hits=$(lnet_pool_count msg hits)
+	lst_brw_run obj_pools 64k
+	echo "msg pool hits before $hits, after $(lnet_pool_count msg hits)"
+	[ $(lnet_pool_count msg hits) -gt $hits ] ||
+		{ _restore_mount; error "brw load did not use the msg pool"; }
+
+	# drop_caches runs every registered shrinker
+	free=$(lnet_pool_count msg free)
+	[ $free -gt 0 ] || { _restore_mount; error "msg pool is empty"; }
+	sync
+	echo 2 > /proc/sys/vm/drop_caches
+	echo "msg pool free before shrink $free, after" \
+	     "$(lnet_pool_count msg free)"
+	[ $(lnet_pool_count msg free) -lt $free ] ||
+		{ _restore_mount; error "shrinker did not drain the pools"; }
+
+	# adding a net resizes and refills the pools, removing it shrinks them
+	[[ $net = tcp* ]] || { echo "resize needs a tcp net, not $net"; return; }
+	iface=$(lnetctl net show --net $net -v |
+		awk '/interfaces:/ { getline; print $2; exit }')
+	max=$(lnet_pool_count msg max)
+	lnetctl net add --net tcp999 --if $iface --credits 1024 ||
+		{ _restore_mount; error "cannot add tcp999 on $iface"; }
+	echo "msg pool max before net add $max, after" \
+	     "$(lnet_pool_count msg max)"
+	[ $(lnet_pool_count msg max) -gt $max ] || {
+		lnetctl net del --net tcp999
+		_restore_mount
+		error "msg pool was not grown"
+	}
+	[ $(lnet_pool_count msg free) -gt 0 ] || {
+		lnetctl net del --net tcp999
+		_restore_mount
+		error "msg pool was not refilled"
+	}
+	lnetctl net del --net tcp999 ||
+		{ _restore_mount; error "cannot delete tcp999"; }
+	[ $(lnet_pool_count msg max) -eq $max ] ||
+		{ _restore_mount; error "msg pool was not shrunk back"; }
+}
+run_test obj_pools "LNet descriptor pools fill, shrink and resize"
+
+# buffers in the large router buffer pools of node $1, summed over all CPTs
+rtr_large_buffers () {
+	do_node $1 $LCTL get_param -n buffers |
+		awk '$1 == 256 { n += $2 } END { print n + 0 }'
+}
+
+test_rtr_buffers_auto () {
+	local param=/sys/module/lnet/parameters
+	local large
+	local auto
+	local before
+	local grown
+	local now
+	local i
+
+	[ -n "$LNET_ROUTER" ] || {
+		skip "set LNET_ROUTER to a router between clients and servers"
+		return 0
+	}
+	do_node $LNET_ROUTER "[ -w $param/router_buffers_auto ]" ||
+		{ skip "no router_buffers_auto on $LNET_ROUTER"; return 0; }
+
+	large=$(do_node $LNET_ROUTER cat $param/large_router_buffers)
+	auto=$(do_node $LNET_ROUTER cat $param/router_buffers_auto)
+	# start from the smallest large pool, so that a 1M brw load queues
+	do_node $LNET_ROUTER lnetctl set large_buffers 16
+	do_node $LNET_ROUTER "echo 1 > $param/router_buffers_auto"
+	before=$(rtr_large_buffers $LNET_ROUTER)
+
+	lst_brw_run rtr_buffers_auto 1M
+	grown=$(rtr_large_buffers $LNET_ROUTER)
+	do_node $LNET_ROUTER $LCTL get_param buffers buffers_history
+	echo "large router buffers before load $before, after $grown"
+	[ $grown -gt $before ] || {
+		do_node $LNET_ROUTER "echo $auto > $param/router_buffers_auto"
+		do_node $LNET_ROUTER lnetctl set large_buffers $large
+		_restore_mount
+		error "large router buffers did not grow under load"
+	}
+
+	# pools more than half idle for 30 passes are shrunk
+	for i in $(seq 90); do
+		now=$(rtr_large_buffers $LNET_ROUTER)
+		[ $now -lt $grown ] && break
+		sleep 1
+	done
+	echo "large router buffers after ${i}s idle: $now"
+	do_node $LNET_ROUTER "echo $auto > $param/router_buffers_auto"
+	do_node $LNET_ROUTER lnetctl set large_buffers $large
+	[ $now -lt $grown ] ||
+		{ _restore_mount; error "idle large router buffers not freed"; }
+	[ $now -ge $before ] ||
+		{ _restore_mount; error "large router buffers shrunk below $before"; }
+}
+run_test rtr_buffers_auto "router buffer pools grow under load, shrink idle"
+
+# match tables of node $1 which fell back to scanning MEs with ignore bits
+masks_off () {
+	do_node $1 $LCTL get_param -n portal_match |
+		sed -ne 's/.*masks_off: \([0-9]*\).*/\1/p'
+}
+
+test_me_masks () {
+	local servers=$(comma_list $(osts_nodes) $(mdts_nodes))
+	local before
+	local server
+	local -A server_before
+
+	[ -n "$(masks_off $HOSTNAME)" ] ||
+		{ skip "LNet has no ignore-bits index"; return 0; }
+
+	# the client posts its reply and bulk buffers with 24 ignore masks,
+	# the servers LNetMEInsert() next to their request buffers
+	before=$(masks_off $HOSTNAME)
+	for server in ${servers//,/ }; do
+		server_before[$server]=$(masks_off $server)
+	done
+	$LCTL set_param fail_loc=0xe001
+	do_nodes $servers $LCTL set_param fail_loc=0xe002
+
+	# check=full makes lst verify that matching picked the right buffers
+	lst_brw_run me_masks 64k
+	$LCTL set_param fail_loc=0
+	do_nodes $servers $LCTL set_param fail_loc=0
+
+	echo "$HOSTNAME tables with the index off: $before -> $(masks_off $HOSTNAME)"
+	[ $(masks_off $HOSTNAME) -gt $before ] ||
+		{ _restore_mount; error "index kept with more than 16 masks"; }
+	for server in ${servers//,/ }; do
+		echo "$server tables with the index off:" \
+		     "${server_before[$server]} -> $(masks_off $server)"
+		[ $(masks_off $server) -gt ${server_before[$server]} ] || {
+			_restore_mount
+			error "$server kept the index after LNetMEInsert"
+		}
+	done
+}
+run_test me_masks "ignore-bits index falls back to list scanning"
+
+# set socklnd parameter $1 to $2 on this node and the servers
+socklnd_param_set () {
+	local nodes=$(comma_list $HOSTNAME $(osts_nodes) $(mdts_nodes))
+
+	do_nodes $nodes "echo $2 > /sys/module/ksocklnd/parameters/$1"
+}
+
+# total of column $1 ("batches" or "rx_direct") of socklnd_batch
+sock_batch_count () {
+	$LCTL get_param -n socklnd_batch | awk -v col=$1 '
+		NR == 1 { for (i = 1; i <= NF; i++) if ($i == col) c = i; next }
+		{ n += $c }
+		END { print n + 0 }'
+}
+
+test_sock_batch () {
+	local param=/sys/module/ksocklnd/parameters
+	local tx_batch
+	local rx_direct
+	local mode
+	local -A bws
+	local -A rates
+	local -A batches
+	local -A directs
+
+	[ -w $param/tx_batch -a -w $param/rx_direct ] ||
+		{ skip "needs ksocklnd with tx_batch and rx_direct"; return 0; }
+	$LCTL list_param socklnd_batch > /dev/null 2>&1 ||
+		{ skip "no socklnd_batch stats"; return 0; }
+	tx_batch=$(cat $param/tx_batch)
+	rx_direct=$(cat $param/rx_direct)
+
+	# "off" is the plain path: one tx per sendmsg, recvmsg into kmaps
+	for mode in off on; do
+		if [ $mode = on ]; then
+			socklnd_param_set tx_batch 8
+			socklnd_param_set rx_direct 1
+		else
+			socklnd_param_set tx_batch 1
+			socklnd_param_set rx_direct 0
+		fi
+		batches[$mode]=$(sock_batch_count batches)
+		directs[$mode]=$(sock_batch_count rx_direct)
+		lst_brw_run sock_batch_brw_$mode 1M
+		bws[$mode]=$(lst_log_avg $TMP/sock_batch_brw_$mode.log Bandwidth)
+		lst_load_run sock_batch_ping_$mode ping
+		rates[$mode]=$(lst_log_avg $TMP/sock_batch_ping_$mode.log Rates)
+		batches[$mode]=$(($(sock_batch_count batches) - ${batches[$mode]}))
+		directs[$mode]=$(($(sock_batch_count rx_direct) - ${directs[$mode]}))
+		echo "$mode: ${batches[$mode]} batched sends," \
+		     "${directs[$mode]} direct receives"
+	done
+	socklnd_param_set tx_batch $tx_batch
+	socklnd_param_set rx_direct $rx_direct
+	$LCTL get_param socklnd_batch
+
+	# throughput depends on the nodes and the network, so only report it
+	log "brw 1M: ${bws[off]} MiB/s plain, ${bws[on]} MiB/s batched/direct"
+	log "ping: ${rates[off]} RPC/s plain, ${rates[on]} RPC/s batched/direct"
+
+	[ ${batches[off]} -eq 0 ] ||
+		{ _restore_mount; error "batched sends with tx_batch=1"; }
+	[ ${directs[off]} -eq 0 ] ||
+		{ _restore_mount; error "direct receives with rx_direct=0"; }
+	[ ${batches[on]} -gt 0 ] ||
+		{ _restore_mount; error "no batched sends with tx_batch=8"; }
+	[ ${directs[on]} -gt 0 ] ||
+		{ _restore_mount; error "no direct receives with rx_direct=1"; }
+}
+run_test sock_batch "lst brw and ping with socklnd tx batching and rx_direct"
+
+# socklnd connections of this node to $1 on net $2
+sock_conns () {
+	$LCTL --net $2 conn_list |
+		awk -v id="-$1" '
+			substr($1, length($1) - length(id) + 1) == id { n++ }
+			END { print n + 0 }'
+}
+
+test_sock_conns () {
+	local param=/sys/module/ksocklnd/parameters
+	local nid=$(remote_server_nid)
+	local net=${nid#*@}
+	local saved
+	local ntypes=1
+	local want
+	local conns
+	local i
+	local j
+
+	[ -n "$nid" ] || { skip "needs a remote server NID"; return 0; }
+	[[ $net = tcp* ]] || { skip "needs a tcp network, not $net"; return 0; }
+	[ -w $param/conns_per_peer ] ||
+		{ skip "ksocklnd has no conns_per_peer"; return 0; }
+
+	saved=$(cat $param/conns_per_peer)
+	# control, bulk in and bulk out
+	[ $(cat $param/typed_conns) -ne 0 ] && ntypes=3
+
+	for i in 2 4; do
+		want=$((i * ntypes))
+		echo $i > $param/conns_per_peer
+		$LCTL --net $net disconnect $nid
+		$LCTL ping $nid > /dev/null ||
+			{ _restore_mount; error "ping $nid failed"; }
+		for j in $(seq 10); do
+			conns=$(sock_conns $nid $net)
+			[ $conns -ge $want ] && break
+			sleep 1
+		done
+		$LCTL --net $net conn_list
+		echo "conns_per_peer=$i: $conns connections to $nid"
+		[ $conns -eq $want ] || {
+			echo $saved > $param/conns_per_peer
+			_restore_mount
+			error "$conns connections to $nid, not $want"
+		}
+	done
+
+	echo $saved > $param/conns_per_peer
+	$LCTL --net $net disconnect $nid
+	$LCTL ping $nid > /dev/null ||
+		{ _restore_mount; error "ping $nid failed"; }
+}
+run_test sock_conns "socklnd opens conns_per_peer connections per type"
+
+# total of column $1 ("polls" or "hits") of socklnd_busy_poll
+sock_busy_poll_count () {
+	$LCTL get_param -n socklnd_busy_poll | awk -v col=$1 '
+		NR == 1 { for (i = 1; i <= NF; i++) if ($i == col) c = i; next }
+		{ n += $c }
+		END { print n + 0 }'
+}
+
+test_sock_busy_poll () {
+	local param=/sys/module/ksocklnd/parameters
+	local threads
+	local polls
+	local hits
+
+	[ -w $param/busy_poll_threads ] ||
+		{ skip "ksocklnd has no busy_poll_threads"; return 0; }
+	$LCTL list_param socklnd_busy_poll > /dev/null 2>&1 ||
+		{ skip "no socklnd_busy_poll stats"; return 0; }
+	threads=$(cat $param/busy_poll_threads)
+
+	echo 0 > $param/busy_poll_threads
+	polls=$(sock_busy_poll_count polls)
+	lst_load_run sock_busy_poll_off ping
+	echo "polls with busy_poll_threads=0: $polls ->" \
+	     "$(sock_busy_poll_count polls)"
+	[ $(sock_busy_poll_count polls) -eq $polls ] || {
+		echo $threads > $param/busy_poll_threads
+		_restore_mount
+		error "schedulers polled with busy_poll_threads=0"
+	}
+
+	echo 1 > $param/busy_poll_threads
+	hits=$(sock_busy_poll_count hits)
+	lst_load_run sock_busy_poll_on ping
+	echo $threads > $param/busy_poll_threads
+	$LCTL get_param socklnd_busy_poll
+	echo "polls with busy_poll_threads=1: $polls ->" \
+	     "$(sock_busy_poll_count polls)"
+	[ $(sock_busy_poll_count polls) -gt $polls ] ||
+		{ _restore_mount; error "no scheduler busy-polled"; }
+	[ $(sock_busy_poll_count hits) -gt $hits ] ||
+		{ _restore_mount; error "busy-polling never found work"; }
+}
+run_test sock_busy_poll "socklnd schedulers busy-poll only when enabled"
+
+# sum of "lnetctl net show -v" statistic $2 over the NIs of nodes $1,
+# counting only 0@lo if $3 is "lo" and only the other NIs otherwise
+ni_stat_sum () {
+	do_nodes $1 "lnetctl net show -v" | awk -v stat="$2:" -v lo=$3 '
+		/ nid: / { onlo = ($NF ~ /@lo$/) }
+		$(NF - 1) == stat && onlo == (lo == "lo") { n += $NF }
+		END { print n + 0 }'
+}
+
+test_lo_parse () {
+	local node=$(hostname)
+	local n=100
+	local rcvd
+	local i
+
+	which lnetctl > /dev/null 2>&1 || { skip "needs lnetctl"; return 0; }
+
+	rcvd=$(ni_stat_sum $node recv_count lo)
+	for ((i = 0; i < n; i++)); do
+		$LCTL ping 0@lo > /dev/null ||
+			{ _restore_mount; error "ping 0@lo failed"; }
+	done
+	rcvd=$(($(ni_stat_sum $node recv_count lo) - rcvd))
+	echo "$n pings of 0@lo, $rcvd messages received on 0@lo"
+	# the GET and the REPLY of each ping
+	[ $rcvd -ge $((n * 2)) ] ||
+		{ _restore_mount; error "$n pings, $rcvd received on 0@lo"; }
+
+	# loopback messages still go through the drop rules
+	$LCTL net_drop_add -s '*' -d 0@lo -r 1 ||
+		{ _restore_mount; error "net_drop_add failed"; }
+	$LCTL ping 0@lo > /dev/null 2>&1
+	i=$?
+	$LCTL net_drop_del -a
+	[ $i -ne 0 ] ||
+		{ _restore_mount; error "ping 0@lo not dropped by the rule"; }
+	$LCTL ping 0@lo > /dev/null ||
+		{ _restore_mount; error "ping 0@lo failed after the rule"; }
+}
+run_test lo_parse "loopback messages are received without lnet_parse()"
+
+# milliseconds "lctl ping $1" takes
+ping_ms () {
+	local start=$(date +%s%N)
+
+	$LCTL ping $1 > /dev/null || return 1
+	echo $((($(date +%s%N) - start) / 1000000))
+}
+
+# check that $2 pings of $1 all take between $3 and $4 milliseconds
+check_ping_ms () {
+	local nid=$1
+	local count=$2
+	local min=$3
+	local max=$4
+	local ms
+	local i
+
+	for i in $(seq $count); do
+		ms=$(ping_ms $nid) || return 1
+		echo "ping $nid: ${ms}ms, expected ${min}-${max}ms"
+		[ $ms -ge $min -a $ms -le $max ] || return 1
+	done
+}
+
+test_delay_shaping () {
+	local nid=$(remote_server_nid)
+	local base
+	local bw
+
+	[ -n "$nid" ] || { skip "needs a remote server NID"; return 0; }
+
+	base=$(ping_ms $nid) || { _restore_mount; error "ping $nid failed"; }
+
+	# replies from $nid are held for 200ms on this node
+	$LCTL net_delay_add -s $nid -d '*' -r 1 -l 200ms ||
+		{ _restore_mount; error "net_delay_add --latency failed"; }
+	check_ping_ms $nid 5 200 $((base + 300)) || {
+		$LCTL net_delay_del -a
+		_restore_mount
+		error "--latency 200ms not applied"
+	}
+	$LCTL net_delay_del -a
+
+	$LCTL net_delay_add -s $nid -d '*' -r 1 -l 200ms -j 100 ||
+		{ _restore_mount; error "net_delay_add --jitter failed"; }
+	check_ping_ms $nid 10 100 $((base + 400)) || {
+		$LCTL net_delay_del -a
+		_restore_mount
+		error "--jitter 100 not applied"
+	}
+	$LCTL net_delay_del -a
+
+	# 10MiB/s for all bulk read into this node
+	$LCTL net_delay_add -s '*' -d '*' -r 1 -l 0 -b 10240 ||
+		{ _restore_mount; error "net_delay_add --bandwidth failed"; }
+	lst_load_run delay_shaping "brw read check=full size=1M"
+	$LCTL net_delay_list
+	$LCTL net_delay_del -a
+	bw=$(lst_log_avg $TMP/delay_shaping.log Bandwidth R)
+	echo "brw read through a 10MiB/s rule: $bw MiB/s"
+	awk -v bw=$bw 'BEGIN { exit !(bw > 0 && bw <= 12) }' ||
+		{ _restore_mount; error "--bandwidth 10MiB/s gave $bw MiB/s"; }
+}
+run_test delay_shaping "delay rule latency, jitter and bandwidth"
+
+# number of peers of this node that ran out of send credits
+peers_queued () {
+	$LCTL get_param -n peers | awk 'NR > 1 && $9 < 0 { n++ }
+				       END { print n + 0 }'
+}
+
+test_coalesce () {
+	local param=/sys/module/lnet/parameters
+	local nodes=$(comma_list ${lst_CLIENTS//,/ } ${lst_SERVERS//,/ })
+	local saved
+	local sent
+	local rcvd
+	local lo
+
+	which lnetctl > /dev/null 2>&1 || { skip "needs lnetctl"; return 0; }
+	[ -w $param/lnet_coalesce_size ] ||
+		{ skip "LNet does not bundle PUTs"; return 0; }
+	saved=$(cat $param/lnet_coalesce_size)
+
+	sent=$(ni_stat_sum $nodes send_count)
+	rcvd=$(ni_stat_sum $nodes recv_count)
+	lo=$(ni_stat_sum $nodes recv_count lo)
+
+	# enough pings in flight to run the peers out of credits, so the
+	# queued requests and replies go out in bundles
+	do_nodes $nodes "echo 4096 > $param/lnet_coalesce_size"
+	lst_load_run coalesce ping 64
+	do_nodes $nodes "echo $saved > $param/lnet_coalesce_size"
+
+	sent=$(($(ni_stat_sum $nodes send_count) - sent))
+	rcvd=$(($(ni_stat_sum $nodes recv_count) - rcvd))
+	lo=$(($(ni_stat_sum $nodes recv_count lo) - lo))
+	echo "sent $sent, received $rcvd, received on 0@lo $lo"
+
+	[ $(peers_queued) -gt 0 ] ||
+		{ _restore_mount; error "no peer ran out of credits"; }
+	# every bundled PUT is counted once on each side, on the NI the
+	# bundle went over; allow 1% for the other traffic of the servers
+	awk -v s=$sent -v r=$rcvd \
+		'BEGIN { d = s - r; exit !(s > 0 && d * d <= s * s / 10000) }' ||
+		{ _restore_mount; error "sent $sent PUTs, received $rcvd"; }
+	[ $lo -lt 10 ] ||
+		{ _restore_mount; error "$lo messages received on 0@lo"; }
+}
+run_test coalesce "PUTs bundled when peer credits run out are delivered"
+
+# check that log $1 of "lnetctl stats stream" has a line of type $2 whose
+# PUT and bulk GET counters moved
+stats_stream_moved () {
+	awk -v type=$2 '
+		$2 == type && $4 > 0 && $9 > 0 && $5 + $10 > 0 { found = 1 }
+		END { exit !found }' $1
+}
+
+test_stats_stream () {
+	local log=$TMP/stats_stream.log
+	local pid
+
+	which lnetctl > /dev/null 2>&1 || { skip "needs lnetctl"; return 0; }
+
+	# one sample that spans the whole brw run
+	lnetctl stats stream --interval 60 --count 1 > $log &
+	pid=$!
+	lst_brw_run stats_stream 64k
+	wait $pid || { _restore_mount; error "lnetctl stats stream failed"; }
+	cat $log
+
+	stats_stream_moved $log ni ||
+		{ _restore_mount; error "no NI counters moved"; }
+	stats_stream_moved $log peer_ni ||
+		{ _restore_mount; error "no peer NI counters moved"; }
+}
+run_test stats_stream "lnetctl stats stream counters move under lst brw"
+
 complete $SECONDS
 _restore_mount
 exit_status
@@ -4598,6 +4598,39 @@ test_120() {
 }
 run_test 120 "DNE fail abort should stop both normal and DNE replay"
 
+mdc_replay_list_len() {
+	$LCTL get_param -n mdc.$FSNAME-MDT0000-mdc-*.import |
+		awk '/replay_list:/ { print $2 }'
+}
+
+test_121() {
+	local count=1000
+	local before
+	local after
+
+	mkdir -p $DIR/$tdir || error "mkdir $DIR/$tdir failed"
+	replay_barrier $SINGLEMDS
+	createmany -m $DIR/$tdir/f- $count ||
+		error "createmany $DIR/$tdir/f- failed"
+
+	before=$(mdc_replay_list_len)
+	[ $before -ge $count ] ||
+		error "replay_list $before, expected at least $count"
+
+	fail $SINGLEMDS
+	unlinkmany $DIR/$tdir/f- $count ||
+		error "unlinkmany $DIR/$tdir/f- failed"
+
+	# replies carry last_committed, which prunes the replay list
+	do_facet $SINGLEMDS "sync; sleep 1; sync"
+	touch $DIR/$tdir/last || error "touch $DIR/$tdir/last failed"
+	after=$(mdc_replay_list_len)
+	[ $after -lt $before ] ||
+		error "replay_list $after not pruned from $before"
+	rm -rf $DIR/$tdir
+}
+run_test 121 "client replay list is pruned after recovery"
+
 complete $SECONDS
 check_and_cleanup_lustre
 exit_status
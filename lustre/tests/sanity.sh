@@ -5610,6 +5610,32 @@ test_64c() {
 }
 run_test 64c "verify grant shrink"
 
+test_64d() {
+	local osc=$($LCTL dl | awk '/OST0000-osc-[^mM]/ { print $4 }')
+	local horizon=$($LCTL get_param -n osc.$osc.grant_horizon_ms)
+
+	[ -n "$horizon" ] || { skip "no grant forecasting" && return; }
+
+	$SETSTRIPE -i 0 -c 1 $DIR/$tfile || error "setstripe failed"
+	$LCTL set_param osc.$osc.grant_horizon_ms=2000
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=64 ||
+		error "dd failed"
+	$LCTL get_param osc.$osc.grant_forecast
+	local rate=$($LCTL get_param -n osc.$osc.grant_forecast |
+		     awk '/rate_bytes_per_sec/ { print $2 }')
+
+	$LCTL set_param osc.$osc.grant_horizon_ms=0
+	local forecast=$($LCTL get_param -n osc.$osc.grant_forecast |
+			 awk '/forecast_bytes/ { print $2 }')
+	$LCTL set_param osc.$osc.grant_horizon_ms=$horizon
+	rm -f $DIR/$tfile
+
+	[ -n "$rate" ] || error "no grant consumption rate reported"
+	[ "$forecast" -eq 0 ] ||
+		error "forecast $forecast with forecasting disabled"
+}
+run_test 64d "grant forecast follows writes and can be disabled"
+
 # bug 1414 - set/get directories' stripe info
 test_65a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
@@ -9073,6 +9099,122 @@ test_127b() { # bug LU-333
 }
 run_test 127b "verify the llite client stats are sane"
 
+test_127c() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	local nr
+
+	$LCTL set_param llite.*.fsync_stats=0
+	$LFS setstripe -c -1 $DIR/$tfile || error "setstripe $DIR/$tfile failed"
+	for i in 1 2 3 4; do
+		dd if=/dev/zero of=$DIR/$tfile bs=1M count=1 seek=$i \
+			conv=notrunc,fsync || error "dd $i failed"
+	done
+	$MULTIOP $DIR/$tfile Oyc || error "multiop fsync failed"
+
+	$LCTL get_param llite.*.fsync_stats
+	nr=$($LCTL get_param -n llite.*.fsync_stats |
+		awk '/^[0-9]+:/ { sum += $2 } END { print sum + 0 }')
+	[ $nr -ge 5 ] || error "expected at least 5 fsync calls, got $nr"
+	rm -f $DIR/$tfile
+
+	[ $OSTCOUNT -lt 2 ] && return
+
+	# with every OST_SYNC held for $delay seconds, syncing all stripes
+	# one after the other would take $OSTCOUNT * $delay seconds
+	local delay=3
+	local begin
+	local elapsed
+
+	$LFS setstripe -c $OSTCOUNT $DIR/$tfile ||
+		error "setstripe $DIR/$tfile failed"
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=$OSTCOUNT ||
+		error "dd failed"
+
+	#define OBD_FAIL_OST_PAUSE_SYNC		 0x23a
+	do_nodes $(comma_list $(osts_nodes)) \
+		$LCTL set_param fail_val=$delay fail_loc=0x23a
+	begin=$(date +%s)
+	$MULTIOP $DIR/$tfile Oyc
+	local rc=$?
+	elapsed=$(($(date +%s) - begin))
+	do_nodes $(comma_list $(osts_nodes)) \
+		$LCTL set_param fail_val=0 fail_loc=0
+	[ $rc -eq 0 ] || error "multiop fsync failed"
+
+	echo "fsync of $OSTCOUNT stripes took $elapsed s, $delay s per OST"
+	[ $elapsed -lt $((delay * 2)) ] ||
+		error "OST_SYNC RPCs were not sent in parallel (${elapsed}s)"
+	rm -f $DIR/$tfile
+}
+run_test 127c "verify the llite fsync latency histogram, parallel OST_SYNC"
+
+test_127d() {
+	local bufsize
+
+	$LFS setstripe -c 1 $DIR/$tfile || error "setstripe $DIR/$tfile failed"
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=1 || error "dd failed"
+	cat $DIR/$tfile > /dev/null
+
+	$LCTL get_param llite.*.page_overhead
+	bufsize=$($LCTL get_param -n llite.*.page_overhead |
+		awk '/^page_bufsize_max:/ { print $2; exit }')
+	[ -n "$bufsize" ] || error "no page_bufsize_max in page_overhead"
+	[ $bufsize -gt 0 ] || error "page_bufsize_max is $bufsize"
+	# keep in sync with the WARN_ON() in cl_object_page_init()
+	[ $bufsize -le 512 ] || error "per-page metadata $bufsize > 512 bytes"
+	rm -f $DIR/$tfile
+}
+run_test 127d "verify the llite per-page metadata overhead readout"
+
+test_127e() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	local osc=$($LCTL list_param osc.*-osc-[^mM]* | head -n1)
+	local old_check=$($LCTL get_param -n llite.*.unstable_stats |
+			  awk '/^unstable_check:/ { print $2; exit }')
+	local waits
+
+	[ -n "$osc" ] || { skip "no OSC found" && return; }
+	$LCTL get_param $osc.unstable_stats | grep -q throttle_waits ||
+		error "no throttle_waits in $osc.unstable_stats"
+
+	$LCTL set_param llite.*.unstable_stats=1
+	$LCTL set_param $osc.unstable_max_mb=1
+	$LCTL set_param $osc.unstable_stats=clear
+
+	$LFS setstripe -c 1 -i 0 $DIR/$tfile || error "setstripe failed"
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=16 ||
+		error "dd to $DIR/$tfile failed"
+	$LCTL get_param $osc.unstable_stats
+	waits=$($LCTL get_param -n $osc.unstable_stats |
+		awk '/^throttle_waits:/ { print $2 }')
+
+	$LCTL set_param $osc.unstable_max_mb=0
+	$LCTL set_param llite.*.unstable_stats=$old_check
+	rm -f $DIR/$tfile
+	[ -n "$waits" ] || error "cannot read throttle_waits"
+	[ $waits -gt 0 ] ||
+		error "16MB write with a 1MB budget was never throttled"
+}
+run_test 127e "per-OSC unstable page budget and throttle stats"
+
+test_127f() {
+	local rc
+
+	$LFS setstripe -c $OSTCOUNT $DIR/$tfile ||
+		error "setstripe $DIR/$tfile failed"
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=$OSTCOUNT ||
+		error "dd failed"
+
+	#define OBD_FAIL_OST_SYNC_ERR		 0x23b
+	do_facet ost1 $LCTL set_param fail_loc=0x23b
+	$MULTIOP $DIR/$tfile Oyc
+	rc=$?
+	do_facet ost1 $LCTL set_param fail_loc=0
+	rm -f $DIR/$tfile
+	[ $rc -ne 0 ] || error "fsync succeeded while OST_SYNC failed"
+}
+run_test 127f "fsync returns the error of a failed OST_SYNC"
+
 test_128() { # bug 15212
 	touch $DIR/$tfile
 	$LFS 2>&1 <<-EOF | tee $TMP/$tfile.log
@@ -12680,12 +12822,12 @@ test_215() { # for bugs 18102, 21079, 21517
 	remove_lnet_proc_files "routers"
 
 	# lnet.peers should look like this:
-	# nid refs state last max rtr min tx min queue
+	# nid refs state last max rtr min tx min queue latency
 	# where nid is a string like 192.168.1.1@tcp2, refs > 0,
 	# state is up/down/NA, max >= 0. last, rtr, min, tx, min are
-	# numeric (0 or >0 or <0), queue >= 0.
-	L1="^nid +refs +state +last +max +rtr +min +tx +min +queue$"
-	BR="^$NID +$P +(up|down|NA) +$I +$N +$I +$I +$I +$I +$N$"
+	# numeric (0 or >0 or <0), queue >= 0, latency (usec) >= 0.
+	L1="^nid +refs +state +last +max +rtr +min +tx +min +queue +latency$"
+	BR="^$NID +$P +(up|down|NA) +$I +$N +$I +$I +$I +$I +$N +$N$"
 	create_lnet_proc_files "peers"
 	check_lnet_proc_entry "peers.sys" "lnet.peers" "$BR" "$L1"
 	remove_lnet_proc_files "peers"
@@ -12699,17 +12841,56 @@ test_215() { # for bugs 18102, 21079, 21517
 	check_lnet_proc_entry "buffers.sys" "lnet.buffers" "$BR" "$L1"
 	remove_lnet_proc_files "buffers"
 
+	# lnet.buffers_history should look like this:
+	# cpt pages history
+	# where cpt, pages >= 0 and history is a list of count/min pairs
+	L1="^cpt +pages +history$"
+	BR="^$N +$N( +$N/$I)*$"
+	create_lnet_proc_files "buffers_history"
+	check_lnet_proc_entry "buffers_history.sys" "lnet.buffers_history" \
+		"$BR" "$L1"
+	remove_lnet_proc_files "buffers_history"
+
 	# lnet.nis should look like this:
-	# nid status alive refs peer rtr max tx min
+	# nid status alive refs peer rtr max tx min health
 	# where nid is a string like 192.168.1.1@tcp2, status is up/down,
 	# alive is numeric (0 or >0 or <0), refs >= 0, peer >= 0,
-	# rtr >= 0, max >=0, tx and min are numeric (0 or >0 or <0).
-	L1="^nid +status +alive +refs +peer +rtr +max +tx +min$"
-	BR="^$NID +(up|down) +$I +$N +$N +$N +$N +$I +$I$"
+	# rtr >= 0, max >=0, tx and min are numeric (0 or >0 or <0),
+	# health >= 0.
+	L1="^nid +status +alive +refs +peer +rtr +max +tx +min +health$"
+	BR="^$NID +(up|down) +$I +$N +$N +$N +$N +$I +$I +$N$"
 	create_lnet_proc_files "nis"
 	check_lnet_proc_entry "nis.sys" "lnet.nis" "$BR" "$L1"
 	remove_lnet_proc_files "nis"
 
+	# lnet.path_cache should look like this:
+	# hits: 1234 misses: 56
+	lctl get_param -n path_cache | grep -Eq "^hits: $N misses: $N$" ||
+		error "lnet.path_cache has unexpected content"
+
+	# lnet.portal_match should look like this:
+	# matches: 1234 scanned: 2345 avg_scan: 1.90 masks_off: 0
+	lctl get_param -n portal_match | grep -Eq \
+		"^matches: $N scanned: $N avg_scan: $N\.[0-9]{2} masks_off: $N$" ||
+		error "lnet.portal_match has unexpected content"
+
+	# socklnd_busy_poll is only present with ksocklnd loaded, and has
+	# one line per scheduler thread under this header
+	if lctl list_param socklnd_busy_poll > /dev/null 2>&1; then
+		lctl get_param -n socklnd_busy_poll | head -n 1 |
+			grep -Eq "^cpt +sched +polls +hits +spin_us +wakes +wake_ns +saved_us$" ||
+			error "socklnd_busy_poll has unexpected content"
+	fi
+
+	# "lnetctl stats stream --all" prints a line for every NI, at least
+	# 0@lo, with 15 message counts, 4 credit values, 2 queue lengths and
+	# the health of the NI
+	if which lnetctl > /dev/null 2>&1; then
+		lnetctl stats stream --count 1 --all |
+			grep -Eq "^[0-9.]+ ni 0@lo( $N){15}( $I){4}( $N){3}$" ||
+			error "lnetctl stats stream has unexpected content"
+	fi
+
 	# can we successfully write to lnet.stats?
 	lctl set_param -n stats=0 || error "cannot write to lnet.stats"
 }
@@ -13789,6 +13970,110 @@ test_231b() {
 }
 run_test 231b "must not assert on fully utilized OST request buffer"
 
+test_231c() {
+	local osc=$(get_osc_import_name client ost1)
+	local nfiles=200
+	local src=$TMP/$tfile.src
+	local max_objs
+	local rpcs
+	local i
+
+	$LCTL get_param -n osc.$osc.connect_flags | grep -q multiobj_brw ||
+		{ skip "OST does not support multi-object writes"; return 0; }
+
+	dd if=/dev/urandom of=$src bs=4k count=$nfiles 2>/dev/null ||
+		error "dd $src failed"
+
+	max_objs=$($LCTL get_param -n osc.$osc.max_objs_per_rpc)
+	$LCTL set_param osc.$osc.max_objs_per_rpc=16
+
+	test_mkdir $DIR/$tdir
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir
+	$LCTL set_param osc.$osc.osc_stats=0
+
+	for ((i = 0; i < nfiles; i++)); do
+		dd if=$src of=$DIR/$tdir/$tfile.$i bs=4k skip=$i count=1 \
+			2>/dev/null || error "dd $tfile.$i failed"
+	done
+	sync
+
+	$LCTL get_param osc.$osc.osc_stats
+	rpcs=$($LCTL get_param -n osc.$osc.osc_stats |
+		awk '/multiobj_write_rpcs/ { print $2 }')
+	$LCTL set_param osc.$osc.max_objs_per_rpc=$max_objs
+	[ ${rpcs:-0} -gt 0 ] || error "no multi-object write RPCs were sent"
+
+	# the write reply refreshes blocks of every packed object while the
+	# client still holds its lock
+	for ((i = 0; i < nfiles; i++)); do
+		[ $(stat -c %b $DIR/$tdir/$tfile.$i) -gt 0 ] ||
+			error "$tfile.$i has no blocks"
+	done
+
+	cancel_lru_locks osc
+	echo 3 > /proc/sys/vm/drop_caches
+	for ((i = 0; i < nfiles; i++)); do
+		[ $(stat -c %s $DIR/$tdir/$tfile.$i) -eq 4096 ] ||
+			error "$tfile.$i has wrong size"
+		cmp -s <(dd if=$src bs=4k skip=$i count=1 2>/dev/null) \
+			$DIR/$tdir/$tfile.$i || error "$tfile.$i data mismatch"
+	done
+	rm -f $src
+}
+run_test 231c "small files are packed into multi-object write RPCs"
+
+test_231d() {
+	local osc=$(get_osc_import_name client ost1)
+	local psz=$(getconf PAGE_SIZE)
+	local nfiles=32
+	local max_objs
+	local in_flight
+	local mppr
+	local pid
+	local i
+
+	$LCTL get_param -n osc.$osc.connect_flags | grep -q multiobj_brw ||
+		{ skip "OST does not support multi-object writes"; return 0; }
+
+	mppr=$($LCTL get_param -n osc.$osc.max_pages_per_rpc)
+	max_objs=$($LCTL get_param -n osc.$osc.max_objs_per_rpc)
+	in_flight=$($LCTL get_param -n osc.$osc.max_rpcs_in_flight)
+	$LCTL set_param osc.$osc.max_objs_per_rpc=16
+	# keep objects queued on the ready list behind the RPC in flight
+	$LCTL set_param osc.$osc.max_rpcs_in_flight=1
+
+	test_mkdir $DIR/$tdir
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir
+
+	# extents of 2 and mppr - 1 pages never fit into one RPC together
+	for ((i = 0; i < nfiles; i++)); do
+		dd if=/dev/zero of=$DIR/$tdir/$tfile.$i bs=$psz \
+			count=$((i % 2 ? mppr - 1 : 2)) 2>/dev/null ||
+			error "dd $tfile.$i failed"
+	done
+
+	sync &
+	pid=$!
+	for ((i = 0; i < 60; i++)); do
+		kill -0 $pid 2>/dev/null || break
+		sleep 1
+	done
+	$LCTL set_param osc.$osc.max_rpcs_in_flight=$in_flight
+	$LCTL set_param osc.$osc.max_objs_per_rpc=$max_objs
+	if kill -0 $pid 2>/dev/null; then
+		error "sync did not complete in 60s"
+	fi
+	wait $pid || error "sync failed"
+
+	cancel_lru_locks osc
+	for ((i = 0; i < nfiles; i++)); do
+		[ $(stat -c %s $DIR/$tdir/$tfile.$i) -eq \
+		  $(((i % 2 ? mppr - 1 : 2) * psz)) ] ||
+			error "$tfile.$i has wrong size"
+	done
+}
+run_test 231d "objects whose extents do not fit are skipped by packing"
+
 test_232() {
 	mkdir -p $DIR/$tdir
 	#define OBD_FAIL_LDLM_OST_LVB		 0x31c
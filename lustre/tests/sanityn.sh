@@ -3565,6 +3565,252 @@ test_77l() {
 }
 run_test 77l "check NRS Delay slows write RPC processing"
 
+test_77m() {
+	[ $(lustre_version_code ost1) -lt $(version_code 2.10.54) ] &&
+		skip "Need OST version at least 2.10.54" && return
+
+	local nodes=$(comma_list $(osts_nodes))
+
+	do_nodes $nodes lctl set_param ost.OSS.ost_io.nrs_policies=edf ||
+		error "Failed to set EDF policy"
+
+	do_nodes $nodes lctl set_param \
+		ost.OSS.ost_io.nrs_edf_weights="ost_write=200 ost_read=50" ||
+		{ do_nodes $nodes lctl set_param \
+			ost.OSS.ost_io.nrs_policies="fifo";
+		  error "Failed to set EDF weights"; }
+
+	do_facet ost1 lctl get_param -n ost.OSS.ost_io.nrs_edf_weights |
+		grep -q "^reg_edf_weights:.* ost_write=200" ||
+		{ do_nodes $nodes lctl set_param \
+			ost.OSS.ost_io.nrs_policies="fifo";
+		  error "ost_write weight not set"; }
+
+	do_facet ost1 lctl set_param \
+		ost.OSS.ost_io.nrs_edf_weights="ost_write=0" &&
+		{ do_nodes $nodes lctl set_param \
+			ost.OSS.ost_io.nrs_policies="fifo";
+		  error "weight 0 should be rejected"; }
+
+	echo "policy: edf, ost_write=200 ost_read=50"
+	nrs_write_read
+
+	do_nodes $nodes lctl set_param \
+		ost.OSS.ost_io.nrs_edf_weights="ost_write=100 ost_read=100"
+
+	echo "policy: edf, default weights"
+	nrs_write_read
+
+	do_nodes $nodes lctl set_param ost.OSS.ost_io.nrs_policies="fifo"
+	[ $? -ne 0 ] && error "failed to set policy back to fifo"
+
+	return 0
+}
+run_test 77m "check NRS EDF policy"
+
+test_77n() {
+	[ $(lustre_version_code ost1) -lt $(version_code 2.10.54) ] &&
+		skip "Need OST version at least 2.10.54" && return
+
+	local dir=$DIR/$tdir
+	local nodes=$(comma_list $(osts_nodes))
+
+	do_nodes $nodes lctl set_param jobid_var=procname_uid \
+		ost.OSS.ost_io.nrs_policies="tbf" ||
+		error "failed to set TBF policy"
+
+	tbf_rule_operate ost1 "start\ proj\ opcode={ost_write}\ rate=1000"
+	tbf_rule_operate ost1 "start\ job\ jobid={dd.$RUNAS_ID}\&opcode={ost_write}\ rate=1\ parent=proj"
+
+	do_facet ost1 lctl set_param ost.OSS.ost_io.nrs_tbf_rule="stop\ proj" &&
+		error "parent rule should not stop while it has children"
+
+	mkdir $dir || error "mkdir $dir failed"
+	$LFS setstripe -c 1 -i 0 $dir || error "setstripe to $dir failed"
+	chmod 777 $dir
+
+	# the job is limited to 1 RPC/s on its own, but can borrow from proj
+	local start=$SECONDS
+	do_node ${CLIENT1:-$(hostname)} $RUNAS dd if=/dev/zero \
+		of=$dir/tbf bs=1M count=20 oflag=direct ||
+		error "dd failed"
+	echo "20 writes took $((SECONDS - start)) s"
+
+	local borrowed=$(do_facet ost1 lctl get_param -n \
+			 ost.OSS.ost_io.nrs_tbf_rule |
+			 awk '/^job / { getline; sum += $NF } END { print sum + 0 }')
+	echo "requests borrowed by job: $borrowed"
+	[ $borrowed -gt 0 ] || error "job did not borrow from its parent rule"
+
+	tbf_rule_operate ost1 "stop\ job"
+	tbf_rule_operate ost1 "stop\ proj"
+	do_nodes $nodes lctl set_param ost.OSS.ost_io.nrs_policies="fifo" ||
+		error "failed to set policy back to fifo"
+
+	rm -rf $dir
+	# wait for the TBF policy to stop completely
+	sleep 3
+}
+run_test 77n "check hierarchical TBF rules borrow from parent"
+
+test_77o() {
+	[ $(lustre_version_code ost1) -lt $(version_code 2.10.54) ] &&
+		skip "Need OST version at least 2.10.54" && return
+
+	local nodes=$(comma_list $(osts_nodes))
+	local param=/sys/module/ptlrpc/parameters/tbf_timer_wheel
+	local old=$(do_facet ost1 cat $param)
+
+	# the scheduler is picked when the policy starts
+	do_nodes $nodes "echo 1 > $param" ||
+		error "failed to enable the TBF timer wheel"
+	do_nodes $nodes lctl set_param jobid_var=procname_uid \
+		ost.OSS.ost_io.nrs_policies="tbf\ jobid" ||
+		error "failed to set TBF policy"
+
+	tbf_rule_operate ost1 "start\ dd_runas\ jobid={dd.$RUNAS_ID}\ rate=50"
+	nrs_write_read "$RUNAS"
+
+	local stats=$(do_facet ost1 lctl get_param -n \
+		      ost.OSS.ost_io.nrs_tbf_stats)
+	echo "$stats"
+	echo "$stats" | grep -q "scheduler: wheel" ||
+		error "TBF is not using the timer wheel"
+	local dequeues=$(echo "$stats" |
+			 awk '/dequeues:/ { sum += $2 } END { print sum + 0 }')
+	[ $dequeues -gt 0 ] || error "no request dequeued from the timer wheel"
+
+	tbf_rule_operate ost1 "stop\ dd_runas"
+	do_nodes $nodes lctl set_param ost.OSS.ost_io.nrs_policies="fifo" ||
+		error "failed to set policy back to fifo"
+	do_nodes $nodes "echo $old > $param"
+
+	# wait for the TBF policy to stop completely
+	sleep 3
+}
+run_test 77o "check TBF policy scheduled with a timer wheel"
+
+test_77p() {
+	[ $(lustre_version_code ost1) -lt $(version_code 2.10.54) ] &&
+		skip "Need OST version at least 2.10.54" && return
+
+	local oss=$(comma_list $(osts_nodes))
+
+	# a quantum of 1 spreads the writes to a file over many rounds, which
+	# coalescing pulls back together
+	do_nodes $oss lctl set_param ost.OSS.ost_io.nrs_policies="orr" \
+		ost.OSS.*.nrs_orr_quantum=1 \
+		ost.OSS.*.nrs_orr_offset_type="logical" \
+		ost.OSS.*.nrs_orr_supported="reads_and_writes" \
+		ost.OSS.*.nrs_orr_coalesce=16 ||
+		error "failed to set ORR policy"
+
+	do_facet ost1 lctl get_param -n ost.OSS.ost_io.nrs_orr_coalesce |
+		grep -q "reg_coalesce:16" || error "coalesce limit not set"
+	do_facet ost1 lctl set_param ost.OSS.ost_io.nrs_orr_coalesce=1000 &&
+		error "coalesce limit above maximum should fail"
+
+	do_facet ost1 lctl set_param -n debug=+rpctrace
+	do_facet ost1 lctl clear
+	nrs_write_read
+
+	local coalesced=$(do_facet ost1 lctl get_param -n \
+			  ost.OSS.ost_io.nrs_orr_coalesce |
+			  awk -F: '/^reg_coalesced:/ { print $2 }')
+	echo "requests coalesced: $coalesced"
+	[ -n "$coalesced" ] || error "no coalescing statistics"
+
+	# each coalesced request is for the object of the request it
+	# follows, and starts right after it:
+	# "NRS: orr coalesced FID start-end after FID start-end"
+	local log=$TMP/sanityn-77p.log
+	do_facet ost1 lctl dk > $log
+	do_facet ost1 lctl set_param -n debug=-rpctrace
+	awk '/NRS: orr coalesced / {
+		sub(/.*NRS: orr coalesced /, "")
+		split($2, cur, "-")
+		split($5, prev, "-")
+		n++
+		if ($1 != $4 || cur[1] != prev[2] + 1) {
+			print "bad run: " $0
+			bad++
+		}
+	     }
+	     END { print n + 0 " coalesced requests logged"; exit bad > 0 }' \
+		$log || error "coalesced requests not contiguous on one object"
+	[ $coalesced -eq 0 ] || grep -q "NRS: orr coalesced " $log ||
+		error "$coalesced requests coalesced, none logged"
+	rm -f $log
+
+	do_nodes $oss lctl set_param ost.OSS.*.nrs_orr_coalesce=0 \
+		ost.OSS.ost_io.nrs_policies="fifo" ||
+		error "failed to set policy back to fifo"
+}
+run_test 77p "check ORR coalescing of adjacent requests"
+
+test_77q() {
+	[ $(lustre_version_code ost1) -lt $(version_code 2.10.54) ] &&
+		skip "Need OST version at least 2.10.54" && return
+
+	local dir=$DIR/$tdir
+	local client1=${CLIENT1:-$(hostname)}
+	local nodes=$(comma_list $(osts_nodes))
+	local np=$(check_cpt_number ost1)
+	local saved_jobid_var=$($LCTL get_param -n jobid_var)
+
+	[ $np -gt 0 ] || error "CPU partitions should not be $np."
+	if [ $saved_jobid_var != procname_uid ]; then
+		set_conf_param_and_check client			\
+			"$LCTL get_param -n jobid_var"		\
+			"$FSNAME.sys.jobid_var" procname_uid
+	fi
+
+	do_nodes $nodes lctl set_param ost.OSS.ost_io.nrs_policies="tbf" ||
+		error "failed to set TBF policy"
+
+	# the children may go 40 RPC/s together, their parent only 10
+	tbf_rule_operate ost1 "start\ proj\ opcode={ost_write}\ rate=10"
+	tbf_rule_operate ost1 "start\ job_runas\ jobid={dd.$RUNAS_ID}\&opcode={ost_write}\ rate=20\ parent=proj"
+	tbf_rule_operate ost1 "start\ job_root\ jobid={dd.0}\&opcode={ost_write}\ rate=20\ parent=proj"
+
+	mkdir $dir || error "mkdir $dir failed"
+	$LFS setstripe -c 1 -i 0 $dir || error "setstripe to $dir failed"
+	chmod 777 $dir
+
+	local start=$SECONDS
+	do_node $client1 $RUNAS dd if=/dev/zero of=$dir/runas \
+		bs=1M count=50 oflag=direct &
+	local pid=$!
+	do_node $client1 dd if=/dev/zero of=$dir/root \
+		bs=1M count=50 oflag=direct || error "dd as root failed"
+	wait $pid || error "dd as $RUNAS_ID failed"
+	local runtime=$((SECONDS - start + 1))
+	local rate=$(bc <<< "scale=6; 100 / $runtime")
+	echo "100 writes of both jobs took $runtime s, $rate IOPS"
+
+	do_facet ost1 lctl get_param -n ost.OSS.ost_io.nrs_tbf_rule
+
+	# the subtree is capped by the parent rate, not the sum of the children
+	[ $(bc <<< "$rate < 1.1 * $np * 10") -eq 1 ] ||
+		error "The write rate ($rate) exceeds 110% of the parent rate (10 * $np)"
+
+	tbf_rule_operate ost1 "stop\ job_runas"
+	tbf_rule_operate ost1 "stop\ job_root"
+	tbf_rule_operate ost1 "stop\ proj"
+	do_nodes $nodes lctl set_param ost.OSS.ost_io.nrs_policies="fifo" ||
+		error "failed to set policy back to fifo"
+
+	rm -rf $dir
+	if [ $saved_jobid_var != procname_uid ]; then
+		set_conf_param_and_check client			\
+			"$LCTL get_param -n jobid_var"		\
+			"$FSNAME.sys.jobid_var" $saved_jobid_var
+	fi
+	# wait for the TBF policy to stop completely
+	sleep 3
+}
+run_test 77q "check hierarchical TBF children do not exceed the parent rate"
+
 test_78() { #LU-6673
 	local server_version=$(lustre_version_code ost1)
 	[[ $server_version -ge $(version_code 2.7.58) ]] ||
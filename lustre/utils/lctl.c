@@ -116,7 +116,8 @@ command_t cmdlist[] = {
 	 "		      <<-r | --rate DROP_RATE> |\n"
 	 "		       <-i | --interval SECONDS>>\n"
 	 "		      [<-p | --portal> PORTAL...]\n"
-	 "		      [<-m | --message> <PUT|ACK|GET|REPLY>...]\n"},
+	 "		      [<-m | --message> <PUT|ACK|GET|REPLY>...]\n"
+	 "		      [<-e | --error> ERRNO]\n"},
 	{"net_drop_del", jt_ptl_drop_del, 0, "remove LNet drop rule\n"
 	 "usage: net_drop_del <[-a | --all] |\n"
 	 "		      <-s | --source NID>\n"
@@ -130,7 +131,11 @@ command_t cmdlist[] = {
 	 "		       <-d | --dest NID>\n"
 	 "		       <<-r | --rate DROP_RATE> |\n"
 	 "			<-i | --interval SECONDS>>\n"
-	 "		       <-l | --latency SECONDS>\n"
+	 "		       <-l | --latency SECONDS[ms]>\n"
+	 "		       [<-j | --jitter MS>\n"
+	 "			[<-J | --jitter_dist> <uniform|normal>]]\n"
+	 "		       [<-b | --bandwidth KBYTES/S[KMG]>\n"
+	 "			[<-u | --burst KBYTES[KMG]>]]\n"
 	 "		       [<-p | --portal> PORTAL...]\n"
 	 "		       [<-m | --message> <PUT|ACK|GET|REPLY>...]\n"},
 	{"net_delay_del", jt_ptl_delay_del, 0, "remove LNet delay rule\n"
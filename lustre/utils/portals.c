@@ -1314,6 +1314,36 @@ fault_attr_ptl_parse(char *ptl_str, __u64 *mask_p)
 	return 0;
 }
 
+/* parse a size in KiB, with an optional K, M or G suffix */
+static int
+fault_attr_kb_parse(char *str, __u32 *kb_p)
+{
+	char			*end;
+	unsigned long long	 kb = strtoull(str, &end, 0);
+
+	switch (*end) {
+	case 'g': case 'G':
+		kb <<= 10;
+		/* fallthrough */
+	case 'm': case 'M':
+		kb <<= 10;
+		/* fallthrough */
+	case 'k': case 'K':
+		end++;
+		/* fallthrough */
+	default:
+		break;
+	}
+
+	if (*end != '\0' || kb == 0 || kb > UINT_MAX) {
+		fprintf(stderr, "invalid size: %s\n", str);
+		return -1;
+	}
+
+	*kb_p = kb;
+	return 0;
+}
+
 static int
 fault_simul_rule_add(__u32 opc, char *name, int argc, char **argv)
 {
@@ -1330,6 +1360,11 @@ fault_simul_rule_add(__u32 opc, char *name, int argc, char **argv)
 	{ .name = "latency",  .has_arg = required_argument, .val = 'l' },
 	{ .name = "portal",   .has_arg = required_argument, .val = 'p' },
 	{ .name = "message",  .has_arg = required_argument, .val = 'm' },
+	{ .name = "jitter",   .has_arg = required_argument, .val = 'j' },
+	{ .name = "jitter_dist", .has_arg = required_argument, .val = 'J' },
+	{ .name = "bandwidth", .has_arg = required_argument, .val = 'b' },
+	{ .name = "burst",    .has_arg = required_argument, .val = 'u' },
+	{ .name = "error",    .has_arg = required_argument, .val = 'e' },
 	{ .name = NULL } };
 
 	if (argc == 1) {
@@ -1338,7 +1373,8 @@ fault_simul_rule_add(__u32 opc, char *name, int argc, char **argv)
 		return -1;
 	}
 
-	optstr = opc == LNET_CTL_DROP_ADD ? "s:d:r:i:p:m:" : "s:d:r:l:p:m:";
+	optstr = opc == LNET_CTL_DROP_ADD ? "s:d:r:i:p:m:e:" :
+					    "s:d:r:i:l:p:m:j:J:b:u:";
 	memset(&attr, 0, sizeof(attr));
 	while (1) {
 		char c = getopt_long(argc, argv, optstr, opts, NULL);
@@ -1375,8 +1411,74 @@ fault_simul_rule_add(__u32 opc, char *name, int argc, char **argv)
 								   NULL, 0);
 			break;
 
-		case 'l': /* seconds to wait before activating rule */
-			attr.u.delay.la_latency = strtoul(optarg, NULL, 0);
+		case 'l': { /* seconds (or "ms" suffixed) to delay */
+			char *end;
+
+			if (opc != LNET_CTL_DELAY_ADD)
+				goto getopt_unrecognized;
+
+			attr.u.delay.la_latency = strtoul(optarg, &end, 0);
+			if (strcasecmp(end, "ms") == 0) {
+				attr.u.delay.la_latency_ms =
+					attr.u.delay.la_latency % 1000;
+				attr.u.delay.la_latency /= 1000;
+			} else if (*end != '\0') {
+				fprintf(stderr, "invalid latency: %s\n",
+					optarg);
+				goto getopt_failed;
+			}
+			break;
+		}
+
+		case 'j': /* milliseconds of latency jitter */
+			if (opc != LNET_CTL_DELAY_ADD)
+				goto getopt_unrecognized;
+
+			attr.u.delay.la_jitter = strtoul(optarg, NULL, 0);
+			break;
+
+		case 'J': /* distribution of jitter */
+			if (opc != LNET_CTL_DELAY_ADD)
+				goto getopt_unrecognized;
+
+			if (strcasecmp(optarg, "uniform") == 0) {
+				attr.u.delay.la_jitter_dist =
+					LNET_JITTER_UNIFORM;
+			} else if (strcasecmp(optarg, "normal") == 0) {
+				attr.u.delay.la_jitter_dist =
+					LNET_JITTER_NORMAL;
+			} else {
+				fprintf(stderr, "unknown jitter distribution "
+					"%s\n", optarg);
+				goto getopt_failed;
+			}
+			break;
+
+		case 'b': /* bandwidth cap in KiB/s */
+			if (opc != LNET_CTL_DELAY_ADD)
+				goto getopt_unrecognized;
+
+			rc = fault_attr_kb_parse(optarg,
+						 &attr.u.delay.la_bandwidth);
+			if (rc != 0)
+				goto getopt_failed;
+			break;
+
+		case 'u': /* token bucket depth in KiB */
+			if (opc != LNET_CTL_DELAY_ADD)
+				goto getopt_unrecognized;
+
+			rc = fault_attr_kb_parse(optarg,
+						 &attr.u.delay.la_burst);
+			if (rc != 0)
+				goto getopt_failed;
+			break;
+
+		case 'e': /* errno to fail matched sends with */
+			if (opc != LNET_CTL_DROP_ADD)
+				goto getopt_unrecognized;
+
+			attr.u.drop.da_error = strtoul(optarg, NULL, 0);
 			break;
 
 		case 'p': /* portal to filter */
@@ -1392,6 +1494,7 @@ fault_simul_rule_add(__u32 opc, char *name, int argc, char **argv)
 			break;
 
 		default:
+getopt_unrecognized:
 			fprintf(stderr, "error: %s: option '%s' "
 				"unrecognized\n", argv[0], argv[optind - 1]);
 			goto getopt_failed;
@@ -1417,10 +1520,19 @@ fault_simul_rule_add(__u32 opc, char *name, int argc, char **argv)
 			return -1;
 		}
 
-		if (attr.u.delay.la_latency == 0) {
+		if (attr.u.delay.la_latency == 0 &&
+		    attr.u.delay.la_latency_ms == 0 &&
+		    attr.u.delay.la_jitter == 0 &&
+		    attr.u.delay.la_bandwidth == 0) {
 			fprintf(stderr, "latency cannot be zero\n");
 			return -1;
 		}
+
+		if (attr.u.delay.la_jitter > LNET_JITTER_MAX) {
+			fprintf(stderr, "jitter cannot exceed %d ms\n",
+				LNET_JITTER_MAX);
+			return -1;
+		}
 	}
 
 	if (attr.fa_src == 0 || attr.fa_dst == 0) {
@@ -1622,7 +1734,7 @@ fault_simul_rule_list(__u32 opc, char *name, int argc, char **argv)
 		if (opc == LNET_CTL_DROP_LIST) {
 			printf("%s->%s (1/%d | %d) ptl %#jx, msg %x, "
 			       "%ju/%ju, PUT %ju, ACK %ju, GET "
-			       "%ju, REP %ju\n",
+			       "%ju, REP %ju, error %u\n",
 			       libcfs_nid2str(attr.fa_src),
 			       libcfs_nid2str(attr.fa_dst),
 			       attr.u.drop.da_rate, attr.u.drop.da_interval,
@@ -1632,19 +1744,28 @@ fault_simul_rule_list(__u32 opc, char *name, int argc, char **argv)
 			       (uintmax_t)stat.fs_put,
 			       (uintmax_t)stat.fs_ack,
 			       (uintmax_t)stat.fs_get,
-			       (uintmax_t)stat.fs_reply);
+			       (uintmax_t)stat.fs_reply,
+			       attr.u.drop.da_error);
 
 		} else if (opc == LNET_CTL_DELAY_LIST) {
-			printf("%s->%s (1/%d | %d, latency %d) ptl %#jx"
-			       ", msg %x, %ju/%ju, PUT %ju"
+			printf("%s->%s (1/%d | %d, latency %d.%03ds, "
+			       "jitter %ums %s, bw %uKiB/s burst %uKiB) "
+			       "ptl %#jx, msg %x, %ju/%ju, shaped %ju, PUT %ju"
 			       ", ACK %ju, GET %ju, REP %ju\n",
 			       libcfs_nid2str(attr.fa_src),
 			       libcfs_nid2str(attr.fa_dst),
 			       attr.u.delay.la_rate, attr.u.delay.la_interval,
 			       attr.u.delay.la_latency,
+			       attr.u.delay.la_latency_ms,
+			       attr.u.delay.la_jitter,
+			       attr.u.delay.la_jitter_dist ==
+			       LNET_JITTER_NORMAL ? "normal" : "uniform",
+			       attr.u.delay.la_bandwidth,
+			       attr.u.delay.la_burst,
 			       (uintmax_t)attr.fa_ptl_mask, attr.fa_msg_mask,
 			       (uintmax_t)stat.u.delay.ls_delayed,
 			       (uintmax_t)stat.fs_count,
+			       (uintmax_t)stat.u.delay.ls_shaped,
 			       (uintmax_t)stat.fs_put,
 			       (uintmax_t)stat.fs_ack,
 			       (uintmax_t)stat.fs_get,
@@ -595,6 +595,7 @@ check_obd_connect_data(void)
 	CHECK_DEFINE_64X(OBD_CONNECT_FLAGS2);
 	CHECK_DEFINE_64X(OBD_CONNECT2_FILE_SECCTX);
 	CHECK_DEFINE_64X(OBD_CONNECT2_LOCKAHEAD);
+	CHECK_DEFINE_64X(OBD_CONNECT2_MULTIOBJ_BRW);
 
 	CHECK_VALUE_X(OBD_CKSUM_CRC32);
 	CHECK_VALUE_X(OBD_CKSUM_ADLER);
@@ -718,6 +719,7 @@ check_obdo(void)
 	CHECK_CVALUE_X(OBD_FL_NOSPC_BLK);
 	CHECK_CVALUE_X(OBD_FL_FLUSH);
 	CHECK_CVALUE_X(OBD_FL_SHORT_IO);
+	CHECK_CVALUE_X(OBD_FL_GRANT_HINT);
 }
 
 static void